@@ -0,0 +1,225 @@
+//
+//  MMSnapAppearanceCoalescer.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapAppearanceCoalescer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const void *key;
+    bool visible;
+    bool appeared;
+    double changeTime;
+} MMSnapAppearanceEntry;
+
+struct MMSnapAppearanceCoalescer {
+    double threshold;
+    
+    // Pages that are visible or have appeared, in the order they started being tracked.
+    MMSnapAppearanceEntry *entries;
+    long count;
+    long capacity;
+    
+    MMSnapAppearanceCoalescerStatistics statistics;
+};
+
+MMSnapAppearanceCoalescerRef MMSnapAppearanceCoalescerCreate(double threshold)
+{
+    MMSnapAppearanceCoalescerRef coalescer = calloc(1, sizeof(struct MMSnapAppearanceCoalescer));
+    if (coalescer) {
+        coalescer->threshold = threshold;
+    }
+    return coalescer;
+}
+
+void MMSnapAppearanceCoalescerRelease(MMSnapAppearanceCoalescerRef coalescer)
+{
+    if (coalescer) {
+        free(coalescer->entries);
+        free(coalescer);
+    }
+}
+
+void MMSnapAppearanceCoalescerSetThreshold(MMSnapAppearanceCoalescerRef coalescer, double threshold)
+{
+    coalescer->threshold = threshold;
+}
+
+// Entries.
+
+static long MMSnapAppearanceCoalescerFindEntry(MMSnapAppearanceCoalescerRef coalescer, const void *key)
+{
+    for (long idx = 0; idx < coalescer->count; idx++) {
+        if (coalescer->entries[idx].key == key) {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+static void MMSnapAppearanceCoalescerRemoveEntry(MMSnapAppearanceCoalescerRef coalescer, long idx)
+{
+    memmove(&coalescer->entries[idx], &coalescer->entries[idx + 1], (size_t)(coalescer->count - idx - 1) * sizeof(MMSnapAppearanceEntry));
+    coalescer->count--;
+}
+
+static inline bool MMSnapAppearanceEntryIsPending(const MMSnapAppearanceEntry *entry)
+{
+    return entry->visible != entry->appeared;
+}
+
+bool MMSnapAppearanceCoalescerSetVisible(MMSnapAppearanceCoalescerRef coalescer, const void *key, bool visible, double time)
+{
+    const long idx = MMSnapAppearanceCoalescerFindEntry(coalescer, key);
+    
+    if (idx < 0) {
+        // Pages that never appeared and aren't visible aren't tracked.
+        if (!visible) {
+            return true;
+        }
+        
+        if (coalescer->count == coalescer->capacity) {
+            const long capacity = (coalescer->capacity > 0) ? coalescer->capacity * 2 : 8;
+            
+            MMSnapAppearanceEntry *entries = realloc(coalescer->entries, (size_t)capacity * sizeof(MMSnapAppearanceEntry));
+            if (!entries) {
+                return false;
+            }
+            
+            coalescer->entries = entries;
+            coalescer->capacity = capacity;
+        }
+        
+        coalescer->entries[coalescer->count++] = (MMSnapAppearanceEntry){ key, true, false, time };
+        coalescer->statistics.changeCount++;
+        return true;
+    }
+    
+    MMSnapAppearanceEntry *entry = &coalescer->entries[idx];
+    if (entry->visible == visible) {
+        return true;
+    }
+    
+    entry->visible = visible;
+    entry->changeTime = time;
+    coalescer->statistics.changeCount++;
+    
+    // The change undoes the one waiting to be delivered.
+    if (!MMSnapAppearanceEntryIsPending(entry)) {
+        coalescer->statistics.droppedCount++;
+        
+        if (!entry->visible) {
+            MMSnapAppearanceCoalescerRemoveEntry(coalescer, idx);
+        }
+    }
+    
+    return true;
+}
+
+bool MMSnapAppearanceCoalescerIsAppeared(MMSnapAppearanceCoalescerRef coalescer, const void *key)
+{
+    const long idx = MMSnapAppearanceCoalescerFindEntry(coalescer, key);
+    return (idx >= 0) && coalescer->entries[idx].appeared;
+}
+
+bool MMSnapAppearanceCoalescerRemoveKey(MMSnapAppearanceCoalescerRef coalescer, const void *key)
+{
+    const long idx = MMSnapAppearanceCoalescerFindEntry(coalescer, key);
+    if (idx < 0) {
+        return false;
+    }
+    
+    const bool appeared = coalescer->entries[idx].appeared;
+    MMSnapAppearanceCoalescerRemoveEntry(coalescer, idx);
+    
+    return appeared;
+}
+
+// Delivery.
+
+long MMSnapAppearanceCoalescerGetPendingCount(MMSnapAppearanceCoalescerRef coalescer)
+{
+    long pendingCount = 0;
+    for (long idx = 0; idx < coalescer->count; idx++) {
+        pendingCount += MMSnapAppearanceEntryIsPending(&coalescer->entries[idx]) ? 1 : 0;
+    }
+    return pendingCount;
+}
+
+bool MMSnapAppearanceCoalescerGetNextDeadline(MMSnapAppearanceCoalescerRef coalescer, double *time)
+{
+    bool found = false;
+    double deadline = 0.0;
+    
+    for (long idx = 0; idx < coalescer->count; idx++) {
+        const MMSnapAppearanceEntry *entry = &coalescer->entries[idx];
+        if (!MMSnapAppearanceEntryIsPending(entry)) {
+            continue;
+        }
+        
+        const double entryDeadline = entry->changeTime + coalescer->threshold;
+        if (!found || entryDeadline < deadline) {
+            deadline = entryDeadline;
+            found = true;
+        }
+    }
+    
+    if (found && time) {
+        *time = deadline;
+    }
+    return found;
+}
+
+long MMSnapAppearanceCoalescerFlush(MMSnapAppearanceCoalescerRef coalescer, double time, bool settled, MMSnapAppearanceEvent *events, long capacity)
+{
+    long eventCount = 0;
+    
+    // Disappearances first, so a page is never told it appears while the one it replaces still is.
+    for (int pass = 0; pass < 2; pass++) {
+        const bool appearing = (pass == 1);
+        
+        for (long idx = 0; idx < coalescer->count && eventCount < capacity; idx++) {
+            MMSnapAppearanceEntry *entry = &coalescer->entries[idx];
+            if (!MMSnapAppearanceEntryIsPending(entry) || entry->visible != appearing) {
+                continue;
+            }
+            if (!settled && time - entry->changeTime < coalescer->threshold) {
+                continue;
+            }
+            
+            entry->appeared = appearing;
+            events[eventCount++] = (MMSnapAppearanceEvent){ entry->key, appearing };
+        }
+    }
+    
+    // Pages that disappeared are no longer tracked.
+    long count = 0;
+    for (long idx = 0; idx < coalescer->count; idx++) {
+        const MMSnapAppearanceEntry *entry = &coalescer->entries[idx];
+        if (entry->visible || entry->appeared) {
+            coalescer->entries[count++] = *entry;
+        }
+    }
+    coalescer->count = count;
+    
+    coalescer->statistics.deliveredCount += (unsigned long)eventCount;
+    
+    return eventCount;
+}
+
+// Statistics.
+
+MMSnapAppearanceCoalescerStatistics MMSnapAppearanceCoalescerGetStatistics(MMSnapAppearanceCoalescerRef coalescer)
+{
+    return coalescer->statistics;
+}
+
+void MMSnapAppearanceCoalescerResetStatistics(MMSnapAppearanceCoalescerRef coalescer)
+{
+    coalescer->statistics = (MMSnapAppearanceCoalescerStatistics){ 0, 0, 0 };
+}
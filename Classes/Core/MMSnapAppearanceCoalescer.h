@@ -0,0 +1,141 @@
+//
+//  MMSnapAppearanceCoalescer.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapAppearanceCoalescer_h
+#define MMSnapAppearanceCoalescer_h
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  Defers the appearance transitions of pages until their visibility has been stable for a while or the scrolling has
+ *  settled, dropping the ones that were undone in the meantime.
+ *
+ *  @note Pages are identified by an opaque key, usually their view controller. A page scrolled across during a fling
+ *  becomes visible and invisible again before it's ever delivered, so it doesn't appear at all. Only the keys that are
+ *  visible or waiting for a transition are tracked, a handful while scrolling, so every operation is linear in their
+ *  number. Times are in seconds, from any monotonic clock.
+ */
+typedef struct MMSnapAppearanceCoalescer *MMSnapAppearanceCoalescerRef;
+
+/**
+ *  An appearance transition to deliver.
+ */
+typedef struct {
+    /**
+     *  The key of the page.
+     */
+    const void *key;
+    /**
+     *  @c true if the page appears, @c false if it disappears.
+     */
+    bool appearing;
+} MMSnapAppearanceEvent;
+
+/**
+ *  Counters of a coalescer.
+ */
+typedef struct {
+    /**
+     *  The number of visibility changes recorded.
+     */
+    unsigned long changeCount;
+    /**
+     *  The number of transitions delivered.
+     */
+    unsigned long deliveredCount;
+    /**
+     *  The number of transitions dropped because the visibility was restored before they were delivered.
+     */
+    unsigned long droppedCount;
+} MMSnapAppearanceCoalescerStatistics;
+
+/**
+ *  Returns a new coalescer, or @c NULL if there was a problem allocating it.
+ *
+ *  @param threshold The time a visibility change must last to be delivered before the scrolling settles.
+ */
+MMSnapAppearanceCoalescerRef MMSnapAppearanceCoalescerCreate(double threshold);
+
+/**
+ *  Frees a coalescer. Passing @c NULL is allowed.
+ */
+void MMSnapAppearanceCoalescerRelease(MMSnapAppearanceCoalescerRef coalescer);
+
+/**
+ *  Sets the time a visibility change must last to be delivered before the scrolling settles.
+ */
+void MMSnapAppearanceCoalescerSetThreshold(MMSnapAppearanceCoalescerRef coalescer, double threshold);
+
+/**
+ *  Records the visibility of a page.
+ *
+ *  @param coalescer The coalescer.
+ *  @param key       The key of the page. Cannot be @c NULL.
+ *  @param visible   @c true if the page became visible, @c false if it's no longer visible.
+ *  @param time      The time of the change.
+ *
+ *  @return @c false if the storage could not be grown, in which case the change is ignored.
+ */
+bool MMSnapAppearanceCoalescerSetVisible(MMSnapAppearanceCoalescerRef coalescer, const void *key, bool visible, double time);
+
+/**
+ *  Returns @c true if the last transition delivered for a page made it appear.
+ */
+bool MMSnapAppearanceCoalescerIsAppeared(MMSnapAppearanceCoalescerRef coalescer, const void *key);
+
+/**
+ *  Stops tracking a page, typically removed from the pages, without delivering its pending transition.
+ *
+ *  @return @c true if the page had appeared.
+ */
+bool MMSnapAppearanceCoalescerRemoveKey(MMSnapAppearanceCoalescerRef coalescer, const void *key);
+
+/**
+ *  Returns the number of pages waiting for a transition, which is enough capacity for the next flush.
+ */
+long MMSnapAppearanceCoalescerGetPendingCount(MMSnapAppearanceCoalescerRef coalescer);
+
+/**
+ *  Returns the earliest time at which a pending transition can be delivered without the scrolling settling.
+ *
+ *  @return @c false if no transition is pending.
+ */
+bool MMSnapAppearanceCoalescerGetNextDeadline(MMSnapAppearanceCoalescerRef coalescer, double *time);
+
+/**
+ *  Copies the transitions due and marks them as delivered.
+ *
+ *  @param coalescer The coalescer.
+ *  @param time      The current time.
+ *  @param settled   @c true if the scrolling has settled, so every pending transition is due.
+ *  @param events    A buffer receiving the transitions, disappearances first, each group in the order the pages started
+ *                   being tracked.
+ *  @param capacity  The capacity of the buffer. Transitions that don't fit stay pending.
+ *
+ *  @return The number of copied transitions.
+ */
+long MMSnapAppearanceCoalescerFlush(MMSnapAppearanceCoalescerRef coalescer, double time, bool settled, MMSnapAppearanceEvent *events, long capacity);
+
+/**
+ *  Returns the counters of a coalescer.
+ */
+MMSnapAppearanceCoalescerStatistics MMSnapAppearanceCoalescerGetStatistics(MMSnapAppearanceCoalescerRef coalescer);
+
+/**
+ *  Resets the counters of a coalescer.
+ */
+void MMSnapAppearanceCoalescerResetStatistics(MMSnapAppearanceCoalescerRef coalescer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapAppearanceCoalescer_h */
@@ -0,0 +1,257 @@
+//
+//  MMSnapAsyncLayout.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapAsyncLayout.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+typedef struct {
+    double *widths;
+    long capacity;
+    long count;
+    unsigned long generation;
+} MMSnapAsyncLayoutBuffer;
+
+struct MMSnapAsyncLayout {
+    pthread_mutex_t mutex;
+    pthread_cond_t backBufferReleased;
+    long retainCount;
+    
+    unsigned long generation;
+    
+    // The front buffer holds the last published widths, the back buffer is written by at most one worker at a time.
+    MMSnapAsyncLayoutBuffer front;
+    MMSnapAsyncLayoutBuffer back;
+    bool frontPublished;
+    bool backAcquired;
+    
+    MMSnapAsyncLayoutStatistics statistics;
+};
+
+MMSnapAsyncLayoutRef MMSnapAsyncLayoutCreate(void)
+{
+    MMSnapAsyncLayoutRef asyncLayout = calloc(1, sizeof(struct MMSnapAsyncLayout));
+    if (!asyncLayout) {
+        return NULL;
+    }
+    
+    if (pthread_mutex_init(&asyncLayout->mutex, NULL) != 0) {
+        free(asyncLayout);
+        return NULL;
+    }
+    if (pthread_cond_init(&asyncLayout->backBufferReleased, NULL) != 0) {
+        pthread_mutex_destroy(&asyncLayout->mutex);
+        free(asyncLayout);
+        return NULL;
+    }
+    
+    asyncLayout->retainCount = 1;
+    
+    return asyncLayout;
+}
+
+MMSnapAsyncLayoutRef MMSnapAsyncLayoutRetain(MMSnapAsyncLayoutRef asyncLayout)
+{
+    pthread_mutex_lock(&asyncLayout->mutex);
+    asyncLayout->retainCount++;
+    pthread_mutex_unlock(&asyncLayout->mutex);
+    
+    return asyncLayout;
+}
+
+void MMSnapAsyncLayoutRelease(MMSnapAsyncLayoutRef asyncLayout)
+{
+    if (!asyncLayout) {
+        return;
+    }
+    
+    pthread_mutex_lock(&asyncLayout->mutex);
+    const long retainCount = --asyncLayout->retainCount;
+    pthread_mutex_unlock(&asyncLayout->mutex);
+    
+    if (retainCount == 0) {
+        pthread_cond_destroy(&asyncLayout->backBufferReleased);
+        pthread_mutex_destroy(&asyncLayout->mutex);
+        free(asyncLayout->front.widths);
+        free(asyncLayout->back.widths);
+        free(asyncLayout);
+    }
+}
+
+// Generations.
+
+unsigned long MMSnapAsyncLayoutInvalidate(MMSnapAsyncLayoutRef asyncLayout)
+{
+    pthread_mutex_lock(&asyncLayout->mutex);
+    const unsigned long generation = ++asyncLayout->generation;
+    asyncLayout->statistics.generationCount++;
+    
+    // Workers waiting for the back buffer on behalf of a previous generation give up.
+    pthread_cond_broadcast(&asyncLayout->backBufferReleased);
+    pthread_mutex_unlock(&asyncLayout->mutex);
+    
+    return generation;
+}
+
+unsigned long MMSnapAsyncLayoutGetGeneration(MMSnapAsyncLayoutRef asyncLayout)
+{
+    pthread_mutex_lock(&asyncLayout->mutex);
+    const unsigned long generation = asyncLayout->generation;
+    pthread_mutex_unlock(&asyncLayout->mutex);
+    
+    return generation;
+}
+
+bool MMSnapAsyncLayoutIsCurrent(MMSnapAsyncLayoutRef asyncLayout, unsigned long generation)
+{
+    return MMSnapAsyncLayoutGetGeneration(asyncLayout) == generation;
+}
+
+// Buffers.
+
+static bool MMSnapAsyncLayoutBufferReserve(MMSnapAsyncLayoutBuffer *buffer, long count)
+{
+    if (count <= buffer->capacity) {
+        return true;
+    }
+    
+    long capacity = buffer->capacity > 0 ? buffer->capacity : 16;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    
+    double *widths = realloc(buffer->widths, (size_t)capacity * sizeof(double));
+    if (!widths) {
+        return false;
+    }
+    
+    buffer->widths = widths;
+    buffer->capacity = capacity;
+    return true;
+}
+
+double *MMSnapAsyncLayoutBeginWriting(MMSnapAsyncLayoutRef asyncLayout, unsigned long generation, long count)
+{
+    pthread_mutex_lock(&asyncLayout->mutex);
+    
+    while (asyncLayout->backAcquired && asyncLayout->generation == generation) {
+        pthread_cond_wait(&asyncLayout->backBufferReleased, &asyncLayout->mutex);
+    }
+    
+    double *widths = NULL;
+    
+    if (asyncLayout->generation == generation && !asyncLayout->backAcquired) {
+        MMSnapAsyncLayoutBuffer *back = &asyncLayout->back;
+        
+        // Keep a valid pointer for empty layouts, so NULL only means failure.
+        if (MMSnapAsyncLayoutBufferReserve(back, (count > 0) ? count : 1)) {
+            back->count = (count > 0) ? count : 0;
+            back->generation = generation;
+            asyncLayout->backAcquired = true;
+            
+            widths = back->widths;
+        }
+    }
+    
+    pthread_mutex_unlock(&asyncLayout->mutex);
+    
+    return widths;
+}
+
+bool MMSnapAsyncLayoutEndWriting(MMSnapAsyncLayoutRef asyncLayout, unsigned long generation)
+{
+    pthread_mutex_lock(&asyncLayout->mutex);
+    
+    bool published = false;
+    
+    if (asyncLayout->backAcquired && asyncLayout->back.generation == generation) {
+        if (asyncLayout->generation == generation) {
+            const MMSnapAsyncLayoutBuffer front = asyncLayout->front;
+            asyncLayout->front = asyncLayout->back;
+            asyncLayout->back = front;
+            asyncLayout->frontPublished = true;
+            asyncLayout->statistics.publishedCount++;
+            
+            published = true;
+        } else {
+            asyncLayout->statistics.discardedCount++;
+        }
+        
+        asyncLayout->backAcquired = false;
+        pthread_cond_broadcast(&asyncLayout->backBufferReleased);
+    }
+    
+    pthread_mutex_unlock(&asyncLayout->mutex);
+    
+    return published;
+}
+
+static long MMSnapAsyncLayoutApplyPages(MMSnapAsyncLayoutRef asyncLayout, unsigned long generation, MMSnapPageIndexRef pageIndex, long count, bool exactCount)
+{
+    pthread_mutex_lock(&asyncLayout->mutex);
+    
+    const MMSnapAsyncLayoutBuffer *front = &asyncLayout->front;
+    long changeCount = -1;
+    
+    if (asyncLayout->frontPublished && front->generation == generation && asyncLayout->generation == generation) {
+        const long pageCount = MMSnapPageIndexGetCount(pageIndex);
+        const bool countMatches = exactCount ? (front->count == pageCount) : (count >= 0 && count <= front->count && count <= pageCount);
+        
+        if (countMatches) {
+            changeCount = 0;
+            
+            for (long page = 0; page < count; page++) {
+                const double width = (front->widths[page] > 0.0) ? front->widths[page] : 0.0;
+                
+                if (width != MMSnapPageIndexGetWidth(pageIndex, page)) {
+                    MMSnapPageIndexSetWidth(pageIndex, page, width);
+                    changeCount++;
+                }
+            }
+            
+            asyncLayout->statistics.appliedCount++;
+        } else {
+            asyncLayout->statistics.discardedCount++;
+        }
+        
+        // A result is applied once.
+        asyncLayout->frontPublished = false;
+    }
+    
+    pthread_mutex_unlock(&asyncLayout->mutex);
+    
+    return changeCount;
+}
+
+long MMSnapAsyncLayoutApply(MMSnapAsyncLayoutRef asyncLayout, unsigned long generation, MMSnapPageIndexRef pageIndex)
+{
+    return MMSnapAsyncLayoutApplyPages(asyncLayout, generation, pageIndex, MMSnapPageIndexGetCount(pageIndex), true);
+}
+
+long MMSnapAsyncLayoutApplyLeadingPages(MMSnapAsyncLayoutRef asyncLayout, unsigned long generation, MMSnapPageIndexRef pageIndex, long count)
+{
+    return MMSnapAsyncLayoutApplyPages(asyncLayout, generation, pageIndex, count, false);
+}
+
+// Statistics.
+
+MMSnapAsyncLayoutStatistics MMSnapAsyncLayoutGetStatistics(MMSnapAsyncLayoutRef asyncLayout)
+{
+    pthread_mutex_lock(&asyncLayout->mutex);
+    const MMSnapAsyncLayoutStatistics statistics = asyncLayout->statistics;
+    pthread_mutex_unlock(&asyncLayout->mutex);
+    
+    return statistics;
+}
+
+void MMSnapAsyncLayoutResetStatistics(MMSnapAsyncLayoutRef asyncLayout)
+{
+    pthread_mutex_lock(&asyncLayout->mutex);
+    asyncLayout->statistics = (MMSnapAsyncLayoutStatistics){ 0, 0, 0, 0 };
+    pthread_mutex_unlock(&asyncLayout->mutex);
+}
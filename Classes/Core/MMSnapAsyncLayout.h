@@ -0,0 +1,153 @@
+//
+//  MMSnapAsyncLayout.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapAsyncLayout_h
+#define MMSnapAsyncLayout_h
+
+#include "MMSnapPageIndex.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  Hands the page widths computed on a background thread over to the thread that owns the page index, discarding the
+ *  results that were computed for a layout that changed in the meantime.
+ *
+ *  @note Every invalidation starts a new generation. A worker writes the widths of a generation into a back buffer, which
+ *  is swapped with the front buffer only if the generation is still current once it's done. The owner then copies the
+ *  front buffer into its page index, again only if the generation is still current.
+ *
+ *  One worker writes at a time: a worker asking for the back buffer waits for the previous one to be done with it.
+ *  Workers are expected to check @c MMSnapAsyncLayoutIsCurrent while writing, and give up early on stale generations.
+ *
+ *  Every function can be called from any thread.
+ */
+typedef struct MMSnapAsyncLayout *MMSnapAsyncLayoutRef;
+
+/**
+ *  Counters of an asynchronous layout.
+ */
+typedef struct {
+    /**
+     *  The number of generations started.
+     */
+    unsigned long generationCount;
+    /**
+     *  The number of results swapped into the front buffer.
+     */
+    unsigned long publishedCount;
+    /**
+     *  The number of results dropped because their generation was no longer current.
+     */
+    unsigned long discardedCount;
+    /**
+     *  The number of results copied into a page index.
+     */
+    unsigned long appliedCount;
+} MMSnapAsyncLayoutStatistics;
+
+/**
+ *  Returns a new asynchronous layout with a retain count of one, or @c NULL if there was a problem allocating it.
+ */
+MMSnapAsyncLayoutRef MMSnapAsyncLayoutCreate(void);
+
+/**
+ *  Retains an asynchronous layout, typically before handing it over to a worker.
+ *
+ *  @return The asynchronous layout.
+ */
+MMSnapAsyncLayoutRef MMSnapAsyncLayoutRetain(MMSnapAsyncLayoutRef asyncLayout);
+
+/**
+ *  Releases an asynchronous layout, freeing it once it's no longer retained. Passing @c NULL is allowed.
+ */
+void MMSnapAsyncLayoutRelease(MMSnapAsyncLayoutRef asyncLayout);
+
+/**
+ *  Starts a new generation, so the results of every previous generation are discarded.
+ *
+ *  @return The new generation.
+ */
+unsigned long MMSnapAsyncLayoutInvalidate(MMSnapAsyncLayoutRef asyncLayout);
+
+/**
+ *  Returns the current generation.
+ */
+unsigned long MMSnapAsyncLayoutGetGeneration(MMSnapAsyncLayoutRef asyncLayout);
+
+/**
+ *  Returns @c true if the specified generation is the current one.
+ */
+bool MMSnapAsyncLayoutIsCurrent(MMSnapAsyncLayoutRef asyncLayout, unsigned long generation);
+
+/**
+ *  Acquires the back buffer to write the widths of a generation, waiting for the previous worker to release it.
+ *
+ *  @param asyncLayout The asynchronous layout.
+ *  @param generation  The generation the widths are computed for.
+ *  @param count       The number of pages.
+ *
+ *  @return A buffer of @c count widths, or @c NULL if the generation is no longer current or the buffer could not be
+ *  grown. Must be followed by @c MMSnapAsyncLayoutEndWriting unless @c NULL is returned.
+ */
+double *MMSnapAsyncLayoutBeginWriting(MMSnapAsyncLayoutRef asyncLayout, unsigned long generation, long count);
+
+/**
+ *  Releases the back buffer, swapping it with the front buffer if its generation is still current.
+ *
+ *  @param asyncLayout The asynchronous layout.
+ *  @param generation  The generation passed to @c MMSnapAsyncLayoutBeginWriting.
+ *
+ *  @return @c true if the widths were published, @c false if they were discarded.
+ */
+bool MMSnapAsyncLayoutEndWriting(MMSnapAsyncLayoutRef asyncLayout, unsigned long generation);
+
+/**
+ *  Copies the published widths of a generation into a page index.
+ *
+ *  @param asyncLayout The asynchronous layout.
+ *  @param generation  The generation expected to be published.
+ *  @param pageIndex   The page index, owned by the calling thread.
+ *
+ *  @return The number of pages whose width changed, or @c -1 if the generation isn't current, wasn't published, was
+ *  already applied or has a different number of pages than @c pageIndex.
+ *
+ *  @note Only the widths that changed are set, so origins are recomputed from the first of them. Results are expected to
+ *  be applied to a page index without invalidated widths, since those would be measured again anyway.
+ */
+long MMSnapAsyncLayoutApply(MMSnapAsyncLayoutRef asyncLayout, unsigned long generation, MMSnapPageIndexRef pageIndex);
+
+/**
+ *  Copies the published widths of the first pages of a generation into a page index, typically after pages were
+ *  appended to it while the widths were computed.
+ *
+ *  @param asyncLayout The asynchronous layout.
+ *  @param generation  The generation expected to be published.
+ *  @param pageIndex   The page index, owned by the calling thread.
+ *  @param count       The number of leading pages laid out as when the widths were requested.
+ *
+ *  @return The number of pages whose width changed, or @c -1 if the generation isn't current, wasn't published, was
+ *  already applied or has fewer than @c count pages, or if @c pageIndex has fewer than @c count pages.
+ */
+long MMSnapAsyncLayoutApplyLeadingPages(MMSnapAsyncLayoutRef asyncLayout, unsigned long generation, MMSnapPageIndexRef pageIndex, long count);
+
+/**
+ *  Returns the counters of an asynchronous layout.
+ */
+MMSnapAsyncLayoutStatistics MMSnapAsyncLayoutGetStatistics(MMSnapAsyncLayoutRef asyncLayout);
+
+/**
+ *  Resets the counters of an asynchronous layout.
+ */
+void MMSnapAsyncLayoutResetStatistics(MMSnapAsyncLayoutRef asyncLayout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapAsyncLayout_h */
@@ -0,0 +1,93 @@
+//
+//  MMSnapContentWindow.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapContentWindow.h"
+
+#include <math.h>
+
+static inline bool MMSnapContentWindowIsBounded(double contentWidth, double maximumLength, double viewportWidth, double *length)
+{
+    if (maximumLength <= 0.0) {
+        return false;
+    }
+    
+    const double boundedLength = ceil(fmax(maximumLength, viewportWidth * MMSnapContentWindowMinimumViewportCount));
+    if (contentWidth <= boundedLength) {
+        return false;
+    }
+    
+    *length = boundedLength;
+    return true;
+}
+
+static inline MMSnapContentWindow MMSnapContentWindowMakeCenteredOnX(double contentWidth, double length, double centerX)
+{
+    // Whole points only, so moving the window doesn't move the pages by a fraction of a pixel.
+    const double origin = floor(centerX - length / 2.0);
+    
+    return (MMSnapContentWindow){
+        .origin = fmax(fmin(origin, contentWidth - length), 0.0),
+        .length = length
+    };
+}
+
+MMSnapContentWindow MMSnapContentWindowMake(double contentWidth, double maximumLength, double globalOffsetX, double viewportWidth)
+{
+    double length = 0.0;
+    if (!MMSnapContentWindowIsBounded(contentWidth, maximumLength, viewportWidth, &length)) {
+        return (MMSnapContentWindow){ 0.0, fmax(contentWidth, 0.0) };
+    }
+    
+    return MMSnapContentWindowMakeCenteredOnX(contentWidth, length, globalOffsetX + viewportWidth / 2.0);
+}
+
+MMSnapContentWindow MMSnapContentWindowMakeIncludingTarget(double contentWidth, double maximumLength, double globalOffsetX, double globalTargetX, double viewportWidth)
+{
+    double length = 0.0;
+    if (!MMSnapContentWindowIsBounded(contentWidth, maximumLength, viewportWidth, &length)) {
+        return (MMSnapContentWindow){ 0.0, fmax(contentWidth, 0.0) };
+    }
+    
+    const double minX = fmin(globalOffsetX, globalTargetX);
+    const double maxX = fmax(globalOffsetX, globalTargetX) + viewportWidth;
+    
+    // Keep both in the window when they fit, with some room left on each side.
+    if (maxX - minX <= length / 2.0) {
+        return MMSnapContentWindowMakeCenteredOnX(contentWidth, length, (minX + maxX) / 2.0);
+    }
+    
+    return MMSnapContentWindowMakeCenteredOnX(contentWidth, length, globalTargetX + viewportWidth / 2.0);
+}
+
+bool MMSnapContentWindowNeedsRecentering(const MMSnapContentWindow *window, double contentWidth, double maximumLength, double localOffsetX, double viewportWidth)
+{
+    double length = 0.0;
+    if (!MMSnapContentWindowIsBounded(contentWidth, maximumLength, viewportWidth, &length)) {
+        return window->origin != 0.0 || window->length != fmax(contentWidth, 0.0);
+    }
+    
+    if (window->length != length || window->origin + window->length > contentWidth) {
+        return true;
+    }
+    
+    const double margin = length / 4.0;
+    
+    const bool nearsLeadingEdge = (localOffsetX < margin) && (window->origin > 0.0);
+    const bool nearsTrailingEdge = (localOffsetX + viewportWidth > length - margin) && (window->origin + length < contentWidth);
+    
+    return nearsLeadingEdge || nearsTrailingEdge;
+}
+
+double MMSnapContentWindowGetGlobalX(const MMSnapContentWindow *window, double localX)
+{
+    return window->origin + localX;
+}
+
+double MMSnapContentWindowGetLocalX(const MMSnapContentWindow *window, double globalX)
+{
+    return globalX - window->origin;
+}
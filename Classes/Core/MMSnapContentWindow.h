@@ -0,0 +1,100 @@
+//
+//  MMSnapContentWindow.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapContentWindow_h
+#define MMSnapContentWindow_h
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  The part of the global page layout exposed to the scroll view as its content.
+ *
+ *  @note Page origins are kept as global offsets, in double precision, from the first page. A snap scroll view with a
+ *  bounded content width only sees the content between @c origin and @c origin+length, in local coordinates starting at
+ *  zero, so the values handed to UIKit stay small however deep the stack is. The window is moved around the content
+ *  offset as it nears its edges, and the content offset is shifted by the same amount.
+ */
+typedef struct {
+    /**
+     *  The global offset of the local origin. Always a whole number of points, so local coordinates keep their pixel
+     *  alignment.
+     */
+    double origin;
+    /**
+     *  The width of the window, which is the content width seen by the scroll view.
+     */
+    double length;
+} MMSnapContentWindow;
+
+/**
+ *  The minimum width of a bounded window, in widths of the viewport, so a single gesture can't cross it.
+ *
+ *  @note Bounded windows are also rounded up to a whole number of points.
+ */
+#define MMSnapContentWindowMinimumViewportCount 8.0
+
+/**
+ *  Returns a window centered on the viewport.
+ *
+ *  @param contentWidth  The global content width.
+ *  @param maximumLength The maximum width of the window, or zero for no limit.
+ *  @param globalOffsetX The global offset of the viewport.
+ *  @param viewportWidth The width of the viewport.
+ *
+ *  @return A window spanning the whole content if it's no wider than @c maximumLength, otherwise a window of
+ *  @c maximumLength (but at least @c MMSnapContentWindowMinimumViewportCount viewports) centered on the viewport and
+ *  clamped to the content.
+ */
+MMSnapContentWindow MMSnapContentWindowMake(double contentWidth, double maximumLength, double globalOffsetX, double viewportWidth);
+
+/**
+ *  Returns a window containing a target offset, along with the current viewport if they fit together.
+ *
+ *  @param contentWidth  The global content width.
+ *  @param maximumLength The maximum width of the window, or zero for no limit.
+ *  @param globalOffsetX The global offset of the viewport.
+ *  @param globalTargetX The global offset the viewport is about to scroll to.
+ *  @param viewportWidth The width of the viewport.
+ *
+ *  @note Used before scrolling to a far page. When both offsets don't fit in a single window, the window is centered on
+ *  the target and the viewport has to jump to its closest edge first.
+ */
+MMSnapContentWindow MMSnapContentWindowMakeIncludingTarget(double contentWidth, double maximumLength, double globalOffsetX, double globalTargetX, double viewportWidth);
+
+/**
+ *  Returns @c true if a window should be moved around the viewport.
+ *
+ *  @param window        The current window.
+ *  @param contentWidth  The global content width.
+ *  @param maximumLength The maximum width of the window, or zero for no limit.
+ *  @param localOffsetX  The offset of the viewport, in the coordinates of the window.
+ *  @param viewportWidth The width of the viewport.
+ *
+ *  @return @c true if the window doesn't have the expected width for the content, or if the viewport is within a quarter
+ *  of the window of one of its edges, unless that edge is the edge of the content.
+ */
+bool MMSnapContentWindowNeedsRecentering(const MMSnapContentWindow *window, double contentWidth, double maximumLength, double localOffsetX, double viewportWidth);
+
+/**
+ *  Converts an offset in the coordinates of a window to a global offset.
+ */
+double MMSnapContentWindowGetGlobalX(const MMSnapContentWindow *window, double localX);
+
+/**
+ *  Converts a global offset to an offset in the coordinates of a window.
+ */
+double MMSnapContentWindowGetLocalX(const MMSnapContentWindow *window, double globalX);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapContentWindow_h */
@@ -0,0 +1,167 @@
+//
+//  MMSnapDiff.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapDiff.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const void *item;
+    long oldCount;
+    long newCount;
+    long oldIndex;
+} MMSnapDiffEntry;
+
+typedef struct {
+    MMSnapDiffEntry *entries;
+    size_t mask;
+} MMSnapDiffTable;
+
+static inline size_t MMSnapDiffHash(const void *item)
+{
+    // Pointers are aligned, so mix the high bits into the low ones before masking.
+    uint64_t x = (uint64_t)(uintptr_t)item;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (size_t)x;
+}
+
+static long MMSnapDiffTableLookup(MMSnapDiffTable *table, const void *item)
+{
+    size_t slot = MMSnapDiffHash(item) & table->mask;
+    
+    for (;;) {
+        MMSnapDiffEntry *entry = &table->entries[slot];
+        if (entry->item == item) {
+            return (long)slot;
+        }
+        if (entry->item == NULL) {
+            entry->item = item;
+            entry->oldIndex = -1;
+            return (long)slot;
+        }
+        slot = (slot + 1) & table->mask;
+    }
+}
+
+void MMSnapDiffResultFree(MMSnapDiffResult *result)
+{
+    free(result->deletes);
+    free(result->inserts);
+    free(result->moves);
+    memset(result, 0, sizeof(*result));
+}
+
+bool MMSnapDiffCompute(const void *const *oldItems, long oldCount, const void *const *newItems, long newCount, MMSnapDiffResult *result)
+{
+    memset(result, 0, sizeof(*result));
+    
+    size_t capacity = 16;
+    while (capacity < (size_t)(oldCount + newCount) * 2) {
+        capacity *= 2;
+    }
+    
+    MMSnapDiffTable table = { calloc(capacity, sizeof(MMSnapDiffEntry)), capacity - 1 };
+    
+    // Entries of the table while building, matched counterpart indexes (or -1) afterwards.
+    long *oldMatches = malloc((size_t)(oldCount > 0 ? oldCount : 1) * sizeof(long));
+    long *newMatches = malloc((size_t)(newCount > 0 ? newCount : 1) * sizeof(long));
+    long *oldEntries = malloc((size_t)(oldCount > 0 ? oldCount : 1) * sizeof(long));
+    long *newEntries = malloc((size_t)(newCount > 0 ? newCount : 1) * sizeof(long));
+    long *deleteOffsets = malloc((size_t)(oldCount > 0 ? oldCount : 1) * sizeof(long));
+    
+    result->deletes = malloc((size_t)(oldCount > 0 ? oldCount : 1) * sizeof(long));
+    result->inserts = malloc((size_t)(newCount > 0 ? newCount : 1) * sizeof(long));
+    result->moves = malloc((size_t)(newCount > 0 ? newCount : 1) * sizeof(MMSnapDiffMove));
+    
+    bool success = (table.entries && oldMatches && newMatches && oldEntries && newEntries && deleteOffsets &&
+                    result->deletes && result->inserts && result->moves);
+    
+    if (success) {
+        // Pass 1 and 2: count the occurrences of every item in both lists.
+        for (long j = 0; j < newCount; j++) {
+            const long slot = MMSnapDiffTableLookup(&table, newItems[j]);
+            table.entries[slot].newCount++;
+            newEntries[j] = slot;
+            newMatches[j] = -1;
+        }
+        
+        for (long i = 0; i < oldCount; i++) {
+            const long slot = MMSnapDiffTableLookup(&table, oldItems[i]);
+            table.entries[slot].oldCount++;
+            table.entries[slot].oldIndex = i;
+            oldEntries[i] = slot;
+            oldMatches[i] = -1;
+        }
+        
+        // Pass 3: items occurring exactly once in each list are the same item.
+        for (long j = 0; j < newCount; j++) {
+            const MMSnapDiffEntry *entry = &table.entries[newEntries[j]];
+            if (entry->oldCount == 1 && entry->newCount == 1) {
+                newMatches[j] = entry->oldIndex;
+                oldMatches[entry->oldIndex] = j;
+            }
+        }
+        
+        // Pass 4 and 5: extend matches to equal neighbors, forwards and backwards.
+        for (long j = 0; j + 1 < newCount; j++) {
+            const long i = newMatches[j];
+            if (i >= 0 && i + 1 < oldCount && newMatches[j + 1] < 0 && oldMatches[i + 1] < 0 &&
+                newEntries[j + 1] == oldEntries[i + 1]) {
+                newMatches[j + 1] = i + 1;
+                oldMatches[i + 1] = j + 1;
+            }
+        }
+        
+        for (long j = newCount - 1; j > 0; j--) {
+            const long i = newMatches[j];
+            if (i > 0 && newMatches[j - 1] < 0 && oldMatches[i - 1] < 0 &&
+                newEntries[j - 1] == oldEntries[i - 1]) {
+                newMatches[j - 1] = i - 1;
+                oldMatches[i - 1] = j - 1;
+            }
+        }
+        
+        // Pass 6: unmatched old items are deletes, unmatched new items are inserts.
+        long deletes = 0;
+        for (long i = 0; i < oldCount; i++) {
+            deleteOffsets[i] = deletes;
+            if (oldMatches[i] < 0) {
+                result->deletes[deletes++] = i;
+            }
+        }
+        result->deleteCount = deletes;
+        
+        // Matched items that don't land where the inserts and deletes alone would put them are moves.
+        long inserts = 0;
+        for (long j = 0; j < newCount; j++) {
+            const long i = newMatches[j];
+            if (i < 0) {
+                result->inserts[inserts++] = j;
+            } else if (i - deleteOffsets[i] + inserts != j) {
+                result->moves[result->moveCount++] = (MMSnapDiffMove){ i, j };
+            }
+        }
+        result->insertCount = inserts;
+    }
+    
+    free(table.entries);
+    free(oldMatches);
+    free(newMatches);
+    free(oldEntries);
+    free(newEntries);
+    free(deleteOffsets);
+    
+    if (!success) {
+        MMSnapDiffResultFree(result);
+    }
+    
+    return success;
+}
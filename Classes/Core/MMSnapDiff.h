@@ -0,0 +1,65 @@
+//
+//  MMSnapDiff.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapDiff_h
+#define MMSnapDiff_h
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  A page that moved from one location to another.
+ */
+typedef struct {
+    long from;
+    long to;
+} MMSnapDiffMove;
+
+/**
+ *  The changes required to turn an old list of items into a new one.
+ *
+ *  @note Deletes and move sources are expressed in the coordinates of the old list, inserts and move destinations in
+ *  the coordinates of the new list, which is what a batch update expects. Every array is sorted in ascending order.
+ */
+typedef struct {
+    long *deletes;
+    long deleteCount;
+    long *inserts;
+    long insertCount;
+    MMSnapDiffMove *moves;
+    long moveCount;
+} MMSnapDiffResult;
+
+/**
+ *  Computes the difference between two lists of items compared by identity, using Heckel's algorithm.
+ *
+ *  @param oldItems The items before the change.
+ *  @param oldCount The number of items in @c oldItems.
+ *  @param newItems The items after the change.
+ *  @param newCount The number of items in @c newItems.
+ *  @param result   On return, the changes. Must be freed with @c MMSnapDiffResultFree.
+ *
+ *  @return @c false if there was a problem allocating memory, in which case @c result is left empty.
+ *
+ *  @note Runs in O(n + m) time using a hash table. Items that appear once in both lists are matched directly; repeated
+ *  items are matched when their neighbors are. Items must not be @c NULL.
+ */
+bool MMSnapDiffCompute(const void *const *oldItems, long oldCount, const void *const *newItems, long newCount, MMSnapDiffResult *result);
+
+/**
+ *  Frees the storage of a diff result and resets it to an empty result.
+ */
+void MMSnapDiffResultFree(MMSnapDiffResult *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapDiff_h */
@@ -0,0 +1,354 @@
+//
+//  MMSnapEvictionPolicy.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapEvictionPolicy.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct {
+    const void *key;
+    unsigned long long byteCount;
+    long previous;
+    long next;
+} MMSnapEvictionNode;
+
+struct MMSnapEvictionPolicy {
+    MMSnapEvictionBudget budget;
+    
+    // Nodes linked from the most to the least recently used, unused nodes are linked through next.
+    MMSnapEvictionNode *nodes;
+    long nodeCapacity;
+    long mostRecent;
+    long leastRecent;
+    long freeNode;
+    
+    long count;
+    unsigned long long byteCount;
+    
+    // Open addressing table from key to node, -1 marks an empty slot.
+    long *slots;
+    long slotCapacity;
+    
+    unsigned long evictionCount;
+};
+
+static inline size_t MMSnapEvictionPolicyHash(const void *key)
+{
+    // Pointers are aligned, so mix the high bits into the low ones before masking.
+    uint64_t x = (uint64_t)(uintptr_t)key;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (size_t)x;
+}
+
+MMSnapEvictionPolicyRef MMSnapEvictionPolicyCreate(void)
+{
+    MMSnapEvictionPolicyRef policy = calloc(1, sizeof(struct MMSnapEvictionPolicy));
+    if (policy) {
+        policy->mostRecent = -1;
+        policy->leastRecent = -1;
+        policy->freeNode = -1;
+    }
+    return policy;
+}
+
+void MMSnapEvictionPolicyRelease(MMSnapEvictionPolicyRef policy)
+{
+    if (policy) {
+        free(policy->nodes);
+        free(policy->slots);
+        free(policy);
+    }
+}
+
+void MMSnapEvictionPolicySetBudget(MMSnapEvictionPolicyRef policy, MMSnapEvictionBudget budget)
+{
+    policy->budget = budget;
+}
+
+MMSnapEvictionBudget MMSnapEvictionPolicyGetBudget(MMSnapEvictionPolicyRef policy)
+{
+    return policy->budget;
+}
+
+bool MMSnapEvictionPolicyIsLimited(MMSnapEvictionPolicyRef policy)
+{
+    return policy->budget.maximumCount > 0 || policy->budget.maximumByteCount > 0;
+}
+
+// Key table.
+
+static long MMSnapEvictionPolicyFindSlot(MMSnapEvictionPolicyRef policy, const void *key)
+{
+    if (policy->slotCapacity == 0) {
+        return -1;
+    }
+    
+    const long mask = policy->slotCapacity - 1;
+    long slot = (long)(MMSnapEvictionPolicyHash(key) & (size_t)mask);
+    
+    while (policy->slots[slot] >= 0) {
+        if (policy->nodes[policy->slots[slot]].key == key) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+static void MMSnapEvictionPolicyInsertSlot(MMSnapEvictionPolicyRef policy, long *slots, long capacity, long node)
+{
+    const long mask = capacity - 1;
+    long slot = (long)(MMSnapEvictionPolicyHash(policy->nodes[node].key) & (size_t)mask);
+    
+    while (slots[slot] >= 0) {
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = node;
+}
+
+static void MMSnapEvictionPolicyRemoveSlot(MMSnapEvictionPolicyRef policy, long slot)
+{
+    // Shift the following entries of the cluster back, so lookups never need tombstones.
+    const long mask = policy->slotCapacity - 1;
+    long *slots = policy->slots;
+    
+    long next = (slot + 1) & mask;
+    while (slots[next] >= 0) {
+        const long home = (long)(MMSnapEvictionPolicyHash(policy->nodes[slots[next]].key) & (size_t)mask);
+        const bool movable = (slot <= next) ? (home <= slot || home > next) : (home <= slot && home > next);
+        if (movable) {
+            slots[slot] = slots[next];
+            slot = next;
+        }
+        next = (next + 1) & mask;
+    }
+    slots[slot] = -1;
+}
+
+static bool MMSnapEvictionPolicyReserve(MMSnapEvictionPolicyRef policy, long count)
+{
+    // Keep the load of the table under one half.
+    if (count * 2 > policy->slotCapacity) {
+        const long capacity = policy->slotCapacity > 0 ? policy->slotCapacity * 2 : 16;
+        long *slots = malloc((size_t)capacity * sizeof(long));
+        if (!slots) {
+            return false;
+        }
+        for (long idx = 0; idx < capacity; idx++) {
+            slots[idx] = -1;
+        }
+        for (long idx = 0; idx < policy->slotCapacity; idx++) {
+            if (policy->slots[idx] >= 0) {
+                MMSnapEvictionPolicyInsertSlot(policy, slots, capacity, policy->slots[idx]);
+            }
+        }
+        free(policy->slots);
+        policy->slots = slots;
+        policy->slotCapacity = capacity;
+    }
+    
+    if (policy->freeNode < 0 && count > policy->nodeCapacity) {
+        const long capacity = policy->nodeCapacity > 0 ? policy->nodeCapacity * 2 : 8;
+        MMSnapEvictionNode *nodes = realloc(policy->nodes, (size_t)capacity * sizeof(MMSnapEvictionNode));
+        if (!nodes) {
+            return false;
+        }
+        for (long idx = policy->nodeCapacity; idx < capacity; idx++) {
+            nodes[idx].next = (idx + 1 < capacity) ? idx + 1 : -1;
+        }
+        policy->nodes = nodes;
+        policy->freeNode = policy->nodeCapacity;
+        policy->nodeCapacity = capacity;
+    }
+    return true;
+}
+
+// Recency list.
+
+static void MMSnapEvictionPolicyUnlinkNode(MMSnapEvictionPolicyRef policy, long node)
+{
+    MMSnapEvictionNode *nodes = policy->nodes;
+    
+    if (nodes[node].previous >= 0) {
+        nodes[nodes[node].previous].next = nodes[node].next;
+    } else {
+        policy->mostRecent = nodes[node].next;
+    }
+    if (nodes[node].next >= 0) {
+        nodes[nodes[node].next].previous = nodes[node].previous;
+    } else {
+        policy->leastRecent = nodes[node].previous;
+    }
+}
+
+static void MMSnapEvictionPolicyLinkMostRecentNode(MMSnapEvictionPolicyRef policy, long node)
+{
+    MMSnapEvictionNode *nodes = policy->nodes;
+    
+    nodes[node].previous = -1;
+    nodes[node].next = policy->mostRecent;
+    
+    if (policy->mostRecent >= 0) {
+        nodes[policy->mostRecent].previous = node;
+    } else {
+        policy->leastRecent = node;
+    }
+    policy->mostRecent = node;
+}
+
+static void MMSnapEvictionPolicyRemoveNodeAtSlot(MMSnapEvictionPolicyRef policy, long slot)
+{
+    const long node = policy->slots[slot];
+    
+    MMSnapEvictionPolicyRemoveSlot(policy, slot);
+    MMSnapEvictionPolicyUnlinkNode(policy, node);
+    
+    policy->count--;
+    policy->byteCount -= policy->nodes[node].byteCount;
+    
+    policy->nodes[node].key = NULL;
+    policy->nodes[node].next = policy->freeNode;
+    policy->freeNode = node;
+}
+
+bool MMSnapEvictionPolicyUseKey(MMSnapEvictionPolicyRef policy, const void *key, unsigned long long byteCount)
+{
+    if (!key) {
+        return false;
+    }
+    
+    const long slot = MMSnapEvictionPolicyFindSlot(policy, key);
+    if (slot >= 0) {
+        const long node = policy->slots[slot];
+        
+        policy->byteCount = policy->byteCount - policy->nodes[node].byteCount + byteCount;
+        policy->nodes[node].byteCount = byteCount;
+        
+        if (node != policy->mostRecent) {
+            MMSnapEvictionPolicyUnlinkNode(policy, node);
+            MMSnapEvictionPolicyLinkMostRecentNode(policy, node);
+        }
+        return true;
+    }
+    
+    if (!MMSnapEvictionPolicyReserve(policy, policy->count + 1)) {
+        return false;
+    }
+    
+    const long node = policy->freeNode;
+    policy->freeNode = policy->nodes[node].next;
+    policy->nodes[node].key = key;
+    policy->nodes[node].byteCount = byteCount;
+    
+    MMSnapEvictionPolicyLinkMostRecentNode(policy, node);
+    MMSnapEvictionPolicyInsertSlot(policy, policy->slots, policy->slotCapacity, node);
+    
+    policy->count++;
+    policy->byteCount += byteCount;
+    
+    return true;
+}
+
+void MMSnapEvictionPolicyRemoveKey(MMSnapEvictionPolicyRef policy, const void *key)
+{
+    const long slot = MMSnapEvictionPolicyFindSlot(policy, key);
+    if (slot >= 0) {
+        MMSnapEvictionPolicyRemoveNodeAtSlot(policy, slot);
+    }
+}
+
+void MMSnapEvictionPolicyRemoveAllKeys(MMSnapEvictionPolicyRef policy)
+{
+    for (long idx = 0; idx < policy->slotCapacity; idx++) {
+        policy->slots[idx] = -1;
+    }
+    for (long idx = 0; idx < policy->nodeCapacity; idx++) {
+        policy->nodes[idx].key = NULL;
+        policy->nodes[idx].next = (idx + 1 < policy->nodeCapacity) ? idx + 1 : -1;
+    }
+    policy->freeNode = policy->nodeCapacity > 0 ? 0 : -1;
+    policy->mostRecent = -1;
+    policy->leastRecent = -1;
+    policy->count = 0;
+    policy->byteCount = 0;
+}
+
+bool MMSnapEvictionPolicyContainsKey(MMSnapEvictionPolicyRef policy, const void *key)
+{
+    return MMSnapEvictionPolicyFindSlot(policy, key) >= 0;
+}
+
+long MMSnapEvictionPolicyGetCount(MMSnapEvictionPolicyRef policy)
+{
+    return policy->count;
+}
+
+unsigned long long MMSnapEvictionPolicyGetByteCount(MMSnapEvictionPolicyRef policy)
+{
+    return policy->byteCount;
+}
+
+// Eviction.
+
+static inline bool MMSnapEvictionPolicyIsOverBudget(MMSnapEvictionPolicyRef policy)
+{
+    const MMSnapEvictionBudget budget = policy->budget;
+    
+    if (budget.maximumCount > 0 && policy->count > budget.maximumCount) {
+        return true;
+    }
+    if (budget.maximumByteCount > 0 && policy->byteCount > budget.maximumByteCount) {
+        return true;
+    }
+    return false;
+}
+
+static inline long MMSnapEvictionPolicyDistanceToRange(long page, MMSnapPageRange range)
+{
+    if (page < range.location) {
+        return range.location - page;
+    }
+    if (range.length > 0 && page >= range.location + range.length) {
+        return page - (range.location + range.length) + 1;
+    }
+    return (range.length > 0) ? 0 : page - range.location + 1;
+}
+
+long MMSnapEvictionPolicyEvict(MMSnapEvictionPolicyRef policy, MMSnapPageRange visible, MMSnapEvictionPageFunction pageFunction, void *context, bool ignoreBudget, const void **keys, long capacity)
+{
+    long count = 0;
+    long node = policy->leastRecent;
+    
+    while (node >= 0 && count < capacity) {
+        if (!ignoreBudget && !MMSnapEvictionPolicyIsOverBudget(policy)) {
+            break;
+        }
+        
+        const void *key = policy->nodes[node].key;
+        const long previous = policy->nodes[node].previous;
+        const long page = pageFunction(key, context);
+        
+        if (page == MMSnapPageNotFound) {
+            MMSnapEvictionPolicyRemoveNodeAtSlot(policy, MMSnapEvictionPolicyFindSlot(policy, key));
+        } else if (MMSnapEvictionPolicyDistanceToRange(page, visible) > policy->budget.keptDistance) {
+            MMSnapEvictionPolicyRemoveNodeAtSlot(policy, MMSnapEvictionPolicyFindSlot(policy, key));
+            
+            keys[count++] = key;
+            policy->evictionCount++;
+        }
+        node = previous;
+    }
+    return count;
+}
+
+unsigned long MMSnapEvictionPolicyGetEvictionCount(MMSnapEvictionPolicyRef policy)
+{
+    return policy->evictionCount;
+}
@@ -0,0 +1,136 @@
+//
+//  MMSnapEvictionPolicy.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapEvictionPolicy_h
+#define MMSnapEvictionPolicy_h
+
+#include "MMSnapPageIndex.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  Keeps track of the loaded views of a snap controller in least recently used order, and decides which ones to unload
+ *  to stay within a memory budget.
+ *
+ *  @note Views are identified by an opaque key, usually their view controller, since pages change as the stack is
+ *  updated. Using, adding and removing a key cost O(1).
+ */
+typedef struct MMSnapEvictionPolicy *MMSnapEvictionPolicyRef;
+
+/**
+ *  The memory budget of the loaded views.
+ */
+typedef struct {
+    /**
+     *  The maximum number of loaded views, or zero for no limit.
+     */
+    long maximumCount;
+    /**
+     *  The maximum sum of the estimated sizes of the loaded views (in bytes), or zero for no limit.
+     */
+    unsigned long long maximumByteCount;
+    /**
+     *  Views whose pages are this number of pages or closer to the visible pages are never evicted.
+     */
+    long keptDistance;
+} MMSnapEvictionBudget;
+
+/**
+ *  A function returning the current page of a key, or @c MMSnapPageNotFound if the key is no longer part of the pages.
+ */
+typedef long (*MMSnapEvictionPageFunction)(const void *key, void *context);
+
+/**
+ *  Returns a new empty policy without limits, or @c NULL if there was a problem allocating it.
+ */
+MMSnapEvictionPolicyRef MMSnapEvictionPolicyCreate(void);
+
+/**
+ *  Frees a policy. Passing @c NULL is allowed.
+ */
+void MMSnapEvictionPolicyRelease(MMSnapEvictionPolicyRef policy);
+
+/**
+ *  Sets the budget used by the following evictions.
+ */
+void MMSnapEvictionPolicySetBudget(MMSnapEvictionPolicyRef policy, MMSnapEvictionBudget budget);
+
+/**
+ *  Returns the budget of the policy.
+ */
+MMSnapEvictionBudget MMSnapEvictionPolicyGetBudget(MMSnapEvictionPolicyRef policy);
+
+/**
+ *  Returns @c true if the budget limits the number or the size of the loaded views.
+ */
+bool MMSnapEvictionPolicyIsLimited(MMSnapEvictionPolicyRef policy);
+
+/**
+ *  Records a loaded view as the most recently used one.
+ *
+ *  @param policy    The policy.
+ *  @param key       The key identifying the view. Cannot be @c NULL.
+ *  @param byteCount The estimated size of the view, replacing the previous estimate if the key was already recorded.
+ *
+ *  @return @c false if the storage could not be grown.
+ */
+bool MMSnapEvictionPolicyUseKey(MMSnapEvictionPolicyRef policy, const void *key, unsigned long long byteCount);
+
+/**
+ *  Forgets a key, for example after its view was unloaded by someone else or its view controller was removed.
+ */
+void MMSnapEvictionPolicyRemoveKey(MMSnapEvictionPolicyRef policy, const void *key);
+
+/**
+ *  Forgets all the keys.
+ */
+void MMSnapEvictionPolicyRemoveAllKeys(MMSnapEvictionPolicyRef policy);
+
+/**
+ *  Returns @c true if a key is recorded as loaded.
+ */
+bool MMSnapEvictionPolicyContainsKey(MMSnapEvictionPolicyRef policy, const void *key);
+
+/**
+ *  Returns the number of recorded keys.
+ */
+long MMSnapEvictionPolicyGetCount(MMSnapEvictionPolicyRef policy);
+
+/**
+ *  Returns the sum of the estimated sizes of the recorded keys.
+ */
+unsigned long long MMSnapEvictionPolicyGetByteCount(MMSnapEvictionPolicyRef policy);
+
+/**
+ *  Chooses the views to unload, starting from the least recently used one, and forgets them.
+ *
+ *  @param policy       The policy.
+ *  @param visible      The visible pages.
+ *  @param pageFunction The function returning the current page of a key.
+ *  @param context      A pointer passed to @c pageFunction.
+ *  @param ignoreBudget Pass @c true to evict every view farther than the kept distance, for example on a memory warning.
+ *  @param keys         A buffer receiving the evicted keys.
+ *  @param capacity     The capacity of the buffer. Evictions stop when it is full.
+ *
+ *  @return The number of evicted keys.
+ *
+ *  @note Keys that are no longer part of the pages are forgotten without being returned.
+ */
+long MMSnapEvictionPolicyEvict(MMSnapEvictionPolicyRef policy, MMSnapPageRange visible, MMSnapEvictionPageFunction pageFunction, void *context, bool ignoreBudget, const void **keys, long capacity);
+
+/**
+ *  Returns the number of keys evicted since the policy was created.
+ */
+unsigned long MMSnapEvictionPolicyGetEvictionCount(MMSnapEvictionPolicyRef policy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapEvictionPolicy_h */
@@ -0,0 +1,227 @@
+//
+//  MMSnapFrameScheduler.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapFrameScheduler.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+typedef struct {
+    MMSnapFrameSchedulerClient client;
+    // The offset last applied, and the smallest change worth applying.
+    double x;
+    double y;
+    double threshold;
+} MMSnapFrameSchedulerEntry;
+
+struct MMSnapFrameScheduler {
+    MMSnapFrameSchedulerClock clock;
+    bool running;
+    
+    // Clients removed during a tick keep their slot with a NULL info, and are compacted when the tick ends.
+    MMSnapFrameSchedulerEntry *entries;
+    long count;
+    long capacity;
+    long removedCount;
+    bool ticking;
+    
+    MMSnapFrameSchedulerStatistics statistics;
+};
+
+MMSnapFrameSchedulerRef MMSnapFrameSchedulerCreate(MMSnapFrameSchedulerClock clock)
+{
+    MMSnapFrameSchedulerRef scheduler = calloc(1, sizeof(struct MMSnapFrameScheduler));
+    if (!scheduler) {
+        return NULL;
+    }
+    
+    scheduler->clock = clock;
+    return scheduler;
+}
+
+static void MMSnapFrameSchedulerSetRunning(MMSnapFrameSchedulerRef scheduler, bool running)
+{
+    if (scheduler->running == running) {
+        return;
+    }
+    scheduler->running = running;
+    
+    if (running) {
+        scheduler->statistics.startCount++;
+        if (scheduler->clock.start) {
+            scheduler->clock.start(scheduler->clock.info);
+        }
+    } else if (scheduler->clock.stop) {
+        scheduler->clock.stop(scheduler->clock.info);
+    }
+}
+
+void MMSnapFrameSchedulerRelease(MMSnapFrameSchedulerRef scheduler)
+{
+    if (!scheduler) {
+        return;
+    }
+    
+    MMSnapFrameSchedulerSetRunning(scheduler, false);
+    
+    free(scheduler->entries);
+    free(scheduler);
+}
+
+// Clients.
+
+static long MMSnapFrameSchedulerFindClient(MMSnapFrameSchedulerRef scheduler, const void *info)
+{
+    if (!info) {
+        return -1;
+    }
+    
+    for (long idx = 0; idx < scheduler->count; idx++) {
+        if (scheduler->entries[idx].client.info == info) {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+static void MMSnapFrameSchedulerCompact(MMSnapFrameSchedulerRef scheduler)
+{
+    long count = 0;
+    for (long idx = 0; idx < scheduler->count; idx++) {
+        if (scheduler->entries[idx].client.info) {
+            scheduler->entries[count++] = scheduler->entries[idx];
+        }
+    }
+    scheduler->count = count;
+    scheduler->removedCount = 0;
+}
+
+bool MMSnapFrameSchedulerAddClient(MMSnapFrameSchedulerRef scheduler, MMSnapFrameSchedulerClient client, double x, double y, double scale)
+{
+    const MMSnapFrameSchedulerEntry entry = {
+        .client = client,
+        .x = x,
+        .y = y,
+        .threshold = (scale > 0.0) ? 0.5 / scale : 0.5
+    };
+    
+    const long existing = MMSnapFrameSchedulerFindClient(scheduler, client.info);
+    if (existing >= 0) {
+        scheduler->entries[existing] = entry;
+        return true;
+    }
+    
+    if (scheduler->count == scheduler->capacity) {
+        const long capacity = (scheduler->capacity > 0) ? scheduler->capacity * 2 : 4;
+        MMSnapFrameSchedulerEntry *entries = realloc(scheduler->entries, (size_t)capacity * sizeof(MMSnapFrameSchedulerEntry));
+        if (!entries) {
+            return false;
+        }
+        scheduler->entries = entries;
+        scheduler->capacity = capacity;
+    }
+    
+    scheduler->entries[scheduler->count++] = entry;
+    MMSnapFrameSchedulerSetRunning(scheduler, true);
+    return true;
+}
+
+void MMSnapFrameSchedulerRemoveClient(MMSnapFrameSchedulerRef scheduler, const void *info)
+{
+    const long idx = MMSnapFrameSchedulerFindClient(scheduler, info);
+    if (idx < 0) {
+        return;
+    }
+    
+    // Slots can't move while a tick walks them.
+    scheduler->entries[idx].client.info = NULL;
+    scheduler->removedCount++;
+    
+    if (!scheduler->ticking) {
+        MMSnapFrameSchedulerCompact(scheduler);
+    }
+    
+    if (MMSnapFrameSchedulerGetClientCount(scheduler) == 0) {
+        MMSnapFrameSchedulerSetRunning(scheduler, false);
+    }
+}
+
+bool MMSnapFrameSchedulerContainsClient(MMSnapFrameSchedulerRef scheduler, const void *info)
+{
+    return MMSnapFrameSchedulerFindClient(scheduler, info) >= 0;
+}
+
+long MMSnapFrameSchedulerGetClientCount(MMSnapFrameSchedulerRef scheduler)
+{
+    return scheduler->count - scheduler->removedCount;
+}
+
+bool MMSnapFrameSchedulerIsRunning(MMSnapFrameSchedulerRef scheduler)
+{
+    return scheduler->running;
+}
+
+// Ticks.
+
+void MMSnapFrameSchedulerTick(MMSnapFrameSchedulerRef scheduler, double time)
+{
+    if (scheduler->ticking) {
+        return;
+    }
+    
+    scheduler->ticking = true;
+    scheduler->statistics.tickCount++;
+    
+    // Clients added by the callbacks wait for the next tick.
+    const long count = scheduler->count;
+    
+    for (long idx = 0; idx < count; idx++) {
+        // Copied, the storage may be reallocated by the callbacks.
+        const MMSnapFrameSchedulerEntry entry = scheduler->entries[idx];
+        if (!entry.client.info) {
+            continue;
+        }
+        
+        double x = entry.x;
+        double y = entry.y;
+        const bool finished = entry.client.evaluate(entry.client.info, time, &x, &y);
+        
+        if (finished) {
+            // Removed first, so the client can start another animation when applying its last offset.
+            scheduler->entries[idx].client.info = NULL;
+            scheduler->removedCount++;
+        } else if (fabs(x - entry.x) < entry.threshold && fabs(y - entry.y) < entry.threshold) {
+            scheduler->statistics.skipCount++;
+            continue;
+        } else {
+            scheduler->entries[idx].x = x;
+            scheduler->entries[idx].y = y;
+        }
+        
+        scheduler->statistics.applyCount++;
+        entry.client.apply(entry.client.info, x, y, finished);
+    }
+    
+    scheduler->ticking = false;
+    MMSnapFrameSchedulerCompact(scheduler);
+    
+    if (scheduler->count == 0) {
+        MMSnapFrameSchedulerSetRunning(scheduler, false);
+    }
+}
+
+// Statistics.
+
+MMSnapFrameSchedulerStatistics MMSnapFrameSchedulerGetStatistics(MMSnapFrameSchedulerRef scheduler)
+{
+    return scheduler->statistics;
+}
+
+void MMSnapFrameSchedulerResetStatistics(MMSnapFrameSchedulerRef scheduler)
+{
+    scheduler->statistics = (MMSnapFrameSchedulerStatistics){ 0, 0, 0, 0 };
+}
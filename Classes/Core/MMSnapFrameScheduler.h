@@ -0,0 +1,142 @@
+//
+//  MMSnapFrameScheduler.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapFrameScheduler_h
+#define MMSnapFrameScheduler_h
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  Multiplexes the animations of any number of clients over a single clock, such as one display link shared by the
+ *  whole process.
+ *
+ *  @note The clock is started when the first client is added and stopped as soon as the last one finishes or is removed,
+ *  so nothing fires while nothing animates. Each tick evaluates the clients at the time the frame will be displayed and
+ *  only applies the offsets that moved by at least half a pixel since they were last applied. The scheduler is not
+ *  thread-safe, and clients can be added or removed from within the callbacks of a tick.
+ */
+typedef struct MMSnapFrameScheduler *MMSnapFrameSchedulerRef;
+
+/**
+ *  The clock driving a scheduler, which calls @c MMSnapFrameSchedulerTick once per frame while it's started.
+ */
+typedef struct {
+    void (*start)(void *info);
+    void (*stop)(void *info);
+    void *info;
+} MMSnapFrameSchedulerClock;
+
+/**
+ *  An animation driven by a scheduler, identified by its @c info.
+ */
+typedef struct {
+    /**
+     *  Computes the offset of the animation at a time, returning @c true if the animation is finished by then.
+     */
+    bool (*evaluate)(void *info, double time, double *x, double *y);
+    /**
+     *  Applies an offset. Finished animations are removed before their last offset is applied.
+     */
+    void (*apply)(void *info, double x, double y, bool finished);
+    void *info;
+} MMSnapFrameSchedulerClient;
+
+/**
+ *  Counters of a scheduler.
+ */
+typedef struct {
+    /**
+     *  The number of ticks.
+     */
+    unsigned long tickCount;
+    /**
+     *  The number of offsets applied.
+     */
+    unsigned long applyCount;
+    /**
+     *  The number of offsets skipped because they moved by less than half a pixel.
+     */
+    unsigned long skipCount;
+    /**
+     *  The number of times the clock was started.
+     */
+    unsigned long startCount;
+} MMSnapFrameSchedulerStatistics;
+
+/**
+ *  Returns a new scheduler without clients, or @c NULL if there was a problem allocating it.
+ *
+ *  @param clock The clock driving the scheduler, which isn't started until a client is added.
+ */
+MMSnapFrameSchedulerRef MMSnapFrameSchedulerCreate(MMSnapFrameSchedulerClock clock);
+
+/**
+ *  Stops the clock if needed and frees a scheduler. Passing @c NULL is allowed.
+ */
+void MMSnapFrameSchedulerRelease(MMSnapFrameSchedulerRef scheduler);
+
+/**
+ *  Adds a client, starting the clock if it was stopped.
+ *
+ *  @param scheduler The scheduler.
+ *  @param client    The client. A client with the same @c info is replaced, as when an animation is retargeted.
+ *  @param x         The horizontal offset currently displayed.
+ *  @param y         The vertical offset currently displayed.
+ *  @param scale     The number of pixels per point of the display, used to skip offsets moving by less than half a pixel.
+ *
+ *  @return @c false if there was a problem allocating storage for the client.
+ */
+bool MMSnapFrameSchedulerAddClient(MMSnapFrameSchedulerRef scheduler, MMSnapFrameSchedulerClient client, double x, double y, double scale);
+
+/**
+ *  Removes a client without applying anything, stopping the clock if it was the last one.
+ */
+void MMSnapFrameSchedulerRemoveClient(MMSnapFrameSchedulerRef scheduler, const void *info);
+
+/**
+ *  Returns @c true if a client is animating.
+ */
+bool MMSnapFrameSchedulerContainsClient(MMSnapFrameSchedulerRef scheduler, const void *info);
+
+/**
+ *  Returns the number of clients animating.
+ */
+long MMSnapFrameSchedulerGetClientCount(MMSnapFrameSchedulerRef scheduler);
+
+/**
+ *  Returns @c true if the clock is started.
+ */
+bool MMSnapFrameSchedulerIsRunning(MMSnapFrameSchedulerRef scheduler);
+
+/**
+ *  Steps every client to a time, applying the offsets that moved visibly and removing the finished clients.
+ *
+ *  @param scheduler The scheduler.
+ *  @param time      The time the frame will be displayed, such as the target timestamp of a display link, so animations
+ *                   advance by the actual frame duration whatever the refresh rate.
+ */
+void MMSnapFrameSchedulerTick(MMSnapFrameSchedulerRef scheduler, double time);
+
+/**
+ *  Returns the counters of a scheduler.
+ */
+MMSnapFrameSchedulerStatistics MMSnapFrameSchedulerGetStatistics(MMSnapFrameSchedulerRef scheduler);
+
+/**
+ *  Resets the counters of a scheduler.
+ */
+void MMSnapFrameSchedulerResetStatistics(MMSnapFrameSchedulerRef scheduler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapFrameScheduler_h */
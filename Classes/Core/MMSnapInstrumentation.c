@@ -0,0 +1,186 @@
+//
+//  MMSnapInstrumentation.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapInstrumentation.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
+typedef struct {
+    uint64_t count;
+    uint64_t totalNanoseconds;
+    uint64_t maximumNanoseconds;
+    uint64_t buckets[MMSnapInstrumentationBucketCount];
+} MMSnapInstrumentationHistogram;
+
+struct MMSnapInstrumentation {
+    MMSnapInstrumentationHistogram histograms[MMSnapInstrumentationPhaseCount];
+    
+    MMSnapInstrumentationObserver observer;
+    void *observerContext;
+};
+
+// Counters are independent, so relaxed ordering is enough.
+#define MMSnapAtomicLoad(pointer) __atomic_load_n((pointer), __ATOMIC_RELAXED)
+#define MMSnapAtomicStore(pointer, value) __atomic_store_n((pointer), (value), __ATOMIC_RELAXED)
+#define MMSnapAtomicAdd(pointer, value) __atomic_fetch_add((pointer), (value), __ATOMIC_RELAXED)
+
+static inline int MMSnapInstrumentationBucketForNanoseconds(uint64_t nanoseconds)
+{
+    if (nanoseconds < 2) {
+        return 0;
+    }
+    
+    const int bucket = 63 - __builtin_clzll(nanoseconds);
+    return (bucket < MMSnapInstrumentationBucketCount) ? bucket : MMSnapInstrumentationBucketCount - 1;
+}
+
+MMSnapInstrumentationRef MMSnapInstrumentationCreate(void)
+{
+    return calloc(1, sizeof(struct MMSnapInstrumentation));
+}
+
+void MMSnapInstrumentationRelease(MMSnapInstrumentationRef instrumentation)
+{
+    free(instrumentation);
+}
+
+void MMSnapInstrumentationRecord(MMSnapInstrumentationRef instrumentation, MMSnapInstrumentationPhase phase, uint64_t nanoseconds)
+{
+    if (!instrumentation || (unsigned int)phase >= MMSnapInstrumentationPhaseCount) {
+        return;
+    }
+    
+    MMSnapInstrumentationHistogram *histogram = &instrumentation->histograms[phase];
+    
+    MMSnapAtomicAdd(&histogram->buckets[MMSnapInstrumentationBucketForNanoseconds(nanoseconds)], 1);
+    MMSnapAtomicAdd(&histogram->totalNanoseconds, nanoseconds);
+    MMSnapAtomicAdd(&histogram->count, 1);
+    
+    uint64_t maximum = MMSnapAtomicLoad(&histogram->maximumNanoseconds);
+    while (nanoseconds > maximum) {
+        if (__atomic_compare_exchange_n(&histogram->maximumNanoseconds, &maximum, nanoseconds, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    
+    MMSnapInstrumentationObserver observer = instrumentation->observer;
+    if (observer) {
+        observer(phase, nanoseconds, instrumentation->observerContext);
+    }
+}
+
+void MMSnapInstrumentationSetObserver(MMSnapInstrumentationRef instrumentation, MMSnapInstrumentationObserver observer, void *context)
+{
+    instrumentation->observer = observer;
+    instrumentation->observerContext = context;
+}
+
+void MMSnapInstrumentationGetStatistics(MMSnapInstrumentationRef instrumentation, MMSnapInstrumentationPhase phase, MMSnapInstrumentationStatistics *statistics)
+{
+    memset(statistics, 0, sizeof(MMSnapInstrumentationStatistics));
+    
+    if (!instrumentation || (unsigned int)phase >= MMSnapInstrumentationPhaseCount) {
+        return;
+    }
+    
+    MMSnapInstrumentationHistogram *histogram = &instrumentation->histograms[phase];
+    
+    statistics->count = MMSnapAtomicLoad(&histogram->count);
+    statistics->totalNanoseconds = MMSnapAtomicLoad(&histogram->totalNanoseconds);
+    statistics->maximumNanoseconds = MMSnapAtomicLoad(&histogram->maximumNanoseconds);
+    
+    for (int bucket = 0; bucket < MMSnapInstrumentationBucketCount; bucket++) {
+        statistics->buckets[bucket] = MMSnapAtomicLoad(&histogram->buckets[bucket]);
+    }
+}
+
+void MMSnapInstrumentationReset(MMSnapInstrumentationRef instrumentation)
+{
+    for (int phase = 0; phase < MMSnapInstrumentationPhaseCount; phase++) {
+        MMSnapInstrumentationHistogram *histogram = &instrumentation->histograms[phase];
+        
+        MMSnapAtomicStore(&histogram->count, 0);
+        MMSnapAtomicStore(&histogram->totalNanoseconds, 0);
+        MMSnapAtomicStore(&histogram->maximumNanoseconds, 0);
+        
+        for (int bucket = 0; bucket < MMSnapInstrumentationBucketCount; bucket++) {
+            MMSnapAtomicStore(&histogram->buckets[bucket], 0);
+        }
+    }
+}
+
+uint64_t MMSnapInstrumentationStatisticsGetPercentile(const MMSnapInstrumentationStatistics *statistics, double percentile)
+{
+    // Counted from the buckets rather than the count, since they may be read while samples are being recorded.
+    uint64_t count = 0;
+    for (int bucket = 0; bucket < MMSnapInstrumentationBucketCount; bucket++) {
+        count += statistics->buckets[bucket];
+    }
+    
+    if (count == 0) {
+        return 0;
+    }
+    
+    percentile = (percentile < 0.0) ? 0.0 : (percentile > 1.0) ? 1.0 : percentile;
+    
+    const uint64_t rank = (uint64_t)(percentile * (double)(count - 1)) + 1;
+    
+    uint64_t cumulative = 0;
+    for (int bucket = 0; bucket < MMSnapInstrumentationBucketCount; bucket++) {
+        cumulative += statistics->buckets[bucket];
+        if (cumulative >= rank) {
+            const uint64_t upperBound = (bucket == MMSnapInstrumentationBucketCount - 1) ? UINT64_MAX : (2ULL << bucket) - 1;
+            return (upperBound < statistics->maximumNanoseconds) ? upperBound : statistics->maximumNanoseconds;
+        }
+    }
+    
+    return statistics->maximumNanoseconds;
+}
+
+const char *MMSnapInstrumentationGetPhaseName(MMSnapInstrumentationPhase phase)
+{
+    switch (phase) {
+        case MMSnapInstrumentationPhaseLayoutPass:
+            return "layoutPass";
+        case MMSnapInstrumentationPhaseLayoutValidation:
+            return "layoutValidation";
+        case MMSnapInstrumentationPhaseVisibleRange:
+            return "visibleRange";
+        case MMSnapInstrumentationPhaseViewRequest:
+            return "viewRequest";
+        case MMSnapInstrumentationPhaseSeparatorDequeue:
+            return "separatorDequeue";
+        case MMSnapInstrumentationPhaseDisplayCallback:
+            return "displayCallback";
+        case MMSnapInstrumentationPhaseUpdates:
+            return "updates";
+        default:
+            return "unknown";
+    }
+}
+
+uint64_t MMSnapInstrumentationGetTime(void)
+{
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
@@ -0,0 +1,165 @@
+//
+//  MMSnapInstrumentation.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapInstrumentation_h
+#define MMSnapInstrumentation_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  Set to @c 0 to compile out the @c MMSnapInstrumentationBegin and @c MMSnapInstrumentationEnd probes. The functions
+ *  remain available, but nothing is ever recorded by the scroll view.
+ */
+#ifndef MM_SNAP_INSTRUMENTATION
+#define MM_SNAP_INSTRUMENTATION 1
+#endif
+
+/**
+ *  Records the durations of the phases of the layout passes and updates of a snap scroll view into fixed-size histograms.
+ *
+ *  @note Recording doesn't allocate or lock. Each histogram is an array of counters updated with relaxed atomic additions,
+ *  so samples may be recorded from any thread while the statistics are read from another. A read is not a consistent
+ *  snapshot across counters, which is fine for statistics.
+ */
+typedef struct MMSnapInstrumentation *MMSnapInstrumentationRef;
+
+/**
+ *  The instrumented phases.
+ */
+typedef enum {
+    /**
+     *  A whole layout pass, from @c -layoutSubviews.
+     */
+    MMSnapInstrumentationPhaseLayoutPass,
+    /**
+     *  Measuring the invalidated pages and updating the content size.
+     */
+    MMSnapInstrumentationPhaseLayoutValidation,
+    /**
+     *  Computing the range of visible pages.
+     */
+    MMSnapInstrumentationPhaseVisibleRange,
+    /**
+     *  A single view requested from the data source.
+     */
+    MMSnapInstrumentationPhaseViewRequest,
+    /**
+     *  A single separator dequeued or created.
+     */
+    MMSnapInstrumentationPhaseSeparatorDequeue,
+    /**
+     *  A single will display or did end displaying delegate call.
+     */
+    MMSnapInstrumentationPhaseDisplayCallback,
+    /**
+     *  Applying a batch of updates, from @c -performBatchUpdates:completion: or a single insert, delete, move or reload.
+     */
+    MMSnapInstrumentationPhaseUpdates,
+    MMSnapInstrumentationPhaseCount
+} MMSnapInstrumentationPhase;
+
+/**
+ *  The number of buckets of a histogram. Bucket @c i counts the samples between 2^i and 2^(i + 1) nanoseconds, the first
+ *  bucket also counts samples under a nanosecond, and the last one every sample over 2^39 nanoseconds.
+ */
+#define MMSnapInstrumentationBucketCount 40
+
+/**
+ *  The statistics of a phase.
+ */
+typedef struct {
+    uint64_t count;
+    uint64_t totalNanoseconds;
+    uint64_t maximumNanoseconds;
+    uint64_t buckets[MMSnapInstrumentationBucketCount];
+} MMSnapInstrumentationStatistics;
+
+/**
+ *  A function called after a sample is recorded, on the thread that recorded it.
+ */
+typedef void (*MMSnapInstrumentationObserver)(MMSnapInstrumentationPhase phase, uint64_t nanoseconds, void *context);
+
+/**
+ *  Returns new instrumentation without samples, or @c NULL if there was a problem allocating it.
+ */
+MMSnapInstrumentationRef MMSnapInstrumentationCreate(void);
+
+/**
+ *  Frees the instrumentation. Passing @c NULL is allowed.
+ */
+void MMSnapInstrumentationRelease(MMSnapInstrumentationRef instrumentation);
+
+/**
+ *  Records the duration of a phase. Passing @c NULL instrumentation does nothing.
+ */
+void MMSnapInstrumentationRecord(MMSnapInstrumentationRef instrumentation, MMSnapInstrumentationPhase phase, uint64_t nanoseconds);
+
+/**
+ *  Sets the function called after each recorded sample, or @c NULL to stop calling it.
+ *
+ *  @note Set the observer from the thread recording the samples, since the function and its context are not updated
+ *  atomically as a pair.
+ */
+void MMSnapInstrumentationSetObserver(MMSnapInstrumentationRef instrumentation, MMSnapInstrumentationObserver observer, void *context);
+
+/**
+ *  Copies the statistics of a phase.
+ */
+void MMSnapInstrumentationGetStatistics(MMSnapInstrumentationRef instrumentation, MMSnapInstrumentationPhase phase, MMSnapInstrumentationStatistics *statistics);
+
+/**
+ *  Removes the samples of every phase.
+ */
+void MMSnapInstrumentationReset(MMSnapInstrumentationRef instrumentation);
+
+/**
+ *  Returns an estimate of a percentile of the samples.
+ *
+ *  @param statistics The statistics of a phase.
+ *  @param percentile A value between @c 0 and @c 1, for example @c 0.99.
+ *
+ *  @return The upper bound of the bucket containing the percentile, capped to the maximum sample, or zero without samples.
+ */
+uint64_t MMSnapInstrumentationStatisticsGetPercentile(const MMSnapInstrumentationStatistics *statistics, double percentile);
+
+/**
+ *  Returns a short name for a phase, like @c "viewRequest".
+ */
+const char *MMSnapInstrumentationGetPhaseName(MMSnapInstrumentationPhase phase);
+
+/**
+ *  Returns a monotonic time in nanoseconds.
+ */
+uint64_t MMSnapInstrumentationGetTime(void);
+
+/**
+ *  Probes around a phase. @c MMSnapInstrumentationBegin evaluates to a start time, or zero if @c instrumentation is
+ *  @c NULL, so disabled instrumentation costs a single comparison. Both compile to nothing without @c MM_SNAP_INSTRUMENTATION.
+ */
+#if MM_SNAP_INSTRUMENTATION
+#define MMSnapInstrumentationBegin(instrumentation) ((instrumentation) ? MMSnapInstrumentationGetTime() : 0)
+#define MMSnapInstrumentationEnd(instrumentation, phase, startTime) do { \
+    const uint64_t _startTime = (startTime); \
+    if (_startTime != 0 && (instrumentation)) { \
+        MMSnapInstrumentationRecord((instrumentation), (phase), MMSnapInstrumentationGetTime() - _startTime); \
+    } \
+} while (0)
+#else
+#define MMSnapInstrumentationBegin(instrumentation) ((uint64_t)0)
+#define MMSnapInstrumentationEnd(instrumentation, phase, startTime) ((void)(startTime))
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapInstrumentation_h */
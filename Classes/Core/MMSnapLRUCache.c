@@ -0,0 +1,317 @@
+//
+//  MMSnapLRUCache.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapLRUCache.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const void *key;
+    unsigned long hash;
+    long previous;
+    long next;
+} MMSnapLRUCacheNode;
+
+struct MMSnapLRUCache {
+    MMSnapLRUCacheKeyCallbacks callbacks;
+    size_t valueSize;
+    
+    // Nodes linked from the most to the least recently used, unused nodes are linked through next. Values are stored
+    // in a parallel array.
+    MMSnapLRUCacheNode *nodes;
+    unsigned char *values;
+    long capacity;
+    long mostRecent;
+    long leastRecent;
+    long freeNode;
+    long count;
+    
+    // Open addressing table from key to node, -1 marks an empty slot.
+    long *slots;
+    long slotMask;
+    
+    MMSnapLRUCacheStatistics statistics;
+};
+
+static inline unsigned long MMSnapLRUCacheHash(MMSnapLRUCacheRef cache, const void *key)
+{
+    uint64_t x = cache->callbacks.hash ? (uint64_t)cache->callbacks.hash(key) : (uint64_t)(uintptr_t)key;
+    
+    // Mix the high bits into the low ones before masking, since pointers are aligned and hashes may be weak.
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (unsigned long)x;
+}
+
+static inline bool MMSnapLRUCacheKeysEqual(MMSnapLRUCacheRef cache, const void *key, const void *otherKey)
+{
+    return (key == otherKey) || (cache->callbacks.equal && cache->callbacks.equal(key, otherKey));
+}
+
+MMSnapLRUCacheRef MMSnapLRUCacheCreate(const MMSnapLRUCacheKeyCallbacks *callbacks, size_t valueSize, long capacity)
+{
+    if (capacity <= 0) {
+        return NULL;
+    }
+    
+    MMSnapLRUCacheRef cache = calloc(1, sizeof(struct MMSnapLRUCache));
+    if (!cache) {
+        return NULL;
+    }
+    cache->mostRecent = -1;
+    
+    // Keep the load of the table under one half.
+    long slotCapacity = 16;
+    while (slotCapacity < capacity * 2) {
+        slotCapacity *= 2;
+    }
+    
+    cache->nodes = malloc((size_t)capacity * sizeof(MMSnapLRUCacheNode));
+    cache->values = malloc((size_t)capacity * (valueSize > 0 ? valueSize : 1));
+    cache->slots = malloc((size_t)slotCapacity * sizeof(long));
+    
+    if (!cache->nodes || !cache->values || !cache->slots) {
+        MMSnapLRUCacheRelease(cache);
+        return NULL;
+    }
+    
+    if (callbacks) {
+        cache->callbacks = *callbacks;
+    }
+    cache->valueSize = valueSize;
+    cache->capacity = capacity;
+    cache->slotMask = slotCapacity - 1;
+    
+    MMSnapLRUCacheRemoveAllValues(cache);
+    
+    return cache;
+}
+
+void MMSnapLRUCacheRelease(MMSnapLRUCacheRef cache)
+{
+    if (cache) {
+        if (cache->nodes && cache->slots) {
+            MMSnapLRUCacheRemoveAllValues(cache);
+        }
+        free(cache->nodes);
+        free(cache->values);
+        free(cache->slots);
+        free(cache);
+    }
+}
+
+// Key table.
+
+static long MMSnapLRUCacheFindSlot(MMSnapLRUCacheRef cache, const void *key, unsigned long hash)
+{
+    const long mask = cache->slotMask;
+    long slot = (long)(hash & (unsigned long)mask);
+    
+    while (cache->slots[slot] >= 0) {
+        const MMSnapLRUCacheNode *node = &cache->nodes[cache->slots[slot]];
+        if (node->hash == hash && MMSnapLRUCacheKeysEqual(cache, node->key, key)) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+static void MMSnapLRUCacheInsertSlot(MMSnapLRUCacheRef cache, long node)
+{
+    const long mask = cache->slotMask;
+    long slot = (long)(cache->nodes[node].hash & (unsigned long)mask);
+    
+    while (cache->slots[slot] >= 0) {
+        slot = (slot + 1) & mask;
+    }
+    cache->slots[slot] = node;
+}
+
+static void MMSnapLRUCacheRemoveSlot(MMSnapLRUCacheRef cache, long slot)
+{
+    // Shift the following entries of the cluster back, so lookups never need tombstones.
+    const long mask = cache->slotMask;
+    long *slots = cache->slots;
+    
+    long next = (slot + 1) & mask;
+    while (slots[next] >= 0) {
+        const long home = (long)(cache->nodes[slots[next]].hash & (unsigned long)mask);
+        const bool movable = (slot <= next) ? (home <= slot || home > next) : (home <= slot && home > next);
+        if (movable) {
+            slots[slot] = slots[next];
+            slot = next;
+        }
+        next = (next + 1) & mask;
+    }
+    slots[slot] = -1;
+}
+
+// Recency list.
+
+static void MMSnapLRUCacheUnlinkNode(MMSnapLRUCacheRef cache, long node)
+{
+    MMSnapLRUCacheNode *nodes = cache->nodes;
+    
+    if (nodes[node].previous >= 0) {
+        nodes[nodes[node].previous].next = nodes[node].next;
+    } else {
+        cache->mostRecent = nodes[node].next;
+    }
+    if (nodes[node].next >= 0) {
+        nodes[nodes[node].next].previous = nodes[node].previous;
+    } else {
+        cache->leastRecent = nodes[node].previous;
+    }
+}
+
+static void MMSnapLRUCacheLinkMostRecentNode(MMSnapLRUCacheRef cache, long node)
+{
+    MMSnapLRUCacheNode *nodes = cache->nodes;
+    
+    nodes[node].previous = -1;
+    nodes[node].next = cache->mostRecent;
+    
+    if (cache->mostRecent >= 0) {
+        nodes[cache->mostRecent].previous = node;
+    } else {
+        cache->leastRecent = node;
+    }
+    cache->mostRecent = node;
+}
+
+static void MMSnapLRUCacheRemoveNode(MMSnapLRUCacheRef cache, long slot)
+{
+    const long node = cache->slots[slot];
+    const void *key = cache->nodes[node].key;
+    
+    MMSnapLRUCacheRemoveSlot(cache, slot);
+    MMSnapLRUCacheUnlinkNode(cache, node);
+    
+    cache->nodes[node].next = cache->freeNode;
+    cache->freeNode = node;
+    cache->count--;
+    
+    if (cache->callbacks.release) {
+        cache->callbacks.release(key);
+    }
+}
+
+static inline unsigned char *MMSnapLRUCacheValueAtNode(MMSnapLRUCacheRef cache, long node)
+{
+    return cache->values + (size_t)node * cache->valueSize;
+}
+
+// Values.
+
+bool MMSnapLRUCacheGetValue(MMSnapLRUCacheRef cache, const void *key, void *value)
+{
+    const long slot = MMSnapLRUCacheFindSlot(cache, key, MMSnapLRUCacheHash(cache, key));
+    if (slot < 0) {
+        cache->statistics.missCount++;
+        return false;
+    }
+    
+    const long node = cache->slots[slot];
+    if (node != cache->mostRecent) {
+        MMSnapLRUCacheUnlinkNode(cache, node);
+        MMSnapLRUCacheLinkMostRecentNode(cache, node);
+    }
+    
+    if (value) {
+        memcpy(value, MMSnapLRUCacheValueAtNode(cache, node), cache->valueSize);
+    }
+    
+    cache->statistics.hitCount++;
+    return true;
+}
+
+void MMSnapLRUCacheSetValue(MMSnapLRUCacheRef cache, const void *key, const void *value)
+{
+    const unsigned long hash = MMSnapLRUCacheHash(cache, key);
+    const long slot = MMSnapLRUCacheFindSlot(cache, key, hash);
+    
+    long node;
+    if (slot >= 0) {
+        node = cache->slots[slot];
+        MMSnapLRUCacheUnlinkNode(cache, node);
+    } else {
+        if (cache->count == cache->capacity) {
+            const long leastRecent = cache->leastRecent;
+            MMSnapLRUCacheRemoveNode(cache, MMSnapLRUCacheFindSlot(cache, cache->nodes[leastRecent].key, cache->nodes[leastRecent].hash));
+            cache->statistics.evictionCount++;
+        }
+        
+        node = cache->freeNode;
+        cache->freeNode = cache->nodes[node].next;
+        cache->count++;
+        
+        cache->nodes[node].key = cache->callbacks.retain ? cache->callbacks.retain(key) : key;
+        cache->nodes[node].hash = hash;
+        
+        MMSnapLRUCacheInsertSlot(cache, node);
+    }
+    
+    MMSnapLRUCacheLinkMostRecentNode(cache, node);
+    memcpy(MMSnapLRUCacheValueAtNode(cache, node), value, cache->valueSize);
+}
+
+void MMSnapLRUCacheRemoveValue(MMSnapLRUCacheRef cache, const void *key)
+{
+    const long slot = MMSnapLRUCacheFindSlot(cache, key, MMSnapLRUCacheHash(cache, key));
+    if (slot >= 0) {
+        MMSnapLRUCacheRemoveNode(cache, slot);
+    }
+}
+
+void MMSnapLRUCacheRemoveAllValues(MMSnapLRUCacheRef cache)
+{
+    if (cache->callbacks.release) {
+        for (long node = cache->mostRecent; node >= 0; node = cache->nodes[node].next) {
+            cache->callbacks.release(cache->nodes[node].key);
+        }
+    }
+    
+    for (long node = 0; node < cache->capacity; node++) {
+        cache->nodes[node].next = (node + 1 < cache->capacity) ? node + 1 : -1;
+    }
+    for (long slot = 0; slot <= cache->slotMask; slot++) {
+        cache->slots[slot] = -1;
+    }
+    
+    cache->mostRecent = -1;
+    cache->leastRecent = -1;
+    cache->freeNode = 0;
+    cache->count = 0;
+}
+
+long MMSnapLRUCacheGetCount(MMSnapLRUCacheRef cache)
+{
+    return cache->count;
+}
+
+MMSnapLRUCacheStatistics MMSnapLRUCacheGetStatistics(MMSnapLRUCacheRef cache)
+{
+    return cache->statistics;
+}
+
+void MMSnapLRUCacheResetStatistics(MMSnapLRUCacheRef cache)
+{
+    memset(&cache->statistics, 0, sizeof(MMSnapLRUCacheStatistics));
+}
+
+double MMSnapLRUCacheGetHitRate(MMSnapLRUCacheRef cache)
+{
+    const unsigned long lookupCount = cache->statistics.hitCount + cache->statistics.missCount;
+    if (lookupCount == 0) {
+        return 0.0;
+    }
+    return (double)cache->statistics.hitCount / (double)lookupCount;
+}
@@ -0,0 +1,111 @@
+//
+//  MMSnapLRUCache.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapLRUCache_h
+#define MMSnapLRUCache_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  A bounded cache of fixed-size values, evicting the least recently used value when it's full.
+ *
+ *  @note Keys are opaque pointers compared through callbacks, like the keys of a @c CFDictionary, and values are copied
+ *  into storage allocated once when the cache is created. Looking up, setting and removing a value cost O(1).
+ *  The cache is not thread-safe.
+ */
+typedef struct MMSnapLRUCache *MMSnapLRUCacheRef;
+
+/**
+ *  Callbacks used for the keys. Any of them can be @c NULL, in which case keys are not retained and are compared by address.
+ */
+typedef struct {
+    const void *(*retain)(const void *key);
+    void (*release)(const void *key);
+    unsigned long (*hash)(const void *key);
+    bool (*equal)(const void *key, const void *otherKey);
+} MMSnapLRUCacheKeyCallbacks;
+
+/**
+ *  Lookup counters of a cache.
+ */
+typedef struct {
+    unsigned long hitCount;
+    unsigned long missCount;
+    unsigned long evictionCount;
+} MMSnapLRUCacheStatistics;
+
+/**
+ *  Returns a new empty cache or @c NULL if there was a problem allocating it.
+ *
+ *  @param callbacks The callbacks used for the keys, or @c NULL to compare them by address without retaining them.
+ *  @param valueSize The size of the values, in bytes.
+ *  @param capacity  The maximum number of values. Must be greater than zero.
+ */
+MMSnapLRUCacheRef MMSnapLRUCacheCreate(const MMSnapLRUCacheKeyCallbacks *callbacks, size_t valueSize, long capacity);
+
+/**
+ *  Releases the keys and frees the cache. Passing @c NULL is allowed.
+ */
+void MMSnapLRUCacheRelease(MMSnapLRUCacheRef cache);
+
+/**
+ *  Copies the value of a key and marks it as the most recently used one.
+ *
+ *  @param cache The cache.
+ *  @param key   The key to look up.
+ *  @param value Storage for @c valueSize bytes receiving the value, or @c NULL.
+ *
+ *  @return @c true if the key was found. Counted as a hit or a miss.
+ */
+bool MMSnapLRUCacheGetValue(MMSnapLRUCacheRef cache, const void *key, void *value);
+
+/**
+ *  Sets the value of a key and marks it as the most recently used one, evicting the least recently used value if the
+ *  cache is full.
+ */
+void MMSnapLRUCacheSetValue(MMSnapLRUCacheRef cache, const void *key, const void *value);
+
+/**
+ *  Removes the value of a key, if any.
+ */
+void MMSnapLRUCacheRemoveValue(MMSnapLRUCacheRef cache, const void *key);
+
+/**
+ *  Removes every value, keeping the counters.
+ */
+void MMSnapLRUCacheRemoveAllValues(MMSnapLRUCacheRef cache);
+
+/**
+ *  Returns the number of values in the cache.
+ */
+long MMSnapLRUCacheGetCount(MMSnapLRUCacheRef cache);
+
+/**
+ *  Returns the lookup counters of the cache.
+ */
+MMSnapLRUCacheStatistics MMSnapLRUCacheGetStatistics(MMSnapLRUCacheRef cache);
+
+/**
+ *  Sets the lookup counters back to zero.
+ */
+void MMSnapLRUCacheResetStatistics(MMSnapLRUCacheRef cache);
+
+/**
+ *  Returns the ratio of lookups that found their key, or zero before the first lookup.
+ */
+double MMSnapLRUCacheGetHitRate(MMSnapLRUCacheRef cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapLRUCache_h */
@@ -0,0 +1,121 @@
+//
+//  MMSnapLayoutCore.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapLayoutCore.h"
+
+#include <math.h>
+
+static const MMSnapLayoutRect MMSnapLayoutRectZero = { 0.0, 0.0, 0.0, 0.0 };
+
+// The end of the last page, in content coordinates.
+static inline double MMSnapLayoutGetContentMaxX(const MMSnapLayout *layout)
+{
+    return MMSnapPageIndexGetContentWidth(layout->pageIndex) - layout->windowOrigin;
+}
+
+MMSnapLayoutRect MMSnapLayoutGetPageFrame(const MMSnapLayout *layout, long page)
+{
+    if (page < 0 || page >= MMSnapPageIndexGetCount(layout->pageIndex)) {
+        return MMSnapLayoutRectZero;
+    }
+    
+    return (MMSnapLayoutRect){
+        .x = MMSnapPageIndexGetOrigin(layout->pageIndex, page) - layout->windowOrigin,
+        .width = MMSnapPageIndexGetWidth(layout->pageIndex, page),
+        .height = layout->pageHeight
+    };
+}
+
+MMSnapLayoutRect MMSnapLayoutGetPageRect(const MMSnapLayout *layout, long page, double *disappearPercent)
+{
+    MMSnapLayoutRect rect = MMSnapLayoutGetPageFrame(layout, page);
+    
+    const double contentOffsetX = layout->bounds.x;
+    
+    // Add parallax offset if:
+    // a. This page should be disappearing because of the content offset.
+    // b. This page can completely dissapear.
+    const bool isBehindContentOffset = (rect.x < contentOffsetX);
+    const bool canDisappear = (rect.x + rect.width) <= MMSnapLayoutGetContentMaxX(layout) - layout->bounds.width;
+    
+    if (canDisappear && isBehindContentOffset) {
+        const double distance = contentOffsetX - rect.x;
+        const double maximum = rect.width;
+        
+        const double percent = fmax(fmin(distance / maximum, 1.0), 0.0);
+        const double offset = percent * (maximum / 2);
+        
+        rect.x = -offset + contentOffsetX;
+        
+        if (disappearPercent) {
+            *disappearPercent = percent;
+        }
+    }
+    
+    return rect;
+}
+
+MMSnapLayoutRect MMSnapLayoutGetSeparatorRect(const MMSnapLayout *layout, MMSnapLayoutRect referenceRect)
+{
+    const double separatorWidth = layout->separatorWidth;
+    
+    return (MMSnapLayoutRect){
+        .x = referenceRect.x - separatorWidth,
+        .width = separatorWidth,
+        .height = referenceRect.height
+    };
+}
+
+MMSnapPageRange MMSnapLayoutGetPagesInRect(const MMSnapLayout *layout, MMSnapLayoutRect rect)
+{
+    const MMSnapPageRange empty = { MMSnapPageNotFound, 0 };
+    
+    // Pages always span the height of the layout, so only the horizontal interval needs to be searched.
+    if (rect.width <= 0.0 || rect.height <= 0.0 || rect.y >= layout->pageHeight || rect.y + rect.height <= 0.0) {
+        return empty;
+    }
+    
+    const double minX = rect.x + layout->windowOrigin;
+    
+    const MMSnapPageRange range = MMSnapPageIndexGetPagesInRange(layout->pageIndex, minX, minX + rect.width);
+    if (range.length == 0) {
+        return empty;
+    }
+    return range;
+}
+
+MMSnapPageRange MMSnapLayoutGetVisiblePages(const MMSnapLayout *layout)
+{
+    return MMSnapLayoutGetPagesInRect(layout, layout->bounds);
+}
+
+double MMSnapLayoutGetTargetContentOffsetX(const MMSnapLayout *layout, double proposedOffsetX, double velocityX)
+{
+    const MMSnapLayoutRect targetRect = { proposedOffsetX, 0.0, layout->bounds.width, layout->bounds.height };
+    const MMSnapPageRange range = MMSnapLayoutGetPagesInRect(layout, targetRect);
+    
+    if (range.length == 0) {
+        return proposedOffsetX;
+    }
+    
+    const MMSnapLayoutRect frame = MMSnapLayoutGetPageFrame(layout, range.location);
+    const double minX = frame.x;
+    const double maxX = frame.x + frame.width;
+    
+    // Go to the previous page when moving backwards.
+    if (velocityX < 0) {
+        return minX;
+    }
+    
+    // Go to the next page, but don't go over the content size (keep this page if so).
+    if (proposedOffsetX > minX + frame.width / 2 || velocityX > 0) {
+        return (maxX < MMSnapLayoutGetContentMaxX(layout)) ? maxX : minX;
+    }
+    
+    // Or to this one.
+    return minX;
+}
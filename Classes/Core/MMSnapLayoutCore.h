@@ -0,0 +1,108 @@
+//
+//  MMSnapLayoutCore.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapLayoutCore_h
+#define MMSnapLayoutCore_h
+
+#include "MMSnapPageIndex.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  A rectangle in the content coordinates of a snap scroll view.
+ */
+typedef struct {
+    double x;
+    double y;
+    double width;
+    double height;
+} MMSnapLayoutRect;
+
+/**
+ *  The state a snap scroll view lays out its pages with.
+ *
+ *  @note The layout core only reads this state, so a snap scroll view can fill it from its properties on every call and
+ *  the same math runs without UIKit.
+ */
+typedef struct {
+    /**
+     *  The validated page index. Not owned by the layout.
+     */
+    MMSnapPageIndexRef pageIndex;
+    /**
+     *  The visible bounds in content coordinates, whose origin is the content offset.
+     */
+    MMSnapLayoutRect bounds;
+    /**
+     *  The global offset of the content origin, when the content is a window of the page index. Zero otherwise.
+     *
+     *  @note Page origins in the page index are global, while the bounds and every rectangle returned by the layout are
+     *  in content coordinates. See @c MMSnapContentWindow.
+     */
+    double windowOrigin;
+    /**
+     *  The height of the pages.
+     */
+    double pageHeight;
+    /**
+     *  The width of the separators.
+     */
+    double separatorWidth;
+} MMSnapLayout;
+
+/**
+ *  Returns the frame of a page without parallax, or an empty rectangle if the page is out of range.
+ */
+MMSnapLayoutRect MMSnapLayoutGetPageFrame(const MMSnapLayout *layout, long page);
+
+/**
+ *  Returns the rectangle in which a page is displayed.
+ *
+ *  @param layout           The layout.
+ *  @param page             The page.
+ *  @param disappearPercent On output, the amount of the page covered by the following page, between zero and one. Not
+ *                          written when the page is not disappearing. Can be @c NULL.
+ *
+ *  @return The frame of the page, moved at half the speed of the content while it disappears behind the content offset.
+ *  Pages that can't be entirely covered, like the last ones, don't move.
+ */
+MMSnapLayoutRect MMSnapLayoutGetPageRect(const MMSnapLayout *layout, long page, double *disappearPercent);
+
+/**
+ *  Returns the rectangle of the separator placed just before a reference rectangle.
+ */
+MMSnapLayoutRect MMSnapLayoutGetSeparatorRect(const MMSnapLayout *layout, MMSnapLayoutRect referenceRect);
+
+/**
+ *  Returns the range of pages intersecting a rectangle, or a range of length zero if there are none.
+ */
+MMSnapPageRange MMSnapLayoutGetPagesInRect(const MMSnapLayout *layout, MMSnapLayoutRect rect);
+
+/**
+ *  Returns the range of pages intersecting the visible bounds.
+ */
+MMSnapPageRange MMSnapLayoutGetVisiblePages(const MMSnapLayout *layout);
+
+/**
+ *  Returns the horizontal content offset at which the scrolling should stop.
+ *
+ *  @param layout          The layout.
+ *  @param proposedOffsetX The content offset at which the scrolling would naturally stop.
+ *  @param velocityX       The horizontal velocity of the scrolling when the gesture ended.
+ *
+ *  @return The origin of the page at the proposed offset, or of the next one if the scrolling was moving forward or
+ *  went past the middle of the page.
+ */
+double MMSnapLayoutGetTargetContentOffsetX(const MMSnapLayout *layout, double proposedOffsetX, double velocityX);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapLayoutCore_h */
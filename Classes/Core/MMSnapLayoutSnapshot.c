@@ -0,0 +1,342 @@
+//
+//  MMSnapLayoutSnapshot.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapLayoutSnapshot.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Layout of the header, every field little-endian.
+enum {
+    MMSnapLayoutSnapshotMagicOffset = 0,
+    MMSnapLayoutSnapshotVersionOffset = 4,
+    MMSnapLayoutSnapshotPageCountOffset = 8,
+    MMSnapLayoutSnapshotWidthOffset = 16,
+    MMSnapLayoutSnapshotHeightOffset = 24,
+    MMSnapLayoutSnapshotTraitsOffset = 32,
+    MMSnapLayoutSnapshotContentOffsetOffset = 40,
+    MMSnapLayoutSnapshotChecksumOffset = 48,
+    MMSnapLayoutSnapshotHeaderSize = 56
+};
+
+static const unsigned char MMSnapLayoutSnapshotMagic[4] = { 'M', 'M', 'S', 'L' };
+
+struct MMSnapLayoutSnapshot {
+    const unsigned char *bytes;
+    long pageCount;
+    MMSnapLayoutSnapshotKey key;
+    double contentOffsetX;
+    
+    // The mapping of the file the snapshot was opened from, if any.
+    void *mapping;
+    size_t mappingLength;
+};
+
+// Encoding.
+
+static void MMSnapLayoutSnapshotWriteUInt32(unsigned char *bytes, uint32_t value)
+{
+    for (int idx = 0; idx < 4; idx++) {
+        bytes[idx] = (unsigned char)(value >> (8 * idx));
+    }
+}
+
+static void MMSnapLayoutSnapshotWriteUInt64(unsigned char *bytes, uint64_t value)
+{
+    for (int idx = 0; idx < 8; idx++) {
+        bytes[idx] = (unsigned char)(value >> (8 * idx));
+    }
+}
+
+static void MMSnapLayoutSnapshotWriteDouble(unsigned char *bytes, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    MMSnapLayoutSnapshotWriteUInt64(bytes, bits);
+}
+
+static uint32_t MMSnapLayoutSnapshotReadUInt32(const unsigned char *bytes)
+{
+    uint32_t value = 0;
+    for (int idx = 0; idx < 4; idx++) {
+        value |= (uint32_t)bytes[idx] << (8 * idx);
+    }
+    return value;
+}
+
+static uint64_t MMSnapLayoutSnapshotReadUInt64(const unsigned char *bytes)
+{
+    uint64_t value = 0;
+    for (int idx = 0; idx < 8; idx++) {
+        value |= (uint64_t)bytes[idx] << (8 * idx);
+    }
+    return value;
+}
+
+static double MMSnapLayoutSnapshotReadDouble(const unsigned char *bytes)
+{
+    const uint64_t bits = MMSnapLayoutSnapshotReadUInt64(bytes);
+    
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// FNV-1a over the whole snapshot but the checksum itself.
+static uint64_t MMSnapLayoutSnapshotChecksum(const unsigned char *bytes, size_t length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t idx = 0; idx < length; idx++) {
+        if (idx == MMSnapLayoutSnapshotChecksumOffset) {
+            idx += 7;
+            continue;
+        }
+        hash ^= bytes[idx];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+size_t MMSnapLayoutSnapshotGetEncodedSize(long pageCount)
+{
+    return MMSnapLayoutSnapshotHeaderSize + (size_t)((pageCount > 0) ? pageCount : 0) * sizeof(uint64_t);
+}
+
+size_t MMSnapLayoutSnapshotEncode(MMSnapPageIndexRef pageIndex, MMSnapLayoutSnapshotKey key, double contentOffsetX, void *buffer, size_t capacity)
+{
+    const long pageCount = MMSnapPageIndexGetCount(pageIndex);
+    const size_t length = MMSnapLayoutSnapshotGetEncodedSize(pageCount);
+    
+    if (length > capacity || MMSnapPageIndexNeedsValidation(pageIndex)) {
+        return 0;
+    }
+    
+    unsigned char *bytes = buffer;
+    
+    memcpy(bytes + MMSnapLayoutSnapshotMagicOffset, MMSnapLayoutSnapshotMagic, sizeof(MMSnapLayoutSnapshotMagic));
+    MMSnapLayoutSnapshotWriteUInt32(bytes + MMSnapLayoutSnapshotVersionOffset, MMSnapLayoutSnapshotVersion);
+    MMSnapLayoutSnapshotWriteUInt64(bytes + MMSnapLayoutSnapshotPageCountOffset, (uint64_t)pageCount);
+    MMSnapLayoutSnapshotWriteDouble(bytes + MMSnapLayoutSnapshotWidthOffset, key.width);
+    MMSnapLayoutSnapshotWriteDouble(bytes + MMSnapLayoutSnapshotHeightOffset, key.height);
+    MMSnapLayoutSnapshotWriteUInt64(bytes + MMSnapLayoutSnapshotTraitsOffset, key.traits);
+    MMSnapLayoutSnapshotWriteDouble(bytes + MMSnapLayoutSnapshotContentOffsetOffset, contentOffsetX);
+    
+    for (long page = 0; page < pageCount; page++) {
+        MMSnapLayoutSnapshotWriteDouble(bytes + MMSnapLayoutSnapshotHeaderSize + page * sizeof(uint64_t), MMSnapPageIndexGetWidth(pageIndex, page));
+    }
+    
+    MMSnapLayoutSnapshotWriteUInt64(bytes + MMSnapLayoutSnapshotChecksumOffset, MMSnapLayoutSnapshotChecksum(bytes, length));
+    
+    return length;
+}
+
+bool MMSnapLayoutSnapshotWriteFile(const char *path, MMSnapPageIndexRef pageIndex, MMSnapLayoutSnapshotKey key, double contentOffsetX)
+{
+    const size_t length = MMSnapLayoutSnapshotGetEncodedSize(MMSnapPageIndexGetCount(pageIndex));
+    
+    unsigned char *bytes = malloc(length);
+    if (!bytes) {
+        return false;
+    }
+    
+    if (MMSnapLayoutSnapshotEncode(pageIndex, key, contentOffsetX, bytes, length) != length) {
+        free(bytes);
+        return false;
+    }
+    
+    // Write next to the file and rename over it, so a snapshot being read is never partially written.
+    const size_t pathLength = strlen(path);
+    char *temporaryPath = malloc(pathLength + 5);
+    if (!temporaryPath) {
+        free(bytes);
+        return false;
+    }
+    memcpy(temporaryPath, path, pathLength);
+    memcpy(temporaryPath + pathLength, ".tmp", 5);
+    
+    bool written = false;
+    
+    const int fd = open(temporaryPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        size_t offset = 0;
+        while (offset < length) {
+            const ssize_t count = write(fd, bytes + offset, length - offset);
+            if (count <= 0) {
+                break;
+            }
+            offset += (size_t)count;
+        }
+        
+        written = (close(fd) == 0) && (offset == length);
+        
+        if (written) {
+            written = (rename(temporaryPath, path) == 0);
+        }
+        if (!written) {
+            unlink(temporaryPath);
+        }
+    }
+    
+    free(temporaryPath);
+    free(bytes);
+    
+    return written;
+}
+
+// Decoding.
+
+static bool MMSnapLayoutSnapshotDecode(MMSnapLayoutSnapshotRef snapshot, const unsigned char *bytes, size_t length)
+{
+    if (length < MMSnapLayoutSnapshotHeaderSize) {
+        return false;
+    }
+    if (memcmp(bytes + MMSnapLayoutSnapshotMagicOffset, MMSnapLayoutSnapshotMagic, sizeof(MMSnapLayoutSnapshotMagic)) != 0) {
+        return false;
+    }
+    if (MMSnapLayoutSnapshotReadUInt32(bytes + MMSnapLayoutSnapshotVersionOffset) != MMSnapLayoutSnapshotVersion) {
+        return false;
+    }
+    
+    // The number of pages must account for every byte, which also rules out counts that would overflow.
+    const uint64_t pageCount = MMSnapLayoutSnapshotReadUInt64(bytes + MMSnapLayoutSnapshotPageCountOffset);
+    if (pageCount != (length - MMSnapLayoutSnapshotHeaderSize) / sizeof(uint64_t) || MMSnapLayoutSnapshotGetEncodedSize((long)pageCount) != length) {
+        return false;
+    }
+    
+    if (MMSnapLayoutSnapshotReadUInt64(bytes + MMSnapLayoutSnapshotChecksumOffset) != MMSnapLayoutSnapshotChecksum(bytes, length)) {
+        return false;
+    }
+    
+    for (uint64_t page = 0; page < pageCount; page++) {
+        const double width = MMSnapLayoutSnapshotReadDouble(bytes + MMSnapLayoutSnapshotHeaderSize + page * sizeof(uint64_t));
+        if (!isfinite(width) || width < 0.0) {
+            return false;
+        }
+    }
+    
+    snapshot->bytes = bytes;
+    snapshot->pageCount = (long)pageCount;
+    snapshot->key = (MMSnapLayoutSnapshotKey){
+        .width = MMSnapLayoutSnapshotReadDouble(bytes + MMSnapLayoutSnapshotWidthOffset),
+        .height = MMSnapLayoutSnapshotReadDouble(bytes + MMSnapLayoutSnapshotHeightOffset),
+        .traits = MMSnapLayoutSnapshotReadUInt64(bytes + MMSnapLayoutSnapshotTraitsOffset)
+    };
+    snapshot->contentOffsetX = MMSnapLayoutSnapshotReadDouble(bytes + MMSnapLayoutSnapshotContentOffsetOffset);
+    
+    return isfinite(snapshot->contentOffsetX);
+}
+
+MMSnapLayoutSnapshotRef MMSnapLayoutSnapshotCreateWithBytes(const void *bytes, size_t length)
+{
+    MMSnapLayoutSnapshotRef snapshot = calloc(1, sizeof(struct MMSnapLayoutSnapshot));
+    if (!snapshot) {
+        return NULL;
+    }
+    
+    if (!bytes || !MMSnapLayoutSnapshotDecode(snapshot, bytes, length)) {
+        free(snapshot);
+        return NULL;
+    }
+    
+    return snapshot;
+}
+
+MMSnapLayoutSnapshotRef MMSnapLayoutSnapshotOpenFile(const char *path)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size < MMSnapLayoutSnapshotHeaderSize) {
+        close(fd);
+        return NULL;
+    }
+    
+    const size_t length = (size_t)status.st_size;
+    void *mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+    
+    MMSnapLayoutSnapshotRef snapshot = MMSnapLayoutSnapshotCreateWithBytes(mapping, length);
+    if (!snapshot) {
+        munmap(mapping, length);
+        return NULL;
+    }
+    
+    snapshot->mapping = mapping;
+    snapshot->mappingLength = length;
+    
+    return snapshot;
+}
+
+void MMSnapLayoutSnapshotRelease(MMSnapLayoutSnapshotRef snapshot)
+{
+    if (!snapshot) {
+        return;
+    }
+    
+    if (snapshot->mapping) {
+        munmap(snapshot->mapping, snapshot->mappingLength);
+    }
+    free(snapshot);
+}
+
+// Accessors.
+
+MMSnapLayoutSnapshotKey MMSnapLayoutSnapshotGetKey(MMSnapLayoutSnapshotRef snapshot)
+{
+    return snapshot->key;
+}
+
+bool MMSnapLayoutSnapshotMatchesKey(MMSnapLayoutSnapshotRef snapshot, MMSnapLayoutSnapshotKey key)
+{
+    return snapshot->key.width == key.width && snapshot->key.height == key.height && snapshot->key.traits == key.traits;
+}
+
+long MMSnapLayoutSnapshotGetPageCount(MMSnapLayoutSnapshotRef snapshot)
+{
+    return snapshot->pageCount;
+}
+
+double MMSnapLayoutSnapshotGetWidth(MMSnapLayoutSnapshotRef snapshot, long page)
+{
+    if (page < 0 || page >= snapshot->pageCount) {
+        return 0.0;
+    }
+    return MMSnapLayoutSnapshotReadDouble(snapshot->bytes + MMSnapLayoutSnapshotHeaderSize + page * sizeof(uint64_t));
+}
+
+double MMSnapLayoutSnapshotGetContentOffsetX(MMSnapLayoutSnapshotRef snapshot)
+{
+    return snapshot->contentOffsetX;
+}
+
+bool MMSnapLayoutSnapshotApply(MMSnapLayoutSnapshotRef snapshot, MMSnapPageIndexRef pageIndex)
+{
+    MMSnapPageIndexRemoveAllPages(pageIndex);
+    
+    // Appended pages are valid, and their origins are accumulated along the way.
+    for (long page = 0; page < snapshot->pageCount; page++) {
+        if (!MMSnapPageIndexAppendPage(pageIndex, MMSnapLayoutSnapshotGetWidth(snapshot, page))) {
+            MMSnapPageIndexRemoveAllPages(pageIndex);
+            return false;
+        }
+    }
+    
+    return true;
+}
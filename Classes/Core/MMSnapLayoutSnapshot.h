@@ -0,0 +1,132 @@
+//
+//  MMSnapLayoutSnapshot.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapLayoutSnapshot_h
+#define MMSnapLayoutSnapshot_h
+
+#include "MMSnapPageIndex.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  A read-only snapshot of the widths of the pages, persisted so the first layout pass after a launch doesn't have to
+ *  measure every page again.
+ *
+ *  @note The binary format is versioned and little-endian: a fixed header with the number of pages, the key the layout
+ *  was computed for, the global content offset and a checksum, followed by one width per page. Snapshots opened from a
+ *  file are memory-mapped and decoded in place. Snapshots that are truncated, fail the checksum, hold invalid widths or
+ *  were written by another version of the format are rejected, since they are only a cache of the layout.
+ */
+typedef struct MMSnapLayoutSnapshot *MMSnapLayoutSnapshotRef;
+
+/**
+ *  The current version of the format. Snapshots of other versions are rejected.
+ */
+#define MMSnapLayoutSnapshotVersion 1
+
+/**
+ *  What the widths of the pages were computed for. A snapshot is only used if its key matches the current one.
+ */
+typedef struct {
+    /**
+     *  The width of the scroll view.
+     */
+    double width;
+    /**
+     *  The height of the scroll view.
+     */
+    double height;
+    /**
+     *  An opaque value describing everything else the widths depend on, such as the size classes.
+     */
+    uint64_t traits;
+} MMSnapLayoutSnapshotKey;
+
+/**
+ *  Returns the size of the snapshot of a number of pages, in bytes.
+ */
+size_t MMSnapLayoutSnapshotGetEncodedSize(long pageCount);
+
+/**
+ *  Encodes the snapshot of a page index into a buffer.
+ *
+ *  @param pageIndex      The page index. Cannot have invalidated widths.
+ *  @param key            The key the widths were computed for.
+ *  @param contentOffsetX The global content offset.
+ *  @param buffer         The buffer receiving the snapshot.
+ *  @param capacity       The size of the buffer, in bytes.
+ *
+ *  @return The number of bytes written, or @c 0 if the buffer is too small or the page index needs to be validated.
+ */
+size_t MMSnapLayoutSnapshotEncode(MMSnapPageIndexRef pageIndex, MMSnapLayoutSnapshotKey key, double contentOffsetX, void *buffer, size_t capacity);
+
+/**
+ *  Writes the snapshot of a page index to a file, replacing it atomically.
+ *
+ *  @return @c false if the page index needs to be validated or the file could not be written.
+ */
+bool MMSnapLayoutSnapshotWriteFile(const char *path, MMSnapPageIndexRef pageIndex, MMSnapLayoutSnapshotKey key, double contentOffsetX);
+
+/**
+ *  Returns a snapshot reading from a buffer, or @c NULL if the buffer doesn't hold a valid snapshot.
+ *
+ *  @note The bytes aren't copied, they must stay valid until the snapshot is released.
+ */
+MMSnapLayoutSnapshotRef MMSnapLayoutSnapshotCreateWithBytes(const void *bytes, size_t length);
+
+/**
+ *  Returns a snapshot memory-mapping a file, or @c NULL if the file doesn't exist or doesn't hold a valid snapshot.
+ */
+MMSnapLayoutSnapshotRef MMSnapLayoutSnapshotOpenFile(const char *path);
+
+/**
+ *  Frees a snapshot, unmapping its file. Passing @c NULL is allowed.
+ */
+void MMSnapLayoutSnapshotRelease(MMSnapLayoutSnapshotRef snapshot);
+
+/**
+ *  Returns the key the widths of a snapshot were computed for.
+ */
+MMSnapLayoutSnapshotKey MMSnapLayoutSnapshotGetKey(MMSnapLayoutSnapshotRef snapshot);
+
+/**
+ *  Returns @c true if a snapshot was taken for the specified key.
+ */
+bool MMSnapLayoutSnapshotMatchesKey(MMSnapLayoutSnapshotRef snapshot, MMSnapLayoutSnapshotKey key);
+
+/**
+ *  Returns the number of pages of a snapshot.
+ */
+long MMSnapLayoutSnapshotGetPageCount(MMSnapLayoutSnapshotRef snapshot);
+
+/**
+ *  Returns the width of a page of a snapshot, or @c 0 if the page is out of range.
+ */
+double MMSnapLayoutSnapshotGetWidth(MMSnapLayoutSnapshotRef snapshot, long page);
+
+/**
+ *  Returns the global content offset of a snapshot.
+ */
+double MMSnapLayoutSnapshotGetContentOffsetX(MMSnapLayoutSnapshotRef snapshot);
+
+/**
+ *  Replaces the pages of a page index with the pages of a snapshot, all of them valid.
+ *
+ *  @return @c false if the storage of the page index could not be grown, in which case it's left empty.
+ */
+bool MMSnapLayoutSnapshotApply(MMSnapLayoutSnapshotRef snapshot, MMSnapPageIndexRef pageIndex);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapLayoutSnapshot_h */
@@ -0,0 +1,525 @@
+//
+//  MMSnapPageIndex.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapPageIndex.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct MMSnapPageIndex {
+    long count;
+    long capacity;
+    double *origins;
+    double *widths;
+    unsigned char *invalidWidths;
+    
+    // Bounds of the pages with an invalidated width. Empty when first > last.
+    long firstInvalidWidth;
+    long lastInvalidWidth;
+    
+    // Origins from this page onwards are stale. Equal or greater than count when all origins are valid.
+    long firstInvalidOrigin;
+    
+    long lastValidationQueryCount;
+};
+
+MMSnapPageIndexRef MMSnapPageIndexCreate(void)
+{
+    MMSnapPageIndexRef pageIndex = calloc(1, sizeof(struct MMSnapPageIndex));
+    if (pageIndex) {
+        pageIndex->firstInvalidWidth = 0;
+        pageIndex->lastInvalidWidth = -1;
+    }
+    return pageIndex;
+}
+
+void MMSnapPageIndexRelease(MMSnapPageIndexRef pageIndex)
+{
+    if (pageIndex) {
+        free(pageIndex->origins);
+        free(pageIndex->widths);
+        free(pageIndex->invalidWidths);
+        free(pageIndex);
+    }
+}
+
+void MMSnapPageIndexRemoveAllPages(MMSnapPageIndexRef pageIndex)
+{
+    pageIndex->count = 0;
+    pageIndex->firstInvalidWidth = 0;
+    pageIndex->lastInvalidWidth = -1;
+    pageIndex->firstInvalidOrigin = 0;
+}
+
+static bool MMSnapPageIndexReserve(MMSnapPageIndexRef pageIndex, long capacity)
+{
+    if (capacity <= pageIndex->capacity) {
+        return true;
+    }
+    
+    long newCapacity = pageIndex->capacity > 0 ? pageIndex->capacity : 16;
+    while (newCapacity < capacity) {
+        newCapacity *= 2;
+    }
+    
+    double *origins = realloc(pageIndex->origins, (size_t)newCapacity * sizeof(double));
+    if (!origins) {
+        return false;
+    }
+    pageIndex->origins = origins;
+    
+    double *widths = realloc(pageIndex->widths, (size_t)newCapacity * sizeof(double));
+    if (!widths) {
+        return false;
+    }
+    pageIndex->widths = widths;
+    
+    unsigned char *invalidWidths = realloc(pageIndex->invalidWidths, (size_t)newCapacity);
+    if (!invalidWidths) {
+        return false;
+    }
+    pageIndex->invalidWidths = invalidWidths;
+    
+    pageIndex->capacity = newCapacity;
+    
+    return true;
+}
+
+static inline void MMSnapPageIndexInvalidateOriginsFromPage(MMSnapPageIndexRef pageIndex, long page)
+{
+    if (page < pageIndex->firstInvalidOrigin) {
+        pageIndex->firstInvalidOrigin = page;
+    }
+}
+
+static inline void MMSnapPageIndexValidateOrigins(MMSnapPageIndexRef pageIndex)
+{
+    const long count = pageIndex->count;
+    long page = pageIndex->firstInvalidOrigin;
+    
+    if (page >= count) {
+        return;
+    }
+    
+    double *origins = pageIndex->origins;
+    const double *widths = pageIndex->widths;
+    
+    double origin = (page > 0) ? origins[page - 1] + widths[page - 1] : 0.0;
+    for (; page < count; page++) {
+        origins[page] = origin;
+        origin += widths[page];
+    }
+    
+    pageIndex->firstInvalidOrigin = count;
+}
+
+bool MMSnapPageIndexAppendPage(MMSnapPageIndexRef pageIndex, double width)
+{
+    const long count = pageIndex->count;
+    
+    if (!MMSnapPageIndexReserve(pageIndex, count + 1)) {
+        return false;
+    }
+    
+    pageIndex->widths[count] = (width > 0.0) ? width : 0.0;
+    pageIndex->invalidWidths[count] = 0;
+    pageIndex->count = count + 1;
+    
+    if (pageIndex->firstInvalidOrigin >= count) {
+        pageIndex->origins[count] = (count > 0) ? pageIndex->origins[count - 1] + pageIndex->widths[count - 1] : 0.0;
+        pageIndex->firstInvalidOrigin = count + 1;
+    }
+    
+    return true;
+}
+
+bool MMSnapPageIndexInsertPages(MMSnapPageIndexRef pageIndex, long page, long count)
+{
+    const long oldCount = pageIndex->count;
+    
+    if (count <= 0 || page < 0 || page > oldCount) {
+        return true;
+    }
+    
+    if (!MMSnapPageIndexReserve(pageIndex, oldCount + count)) {
+        return false;
+    }
+    
+    const size_t tail = (size_t)(oldCount - page);
+    memmove(pageIndex->origins + page + count, pageIndex->origins + page, tail * sizeof(double));
+    memmove(pageIndex->widths + page + count, pageIndex->widths + page, tail * sizeof(double));
+    memmove(pageIndex->invalidWidths + page + count, pageIndex->invalidWidths + page, tail);
+    
+    for (long idx = page; idx < page + count; idx++) {
+        pageIndex->widths[idx] = 0.0;
+        pageIndex->invalidWidths[idx] = 1;
+    }
+    
+    pageIndex->count = oldCount + count;
+    
+    // Shift the invalidated bounds past the insertion point, then include the inserted pages.
+    if (pageIndex->firstInvalidWidth <= pageIndex->lastInvalidWidth) {
+        if (pageIndex->firstInvalidWidth >= page) {
+            pageIndex->firstInvalidWidth += count;
+        }
+        if (pageIndex->lastInvalidWidth >= page) {
+            pageIndex->lastInvalidWidth += count;
+        }
+        if (page < pageIndex->firstInvalidWidth) {
+            pageIndex->firstInvalidWidth = page;
+        }
+        if (page + count - 1 > pageIndex->lastInvalidWidth) {
+            pageIndex->lastInvalidWidth = page + count - 1;
+        }
+    } else {
+        pageIndex->firstInvalidWidth = page;
+        pageIndex->lastInvalidWidth = page + count - 1;
+    }
+    
+    MMSnapPageIndexInvalidateOriginsFromPage(pageIndex, page);
+    
+    return true;
+}
+
+void MMSnapPageIndexRemovePages(MMSnapPageIndexRef pageIndex, long page, long count)
+{
+    const long oldCount = pageIndex->count;
+    
+    if (page < 0 || page >= oldCount || count <= 0) {
+        return;
+    }
+    if (count > oldCount - page) {
+        count = oldCount - page;
+    }
+    
+    const size_t tail = (size_t)(oldCount - page - count);
+    memmove(pageIndex->origins + page, pageIndex->origins + page + count, tail * sizeof(double));
+    memmove(pageIndex->widths + page, pageIndex->widths + page + count, tail * sizeof(double));
+    memmove(pageIndex->invalidWidths + page, pageIndex->invalidWidths + page + count, tail);
+    
+    pageIndex->count = oldCount - count;
+    
+    // Keep conservative bounds for the invalidated pages, validation checks each flag anyway.
+    long first = pageIndex->firstInvalidWidth;
+    long last = pageIndex->lastInvalidWidth;
+    
+    if (first <= last) {
+        if (first >= page + count) {
+            first -= count;
+        } else if (first > page) {
+            first = page;
+        }
+        if (last >= page + count) {
+            last -= count;
+        } else if (last >= page) {
+            last = page - 1;
+        }
+        if (last >= pageIndex->count) {
+            last = pageIndex->count - 1;
+        }
+        if (first > last) {
+            first = 0;
+            last = -1;
+        }
+        pageIndex->firstInvalidWidth = first;
+        pageIndex->lastInvalidWidth = last;
+    }
+    
+    MMSnapPageIndexInvalidateOriginsFromPage(pageIndex, page);
+}
+
+// Recomputes the invalidated bounds for the pages from the specified page onwards, keeping the ones before it.
+static void MMSnapPageIndexRescanInvalidWidthsFromPage(MMSnapPageIndexRef pageIndex, long page)
+{
+    long first = 0;
+    long last = -1;
+    
+    if (pageIndex->firstInvalidWidth <= pageIndex->lastInvalidWidth && pageIndex->firstInvalidWidth < page) {
+        first = pageIndex->firstInvalidWidth;
+        last = (pageIndex->lastInvalidWidth < page) ? pageIndex->lastInvalidWidth : page - 1;
+    }
+    
+    const unsigned char *invalidWidths = pageIndex->invalidWidths;
+    for (long idx = page; idx < pageIndex->count; idx++) {
+        if (invalidWidths[idx]) {
+            if (first > last) {
+                first = idx;
+            }
+            last = idx;
+        }
+    }
+    
+    pageIndex->firstInvalidWidth = first;
+    pageIndex->lastInvalidWidth = last;
+}
+
+void MMSnapPageIndexRemovePagesAtIndexes(MMSnapPageIndexRef pageIndex, const long *pages, long count)
+{
+    const long oldCount = pageIndex->count;
+    
+    long next = 0;
+    while (next < count && pages[next] < 0) {
+        next++;
+    }
+    if (next == count || pages[next] >= oldCount) {
+        return;
+    }
+    
+    const long firstPage = pages[next];
+    long write = firstPage;
+    
+    for (long read = firstPage; read < oldCount; read++) {
+        if (next < count && pages[next] == read) {
+            next++;
+            continue;
+        }
+        pageIndex->widths[write] = pageIndex->widths[read];
+        pageIndex->invalidWidths[write] = pageIndex->invalidWidths[read];
+        write++;
+    }
+    
+    pageIndex->count = write;
+    
+    MMSnapPageIndexRescanInvalidWidthsFromPage(pageIndex, firstPage);
+    MMSnapPageIndexInvalidateOriginsFromPage(pageIndex, firstPage);
+}
+
+bool MMSnapPageIndexInsertPagesAtIndexes(MMSnapPageIndexRef pageIndex, const long *pages, long count)
+{
+    if (count <= 0) {
+        return true;
+    }
+    
+    const long oldCount = pageIndex->count;
+    const long newCount = oldCount + count;
+    
+    if (pages[0] < 0 || pages[count - 1] >= newCount) {
+        return false;
+    }
+    if (!MMSnapPageIndexReserve(pageIndex, newCount)) {
+        return false;
+    }
+    
+    // Fill from the back, so every page is moved at most once.
+    long next = count - 1;
+    long read = oldCount - 1;
+    
+    for (long write = newCount - 1; write >= pages[0]; write--) {
+        if (next >= 0 && pages[next] == write) {
+            pageIndex->widths[write] = 0.0;
+            pageIndex->invalidWidths[write] = 1;
+            next--;
+        } else {
+            pageIndex->widths[write] = pageIndex->widths[read];
+            pageIndex->invalidWidths[write] = pageIndex->invalidWidths[read];
+            read--;
+        }
+    }
+    
+    pageIndex->count = newCount;
+    
+    MMSnapPageIndexRescanInvalidWidthsFromPage(pageIndex, pages[0]);
+    MMSnapPageIndexInvalidateOriginsFromPage(pageIndex, pages[0]);
+    
+    return true;
+}
+
+void MMSnapPageIndexSetWidth(MMSnapPageIndexRef pageIndex, long page, double width)
+{
+    if (page < 0 || page >= pageIndex->count) {
+        return;
+    }
+    
+    pageIndex->widths[page] = (width > 0.0) ? width : 0.0;
+    pageIndex->invalidWidths[page] = 0;
+    
+    MMSnapPageIndexInvalidateOriginsFromPage(pageIndex, page + 1);
+}
+
+void MMSnapPageIndexInvalidatePage(MMSnapPageIndexRef pageIndex, long page)
+{
+    if (page < 0 || page >= pageIndex->count) {
+        return;
+    }
+    
+    pageIndex->invalidWidths[page] = 1;
+    
+    if (pageIndex->firstInvalidWidth > pageIndex->lastInvalidWidth) {
+        pageIndex->firstInvalidWidth = page;
+        pageIndex->lastInvalidWidth = page;
+    } else {
+        if (page < pageIndex->firstInvalidWidth) {
+            pageIndex->firstInvalidWidth = page;
+        }
+        if (page > pageIndex->lastInvalidWidth) {
+            pageIndex->lastInvalidWidth = page;
+        }
+    }
+}
+
+void MMSnapPageIndexInvalidateAllPages(MMSnapPageIndexRef pageIndex)
+{
+    const long count = pageIndex->count;
+    if (count == 0) {
+        return;
+    }
+    
+    memset(pageIndex->invalidWidths, 1, (size_t)count);
+    
+    pageIndex->firstInvalidWidth = 0;
+    pageIndex->lastInvalidWidth = count - 1;
+}
+
+bool MMSnapPageIndexNeedsValidation(MMSnapPageIndexRef pageIndex)
+{
+    return pageIndex->firstInvalidWidth <= pageIndex->lastInvalidWidth;
+}
+
+long MMSnapPageIndexValidate(MMSnapPageIndexRef pageIndex, MMSnapPageWidthFunction widthFunction, void *context)
+{
+    long queries = 0;
+    
+    const long first = pageIndex->firstInvalidWidth;
+    const long last = pageIndex->lastInvalidWidth;
+    
+    // Pages invalidated by the callout, including the one being measured, are left for the next validation.
+    pageIndex->firstInvalidWidth = 0;
+    pageIndex->lastInvalidWidth = -1;
+    
+    for (long page = first; page <= last; page++) {
+        if (pageIndex->invalidWidths[page]) {
+            pageIndex->invalidWidths[page] = 0;
+            
+            const double width = widthFunction ? widthFunction(page, context) : 0.0;
+            
+            // Widths and origins are updated after the callout, which is free to look at the index.
+            pageIndex->widths[page] = (width > 0.0) ? width : 0.0;
+            
+            MMSnapPageIndexInvalidateOriginsFromPage(pageIndex, page + 1);
+            
+            queries++;
+        }
+    }
+    
+    pageIndex->lastValidationQueryCount = queries;
+    
+    MMSnapPageIndexValidateOrigins(pageIndex);
+    
+    return queries;
+}
+
+long MMSnapPageIndexGetLastValidationQueryCount(MMSnapPageIndexRef pageIndex)
+{
+    return pageIndex->lastValidationQueryCount;
+}
+
+long MMSnapPageIndexGetCount(MMSnapPageIndexRef pageIndex)
+{
+    return pageIndex->count;
+}
+
+double MMSnapPageIndexGetOrigin(MMSnapPageIndexRef pageIndex, long page)
+{
+    if (page < 0 || page >= pageIndex->count) {
+        return 0.0;
+    }
+    
+    MMSnapPageIndexValidateOrigins(pageIndex);
+    
+    return pageIndex->origins[page];
+}
+
+double MMSnapPageIndexGetWidth(MMSnapPageIndexRef pageIndex, long page)
+{
+    if (page < 0 || page >= pageIndex->count) {
+        return 0.0;
+    }
+    return pageIndex->widths[page];
+}
+
+double MMSnapPageIndexGetContentWidth(MMSnapPageIndexRef pageIndex)
+{
+    const long count = pageIndex->count;
+    if (count == 0) {
+        return 0.0;
+    }
+    
+    MMSnapPageIndexValidateOrigins(pageIndex);
+    
+    return pageIndex->origins[count - 1] + pageIndex->widths[count - 1];
+}
+
+// Returns the first page whose maximum X is greater than x.
+static long MMSnapPageIndexFirstPageEndingAfter(MMSnapPageIndexRef pageIndex, double x)
+{
+    const double *origins = pageIndex->origins;
+    const double *widths = pageIndex->widths;
+    
+    long low = 0;
+    long high = pageIndex->count;
+    
+    while (low < high) {
+        const long mid = low + (high - low) / 2;
+        if (origins[mid] + widths[mid] > x) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+// Returns the first page whose minimum X is greater than or equal to x.
+static long MMSnapPageIndexFirstPageStartingAtOrAfter(MMSnapPageIndexRef pageIndex, double x)
+{
+    const double *origins = pageIndex->origins;
+    
+    long low = 0;
+    long high = pageIndex->count;
+    
+    while (low < high) {
+        const long mid = low + (high - low) / 2;
+        if (origins[mid] >= x) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+MMSnapPageRange MMSnapPageIndexGetPagesInRange(MMSnapPageIndexRef pageIndex, double minX, double maxX)
+{
+    MMSnapPageRange range = { 0, 0 };
+    
+    if (pageIndex->count == 0 || !(maxX > minX)) {
+        return range;
+    }
+    
+    MMSnapPageIndexValidateOrigins(pageIndex);
+    
+    const long first = MMSnapPageIndexFirstPageEndingAfter(pageIndex, minX);
+    const long end = MMSnapPageIndexFirstPageStartingAtOrAfter(pageIndex, maxX);
+    
+    if (end > first) {
+        range.location = first;
+        range.length = end - first;
+    }
+    return range;
+}
+
+long MMSnapPageIndexGetPageAtOffset(MMSnapPageIndexRef pageIndex, double x)
+{
+    MMSnapPageIndexValidateOrigins(pageIndex);
+    
+    const long page = MMSnapPageIndexFirstPageEndingAfter(pageIndex, x);
+    
+    if (page < pageIndex->count && pageIndex->origins[page] <= x) {
+        return page;
+    }
+    return MMSnapPageNotFound;
+}
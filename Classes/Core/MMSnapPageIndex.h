@@ -0,0 +1,186 @@
+//
+//  MMSnapPageIndex.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapPageIndex_h
+#define MMSnapPageIndex_h
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  A compact, UIKit-free index of the horizontal layout of the pages in a snap scroll view.
+ *
+ *  @note Pages are stored as contiguous arrays of origins and widths, so the origins are the prefix sums of the widths.
+ *  Since origins never decrease, range queries are answered with a binary search.
+ *
+ *  The index also keeps track of the pages whose widths were invalidated, inserted or removed, so a validation pass only
+ *  queries the widths of those pages and recomputes the origins from the first affected page onwards.
+ */
+typedef struct MMSnapPageIndex *MMSnapPageIndexRef;
+
+/**
+ *  A range of pages.
+ */
+typedef struct {
+    long location;
+    long length;
+} MMSnapPageRange;
+
+/**
+ *  Value returned by lookups that can't locate a page.
+ */
+#define MMSnapPageNotFound (-1L)
+
+/**
+ *  A function returning the width of a page, used to validate the pages with an invalidated width.
+ */
+typedef double (*MMSnapPageWidthFunction)(long page, void *context);
+
+/**
+ *  Returns a new empty page index or @c NULL if there was a problem allocating it.
+ */
+MMSnapPageIndexRef MMSnapPageIndexCreate(void);
+
+/**
+ *  Frees a page index and its storage. Passing @c NULL is allowed.
+ */
+void MMSnapPageIndexRelease(MMSnapPageIndexRef pageIndex);
+
+/**
+ *  Removes all pages from the index, keeping its storage for reuse.
+ */
+void MMSnapPageIndexRemoveAllPages(MMSnapPageIndexRef pageIndex);
+
+/**
+ *  Appends a page at the end of the index.
+ *
+ *  @param pageIndex The page index.
+ *  @param width     The width of the page. Negative values are treated as zero.
+ *
+ *  @return @c false if the storage could not be grown.
+ */
+bool MMSnapPageIndexAppendPage(MMSnapPageIndexRef pageIndex, double width);
+
+/**
+ *  Inserts pages with an invalidated width.
+ *
+ *  @param pageIndex The page index.
+ *  @param page      The location of the first inserted page. Must be between zero and the number of pages.
+ *  @param count     The number of pages to insert.
+ *
+ *  @return @c false if the storage could not be grown.
+ */
+bool MMSnapPageIndexInsertPages(MMSnapPageIndexRef pageIndex, long page, long count);
+
+/**
+ *  Removes pages from the index. The origins of the following pages are shifted on the next validation.
+ *
+ *  @param pageIndex The page index.
+ *  @param page      The location of the first removed page.
+ *  @param count     The number of pages to remove. The range is clamped to the number of pages.
+ */
+void MMSnapPageIndexRemovePages(MMSnapPageIndexRef pageIndex, long page, long count);
+
+/**
+ *  Removes scattered pages from the index in a single pass.
+ *
+ *  @param pageIndex The page index.
+ *  @param pages     The pages to remove, in strictly ascending order. Pages out of range are ignored.
+ *  @param count     The number of pages in @c pages.
+ */
+void MMSnapPageIndexRemovePagesAtIndexes(MMSnapPageIndexRef pageIndex, const long *pages, long count);
+
+/**
+ *  Inserts scattered pages with an invalidated width in a single pass.
+ *
+ *  @param pageIndex The page index.
+ *  @param pages     The locations of the inserted pages after the insertion, in strictly ascending order.
+ *  @param count     The number of pages in @c pages.
+ *
+ *  @return @c false if the storage could not be grown or a location is out of range.
+ */
+bool MMSnapPageIndexInsertPagesAtIndexes(MMSnapPageIndexRef pageIndex, const long *pages, long count);
+
+/**
+ *  Sets the width of a page and marks it as valid.
+ */
+void MMSnapPageIndexSetWidth(MMSnapPageIndexRef pageIndex, long page, double width);
+
+/**
+ *  Marks the width of a page as invalid, so it's queried again on the next validation.
+ */
+void MMSnapPageIndexInvalidatePage(MMSnapPageIndexRef pageIndex, long page);
+
+/**
+ *  Marks the width of every page as invalid.
+ */
+void MMSnapPageIndexInvalidateAllPages(MMSnapPageIndexRef pageIndex);
+
+/**
+ *  Returns @c true if any page has an invalidated width.
+ */
+bool MMSnapPageIndexNeedsValidation(MMSnapPageIndexRef pageIndex);
+
+/**
+ *  Queries the widths of the invalidated pages and updates the origins of the pages that follow them.
+ *
+ *  @param pageIndex     The page index.
+ *  @param widthFunction The function returning the width of a page.
+ *  @param context       A pointer passed to @c widthFunction.
+ *
+ *  @return The number of widths that were queried.
+ *
+ *  @note The cost of a validation is proportional to the number of invalidated pages plus the number of pages after the first one.
+ */
+long MMSnapPageIndexValidate(MMSnapPageIndexRef pageIndex, MMSnapPageWidthFunction widthFunction, void *context);
+
+/**
+ *  Returns the number of widths queried by the last call to @c MMSnapPageIndexValidate.
+ */
+long MMSnapPageIndexGetLastValidationQueryCount(MMSnapPageIndexRef pageIndex);
+
+/**
+ *  Returns the number of pages in the index.
+ */
+long MMSnapPageIndexGetCount(MMSnapPageIndexRef pageIndex);
+
+/**
+ *  Returns the origin of a page, or zero if the page is out of range.
+ */
+double MMSnapPageIndexGetOrigin(MMSnapPageIndexRef pageIndex, long page);
+
+/**
+ *  Returns the width of a page, or zero if the page is out of range.
+ */
+double MMSnapPageIndexGetWidth(MMSnapPageIndexRef pageIndex, long page);
+
+/**
+ *  Returns the sum of the widths of all pages.
+ */
+double MMSnapPageIndexGetContentWidth(MMSnapPageIndexRef pageIndex);
+
+/**
+ *  Returns the range of pages intersecting the open interval between @c minX and @c maxX.
+ *
+ *  @note Pages that only touch the interval at one of its edges are not included, which matches @c CGRectIntersectsRect.
+ *  Runs in O(log n). Returns a range of length zero if no page intersects.
+ */
+MMSnapPageRange MMSnapPageIndexGetPagesInRange(MMSnapPageIndexRef pageIndex, double minX, double maxX);
+
+/**
+ *  Returns the page containing the specified horizontal offset, or @c MMSnapPageNotFound if there isn't one.
+ */
+long MMSnapPageIndexGetPageAtOffset(MMSnapPageIndexRef pageIndex, double x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapPageIndex_h */
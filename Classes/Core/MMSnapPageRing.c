@@ -0,0 +1,354 @@
+//
+//  MMSnapPageRing.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapPageRing.h"
+#include "MMSnapPageIndex.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct {
+    const void *value;
+    long page;
+} MMSnapPageRingEntry;
+
+struct MMSnapPageRing {
+    MMSnapPageRingCallbacks callbacks;
+    
+    // Elements of capacity pages, the ones outside the run are always NULL.
+    const void **slots;
+    long capacity;
+    long head;
+    
+    long firstPage;
+    long pageCount;
+    long elementCounts[MMSnapPageRingElementCount];
+    
+    // Open addressing table from element to page.
+    MMSnapPageRingEntry *entries;
+    long entryCapacity;
+    long entryCount;
+    
+    unsigned long mutationCount;
+};
+
+static inline size_t MMSnapPageRingHash(const void *value)
+{
+    // Pointers are aligned, so mix the high bits into the low ones before masking.
+    uint64_t x = (uint64_t)(uintptr_t)value;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (size_t)x;
+}
+
+MMSnapPageRingRef MMSnapPageRingCreate(const MMSnapPageRingCallbacks *callbacks)
+{
+    MMSnapPageRingRef ring = calloc(1, sizeof(struct MMSnapPageRing));
+    if (ring && callbacks) {
+        ring->callbacks = *callbacks;
+    }
+    return ring;
+}
+
+void MMSnapPageRingRelease(MMSnapPageRingRef ring)
+{
+    if (ring) {
+        MMSnapPageRingRemoveAllElements(ring);
+        free(ring->slots);
+        free(ring->entries);
+        free(ring);
+    }
+}
+
+static inline const void **MMSnapPageRingSlot(MMSnapPageRingRef ring, long page)
+{
+    const long slot = (ring->head + (page - ring->firstPage)) & (ring->capacity - 1);
+    return &ring->slots[slot * MMSnapPageRingElementCount];
+}
+
+// Reverse map.
+
+static long MMSnapPageRingFindEntry(MMSnapPageRingRef ring, const void *value)
+{
+    if (ring->entryCapacity == 0) {
+        return -1;
+    }
+    
+    const long mask = ring->entryCapacity - 1;
+    long slot = (long)(MMSnapPageRingHash(value) & (size_t)mask);
+    
+    while (ring->entries[slot].value) {
+        if (ring->entries[slot].value == value) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+static void MMSnapPageRingInsertEntry(MMSnapPageRingEntry *entries, long capacity, const void *value, long page)
+{
+    const long mask = capacity - 1;
+    long slot = (long)(MMSnapPageRingHash(value) & (size_t)mask);
+    
+    while (entries[slot].value && entries[slot].value != value) {
+        slot = (slot + 1) & mask;
+    }
+    entries[slot].value = value;
+    entries[slot].page = page;
+}
+
+static bool MMSnapPageRingSetEntry(MMSnapPageRingRef ring, const void *value, long page)
+{
+    // Keep the load under one half.
+    if ((ring->entryCount + 1) * 2 > ring->entryCapacity) {
+        const long capacity = ring->entryCapacity > 0 ? ring->entryCapacity * 2 : 16;
+        MMSnapPageRingEntry *entries = calloc((size_t)capacity, sizeof(MMSnapPageRingEntry));
+        if (!entries) {
+            return false;
+        }
+        for (long idx = 0; idx < ring->entryCapacity; idx++) {
+            if (ring->entries[idx].value) {
+                MMSnapPageRingInsertEntry(entries, capacity, ring->entries[idx].value, ring->entries[idx].page);
+            }
+        }
+        free(ring->entries);
+        ring->entries = entries;
+        ring->entryCapacity = capacity;
+    }
+    
+    MMSnapPageRingInsertEntry(ring->entries, ring->entryCapacity, value, page);
+    ring->entryCount++;
+    
+    return true;
+}
+
+static void MMSnapPageRingRemoveEntry(MMSnapPageRingRef ring, const void *value)
+{
+    long slot = MMSnapPageRingFindEntry(ring, value);
+    if (slot < 0) {
+        return;
+    }
+    
+    // Shift the following entries of the cluster back, so lookups never need tombstones.
+    const long mask = ring->entryCapacity - 1;
+    MMSnapPageRingEntry *entries = ring->entries;
+    
+    long next = (slot + 1) & mask;
+    while (entries[next].value) {
+        const long home = (long)(MMSnapPageRingHash(entries[next].value) & (size_t)mask);
+        const bool movable = (slot <= next) ? (home <= slot || home > next) : (home <= slot && home > next);
+        if (movable) {
+            entries[slot] = entries[next];
+            slot = next;
+        }
+        next = (next + 1) & mask;
+    }
+    entries[slot].value = NULL;
+    ring->entryCount--;
+}
+
+// Run of pages.
+
+static bool MMSnapPageRingReserve(MMSnapPageRingRef ring, long pageCount)
+{
+    if (pageCount <= ring->capacity) {
+        return true;
+    }
+    
+    long capacity = ring->capacity > 0 ? ring->capacity : 8;
+    while (capacity < pageCount) {
+        capacity *= 2;
+    }
+    
+    const void **slots = calloc((size_t)capacity * MMSnapPageRingElementCount, sizeof(void *));
+    if (!slots) {
+        return false;
+    }
+    
+    // Unwrap the run at the start of the new storage.
+    for (long idx = 0; idx < ring->pageCount; idx++) {
+        const void **slot = MMSnapPageRingSlot(ring, ring->firstPage + idx);
+        for (int element = 0; element < MMSnapPageRingElementCount; element++) {
+            slots[idx * MMSnapPageRingElementCount + element] = slot[element];
+        }
+    }
+    
+    free(ring->slots);
+    ring->slots = slots;
+    ring->capacity = capacity;
+    ring->head = 0;
+    
+    return true;
+}
+
+static bool MMSnapPageRingIsPageEmpty(MMSnapPageRingRef ring, long page)
+{
+    const void **slot = MMSnapPageRingSlot(ring, page);
+    for (int element = 0; element < MMSnapPageRingElementCount; element++) {
+        if (slot[element]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Grows the run to include the page.
+static bool MMSnapPageRingIncludePage(MMSnapPageRingRef ring, long page)
+{
+    if (ring->pageCount == 0) {
+        if (!MMSnapPageRingReserve(ring, 1)) {
+            return false;
+        }
+        ring->firstPage = page;
+        ring->head = 0;
+        ring->pageCount = 1;
+        return true;
+    }
+    
+    if (page < ring->firstPage) {
+        const long grow = ring->firstPage - page;
+        if (!MMSnapPageRingReserve(ring, ring->pageCount + grow)) {
+            return false;
+        }
+        ring->head = (ring->head - grow) & (ring->capacity - 1);
+        ring->firstPage = page;
+        ring->pageCount += grow;
+    } else if (page >= ring->firstPage + ring->pageCount) {
+        const long pageCount = page - ring->firstPage + 1;
+        if (!MMSnapPageRingReserve(ring, pageCount)) {
+            return false;
+        }
+        ring->pageCount = pageCount;
+    }
+    return true;
+}
+
+// Shrinks the run so it starts and ends with a page storing an element.
+static void MMSnapPageRingTrim(MMSnapPageRingRef ring)
+{
+    while (ring->pageCount > 0 && MMSnapPageRingIsPageEmpty(ring, ring->firstPage)) {
+        ring->head = (ring->head + 1) & (ring->capacity - 1);
+        ring->firstPage++;
+        ring->pageCount--;
+    }
+    while (ring->pageCount > 0 && MMSnapPageRingIsPageEmpty(ring, ring->firstPage + ring->pageCount - 1)) {
+        ring->pageCount--;
+    }
+}
+
+void MMSnapPageRingRemoveAllElements(MMSnapPageRingRef ring)
+{
+    for (long page = ring->firstPage; page < ring->firstPage + ring->pageCount; page++) {
+        const void **slot = MMSnapPageRingSlot(ring, page);
+        for (int element = 0; element < MMSnapPageRingElementCount; element++) {
+            if (slot[element] && ring->callbacks.release) {
+                ring->callbacks.release(slot[element]);
+            }
+            slot[element] = NULL;
+        }
+    }
+    
+    for (long idx = 0; idx < ring->entryCapacity; idx++) {
+        ring->entries[idx].value = NULL;
+    }
+    
+    ring->entryCount = 0;
+    ring->pageCount = 0;
+    for (int element = 0; element < MMSnapPageRingElementCount; element++) {
+        ring->elementCounts[element] = 0;
+    }
+    ring->mutationCount++;
+}
+
+long MMSnapPageRingGetFirstPage(MMSnapPageRingRef ring)
+{
+    return ring->firstPage;
+}
+
+long MMSnapPageRingGetPageCount(MMSnapPageRingRef ring)
+{
+    return ring->pageCount;
+}
+
+long MMSnapPageRingGetElementCount(MMSnapPageRingRef ring, MMSnapPageRingElement element)
+{
+    return ring->elementCounts[element];
+}
+
+const void *MMSnapPageRingGetElement(MMSnapPageRingRef ring, long page, MMSnapPageRingElement element)
+{
+    if (page < ring->firstPage || page >= ring->firstPage + ring->pageCount) {
+        return NULL;
+    }
+    return MMSnapPageRingSlot(ring, page)[element];
+}
+
+bool MMSnapPageRingSetElement(MMSnapPageRingRef ring, long page, MMSnapPageRingElement element, const void *value)
+{
+    const void *previous = MMSnapPageRingGetElement(ring, page, element);
+    if (previous == value) {
+        return true;
+    }
+    
+    if (value) {
+        // Move the element if it's stored somewhere else.
+        const long entry = MMSnapPageRingFindEntry(ring, value);
+        if (entry >= 0) {
+            const long previousPage = ring->entries[entry].page;
+            for (int other = 0; other < MMSnapPageRingElementCount; other++) {
+                if (MMSnapPageRingGetElement(ring, previousPage, other) == value) {
+                    MMSnapPageRingSetElement(ring, previousPage, other, NULL);
+                    break;
+                }
+            }
+        }
+        
+        if (!MMSnapPageRingIncludePage(ring, page) || !MMSnapPageRingSetEntry(ring, value, page)) {
+            MMSnapPageRingTrim(ring);
+            return false;
+        }
+        if (ring->callbacks.retain) {
+            value = ring->callbacks.retain(value);
+        }
+        ring->elementCounts[element]++;
+    }
+    
+    if (previous) {
+        MMSnapPageRingRemoveEntry(ring, previous);
+        if (ring->callbacks.release) {
+            ring->callbacks.release(previous);
+        }
+        ring->elementCounts[element]--;
+    }
+    
+    MMSnapPageRingSlot(ring, page)[element] = value;
+    
+    if (!value) {
+        MMSnapPageRingTrim(ring);
+    }
+    
+    ring->mutationCount++;
+    
+    return true;
+}
+
+long MMSnapPageRingGetPageOfElement(MMSnapPageRingRef ring, const void *value)
+{
+    if (!value) {
+        return MMSnapPageNotFound;
+    }
+    
+    const long entry = MMSnapPageRingFindEntry(ring, value);
+    return (entry >= 0) ? ring->entries[entry].page : MMSnapPageNotFound;
+}
+
+unsigned long MMSnapPageRingGetMutationCount(MMSnapPageRingRef ring)
+{
+    return ring->mutationCount;
+}
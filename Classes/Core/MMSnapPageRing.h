@@ -0,0 +1,102 @@
+//
+//  MMSnapPageRing.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapPageRing_h
+#define MMSnapPageRing_h
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  Stores the elements displayed for a contiguous run of pages, indexed by their distance to the first page.
+ *
+ *  @note The run grows and shrinks at both ends without moving the stored elements, and a reverse map locates the page
+ *  of an element, so reading, writing and locating elements cost O(1).
+ */
+typedef struct MMSnapPageRing *MMSnapPageRingRef;
+
+/**
+ *  The elements stored for each page.
+ */
+typedef enum {
+    MMSnapPageRingElementView,
+    MMSnapPageRingElementSeparator,
+    MMSnapPageRingElementCount
+} MMSnapPageRingElement;
+
+/**
+ *  Callbacks used to retain and release the stored elements. Either can be @c NULL.
+ */
+typedef struct {
+    const void *(*retain)(const void *value);
+    void (*release)(const void *value);
+} MMSnapPageRingCallbacks;
+
+/**
+ *  Returns a new empty ring or @c NULL if there was a problem allocating it.
+ *
+ *  @param callbacks The callbacks used for the elements, or @c NULL to store them without retaining them.
+ */
+MMSnapPageRingRef MMSnapPageRingCreate(const MMSnapPageRingCallbacks *callbacks);
+
+/**
+ *  Releases the stored elements and frees the ring. Passing @c NULL is allowed.
+ */
+void MMSnapPageRingRelease(MMSnapPageRingRef ring);
+
+/**
+ *  Releases and removes all the stored elements.
+ */
+void MMSnapPageRingRemoveAllElements(MMSnapPageRingRef ring);
+
+/**
+ *  Returns the first page of the run, only meaningful if the run is not empty.
+ */
+long MMSnapPageRingGetFirstPage(MMSnapPageRingRef ring);
+
+/**
+ *  Returns the number of pages between the first and the last page storing an element, both included.
+ */
+long MMSnapPageRingGetPageCount(MMSnapPageRingRef ring);
+
+/**
+ *  Returns the number of stored elements of a kind.
+ */
+long MMSnapPageRingGetElementCount(MMSnapPageRingRef ring, MMSnapPageRingElement element);
+
+/**
+ *  Returns the element of a kind stored for a page, or @c NULL.
+ */
+const void *MMSnapPageRingGetElement(MMSnapPageRingRef ring, long page, MMSnapPageRingElement element);
+
+/**
+ *  Stores an element for a page, releasing the previous one. Pass @c NULL to remove it.
+ *
+ *  @return @c false if the storage could not be grown.
+ *
+ *  @note An element can only be stored once. Storing it for another page removes it from its previous page.
+ */
+bool MMSnapPageRingSetElement(MMSnapPageRingRef ring, long page, MMSnapPageRingElement element, const void *value);
+
+/**
+ *  Returns the page storing an element, or @c MMSnapPageNotFound.
+ */
+long MMSnapPageRingGetPageOfElement(MMSnapPageRingRef ring, const void *value);
+
+/**
+ *  Returns a counter incremented on every change, useful to invalidate values derived from the ring.
+ */
+unsigned long MMSnapPageRingGetMutationCount(MMSnapPageRingRef ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapPageRing_h */
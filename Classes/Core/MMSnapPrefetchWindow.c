@@ -0,0 +1,75 @@
+//
+//  MMSnapPrefetchWindow.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapPrefetchWindow.h"
+
+static inline bool MMSnapPageRangeContainsPage(MMSnapPageRange range, long page)
+{
+    return page >= range.location && page < range.location + range.length;
+}
+
+MMSnapPrefetchWindow MMSnapPrefetchWindowMake(MMSnapPageRange visible, long pageCount, long direction, long lookAhead)
+{
+    MMSnapPrefetchWindow window = { { 0, 0 }, { 0, 0 } };
+    
+    if (visible.length <= 0 || lookAhead <= 0) {
+        return window;
+    }
+    
+    long leadingCount = 0;
+    long trailingCount = 0;
+    
+    if (direction > 0) {
+        trailingCount = lookAhead;
+    } else if (direction < 0) {
+        leadingCount = lookAhead;
+    } else {
+        leadingCount = 1;
+        trailingCount = 1;
+    }
+    
+    const long first = visible.location;
+    const long end = visible.location + visible.length;
+    
+    if (leadingCount > first) {
+        leadingCount = first;
+    }
+    if (trailingCount > pageCount - end) {
+        trailingCount = (pageCount > end) ? pageCount - end : 0;
+    }
+    
+    window.leading = (MMSnapPageRange){ first - leadingCount, leadingCount };
+    window.trailing = (MMSnapPageRange){ end, trailingCount };
+    
+    return window;
+}
+
+bool MMSnapPrefetchWindowContainsPage(const MMSnapPrefetchWindow *window, long page)
+{
+    return MMSnapPageRangeContainsPage(window->leading, page) || MMSnapPageRangeContainsPage(window->trailing, page);
+}
+
+long MMSnapPrefetchWindowGetPageCount(const MMSnapPrefetchWindow *window)
+{
+    return window->leading.length + window->trailing.length;
+}
+
+long MMSnapPrefetchWindowCopyPagesNotInWindow(const MMSnapPrefetchWindow *window, const MMSnapPrefetchWindow *other, MMSnapPageRange excluded, long *pages, long capacity)
+{
+    const MMSnapPageRange ranges[] = { window->leading, window->trailing };
+    long count = 0;
+    
+    for (int idx = 0; idx < 2; idx++) {
+        const MMSnapPageRange range = ranges[idx];
+        for (long page = range.location; page < range.location + range.length && count < capacity; page++) {
+            if (!MMSnapPrefetchWindowContainsPage(other, page) && !MMSnapPageRangeContainsPage(excluded, page)) {
+                pages[count++] = page;
+            }
+        }
+    }
+    return count;
+}
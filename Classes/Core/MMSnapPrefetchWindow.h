@@ -0,0 +1,75 @@
+//
+//  MMSnapPrefetchWindow.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapPrefetchWindow_h
+#define MMSnapPrefetchWindow_h
+
+#include "MMSnapPageIndex.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  The pages around the visible pages that should be prepared before they scroll into view.
+ */
+typedef struct {
+    /**
+     *  The pages before the visible pages.
+     */
+    MMSnapPageRange leading;
+    /**
+     *  The pages after the visible pages.
+     */
+    MMSnapPageRange trailing;
+} MMSnapPrefetchWindow;
+
+/**
+ *  Returns the window of pages to prefetch.
+ *
+ *  @param visible   The visible pages.
+ *  @param pageCount The number of pages.
+ *  @param direction The direction of the scrolling: positive towards the following pages, negative towards the previous
+ *                   pages and zero when it is unknown.
+ *  @param lookAhead The number of pages to prefetch in the direction of the scrolling.
+ *
+ *  @return The window, clamped to the available pages. When the direction is unknown, a single page is prefetched on
+ *  each side.
+ */
+MMSnapPrefetchWindow MMSnapPrefetchWindowMake(MMSnapPageRange visible, long pageCount, long direction, long lookAhead);
+
+/**
+ *  Returns @c true if the window contains a page.
+ */
+bool MMSnapPrefetchWindowContainsPage(const MMSnapPrefetchWindow *window, long page);
+
+/**
+ *  Returns the number of pages in the window.
+ */
+long MMSnapPrefetchWindowGetPageCount(const MMSnapPrefetchWindow *window);
+
+/**
+ *  Copies the pages of a window that are neither in another window nor in a range.
+ *
+ *  @param window   The window whose pages are copied.
+ *  @param other    The window whose pages are skipped.
+ *  @param excluded A range of pages that are skipped as well, for example the visible pages.
+ *  @param pages    A buffer receiving the pages in ascending order.
+ *  @param capacity The capacity of the buffer. The number of pages in @c window is always enough.
+ *
+ *  @return The number of copied pages.
+ *
+ *  @note Pages of the new window missing in the previous one must be prefetched, and pages of the previous window
+ *  missing in the new one (that didn't become visible) can be cancelled.
+ */
+long MMSnapPrefetchWindowCopyPagesNotInWindow(const MMSnapPrefetchWindow *window, const MMSnapPrefetchWindow *other, MMSnapPageRange excluded, long *pages, long capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapPrefetchWindow_h */
@@ -0,0 +1,254 @@
+//
+//  MMSnapRasterizationPolicy.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapRasterizationPolicy.h"
+
+#include <stdlib.h>
+
+typedef struct {
+    const void *key;
+    unsigned long long byteCount;
+    // The value of the use counter when the snapshot was last displayed.
+    unsigned long lastUse;
+    bool displayed;
+} MMSnapRasterizationEntry;
+
+struct MMSnapRasterizationPolicy {
+    MMSnapRasterizationConfiguration configuration;
+    
+    MMSnapRasterizationEntry *entries;
+    long count;
+    long capacity;
+    
+    unsigned long long byteCount;
+    unsigned long useCounter;
+    
+    MMSnapRasterizationStatistics statistics;
+};
+
+MMSnapRasterizationConfiguration MMSnapRasterizationConfigurationDefault(void)
+{
+    return (MMSnapRasterizationConfiguration){
+        .rasterizeThreshold = 0.2,
+        .restoreThreshold = 0.1,
+        .maximumByteCount = 32ULL * 1024ULL * 1024ULL
+    };
+}
+
+MMSnapRasterizationPolicyRef MMSnapRasterizationPolicyCreate(void)
+{
+    MMSnapRasterizationPolicyRef policy = calloc(1, sizeof(struct MMSnapRasterizationPolicy));
+    if (policy) {
+        policy->configuration = MMSnapRasterizationConfigurationDefault();
+    }
+    return policy;
+}
+
+void MMSnapRasterizationPolicyRelease(MMSnapRasterizationPolicyRef policy)
+{
+    if (policy) {
+        free(policy->entries);
+        free(policy);
+    }
+}
+
+void MMSnapRasterizationPolicySetConfiguration(MMSnapRasterizationPolicyRef policy, MMSnapRasterizationConfiguration configuration)
+{
+    policy->configuration = configuration;
+}
+
+MMSnapRasterizationConfiguration MMSnapRasterizationPolicyGetConfiguration(MMSnapRasterizationPolicyRef policy)
+{
+    return policy->configuration;
+}
+
+// Snapshots.
+
+static long MMSnapRasterizationPolicyFindKey(MMSnapRasterizationPolicyRef policy, const void *key)
+{
+    for (long idx = 0; idx < policy->count; idx++) {
+        if (policy->entries[idx].key == key) {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+static void MMSnapRasterizationPolicyRemoveEntry(MMSnapRasterizationPolicyRef policy, long entry)
+{
+    policy->byteCount -= policy->entries[entry].byteCount;
+    
+    // Order doesn't matter, the use counter keeps track of recency.
+    policy->entries[entry] = policy->entries[policy->count - 1];
+    policy->count--;
+}
+
+static unsigned long long MMSnapRasterizationPolicyGetDisplayedByteCount(MMSnapRasterizationPolicyRef policy)
+{
+    unsigned long long byteCount = 0;
+    for (long idx = 0; idx < policy->count; idx++) {
+        if (policy->entries[idx].displayed) {
+            byteCount += policy->entries[idx].byteCount;
+        }
+    }
+    return byteCount;
+}
+
+MMSnapRasterizationAction MMSnapRasterizationPolicyUpdate(MMSnapRasterizationPolicyRef policy, const void *key, double percentDisappeared)
+{
+    const MMSnapRasterizationConfiguration configuration = policy->configuration;
+    
+    const long entry = MMSnapRasterizationPolicyFindKey(policy, key);
+    
+    if (entry >= 0 && policy->entries[entry].displayed) {
+        if (percentDisappeared < configuration.restoreThreshold) {
+            policy->entries[entry].displayed = false;
+            policy->statistics.restoreCount++;
+            return MMSnapRasterizationActionShowLiveView;
+        }
+        
+        policy->entries[entry].lastUse = ++policy->useCounter;
+        return MMSnapRasterizationActionNone;
+    }
+    
+    if (percentDisappeared < configuration.rasterizeThreshold) {
+        return MMSnapRasterizationActionNone;
+    }
+    
+    if (entry >= 0) {
+        policy->entries[entry].displayed = true;
+        policy->entries[entry].lastUse = ++policy->useCounter;
+        policy->statistics.reuseCount++;
+        return MMSnapRasterizationActionShowSnapshot;
+    }
+    
+    return MMSnapRasterizationActionRasterize;
+}
+
+bool MMSnapRasterizationPolicySetSnapshot(MMSnapRasterizationPolicyRef policy, const void *key, unsigned long long byteCount)
+{
+    long entry = MMSnapRasterizationPolicyFindKey(policy, key);
+    if (entry >= 0) {
+        MMSnapRasterizationPolicyRemoveEntry(policy, entry);
+    }
+    
+    // Snapshots that aren't displayed can be evicted to make room, the displayed ones can't.
+    if (MMSnapRasterizationPolicyGetDisplayedByteCount(policy) + byteCount > policy->configuration.maximumByteCount) {
+        return false;
+    }
+    
+    if (policy->count == policy->capacity) {
+        const long capacity = (policy->capacity > 0) ? policy->capacity * 2 : 8;
+        MMSnapRasterizationEntry *entries = realloc(policy->entries, (size_t)capacity * sizeof(MMSnapRasterizationEntry));
+        if (!entries) {
+            return false;
+        }
+        policy->entries = entries;
+        policy->capacity = capacity;
+    }
+    
+    entry = policy->count++;
+    policy->entries[entry] = (MMSnapRasterizationEntry){ key, byteCount, ++policy->useCounter, true };
+    policy->byteCount += byteCount;
+    policy->statistics.rasterizeCount++;
+    
+    return true;
+}
+
+bool MMSnapRasterizationPolicyHide(MMSnapRasterizationPolicyRef policy, const void *key)
+{
+    const long entry = MMSnapRasterizationPolicyFindKey(policy, key);
+    if (entry < 0 || !policy->entries[entry].displayed) {
+        return false;
+    }
+    
+    policy->entries[entry].displayed = false;
+    return true;
+}
+
+bool MMSnapRasterizationPolicyInvalidate(MMSnapRasterizationPolicyRef policy, const void *key)
+{
+    const long entry = MMSnapRasterizationPolicyFindKey(policy, key);
+    if (entry < 0) {
+        return false;
+    }
+    
+    const bool displayed = policy->entries[entry].displayed;
+    MMSnapRasterizationPolicyRemoveEntry(policy, entry);
+    return displayed;
+}
+
+bool MMSnapRasterizationPolicyContainsSnapshot(MMSnapRasterizationPolicyRef policy, const void *key)
+{
+    return MMSnapRasterizationPolicyFindKey(policy, key) >= 0;
+}
+
+bool MMSnapRasterizationPolicyIsDisplayingSnapshot(MMSnapRasterizationPolicyRef policy, const void *key)
+{
+    const long entry = MMSnapRasterizationPolicyFindKey(policy, key);
+    return entry >= 0 && policy->entries[entry].displayed;
+}
+
+long MMSnapRasterizationPolicyGetCount(MMSnapRasterizationPolicyRef policy)
+{
+    return policy->count;
+}
+
+unsigned long long MMSnapRasterizationPolicyGetByteCount(MMSnapRasterizationPolicyRef policy)
+{
+    return policy->byteCount;
+}
+
+// Evictions.
+
+long MMSnapRasterizationPolicyEvict(MMSnapRasterizationPolicyRef policy, unsigned long long maximumByteCount, const void **keys, long capacity)
+{
+    if (maximumByteCount > policy->configuration.maximumByteCount) {
+        maximumByteCount = policy->configuration.maximumByteCount;
+    }
+    
+    long evictedCount = 0;
+    
+    while (policy->byteCount > maximumByteCount && evictedCount < capacity) {
+        long leastRecent = -1;
+        for (long idx = 0; idx < policy->count; idx++) {
+            const MMSnapRasterizationEntry *entry = &policy->entries[idx];
+            if (!entry->displayed && (leastRecent < 0 || entry->lastUse < policy->entries[leastRecent].lastUse)) {
+                leastRecent = idx;
+            }
+        }
+        
+        // Only displayed snapshots left.
+        if (leastRecent < 0) {
+            break;
+        }
+        
+        keys[evictedCount++] = policy->entries[leastRecent].key;
+        MMSnapRasterizationPolicyRemoveEntry(policy, leastRecent);
+        policy->statistics.evictionCount++;
+    }
+    
+    return evictedCount;
+}
+
+void MMSnapRasterizationPolicyRemoveAll(MMSnapRasterizationPolicyRef policy)
+{
+    policy->count = 0;
+    policy->byteCount = 0;
+}
+
+// Statistics.
+
+MMSnapRasterizationStatistics MMSnapRasterizationPolicyGetStatistics(MMSnapRasterizationPolicyRef policy)
+{
+    return policy->statistics;
+}
+
+void MMSnapRasterizationPolicyResetStatistics(MMSnapRasterizationPolicyRef policy)
+{
+    policy->statistics = (MMSnapRasterizationStatistics){ 0, 0, 0, 0 };
+}
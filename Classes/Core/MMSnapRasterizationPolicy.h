@@ -0,0 +1,204 @@
+//
+//  MMSnapRasterizationPolicy.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapRasterizationPolicy_h
+#define MMSnapRasterizationPolicy_h
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  Decides when the pages sliding behind the following pages are swapped for a rasterized snapshot, and which snapshots
+ *  to keep within a memory budget.
+ *
+ *  @note Pages are swapped for their snapshot once they disappear past a threshold, and swapped back to their live view
+ *  once they re-emerge below a lower threshold, so pages resting around a threshold don't flip back and forth. Snapshots
+ *  stay cached after their page is swapped back or hidden, and the least recently used ones are evicted when the
+ *  budget is exceeded, except the snapshots being displayed. Pages are identified by an opaque key, usually their view.
+ *  The number of snapshots is expected to be small, lookups cost O(n).
+ */
+typedef struct MMSnapRasterizationPolicy *MMSnapRasterizationPolicyRef;
+
+/**
+ *  What to do with a page after its disappear percent changed.
+ */
+typedef enum {
+    /**
+     *  Keep displaying the page as it is.
+     */
+    MMSnapRasterizationActionNone,
+    /**
+     *  Take a snapshot of the page, record it with @c MMSnapRasterizationPolicySetSnapshot and display it instead of the
+     *  live view.
+     */
+    MMSnapRasterizationActionRasterize,
+    /**
+     *  Display the cached snapshot instead of the live view.
+     */
+    MMSnapRasterizationActionShowSnapshot,
+    /**
+     *  Display the live view again, keeping the snapshot cached.
+     */
+    MMSnapRasterizationActionShowLiveView
+} MMSnapRasterizationAction;
+
+/**
+ *  The thresholds and the budget of a policy.
+ */
+typedef struct {
+    /**
+     *  The disappear percent from which pages are displayed as a snapshot. Defaults to @c 0.2.
+     */
+    double rasterizeThreshold;
+    /**
+     *  The disappear percent under which pages are displayed live again. Defaults to @c 0.1.
+     */
+    double restoreThreshold;
+    /**
+     *  The maximum sum of the sizes of the cached snapshots, in bytes. Defaults to 32 MB.
+     */
+    unsigned long long maximumByteCount;
+} MMSnapRasterizationConfiguration;
+
+/**
+ *  Counters of a policy.
+ */
+typedef struct {
+    /**
+     *  The number of snapshots taken.
+     */
+    unsigned long rasterizeCount;
+    /**
+     *  The number of times a cached snapshot was displayed again.
+     */
+    unsigned long reuseCount;
+    /**
+     *  The number of times a live view was displayed again.
+     */
+    unsigned long restoreCount;
+    /**
+     *  The number of snapshots evicted to stay within the budget.
+     */
+    unsigned long evictionCount;
+} MMSnapRasterizationStatistics;
+
+/**
+ *  Returns the default configuration.
+ */
+MMSnapRasterizationConfiguration MMSnapRasterizationConfigurationDefault(void);
+
+/**
+ *  Returns a new policy without snapshots using the default configuration, or @c NULL if there was a problem allocating it.
+ */
+MMSnapRasterizationPolicyRef MMSnapRasterizationPolicyCreate(void);
+
+/**
+ *  Frees a policy. Passing @c NULL is allowed.
+ */
+void MMSnapRasterizationPolicyRelease(MMSnapRasterizationPolicyRef policy);
+
+/**
+ *  Sets the configuration used by the following updates and evictions.
+ */
+void MMSnapRasterizationPolicySetConfiguration(MMSnapRasterizationPolicyRef policy, MMSnapRasterizationConfiguration configuration);
+
+/**
+ *  Returns the configuration of a policy.
+ */
+MMSnapRasterizationConfiguration MMSnapRasterizationPolicyGetConfiguration(MMSnapRasterizationPolicyRef policy);
+
+/**
+ *  Returns what to do with a displayed page.
+ *
+ *  @param policy             The policy.
+ *  @param key                The key identifying the page. Cannot be @c NULL.
+ *  @param percentDisappeared The amount of the page covered by the following page, between zero and one.
+ */
+MMSnapRasterizationAction MMSnapRasterizationPolicyUpdate(MMSnapRasterizationPolicyRef policy, const void *key, double percentDisappeared);
+
+/**
+ *  Records the snapshot taken for a page as displayed.
+ *
+ *  @param policy    The policy.
+ *  @param key       The key identifying the page.
+ *  @param byteCount The size of the snapshot.
+ *
+ *  @return @c false if the snapshot doesn't fit in the budget with the displayed snapshots, or if the storage could not be
+ *  grown, in which case the live view should be kept.
+ */
+bool MMSnapRasterizationPolicySetSnapshot(MMSnapRasterizationPolicyRef policy, const void *key, unsigned long long byteCount);
+
+/**
+ *  Records that a page is no longer displayed, keeping its snapshot cached.
+ *
+ *  @return @c true if its snapshot was displayed.
+ */
+bool MMSnapRasterizationPolicyHide(MMSnapRasterizationPolicyRef policy, const void *key);
+
+/**
+ *  Forgets the snapshot of a page, for example because its content changed.
+ *
+ *  @return @c true if its snapshot was displayed, in which case the live view should be displayed again.
+ */
+bool MMSnapRasterizationPolicyInvalidate(MMSnapRasterizationPolicyRef policy, const void *key);
+
+/**
+ *  Returns @c true if a page has a cached snapshot.
+ */
+bool MMSnapRasterizationPolicyContainsSnapshot(MMSnapRasterizationPolicyRef policy, const void *key);
+
+/**
+ *  Returns @c true if a page is displayed as a snapshot.
+ */
+bool MMSnapRasterizationPolicyIsDisplayingSnapshot(MMSnapRasterizationPolicyRef policy, const void *key);
+
+/**
+ *  Returns the number of cached snapshots.
+ */
+long MMSnapRasterizationPolicyGetCount(MMSnapRasterizationPolicyRef policy);
+
+/**
+ *  Returns the sum of the sizes of the cached snapshots.
+ */
+unsigned long long MMSnapRasterizationPolicyGetByteCount(MMSnapRasterizationPolicyRef policy);
+
+/**
+ *  Chooses the snapshots to discard, from the least recently used one, until the cached snapshots fit in the budget.
+ *
+ *  @param policy           The policy.
+ *  @param maximumByteCount The budget to fit in, or zero to discard every snapshot that isn't displayed, for example
+ *                          on a memory warning. Budgets larger than the configured one are ignored.
+ *  @param keys             A buffer receiving the keys of the discarded snapshots.
+ *  @param capacity         The capacity of the buffer. Evictions stop when it is full.
+ *
+ *  @return The number of discarded snapshots.
+ */
+long MMSnapRasterizationPolicyEvict(MMSnapRasterizationPolicyRef policy, unsigned long long maximumByteCount, const void **keys, long capacity);
+
+/**
+ *  Forgets every snapshot.
+ */
+void MMSnapRasterizationPolicyRemoveAll(MMSnapRasterizationPolicyRef policy);
+
+/**
+ *  Returns the counters of a policy.
+ */
+MMSnapRasterizationStatistics MMSnapRasterizationPolicyGetStatistics(MMSnapRasterizationPolicyRef policy);
+
+/**
+ *  Resets the counters of a policy.
+ */
+void MMSnapRasterizationPolicyResetStatistics(MMSnapRasterizationPolicyRef policy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapRasterizationPolicy_h */
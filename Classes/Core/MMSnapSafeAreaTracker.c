@@ -0,0 +1,260 @@
+//
+//  MMSnapSafeAreaTracker.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapSafeAreaTracker.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define MMSnapSafeAreaTrackerMaximumPropagationTimes 240
+
+typedef struct {
+    const void *key;
+    MMSnapSafeAreaInsets insets;
+} MMSnapSafeAreaTrackerEntry;
+
+struct MMSnapSafeAreaTracker {
+    // The pages of the last update, and the storage the next update is written to before both are swapped.
+    MMSnapSafeAreaTrackerEntry *entries;
+    MMSnapSafeAreaTrackerEntry *nextEntries;
+    unsigned char *matched;
+    long count;
+    long capacity;
+    
+    // The times of the last propagations, oldest first from the head.
+    double propagationTimes[MMSnapSafeAreaTrackerMaximumPropagationTimes];
+    long propagationTimesHead;
+    long propagationTimesCount;
+    
+    MMSnapSafeAreaTrackerStatistics statistics;
+};
+
+MMSnapSafeAreaTrackerRef MMSnapSafeAreaTrackerCreate(void)
+{
+    return calloc(1, sizeof(struct MMSnapSafeAreaTracker));
+}
+
+void MMSnapSafeAreaTrackerRelease(MMSnapSafeAreaTrackerRef tracker)
+{
+    if (!tracker) {
+        return;
+    }
+    
+    free(tracker->entries);
+    free(tracker->nextEntries);
+    free(tracker->matched);
+    free(tracker);
+}
+
+static bool MMSnapSafeAreaTrackerReserve(MMSnapSafeAreaTrackerRef tracker, long count)
+{
+    if (count <= tracker->capacity) {
+        return true;
+    }
+    
+    long capacity = tracker->capacity > 0 ? tracker->capacity : 8;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    
+    MMSnapSafeAreaTrackerEntry *entries = realloc(tracker->entries, (size_t)capacity * sizeof(MMSnapSafeAreaTrackerEntry));
+    if (!entries) {
+        return false;
+    }
+    tracker->entries = entries;
+    
+    MMSnapSafeAreaTrackerEntry *nextEntries = realloc(tracker->nextEntries, (size_t)capacity * sizeof(MMSnapSafeAreaTrackerEntry));
+    if (!nextEntries) {
+        return false;
+    }
+    tracker->nextEntries = nextEntries;
+    
+    unsigned char *matched = realloc(tracker->matched, (size_t)capacity);
+    if (!matched) {
+        return false;
+    }
+    tracker->matched = matched;
+    
+    tracker->capacity = capacity;
+    return true;
+}
+
+static long MMSnapSafeAreaTrackerFindKey(MMSnapSafeAreaTrackerRef tracker, const void *key)
+{
+    for (long idx = 0; idx < tracker->count; idx++) {
+        if (tracker->entries[idx].key == key) {
+            return idx;
+        }
+    }
+    return MMSnapPageNotFound;
+}
+
+static double MMSnapSafeAreaClamp(double value, double maximum)
+{
+    return fmin(fmax(value, 0.0), fmax(maximum, 0.0));
+}
+
+MMSnapSafeAreaInsets MMSnapSafeAreaGetPageInsets(MMSnapLayoutRect pageRect, MMSnapLayoutRect bounds, MMSnapSafeAreaInsets insets)
+{
+    // Only the visible part of the page counts, so pages sliding behind the edges of the viewport keep their insets.
+    const double minX = fmax(pageRect.x, bounds.x);
+    const double maxX = fmin(pageRect.x + pageRect.width, bounds.x + bounds.width);
+    const double minY = fmax(pageRect.y, bounds.y);
+    const double maxY = fmin(pageRect.y + pageRect.height, bounds.y + bounds.height);
+    
+    if (maxX <= minX || maxY <= minY) {
+        return (MMSnapSafeAreaInsets){ 0.0, 0.0, 0.0, 0.0 };
+    }
+    
+    return (MMSnapSafeAreaInsets){
+        .top = MMSnapSafeAreaClamp(bounds.y + insets.top - minY, maxY - minY),
+        .left = MMSnapSafeAreaClamp(bounds.x + insets.left - minX, maxX - minX),
+        .bottom = MMSnapSafeAreaClamp(maxY - (bounds.y + bounds.height - insets.bottom), maxY - minY),
+        .right = MMSnapSafeAreaClamp(maxX - (bounds.x + bounds.width - insets.right), maxX - minX)
+    };
+}
+
+static bool MMSnapSafeAreaInsetsEqual(MMSnapSafeAreaInsets insets, MMSnapSafeAreaInsets otherInsets)
+{
+    return insets.top == otherInsets.top && insets.left == otherInsets.left && insets.bottom == otherInsets.bottom && insets.right == otherInsets.right;
+}
+
+// Updates.
+
+static void MMSnapSafeAreaTrackerRecordPropagation(MMSnapSafeAreaTrackerRef tracker, double time)
+{
+    const long capacity = MMSnapSafeAreaTrackerMaximumPropagationTimes;
+    
+    if (tracker->propagationTimesCount < capacity) {
+        tracker->propagationTimes[(tracker->propagationTimesHead + tracker->propagationTimesCount) % capacity] = time;
+        tracker->propagationTimesCount++;
+    } else {
+        tracker->propagationTimes[tracker->propagationTimesHead] = time;
+        tracker->propagationTimesHead = (tracker->propagationTimesHead + 1) % capacity;
+    }
+}
+
+long MMSnapSafeAreaTrackerUpdate(MMSnapSafeAreaTrackerRef tracker, const MMSnapLayoutRect *rects, const void *const *keys, long count, MMSnapLayoutRect bounds, MMSnapSafeAreaInsets insets, double time, const void **changedKeys, long capacity)
+{
+    const long pageCount = (count > 0) ? count : 0;
+    
+    tracker->statistics.updateCount++;
+    
+    if (!MMSnapSafeAreaTrackerReserve(tracker, pageCount)) {
+        // Start over with no pages, so every page is reported next time.
+        tracker->count = 0;
+        tracker->statistics.propagationCount++;
+        MMSnapSafeAreaTrackerRecordPropagation(tracker, time);
+        return -1;
+    }
+    
+    for (long idx = 0; idx < tracker->count; idx++) {
+        tracker->matched[idx] = 0;
+    }
+    
+    long changedCount = 0;
+    
+    for (long idx = 0; idx < pageCount; idx++) {
+        const MMSnapSafeAreaInsets pageInsets = MMSnapSafeAreaGetPageInsets(rects[idx], bounds, insets);
+        
+        const long entry = MMSnapSafeAreaTrackerFindKey(tracker, keys[idx]);
+        if (entry != MMSnapPageNotFound) {
+            tracker->matched[entry] = 1;
+        }
+        
+        // New pages and pages whose insets changed.
+        if ((entry == MMSnapPageNotFound || !MMSnapSafeAreaInsetsEqual(tracker->entries[entry].insets, pageInsets)) && changedCount < capacity) {
+            changedKeys[changedCount++] = keys[idx];
+        }
+        
+        tracker->nextEntries[idx] = (MMSnapSafeAreaTrackerEntry){ keys[idx], pageInsets };
+    }
+    
+    // Pages that are no longer visible.
+    for (long idx = 0; idx < tracker->count; idx++) {
+        if (!tracker->matched[idx] && changedCount < capacity) {
+            changedKeys[changedCount++] = tracker->entries[idx].key;
+        }
+    }
+    
+    MMSnapSafeAreaTrackerEntry *entries = tracker->entries;
+    tracker->entries = tracker->nextEntries;
+    tracker->nextEntries = entries;
+    tracker->count = pageCount;
+    
+    if (changedCount > 0) {
+        tracker->statistics.propagationCount++;
+        tracker->statistics.changedPageCount += (unsigned long)changedCount;
+        MMSnapSafeAreaTrackerRecordPropagation(tracker, time);
+    }
+    
+    return changedCount;
+}
+
+long MMSnapSafeAreaTrackerGetPageCount(MMSnapSafeAreaTrackerRef tracker)
+{
+    return tracker->count;
+}
+
+bool MMSnapSafeAreaTrackerGetInsets(MMSnapSafeAreaTrackerRef tracker, const void *key, MMSnapSafeAreaInsets *insets)
+{
+    const long entry = MMSnapSafeAreaTrackerFindKey(tracker, key);
+    if (entry == MMSnapPageNotFound) {
+        return false;
+    }
+    
+    if (insets) {
+        *insets = tracker->entries[entry].insets;
+    }
+    return true;
+}
+
+void MMSnapSafeAreaTrackerRemoveKey(MMSnapSafeAreaTrackerRef tracker, const void *key)
+{
+    const long entry = MMSnapSafeAreaTrackerFindKey(tracker, key);
+    if (entry == MMSnapPageNotFound) {
+        return;
+    }
+    
+    for (long idx = entry + 1; idx < tracker->count; idx++) {
+        tracker->entries[idx - 1] = tracker->entries[idx];
+    }
+    tracker->count--;
+}
+
+void MMSnapSafeAreaTrackerInvalidate(MMSnapSafeAreaTrackerRef tracker)
+{
+    tracker->count = 0;
+}
+
+// Statistics.
+
+long MMSnapSafeAreaTrackerGetPropagationsPerSecond(MMSnapSafeAreaTrackerRef tracker, double time)
+{
+    const long capacity = MMSnapSafeAreaTrackerMaximumPropagationTimes;
+    
+    long count = 0;
+    for (long idx = 0; idx < tracker->propagationTimesCount; idx++) {
+        const double propagationTime = tracker->propagationTimes[(tracker->propagationTimesHead + idx) % capacity];
+        if (propagationTime > time - 1.0 && propagationTime <= time) {
+            count++;
+        }
+    }
+    return count;
+}
+
+MMSnapSafeAreaTrackerStatistics MMSnapSafeAreaTrackerGetStatistics(MMSnapSafeAreaTrackerRef tracker)
+{
+    return tracker->statistics;
+}
+
+void MMSnapSafeAreaTrackerResetStatistics(MMSnapSafeAreaTrackerRef tracker)
+{
+    tracker->statistics = (MMSnapSafeAreaTrackerStatistics){ 0, 0, 0 };
+    tracker->propagationTimesHead = 0;
+    tracker->propagationTimesCount = 0;
+}
@@ -0,0 +1,139 @@
+//
+//  MMSnapSafeAreaTracker.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapSafeAreaTracker_h
+#define MMSnapSafeAreaTracker_h
+
+#include "MMSnapLayoutCore.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  Remembers the safe area insets last propagated to the visible pages, so the insets are only propagated to the pages
+ *  whose insets changed, and to the pages that appeared or disappeared since.
+ *
+ *  @note The insets of a page are the parts of its visible part that fall outside of the safe area of the viewport. Pages
+ *  within the safe area have no insets at all, and pages covering a whole edge keep the insets of that edge, so
+ *  scrolling only changes the insets of the pages whose sides cross the edges. Pages are identified by an opaque key,
+ *  usually their view controller, so they can move without being reported.
+ */
+typedef struct MMSnapSafeAreaTracker *MMSnapSafeAreaTrackerRef;
+
+/**
+ *  Insets from the edges of a rectangle.
+ */
+typedef struct {
+    double top;
+    double left;
+    double bottom;
+    double right;
+} MMSnapSafeAreaInsets;
+
+/**
+ *  Counters of a tracker.
+ */
+typedef struct {
+    /**
+     *  The number of updates.
+     */
+    unsigned long updateCount;
+    /**
+     *  The number of updates that reported changed pages.
+     */
+    unsigned long propagationCount;
+    /**
+     *  The number of changed pages reported.
+     */
+    unsigned long changedPageCount;
+} MMSnapSafeAreaTrackerStatistics;
+
+/**
+ *  Returns a new tracker, or @c NULL if there was a problem allocating it.
+ */
+MMSnapSafeAreaTrackerRef MMSnapSafeAreaTrackerCreate(void);
+
+/**
+ *  Frees a tracker. Passing @c NULL is allowed.
+ */
+void MMSnapSafeAreaTrackerRelease(MMSnapSafeAreaTrackerRef tracker);
+
+/**
+ *  Returns the insets of a page.
+ *
+ *  @param pageRect The rect of the page, in the coordinates of the content.
+ *  @param bounds   The visible part of the content.
+ *  @param insets   The safe area insets of the viewport.
+ *
+ *  @return The parts of the visible part of the page outside of the safe area, or zero insets if the page isn't visible.
+ */
+MMSnapSafeAreaInsets MMSnapSafeAreaGetPageInsets(MMSnapLayoutRect pageRect, MMSnapLayoutRect bounds, MMSnapSafeAreaInsets insets);
+
+/**
+ *  Computes the insets of the visible pages and returns the pages that need to be propagated.
+ *
+ *  @param tracker     The tracker.
+ *  @param rects       The rects in which the visible pages are displayed.
+ *  @param keys        The keys of the visible pages.
+ *  @param count       The number of visible pages.
+ *  @param bounds      The visible part of the content.
+ *  @param insets      The safe area insets of the viewport.
+ *  @param time        The current time, in seconds, used to compute the propagation rate.
+ *  @param changedKeys A buffer receiving the keys of the pages that appeared, disappeared or whose insets changed.
+ *  @param capacity    The capacity of @c changedKeys, which is enough when it's the number of visible pages plus the number
+ *                     of pages returned by @c MMSnapSafeAreaTrackerGetPageCount beforehand.
+ *
+ *  @return The number of keys copied to @c changedKeys, or @c -1 if the storage could not be grown, in which case every
+ *  page should be propagated.
+ */
+long MMSnapSafeAreaTrackerUpdate(MMSnapSafeAreaTrackerRef tracker, const MMSnapLayoutRect *rects, const void *const *keys, long count, MMSnapLayoutRect bounds, MMSnapSafeAreaInsets insets, double time, const void **changedKeys, long capacity);
+
+/**
+ *  Returns the number of pages whose insets are remembered.
+ */
+long MMSnapSafeAreaTrackerGetPageCount(MMSnapSafeAreaTrackerRef tracker);
+
+/**
+ *  Returns the insets last propagated to a page.
+ *
+ *  @return @c false if the page isn't visible.
+ */
+bool MMSnapSafeAreaTrackerGetInsets(MMSnapSafeAreaTrackerRef tracker, const void *key, MMSnapSafeAreaInsets *insets);
+
+/**
+ *  Forgets a page, typically removed from the pages, so it's never reported again.
+ */
+void MMSnapSafeAreaTrackerRemoveKey(MMSnapSafeAreaTrackerRef tracker, const void *key);
+
+/**
+ *  Forgets every page, so they are all reported by the next update.
+ */
+void MMSnapSafeAreaTrackerInvalidate(MMSnapSafeAreaTrackerRef tracker);
+
+/**
+ *  Returns the number of updates that reported changed pages during the second before a time.
+ *
+ *  @note Only the most recent propagations are remembered, so rates above @c 240 per second are reported as @c 240.
+ */
+long MMSnapSafeAreaTrackerGetPropagationsPerSecond(MMSnapSafeAreaTrackerRef tracker, double time);
+
+/**
+ *  Returns the counters of a tracker.
+ */
+MMSnapSafeAreaTrackerStatistics MMSnapSafeAreaTrackerGetStatistics(MMSnapSafeAreaTrackerRef tracker);
+
+/**
+ *  Resets the counters of a tracker, including the propagation rate.
+ */
+void MMSnapSafeAreaTrackerResetStatistics(MMSnapSafeAreaTrackerRef tracker);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapSafeAreaTracker_h */
@@ -0,0 +1,206 @@
+//
+//  MMSnapSeparatorTracker.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapSeparatorTracker.h"
+
+#include <stdlib.h>
+
+typedef struct {
+    MMSnapLayoutRect pageRect;
+    MMSnapSeparatorState state;
+    // The separator the state was applied to on this pass, or NULL.
+    const void *separator;
+} MMSnapSeparatorTrackerEntry;
+
+typedef struct {
+    MMSnapSeparatorTrackerEntry *entries;
+    long capacity;
+    long firstPage;
+    long count;
+} MMSnapSeparatorTrackerPass;
+
+struct MMSnapSeparatorTracker {
+    MMSnapSeparatorTrackerPass current;
+    MMSnapSeparatorTrackerPass previous;
+    
+    MMSnapSeparatorTrackerStatistics statistics;
+};
+
+static const MMSnapLayoutRect MMSnapSeparatorTrackerRectZero = { 0.0, 0.0, 0.0, 0.0 };
+
+MMSnapSeparatorTrackerRef MMSnapSeparatorTrackerCreate(void)
+{
+    return calloc(1, sizeof(struct MMSnapSeparatorTracker));
+}
+
+void MMSnapSeparatorTrackerRelease(MMSnapSeparatorTrackerRef tracker)
+{
+    if (tracker) {
+        free(tracker->current.entries);
+        free(tracker->previous.entries);
+        free(tracker);
+    }
+}
+
+static inline MMSnapSeparatorTrackerEntry *MMSnapSeparatorTrackerPassGetEntry(MMSnapSeparatorTrackerPass *pass, long page)
+{
+    if (page < pass->firstPage || page >= pass->firstPage + pass->count) {
+        return NULL;
+    }
+    return &pass->entries[page - pass->firstPage];
+}
+
+static bool MMSnapSeparatorTrackerPassReserve(MMSnapSeparatorTrackerPass *pass, long count)
+{
+    if (count <= pass->capacity) {
+        return true;
+    }
+    
+    long capacity = pass->capacity > 0 ? pass->capacity : 8;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    
+    MMSnapSeparatorTrackerEntry *entries = realloc(pass->entries, (size_t)capacity * sizeof(MMSnapSeparatorTrackerEntry));
+    if (!entries) {
+        return false;
+    }
+    
+    pass->entries = entries;
+    pass->capacity = capacity;
+    return true;
+}
+
+// Passes.
+
+bool MMSnapSeparatorTrackerUpdate(MMSnapSeparatorTrackerRef tracker, const MMSnapLayout *layout, MMSnapPageRange range, long pageCount, bool showsAsColumnSeparator)
+{
+    // The current pass becomes the previous one, keeping both storages.
+    const MMSnapSeparatorTrackerPass previous = tracker->previous;
+    tracker->previous = tracker->current;
+    tracker->current = previous;
+    
+    MMSnapSeparatorTrackerPass *pass = &tracker->current;
+    pass->firstPage = range.location;
+    pass->count = 0;
+    
+    tracker->statistics.passCount++;
+    tracker->statistics.lastPassUpdateCount = 0;
+    
+    if (range.length <= 0) {
+        return true;
+    }
+    
+    if (!MMSnapSeparatorTrackerPassReserve(pass, range.length)) {
+        return false;
+    }
+    
+    pass->count = range.length;
+    
+    // Each separator is placed before the following page, whose rect is kept for the next iteration.
+    double percent = 0.0;
+    MMSnapLayoutRect pageRect = MMSnapLayoutGetPageRect(layout, range.location, &percent);
+    
+    for (long idx = 0; idx < range.length; idx++) {
+        const long page = range.location + idx;
+        
+        double nextPercent = 0.0;
+        const MMSnapLayoutRect nextPageRect = MMSnapLayoutGetPageRect(layout, page + 1, &nextPercent);
+        
+        MMSnapSeparatorTrackerEntry *entry = &pass->entries[idx];
+        entry->pageRect = pageRect;
+        entry->state = (MMSnapSeparatorState){
+            .rect = (page + 1 < pageCount) ? MMSnapLayoutGetSeparatorRect(layout, nextPageRect) : MMSnapSeparatorTrackerRectZero,
+            .percentDisappeared = percent,
+            .showsAsColumnSeparator = showsAsColumnSeparator
+        };
+        entry->separator = NULL;
+        
+        pageRect = nextPageRect;
+        percent = nextPercent;
+    }
+    
+    return true;
+}
+
+MMSnapLayoutRect MMSnapSeparatorTrackerGetPageRect(MMSnapSeparatorTrackerRef tracker, long page)
+{
+    const MMSnapSeparatorTrackerEntry *entry = MMSnapSeparatorTrackerPassGetEntry(&tracker->current, page);
+    return entry ? entry->pageRect : MMSnapSeparatorTrackerRectZero;
+}
+
+const MMSnapSeparatorState *MMSnapSeparatorTrackerGetState(MMSnapSeparatorTrackerRef tracker, long page)
+{
+    const MMSnapSeparatorTrackerEntry *entry = MMSnapSeparatorTrackerPassGetEntry(&tracker->current, page);
+    return entry ? &entry->state : NULL;
+}
+
+// Diffing.
+
+static inline bool MMSnapLayoutRectEqualToRect(MMSnapLayoutRect rect, MMSnapLayoutRect otherRect)
+{
+    return rect.x == otherRect.x && rect.y == otherRect.y && rect.width == otherRect.width && rect.height == otherRect.height;
+}
+
+MMSnapSeparatorChange MMSnapSeparatorTrackerApplySeparator(MMSnapSeparatorTrackerRef tracker, long page, const void *separator)
+{
+    MMSnapSeparatorTrackerEntry *entry = MMSnapSeparatorTrackerPassGetEntry(&tracker->current, page);
+    if (!entry || !separator) {
+        return MMSnapSeparatorChangeNone;
+    }
+    
+    entry->separator = separator;
+    tracker->statistics.separatorCount++;
+    
+    MMSnapSeparatorChange change = MMSnapSeparatorChangeAll;
+    
+    const MMSnapSeparatorTrackerEntry *previousEntry = MMSnapSeparatorTrackerPassGetEntry(&tracker->previous, page);
+    if (previousEntry && previousEntry->separator == separator) {
+        const MMSnapSeparatorState *state = &entry->state;
+        const MMSnapSeparatorState *previousState = &previousEntry->state;
+        
+        change = MMSnapSeparatorChangeNone;
+        
+        if (!MMSnapLayoutRectEqualToRect(state->rect, previousState->rect)) {
+            change |= MMSnapSeparatorChangeRect;
+        }
+        if (state->percentDisappeared != previousState->percentDisappeared) {
+            change |= MMSnapSeparatorChangePercentDisappeared;
+        }
+        if (state->showsAsColumnSeparator != previousState->showsAsColumnSeparator) {
+            change |= MMSnapSeparatorChangeShowsAsColumnSeparator;
+        }
+    }
+    
+    if (change != MMSnapSeparatorChangeNone) {
+        tracker->statistics.updateCount++;
+        tracker->statistics.lastPassUpdateCount++;
+    }
+    
+    return change;
+}
+
+void MMSnapSeparatorTrackerInvalidate(MMSnapSeparatorTrackerRef tracker)
+{
+    for (long idx = 0; idx < tracker->current.count; idx++) {
+        tracker->current.entries[idx].separator = NULL;
+    }
+    
+    tracker->previous.count = 0;
+}
+
+// Statistics.
+
+MMSnapSeparatorTrackerStatistics MMSnapSeparatorTrackerGetStatistics(MMSnapSeparatorTrackerRef tracker)
+{
+    return tracker->statistics;
+}
+
+void MMSnapSeparatorTrackerResetStatistics(MMSnapSeparatorTrackerRef tracker)
+{
+    tracker->statistics = (MMSnapSeparatorTrackerStatistics){ 0, 0, 0, 0 };
+}
@@ -0,0 +1,146 @@
+//
+//  MMSnapSeparatorTracker.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapSeparatorTracker_h
+#define MMSnapSeparatorTracker_h
+
+#include "MMSnapLayoutCore.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  Computes the state of the separators of the visible pages once per layout pass and remembers the state last applied
+ *  to each separator, so only the separators whose state changed are touched.
+ *
+ *  @note A pass starts with @c MMSnapSeparatorTrackerUpdate, which lays out every page of a range at once, and continues
+ *  with a call to @c MMSnapSeparatorTrackerApplySeparator for each separator. A separator is compared to the state it
+ *  had on the previous pass only if it was displayed for the same page, otherwise its whole state is reported changed.
+ */
+typedef struct MMSnapSeparatorTracker *MMSnapSeparatorTrackerRef;
+
+/**
+ *  The state of the separator displayed after a page.
+ */
+typedef struct {
+    /**
+     *  The frame of the separator, just before the following page. Empty for the last page.
+     */
+    MMSnapLayoutRect rect;
+    /**
+     *  The amount of the page covered by the following page, between zero and one.
+     */
+    double percentDisappeared;
+    /**
+     *  Whether the separator is displayed between columns, as opposed to pages.
+     */
+    bool showsAsColumnSeparator;
+} MMSnapSeparatorState;
+
+/**
+ *  The parts of a separator state that changed.
+ */
+typedef enum {
+    MMSnapSeparatorChangeNone = 0,
+    MMSnapSeparatorChangeRect = 1 << 0,
+    MMSnapSeparatorChangePercentDisappeared = 1 << 1,
+    MMSnapSeparatorChangeShowsAsColumnSeparator = 1 << 2,
+    MMSnapSeparatorChangeAll = MMSnapSeparatorChangeRect | MMSnapSeparatorChangePercentDisappeared | MMSnapSeparatorChangeShowsAsColumnSeparator
+} MMSnapSeparatorChange;
+
+/**
+ *  Update counters of a tracker.
+ */
+typedef struct {
+    /**
+     *  The number of layout passes.
+     */
+    unsigned long passCount;
+    /**
+     *  The number of separators applied, whether they changed or not.
+     */
+    unsigned long separatorCount;
+    /**
+     *  The number of separators that changed and had to be updated.
+     */
+    unsigned long updateCount;
+    /**
+     *  The number of separators updated on the last pass.
+     */
+    unsigned long lastPassUpdateCount;
+} MMSnapSeparatorTrackerStatistics;
+
+/**
+ *  Returns a new tracker or @c NULL if there was a problem allocating it.
+ */
+MMSnapSeparatorTrackerRef MMSnapSeparatorTrackerCreate(void);
+
+/**
+ *  Frees a tracker. Passing @c NULL is allowed.
+ */
+void MMSnapSeparatorTrackerRelease(MMSnapSeparatorTrackerRef tracker);
+
+/**
+ *  Starts a layout pass, laying out the pages of a range and their separators.
+ *
+ *  @param tracker                The tracker.
+ *  @param layout                 The layout. Its page index must be validated.
+ *  @param range                  The pages displayed on this pass.
+ *  @param pageCount              The number of pages. The last page doesn't show a separator.
+ *  @param showsAsColumnSeparator Whether the separators are displayed between columns.
+ *
+ *  @return @c false if the storage could not be grown, in which case the range is empty.
+ *
+ *  @note Each page rect is computed once, and reused to place the separator of the previous page.
+ */
+bool MMSnapSeparatorTrackerUpdate(MMSnapSeparatorTrackerRef tracker, const MMSnapLayout *layout, MMSnapPageRange range, long pageCount, bool showsAsColumnSeparator);
+
+/**
+ *  Returns the rect of a page laid out by the current pass, or an empty rectangle if it's out of the range.
+ */
+MMSnapLayoutRect MMSnapSeparatorTrackerGetPageRect(MMSnapSeparatorTrackerRef tracker, long page);
+
+/**
+ *  Returns the state of the separator of a page laid out by the current pass, or @c NULL if it's out of the range.
+ */
+const MMSnapSeparatorState *MMSnapSeparatorTrackerGetState(MMSnapSeparatorTrackerRef tracker, long page);
+
+/**
+ *  Records that a separator displays the state of a page in the current pass.
+ *
+ *  @param tracker   The tracker.
+ *  @param page      The page, in the range of the current pass.
+ *  @param separator An identifier of the separator displayed for the page, typically its address.
+ *
+ *  @return The parts of the state that changed since the separator was last applied. Everything changed if the separator
+ *  wasn't displayed for the same page on the previous pass.
+ */
+MMSnapSeparatorChange MMSnapSeparatorTrackerApplySeparator(MMSnapSeparatorTrackerRef tracker, long page, const void *separator);
+
+/**
+ *  Forgets the states applied so far, so every separator is reported changed on the next pass.
+ *
+ *  @note Required when the identifiers of the separators can be reused by other separators, like after they are freed.
+ */
+void MMSnapSeparatorTrackerInvalidate(MMSnapSeparatorTrackerRef tracker);
+
+/**
+ *  Returns the update counters of a tracker.
+ */
+MMSnapSeparatorTrackerStatistics MMSnapSeparatorTrackerGetStatistics(MMSnapSeparatorTrackerRef tracker);
+
+/**
+ *  Resets the update counters of a tracker.
+ */
+void MMSnapSeparatorTrackerResetStatistics(MMSnapSeparatorTrackerRef tracker);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapSeparatorTracker_h */
@@ -0,0 +1,143 @@
+//
+//  MMSnapSpring.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapSpring.h"
+
+#include <math.h>
+
+// The displacement u = x - target follows m u'' + b u' + k u = 0, or u'' + 2 beta u' + omega0^2 u = 0.
+
+static double MMSnapSpringSettleTimeForBound(double amplitude, double decay, double precision)
+{
+    // Time at which amplitude * exp(-decay * t) reaches the precision.
+    if (amplitude <= precision) {
+        return 0.0;
+    }
+    if (decay <= 0.0) {
+        return INFINITY;
+    }
+    return log(amplitude / precision) / decay;
+}
+
+void MMSnapSpringStart(MMSnapSpring *spring, MMSnapSpringParameters parameters, double position, double velocity, double target, double precision)
+{
+    const double beta = parameters.damping / (2.0 * parameters.mass);
+    const double omega0 = sqrt(parameters.stiffness / parameters.mass);
+    const double u0 = position - target;
+    const double v0 = velocity;
+    
+    spring->parameters = parameters;
+    spring->target = target;
+    spring->beta = beta;
+    
+    if (precision <= 0.0) {
+        precision = 1e-3;
+    }
+    
+    if (fabs(beta - omega0) <= 1e-9 * omega0) {
+        // u = exp(-beta t) (c1 + c2 t)
+        spring->regime = MMSnapSpringRegimeCriticallyDamped;
+        spring->omega = 0.0;
+        spring->c1 = u0;
+        spring->c2 = v0 + beta * u0;
+        
+        // |c1 + c2 t| exp(-beta t) <= (|c1| + |c2| / (beta e / 2)) exp(-beta t / 2), since t exp(-beta t / 2) <= 2 / (beta e).
+        const double amplitude = fabs(spring->c1) + fabs(spring->c2) * 2.0 / (beta * exp(1.0));
+        spring->settleTime = MMSnapSpringSettleTimeForBound(amplitude, beta / 2.0, precision);
+    } else if (beta < omega0) {
+        // u = exp(-beta t) (c1 cos(omega t) + c2 sin(omega t))
+        const double omega = sqrt(omega0 * omega0 - beta * beta);
+        
+        spring->regime = MMSnapSpringRegimeUnderdamped;
+        spring->omega = omega;
+        spring->c1 = u0;
+        spring->c2 = (v0 + beta * u0) / omega;
+        
+        const double amplitude = sqrt(spring->c1 * spring->c1 + spring->c2 * spring->c2);
+        spring->settleTime = MMSnapSpringSettleTimeForBound(amplitude, beta, precision);
+    } else {
+        // u = c1 exp(r1 t) + c2 exp(r2 t), with r1 = -beta + omega and r2 = -beta - omega.
+        const double omega = sqrt(beta * beta - omega0 * omega0);
+        const double r1 = -beta + omega;
+        const double r2 = -beta - omega;
+        
+        spring->regime = MMSnapSpringRegimeOverdamped;
+        spring->omega = omega;
+        spring->c1 = (v0 - r2 * u0) / (r1 - r2);
+        spring->c2 = u0 - spring->c1;
+        
+        // The slowest term dominates.
+        const double amplitude = fabs(spring->c1) + fabs(spring->c2);
+        spring->settleTime = MMSnapSpringSettleTimeForBound(amplitude, -r1, precision);
+    }
+}
+
+void MMSnapSpringEvaluate(const MMSnapSpring *spring, double time, double *position, double *velocity)
+{
+    double u = 0.0;
+    double v = 0.0;
+    
+    if (time < 0.0) {
+        time = 0.0;
+    }
+    
+    if (time < spring->settleTime) {
+        const double beta = spring->beta;
+        const double omega = spring->omega;
+        const double c1 = spring->c1;
+        const double c2 = spring->c2;
+        
+        switch (spring->regime) {
+            case MMSnapSpringRegimeUnderdamped: {
+                const double envelope = exp(-beta * time);
+                const double cosine = cos(omega * time);
+                const double sine = sin(omega * time);
+                
+                u = envelope * (c1 * cosine + c2 * sine);
+                v = envelope * ((c2 * omega - beta * c1) * cosine - (c1 * omega + beta * c2) * sine);
+                break;
+            }
+            case MMSnapSpringRegimeCriticallyDamped: {
+                const double envelope = exp(-beta * time);
+                
+                u = envelope * (c1 + c2 * time);
+                v = envelope * (c2 - beta * (c1 + c2 * time));
+                break;
+            }
+            case MMSnapSpringRegimeOverdamped: {
+                const double r1 = -beta + omega;
+                const double r2 = -beta - omega;
+                const double e1 = exp(r1 * time);
+                const double e2 = exp(r2 * time);
+                
+                u = c1 * e1 + c2 * e2;
+                v = r1 * c1 * e1 + r2 * c2 * e2;
+                break;
+            }
+        }
+    }
+    
+    if (position) {
+        *position = spring->target + u;
+    }
+    if (velocity) {
+        *velocity = v;
+    }
+}
+
+void MMSnapSpringRetarget(MMSnapSpring *spring, double time, double target, double precision)
+{
+    double position, velocity;
+    MMSnapSpringEvaluate(spring, time, &position, &velocity);
+    
+    MMSnapSpringStart(spring, spring->parameters, position, velocity, target, precision);
+}
+
+double MMSnapSpringGetSettleTime(const MMSnapSpring *spring)
+{
+    return spring->settleTime;
+}
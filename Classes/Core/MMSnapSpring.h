@@ -0,0 +1,109 @@
+//
+//  MMSnapSpring.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapSpring_h
+#define MMSnapSpring_h
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  The physical parameters of a damped spring.
+ */
+typedef struct {
+    /**
+     *  The mass of the object attached to the spring. Must be greater than zero.
+     */
+    double mass;
+    /**
+     *  The stiffness coefficient of the spring. Must be greater than zero.
+     */
+    double stiffness;
+    /**
+     *  The damping coefficient. Must be greater than or equal to zero.
+     */
+    double damping;
+} MMSnapSpringParameters;
+
+/**
+ *  The damping regimes of a spring.
+ */
+typedef enum {
+    MMSnapSpringRegimeUnderdamped,
+    MMSnapSpringRegimeCriticallyDamped,
+    MMSnapSpringRegimeOverdamped
+} MMSnapSpringRegime;
+
+/**
+ *  A closed-form solution of a damped spring moving an object towards a target, in real time.
+ *
+ *  @note The coefficients are computed once when the spring starts or is retargeted, so evaluating a frame costs a few
+ *  exponentials and trigonometric functions.
+ */
+typedef struct {
+    MMSnapSpringParameters parameters;
+    MMSnapSpringRegime regime;
+    
+    double target;
+    double beta;
+    double omega;
+    double c1;
+    double c2;
+    
+    double settleTime;
+} MMSnapSpring;
+
+/**
+ *  Starts a spring.
+ *
+ *  @param spring     The spring to initialize.
+ *  @param parameters The physical parameters.
+ *  @param position   The position of the object at time zero.
+ *  @param velocity   The velocity of the object at time zero, in units per second.
+ *  @param target     The position at which the object rests.
+ *  @param precision  The distance to the target under which the object is considered at rest.
+ */
+void MMSnapSpringStart(MMSnapSpring *spring, MMSnapSpringParameters parameters, double position, double velocity, double target, double precision);
+
+/**
+ *  Returns the position and velocity of the object at a time.
+ *
+ *  @param spring   The spring.
+ *  @param time     The time since the spring started, in seconds.
+ *  @param position On output, the position. Can be @c NULL.
+ *  @param velocity On output, the velocity in units per second. Can be @c NULL.
+ *
+ *  @note After the settle time, the object is reported at rest on the target.
+ */
+void MMSnapSpringEvaluate(const MMSnapSpring *spring, double time, double *position, double *velocity);
+
+/**
+ *  Changes the target of a spring in flight, keeping the position and velocity of the object.
+ *
+ *  @param spring    The spring.
+ *  @param time      The time since the spring started at which the target changes. The time base of the spring is
+ *                   reset, so later evaluations are relative to this instant.
+ *  @param target    The new target.
+ *  @param precision The distance to the target under which the object is considered at rest.
+ */
+void MMSnapSpringRetarget(MMSnapSpring *spring, double time, double target, double precision);
+
+/**
+ *  Returns the time after which the object stays within the precision of the target, in seconds.
+ *
+ *  @note Computed analytically from an upper bound of the displacement, so it's never shorter than the actual time.
+ */
+double MMSnapSpringGetSettleTime(const MMSnapSpring *spring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapSpring_h */
@@ -0,0 +1,81 @@
+//
+//  MMSnapToolbarLayout.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapToolbarLayout.h"
+
+#include <math.h>
+
+static inline double MMSnapToolbarItemGetWidth(const MMSnapToolbarItem *item)
+{
+    return (item->kind == MMSnapToolbarItemKindFlexibleSpace) ? 0.0 : item->width;
+}
+
+static inline double MMSnapToolbarItemGetHeight(const MMSnapToolbarItem *item)
+{
+    return (item->kind == MMSnapToolbarItemKindView) ? item->height : 0.0;
+}
+
+long MMSnapToolbarLayoutSolve(const MMSnapToolbarItem *items, long count, MMSnapToolbarMetrics metrics, MMSnapLayoutRect *frames)
+{
+    if (count <= 0) {
+        return 0;
+    }
+    
+    long flexibleCount = 0;
+    for (long idx = 0; idx < count; idx++) {
+        if (items[idx].kind == MMSnapToolbarItemKindFlexibleSpace) {
+            flexibleCount++;
+        }
+    }
+    
+    const long actualCount = count - flexibleCount;
+    const double separationWidth = (actualCount == 1) ? 0.0 : (double)(count - 1) * metrics.spacing;
+    
+    // Truncate at the first item that doesn't fit.
+    double contentWidth = 0.0;
+    long fittingCount = 0;
+    
+    while (fittingCount < count) {
+        const double itemWidth = MMSnapToolbarItemGetWidth(&items[fittingCount]);
+        
+        if (contentWidth + itemWidth + separationWidth > metrics.width) {
+            break;
+        }
+        
+        contentWidth += itemWidth;
+        fittingCount++;
+    }
+    
+    double flexibleWidth = 0.0;
+    if (flexibleCount > 0) {
+        flexibleWidth = (metrics.width - contentWidth - separationWidth) / (double)flexibleCount;
+    }
+    
+    // Layout.
+    double offset = metrics.minX;
+    
+    for (long idx = 0; idx < fittingCount; idx++) {
+        const MMSnapToolbarItem *item = &items[idx];
+        const double width = (item->kind == MMSnapToolbarItemKindFlexibleSpace) ? flexibleWidth : item->width;
+        const double height = MMSnapToolbarItemGetHeight(item);
+        
+        frames[idx] = (MMSnapLayoutRect){
+            .x = round(offset),
+            .y = round((metrics.height - height) / 2.0),
+            .width = width,
+            .height = height
+        };
+        
+        offset = frames[idx].x + width;
+        
+        if (separationWidth > 0.0) {
+            offset += metrics.spacing;
+        }
+    }
+    
+    return fittingCount;
+}
@@ -0,0 +1,93 @@
+//
+//  MMSnapToolbarLayout.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapToolbarLayout_h
+#define MMSnapToolbarLayout_h
+
+#include "MMSnapLayoutCore.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  The kind of an item in a toolbar.
+ */
+typedef enum {
+    /**
+     *  A view, laid out with its measured size.
+     */
+    MMSnapToolbarItemKindView,
+    /**
+     *  A space with a fixed width.
+     */
+    MMSnapToolbarItemKindFixedSpace,
+    /**
+     *  A space sharing the width left by the other items with the rest of the flexible spaces.
+     */
+    MMSnapToolbarItemKindFlexibleSpace
+} MMSnapToolbarItemKind;
+
+/**
+ *  An item of a toolbar and its measured size.
+ */
+typedef struct {
+    MMSnapToolbarItemKind kind;
+    /**
+     *  The width of the item. Ignored for flexible spaces.
+     */
+    double width;
+    /**
+     *  The height of the item. Ignored for spaces, which have no height.
+     */
+    double height;
+} MMSnapToolbarItem;
+
+/**
+ *  The metrics a toolbar lays out its items with.
+ */
+typedef struct {
+    /**
+     *  The horizontal origin of the first item.
+     */
+    double minX;
+    /**
+     *  The width available to the items and the spacing between them.
+     */
+    double width;
+    /**
+     *  The height of the toolbar, in which items are centered vertically.
+     */
+    double height;
+    /**
+     *  The spacing between two consecutive items.
+     */
+    double spacing;
+} MMSnapToolbarMetrics;
+
+/**
+ *  Packs the items of a toolbar from left to right.
+ *
+ *  @param items   The items, in order.
+ *  @param count   The number of items.
+ *  @param metrics The metrics of the toolbar.
+ *  @param frames  On output, the frames of the items that fit. Must have room for @c count rectangles.
+ *
+ *  @return The number of items that fit, which are always the first ones. Items from that index onwards should be
+ *  hidden.
+ *
+ *  @note Items are separated by the spacing unless there is a single item that isn't a flexible space. The first item
+ *  that doesn't fit truncates the toolbar, and flexible spaces share whatever width is left, including the truncated
+ *  ones. Origins are rounded to whole points. The solver doesn't allocate, so it can run on every layout pass.
+ */
+long MMSnapToolbarLayoutSolve(const MMSnapToolbarItem *items, long count, MMSnapToolbarMetrics metrics, MMSnapLayoutRect *frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapToolbarLayout_h */
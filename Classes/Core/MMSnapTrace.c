@@ -0,0 +1,268 @@
+//
+//  MMSnapTrace.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapTrace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Layout of the header and of the events, every field little-endian.
+enum {
+    MMSnapTraceMagicOffset = 0,
+    MMSnapTraceVersionOffset = 4,
+    MMSnapTraceEventSizeOffset = 8,
+    MMSnapTraceHeaderSize = 16,
+    
+    MMSnapTraceTimeOffset = 0,
+    MMSnapTraceTypeOffset = 8,
+    MMSnapTraceFlagsOffset = 10,
+    MMSnapTracePageOffset = 12,
+    MMSnapTraceOtherPageOffset = 16,
+    MMSnapTraceXOffset = 24,
+    MMSnapTraceYOffset = 32
+};
+
+static const unsigned char MMSnapTraceMagic[4] = { 'M', 'M', 'S', 'T' };
+
+struct MMSnapTraceRecorder {
+    FILE *file;
+    
+    // Encoded events, the oldest one at head.
+    unsigned char *ring;
+    long capacity;
+    long head;
+    long count;
+    
+    unsigned long eventCount;
+    unsigned long droppedCount;
+};
+
+struct MMSnapTraceReader {
+    FILE *file;
+};
+
+// Encoding.
+
+static void MMSnapTraceWriteUInt(unsigned char *bytes, uint64_t value, int size)
+{
+    for (int idx = 0; idx < size; idx++) {
+        bytes[idx] = (unsigned char)(value >> (8 * idx));
+    }
+}
+
+static uint64_t MMSnapTraceReadUInt(const unsigned char *bytes, int size)
+{
+    uint64_t value = 0;
+    for (int idx = 0; idx < size; idx++) {
+        value |= (uint64_t)bytes[idx] << (8 * idx);
+    }
+    return value;
+}
+
+static void MMSnapTraceWriteDouble(unsigned char *bytes, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    MMSnapTraceWriteUInt(bytes, bits, 8);
+}
+
+static double MMSnapTraceReadDouble(const unsigned char *bytes)
+{
+    const uint64_t bits = MMSnapTraceReadUInt(bytes, 8);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void MMSnapTraceEncodeEvent(unsigned char *bytes, const MMSnapTraceEvent *event)
+{
+    memset(bytes, 0, MMSnapTraceEventSize);
+    
+    // Pages are stored as 32-bit signed integers, which fits any realistic stack.
+    MMSnapTraceWriteDouble(bytes + MMSnapTraceTimeOffset, event->time);
+    MMSnapTraceWriteUInt(bytes + MMSnapTraceTypeOffset, (uint64_t)event->type, 2);
+    MMSnapTraceWriteUInt(bytes + MMSnapTraceFlagsOffset, event->flags, 2);
+    MMSnapTraceWriteUInt(bytes + MMSnapTracePageOffset, (uint32_t)(int32_t)event->page, 4);
+    MMSnapTraceWriteUInt(bytes + MMSnapTraceOtherPageOffset, (uint32_t)(int32_t)event->otherPage, 4);
+    MMSnapTraceWriteDouble(bytes + MMSnapTraceXOffset, event->x);
+    MMSnapTraceWriteDouble(bytes + MMSnapTraceYOffset, event->y);
+}
+
+static void MMSnapTraceDecodeEvent(const unsigned char *bytes, MMSnapTraceEvent *event)
+{
+    event->time = MMSnapTraceReadDouble(bytes + MMSnapTraceTimeOffset);
+    event->type = (MMSnapTraceEventType)MMSnapTraceReadUInt(bytes + MMSnapTraceTypeOffset, 2);
+    event->flags = (uint16_t)MMSnapTraceReadUInt(bytes + MMSnapTraceFlagsOffset, 2);
+    event->page = (int32_t)(uint32_t)MMSnapTraceReadUInt(bytes + MMSnapTracePageOffset, 4);
+    event->otherPage = (int32_t)(uint32_t)MMSnapTraceReadUInt(bytes + MMSnapTraceOtherPageOffset, 4);
+    event->x = MMSnapTraceReadDouble(bytes + MMSnapTraceXOffset);
+    event->y = MMSnapTraceReadDouble(bytes + MMSnapTraceYOffset);
+}
+
+const char *MMSnapTraceEventTypeGetName(MMSnapTraceEventType type)
+{
+    switch (type) {
+        case MMSnapTraceEventBegin: return "begin";
+        case MMSnapTraceEventContentOffset: return "contentOffset";
+        case MMSnapTraceEventBounds: return "bounds";
+        case MMSnapTraceEventPageWidth: return "pageWidth";
+        case MMSnapTraceEventReloadData: return "reloadData";
+        case MMSnapTraceEventDeletePage: return "deletePage";
+        case MMSnapTraceEventInsertPage: return "insertPage";
+        case MMSnapTraceEventReloadPage: return "reloadPage";
+        case MMSnapTraceEventMovePage: return "movePage";
+        case MMSnapTraceEventEndUpdates: return "endUpdates";
+        case MMSnapTraceEventScrollToPage: return "scrollToPage";
+        case MMSnapTraceEventPush: return "push";
+        case MMSnapTraceEventPop: return "pop";
+    }
+    return "unknown";
+}
+
+// Recording.
+
+MMSnapTraceRecorderRef MMSnapTraceRecorderCreate(const char *path, long capacity)
+{
+    if (capacity <= 0) {
+        return NULL;
+    }
+    
+    MMSnapTraceRecorderRef recorder = calloc(1, sizeof(struct MMSnapTraceRecorder));
+    if (!recorder) {
+        return NULL;
+    }
+    
+    recorder->capacity = capacity;
+    recorder->ring = malloc((size_t)capacity * MMSnapTraceEventSize);
+    recorder->file = recorder->ring ? fopen(path, "wb") : NULL;
+    
+    unsigned char header[MMSnapTraceHeaderSize] = { 0 };
+    memcpy(header + MMSnapTraceMagicOffset, MMSnapTraceMagic, sizeof(MMSnapTraceMagic));
+    MMSnapTraceWriteUInt(header + MMSnapTraceVersionOffset, MMSnapTraceVersion, 4);
+    MMSnapTraceWriteUInt(header + MMSnapTraceEventSizeOffset, MMSnapTraceEventSize, 4);
+    
+    if (!recorder->file || fwrite(header, sizeof(header), 1, recorder->file) != 1) {
+        MMSnapTraceRecorderRelease(recorder);
+        return NULL;
+    }
+    return recorder;
+}
+
+void MMSnapTraceRecorderRelease(MMSnapTraceRecorderRef recorder)
+{
+    if (!recorder) {
+        return;
+    }
+    
+    if (recorder->file) {
+        MMSnapTraceRecorderFlush(recorder);
+        fclose(recorder->file);
+    }
+    free(recorder->ring);
+    free(recorder);
+}
+
+bool MMSnapTraceRecorderRecord(MMSnapTraceRecorderRef recorder, const MMSnapTraceEvent *event)
+{
+    bool written = true;
+    if (recorder->count == recorder->capacity) {
+        written = MMSnapTraceRecorderFlush(recorder);
+    }
+    
+    const long slot = (recorder->head + recorder->count) % recorder->capacity;
+    MMSnapTraceEncodeEvent(recorder->ring + slot * MMSnapTraceEventSize, event);
+    
+    recorder->count++;
+    recorder->eventCount++;
+    
+    return written;
+}
+
+bool MMSnapTraceRecorderFlush(MMSnapTraceRecorderRef recorder)
+{
+    if (recorder->count == 0) {
+        return true;
+    }
+    
+    // At most two contiguous runs, before and after the end of the ring.
+    const long firstCount = (recorder->head + recorder->count <= recorder->capacity) ? recorder->count : recorder->capacity - recorder->head;
+    const long secondCount = recorder->count - firstCount;
+    
+    bool written = (fwrite(recorder->ring + recorder->head * MMSnapTraceEventSize, MMSnapTraceEventSize, (size_t)firstCount, recorder->file) == (size_t)firstCount);
+    if (written && secondCount > 0) {
+        written = (fwrite(recorder->ring, MMSnapTraceEventSize, (size_t)secondCount, recorder->file) == (size_t)secondCount);
+    }
+    written = written && (fflush(recorder->file) == 0);
+    
+    if (!written) {
+        recorder->droppedCount += (unsigned long)recorder->count;
+    }
+    
+    recorder->head = (recorder->head + recorder->count) % recorder->capacity;
+    recorder->count = 0;
+    
+    return written;
+}
+
+long MMSnapTraceRecorderGetPendingCount(MMSnapTraceRecorderRef recorder)
+{
+    return recorder->count;
+}
+
+unsigned long MMSnapTraceRecorderGetEventCount(MMSnapTraceRecorderRef recorder, unsigned long *droppedCount)
+{
+    if (droppedCount) {
+        *droppedCount = recorder->droppedCount;
+    }
+    return recorder->eventCount;
+}
+
+// Reading.
+
+MMSnapTraceReaderRef MMSnapTraceReaderOpen(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    
+    unsigned char header[MMSnapTraceHeaderSize];
+    
+    const bool valid = (fread(header, sizeof(header), 1, file) == 1 &&
+                        memcmp(header + MMSnapTraceMagicOffset, MMSnapTraceMagic, sizeof(MMSnapTraceMagic)) == 0 &&
+                        MMSnapTraceReadUInt(header + MMSnapTraceVersionOffset, 4) == MMSnapTraceVersion &&
+                        MMSnapTraceReadUInt(header + MMSnapTraceEventSizeOffset, 4) == MMSnapTraceEventSize);
+    
+    MMSnapTraceReaderRef reader = valid ? calloc(1, sizeof(struct MMSnapTraceReader)) : NULL;
+    if (!reader) {
+        fclose(file);
+        return NULL;
+    }
+    
+    reader->file = file;
+    return reader;
+}
+
+void MMSnapTraceReaderRelease(MMSnapTraceReaderRef reader)
+{
+    if (reader) {
+        fclose(reader->file);
+        free(reader);
+    }
+}
+
+bool MMSnapTraceReaderNext(MMSnapTraceReaderRef reader, MMSnapTraceEvent *event)
+{
+    unsigned char bytes[MMSnapTraceEventSize];
+    if (fread(bytes, sizeof(bytes), 1, reader->file) != 1) {
+        return false;
+    }
+    
+    MMSnapTraceDecodeEvent(bytes, event);
+    return true;
+}
@@ -0,0 +1,191 @@
+//
+//  MMSnapTrace.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapTrace_h
+#define MMSnapTrace_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  The version of the trace format written by this build. Traces of other versions are rejected.
+ */
+#define MMSnapTraceVersion 1
+
+/**
+ *  The size of an encoded event, in bytes.
+ */
+#define MMSnapTraceEventSize 40
+
+/**
+ *  The kinds of events of a trace.
+ */
+typedef enum {
+    /**
+     *  Recording started with @c page pages at the global content offset @c x. Followed by the bounds and the widths of
+     *  the pages.
+     */
+    MMSnapTraceEventBegin = 1,
+    /**
+     *  A layout pass at the global content offset @c x, @c y.
+     */
+    MMSnapTraceEventContentOffset,
+    /**
+     *  The bounds of the following layout passes changed to @c x by @c y points.
+     */
+    MMSnapTraceEventBounds,
+    /**
+     *  The width of @c page was measured as @c x points, by the event before it or ahead of the next layout pass.
+     */
+    MMSnapTraceEventPageWidth,
+    /**
+     *  The pages were reloaded, leaving @c page pages.
+     */
+    MMSnapTraceEventReloadData,
+    /**
+     *  @c page was deleted by the next update.
+     */
+    MMSnapTraceEventDeletePage,
+    /**
+     *  @c page was inserted by the next update, in terms of the pages after the update.
+     */
+    MMSnapTraceEventInsertPage,
+    /**
+     *  @c page was reloaded by the next update.
+     */
+    MMSnapTraceEventReloadPage,
+    /**
+     *  @c page was moved to @c otherPage by the next update.
+     */
+    MMSnapTraceEventMovePage,
+    /**
+     *  The updates since the previous one were applied, animated if @c flags has @c MMSnapTraceEventFlagAnimated.
+     */
+    MMSnapTraceEventEndUpdates,
+    /**
+     *  The scroll view was asked to scroll to @c page.
+     */
+    MMSnapTraceEventScrollToPage,
+    /**
+     *  A view controller was pushed at @c page.
+     */
+    MMSnapTraceEventPush,
+    /**
+     *  View controllers were popped down to @c page pages.
+     */
+    MMSnapTraceEventPop
+} MMSnapTraceEventType;
+
+/**
+ *  Flags of an event.
+ */
+enum {
+    MMSnapTraceEventFlagAnimated = 1 << 0
+};
+
+/**
+ *  An event of a trace.
+ */
+typedef struct {
+    /**
+     *  The time of the event, in seconds.
+     */
+    double time;
+    MMSnapTraceEventType type;
+    uint16_t flags;
+    long page;
+    long otherPage;
+    double x;
+    double y;
+} MMSnapTraceEvent;
+
+/**
+ *  Appends the events of a scroll view to a trace file, through a ring of encoded events allocated when recording starts.
+ *
+ *  @note Recording an event copies it into the ring without allocating, and the ring is written to the file when it's
+ *  full or flushed, in order, so the file only ever grows. The recorder is not thread-safe.
+ */
+typedef struct MMSnapTraceRecorder *MMSnapTraceRecorderRef;
+
+/**
+ *  Reads the events of a trace file in order.
+ */
+typedef struct MMSnapTraceReader *MMSnapTraceReaderRef;
+
+/**
+ *  Creates a trace file and returns a recorder appending to it.
+ *
+ *  @param path     The path of the trace, replaced if it exists.
+ *  @param capacity The number of events buffered before being written. Must be greater than zero.
+ *
+ *  @return A new recorder, or @c NULL if the file could not be created or there was a problem allocating the ring.
+ */
+MMSnapTraceRecorderRef MMSnapTraceRecorderCreate(const char *path, long capacity);
+
+/**
+ *  Writes the buffered events, closes the file and frees a recorder. Passing @c NULL is allowed.
+ */
+void MMSnapTraceRecorderRelease(MMSnapTraceRecorderRef recorder);
+
+/**
+ *  Appends an event to the ring, writing the ring to the file first if it's full.
+ *
+ *  @return @c false if the ring could not be written, in which case its events are dropped.
+ */
+bool MMSnapTraceRecorderRecord(MMSnapTraceRecorderRef recorder, const MMSnapTraceEvent *event);
+
+/**
+ *  Writes the buffered events to the file.
+ *
+ *  @return @c false if they could not be written, in which case they are dropped.
+ */
+bool MMSnapTraceRecorderFlush(MMSnapTraceRecorderRef recorder);
+
+/**
+ *  Returns the number of events waiting in the ring.
+ */
+long MMSnapTraceRecorderGetPendingCount(MMSnapTraceRecorderRef recorder);
+
+/**
+ *  Returns the number of events recorded, and the number of them that were dropped because they couldn't be written.
+ */
+unsigned long MMSnapTraceRecorderGetEventCount(MMSnapTraceRecorderRef recorder, unsigned long *droppedCount);
+
+/**
+ *  Opens a trace file.
+ *
+ *  @return A new reader, or @c NULL if the file could not be opened or isn't a trace of this version.
+ */
+MMSnapTraceReaderRef MMSnapTraceReaderOpen(const char *path);
+
+/**
+ *  Closes a trace file and frees a reader. Passing @c NULL is allowed.
+ */
+void MMSnapTraceReaderRelease(MMSnapTraceReaderRef reader);
+
+/**
+ *  Reads the next event.
+ *
+ *  @return @c false at the end of the trace. A partially written last event, as left by a process that was killed while
+ *  recording, ends the trace.
+ */
+bool MMSnapTraceReaderNext(MMSnapTraceReaderRef reader, MMSnapTraceEvent *event);
+
+/**
+ *  Returns the name of an event type, such as @c "contentOffset", or @c "unknown".
+ */
+const char *MMSnapTraceEventTypeGetName(MMSnapTraceEventType type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapTrace_h */
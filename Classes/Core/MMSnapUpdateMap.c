@@ -0,0 +1,331 @@
+//
+//  MMSnapUpdateMap.c
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapUpdateMap.h"
+#include "MMSnapPageIndex.h"
+
+#include <stdlib.h>
+
+typedef struct {
+    long *pages;
+    long count;
+    long capacity;
+} MMSnapUpdateList;
+
+typedef struct {
+    long page;
+    long newPage;
+} MMSnapUpdateMove;
+
+struct MMSnapUpdateMap {
+    MMSnapUpdateList deletes;
+    MMSnapUpdateList inserts;
+    MMSnapUpdateList reloads;
+    
+    MMSnapUpdateMove *moves;
+    long moveCount;
+    long moveCapacity;
+    
+    // Built by the preparation: deletes and move sources, inserts and move destinations.
+    MMSnapUpdateList removed;
+    MMSnapUpdateList added;
+};
+
+MMSnapUpdateMapRef MMSnapUpdateMapCreate(void)
+{
+    return calloc(1, sizeof(struct MMSnapUpdateMap));
+}
+
+void MMSnapUpdateMapRelease(MMSnapUpdateMapRef updateMap)
+{
+    if (updateMap) {
+        free(updateMap->deletes.pages);
+        free(updateMap->inserts.pages);
+        free(updateMap->reloads.pages);
+        free(updateMap->moves);
+        free(updateMap->removed.pages);
+        free(updateMap->added.pages);
+        free(updateMap);
+    }
+}
+
+void MMSnapUpdateMapRemoveAllUpdates(MMSnapUpdateMapRef updateMap)
+{
+    updateMap->deletes.count = 0;
+    updateMap->inserts.count = 0;
+    updateMap->reloads.count = 0;
+    updateMap->moveCount = 0;
+    updateMap->removed.count = 0;
+    updateMap->added.count = 0;
+}
+
+static bool MMSnapUpdateListReserve(MMSnapUpdateList *list, long capacity)
+{
+    if (capacity <= list->capacity) {
+        return true;
+    }
+    
+    long newCapacity = list->capacity > 0 ? list->capacity : 8;
+    while (newCapacity < capacity) {
+        newCapacity *= 2;
+    }
+    
+    long *pages = realloc(list->pages, (size_t)newCapacity * sizeof(long));
+    if (!pages) {
+        return false;
+    }
+    list->pages = pages;
+    list->capacity = newCapacity;
+    
+    return true;
+}
+
+static bool MMSnapUpdateListAppend(MMSnapUpdateList *list, long page)
+{
+    if (!MMSnapUpdateListReserve(list, list->count + 1)) {
+        return false;
+    }
+    list->pages[list->count++] = page;
+    return true;
+}
+
+bool MMSnapUpdateMapDeletePage(MMSnapUpdateMapRef updateMap, long page)
+{
+    return MMSnapUpdateListAppend(&updateMap->deletes, page);
+}
+
+bool MMSnapUpdateMapInsertPage(MMSnapUpdateMapRef updateMap, long page)
+{
+    return MMSnapUpdateListAppend(&updateMap->inserts, page);
+}
+
+bool MMSnapUpdateMapReloadPage(MMSnapUpdateMapRef updateMap, long page)
+{
+    return MMSnapUpdateListAppend(&updateMap->reloads, page);
+}
+
+bool MMSnapUpdateMapMovePage(MMSnapUpdateMapRef updateMap, long page, long newPage)
+{
+    if (updateMap->moveCount == updateMap->moveCapacity) {
+        long newCapacity = updateMap->moveCapacity > 0 ? updateMap->moveCapacity * 2 : 8;
+        MMSnapUpdateMove *moves = realloc(updateMap->moves, (size_t)newCapacity * sizeof(MMSnapUpdateMove));
+        if (!moves) {
+            return false;
+        }
+        updateMap->moves = moves;
+        updateMap->moveCapacity = newCapacity;
+    }
+    
+    updateMap->moves[updateMap->moveCount++] = (MMSnapUpdateMove){ page, newPage };
+    
+    return true;
+}
+
+static int MMSnapUpdateComparePages(const void *a, const void *b)
+{
+    const long lhs = *(const long *)a;
+    const long rhs = *(const long *)b;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+static int MMSnapUpdateCompareMoves(const void *a, const void *b)
+{
+    const long lhs = ((const MMSnapUpdateMove *)a)->page;
+    const long rhs = ((const MMSnapUpdateMove *)b)->page;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+static inline bool MMSnapUpdateListIsStrictlyAscending(const MMSnapUpdateList *list)
+{
+    for (long idx = 1; idx < list->count; idx++) {
+        if (list->pages[idx] <= list->pages[idx - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the number of pages in a sorted list lower than the specified page.
+static inline long MMSnapUpdateListCountPagesBefore(const long *pages, long count, long page)
+{
+    long low = 0;
+    long high = count;
+    
+    while (low < high) {
+        const long mid = low + (high - low) / 2;
+        if (pages[mid] < page) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static inline bool MMSnapUpdateListContainsPage(const MMSnapUpdateList *list, long page)
+{
+    const long idx = MMSnapUpdateListCountPagesBefore(list->pages, list->count, page);
+    return idx < list->count && list->pages[idx] == page;
+}
+
+static long MMSnapUpdateMapIndexOfMove(MMSnapUpdateMapRef updateMap, long page)
+{
+    long low = 0;
+    long high = updateMap->moveCount;
+    
+    while (low < high) {
+        const long mid = low + (high - low) / 2;
+        if (updateMap->moves[mid].page < page) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    
+    if (low < updateMap->moveCount && updateMap->moves[low].page == page) {
+        return low;
+    }
+    return -1;
+}
+
+bool MMSnapUpdateMapPrepare(MMSnapUpdateMapRef updateMap)
+{
+    MMSnapUpdateList *deletes = &updateMap->deletes;
+    MMSnapUpdateList *inserts = &updateMap->inserts;
+    MMSnapUpdateList *reloads = &updateMap->reloads;
+    MMSnapUpdateList *removed = &updateMap->removed;
+    MMSnapUpdateList *added = &updateMap->added;
+    
+    const long moveCount = updateMap->moveCount;
+    
+    // Lists that were never reserved have no storage to sort.
+    if (deletes->count > 1) {
+        qsort(deletes->pages, (size_t)deletes->count, sizeof(long), MMSnapUpdateComparePages);
+    }
+    if (inserts->count > 1) {
+        qsort(inserts->pages, (size_t)inserts->count, sizeof(long), MMSnapUpdateComparePages);
+    }
+    if (reloads->count > 1) {
+        qsort(reloads->pages, (size_t)reloads->count, sizeof(long), MMSnapUpdateComparePages);
+    }
+    if (moveCount > 1) {
+        qsort(updateMap->moves, (size_t)moveCount, sizeof(MMSnapUpdateMove), MMSnapUpdateCompareMoves);
+    }
+    
+    if (!MMSnapUpdateListReserve(removed, deletes->count + moveCount) ||
+        !MMSnapUpdateListReserve(added, inserts->count + moveCount)) {
+        return false;
+    }
+    
+    // Moves are sorted by source, so the sources merge straight into the removed pages.
+    long d = 0, m = 0;
+    removed->count = 0;
+    while (d < deletes->count || m < moveCount) {
+        if (m == moveCount || (d < deletes->count && deletes->pages[d] < updateMap->moves[m].page)) {
+            removed->pages[removed->count++] = deletes->pages[d++];
+        } else {
+            removed->pages[removed->count++] = updateMap->moves[m++].page;
+        }
+    }
+    
+    added->count = 0;
+    for (long idx = 0; idx < inserts->count; idx++) {
+        added->pages[added->count++] = inserts->pages[idx];
+    }
+    for (long idx = 0; idx < moveCount; idx++) {
+        added->pages[added->count++] = updateMap->moves[idx].newPage;
+    }
+    if (added->count > 1) {
+        qsort(added->pages, (size_t)added->count, sizeof(long), MMSnapUpdateComparePages);
+    }
+    
+    // A page can only be removed or added once, and reloaded pages must survive the batch untouched.
+    if (!MMSnapUpdateListIsStrictlyAscending(removed) ||
+        !MMSnapUpdateListIsStrictlyAscending(added) ||
+        !MMSnapUpdateListIsStrictlyAscending(reloads)) {
+        return false;
+    }
+    if ((removed->count > 0 && removed->pages[0] < 0) || (added->count > 0 && added->pages[0] < 0)) {
+        return false;
+    }
+    for (long idx = 0; idx < reloads->count; idx++) {
+        if (MMSnapUpdateListContainsPage(removed, reloads->pages[idx])) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+long MMSnapUpdateMapGetUpdateCount(MMSnapUpdateMapRef updateMap)
+{
+    return updateMap->deletes.count + updateMap->inserts.count + updateMap->reloads.count + updateMap->moveCount;
+}
+
+long MMSnapUpdateMapGetDeleteCount(MMSnapUpdateMapRef updateMap)
+{
+    return updateMap->deletes.count;
+}
+
+long MMSnapUpdateMapGetInsertCount(MMSnapUpdateMapRef updateMap)
+{
+    return updateMap->inserts.count;
+}
+
+const long *MMSnapUpdateMapGetRemovedPages(MMSnapUpdateMapRef updateMap, long *count)
+{
+    *count = updateMap->removed.count;
+    return updateMap->removed.pages;
+}
+
+const long *MMSnapUpdateMapGetAddedPages(MMSnapUpdateMapRef updateMap, long *count)
+{
+    *count = updateMap->added.count;
+    return updateMap->added.pages;
+}
+
+const long *MMSnapUpdateMapGetReloadedPages(MMSnapUpdateMapRef updateMap, long *count)
+{
+    *count = updateMap->reloads.count;
+    return updateMap->reloads.pages;
+}
+
+long MMSnapUpdateMapGetFinalPage(MMSnapUpdateMapRef updateMap, long page)
+{
+    const MMSnapUpdateList *removed = &updateMap->removed;
+    const MMSnapUpdateList *added = &updateMap->added;
+    
+    const long removedBefore = MMSnapUpdateListCountPagesBefore(removed->pages, removed->count, page);
+    
+    if (removedBefore < removed->count && removed->pages[removedBefore] == page) {
+        const long move = MMSnapUpdateMapIndexOfMove(updateMap, page);
+        return (move >= 0) ? updateMap->moves[move].newPage : MMSnapPageNotFound;
+    }
+    
+    // After removing, the page sits at compacted. The added page k pushes it forward when added[k] <= compacted + k,
+    // and added[k] - k never decreases, so the number of pushes is found with a binary search.
+    const long compacted = page - removedBefore;
+    
+    long low = 0;
+    long high = added->count;
+    
+    while (low < high) {
+        const long mid = low + (high - low) / 2;
+        if (added->pages[mid] - mid <= compacted) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    
+    return compacted + low;
+}
+
+bool MMSnapUpdateMapIsPageReloaded(MMSnapUpdateMapRef updateMap, long page)
+{
+    return MMSnapUpdateListContainsPage(&updateMap->reloads, page);
+}
@@ -0,0 +1,98 @@
+//
+//  MMSnapUpdateMap.h
+//  MMSnapController
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapUpdateMap_h
+#define MMSnapUpdateMap_h
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  Collects the updates of a batch and maps the pages before the batch to the pages after it.
+ *
+ *  @note Deletes, reloads and move sources are expressed in terms of the pages before the batch; inserts and move
+ *  destinations in terms of the pages after it. Once prepared, mapping a page costs O(log u) for u updates, so a batch
+ *  only needs to visit the pages it displays instead of every page.
+ */
+typedef struct MMSnapUpdateMap *MMSnapUpdateMapRef;
+
+/**
+ *  Returns a new empty update map or @c NULL if there was a problem allocating it.
+ */
+MMSnapUpdateMapRef MMSnapUpdateMapCreate(void);
+
+/**
+ *  Frees an update map. Passing @c NULL is allowed.
+ */
+void MMSnapUpdateMapRelease(MMSnapUpdateMapRef updateMap);
+
+/**
+ *  Removes all updates, keeping the storage for the next batch.
+ */
+void MMSnapUpdateMapRemoveAllUpdates(MMSnapUpdateMapRef updateMap);
+
+/**
+ *  Records updates. Each returns @c false if the storage could not be grown.
+ */
+bool MMSnapUpdateMapDeletePage(MMSnapUpdateMapRef updateMap, long page);
+bool MMSnapUpdateMapInsertPage(MMSnapUpdateMapRef updateMap, long page);
+bool MMSnapUpdateMapReloadPage(MMSnapUpdateMapRef updateMap, long page);
+bool MMSnapUpdateMapMovePage(MMSnapUpdateMapRef updateMap, long page, long newPage);
+
+/**
+ *  Sorts the updates so pages can be mapped. Must be called after recording the updates and before any query.
+ *
+ *  @return @c false if the updates are inconsistent, for example if a page is deleted twice, deleted and moved, or two
+ *  pages are inserted at the same location.
+ */
+bool MMSnapUpdateMapPrepare(MMSnapUpdateMapRef updateMap);
+
+/**
+ *  Returns the total number of recorded updates.
+ */
+long MMSnapUpdateMapGetUpdateCount(MMSnapUpdateMapRef updateMap);
+
+/**
+ *  Returns the number of deleted and inserted pages. The number of pages after the batch is the number of pages before
+ *  it, minus the deleted pages, plus the inserted pages.
+ */
+long MMSnapUpdateMapGetDeleteCount(MMSnapUpdateMapRef updateMap);
+long MMSnapUpdateMapGetInsertCount(MMSnapUpdateMapRef updateMap);
+
+/**
+ *  Returns the pages removed before the batch (deletes and move sources) in ascending order.
+ */
+const long *MMSnapUpdateMapGetRemovedPages(MMSnapUpdateMapRef updateMap, long *count);
+
+/**
+ *  Returns the pages added after the batch (inserts and move destinations) in ascending order.
+ */
+const long *MMSnapUpdateMapGetAddedPages(MMSnapUpdateMapRef updateMap, long *count);
+
+/**
+ *  Returns the reloaded pages, expressed in terms of the pages before the batch, in ascending order.
+ */
+const long *MMSnapUpdateMapGetReloadedPages(MMSnapUpdateMapRef updateMap, long *count);
+
+/**
+ *  Returns the location after the batch of a page before the batch, or @c MMSnapPageNotFound if it was deleted.
+ */
+long MMSnapUpdateMapGetFinalPage(MMSnapUpdateMapRef updateMap, long page);
+
+/**
+ *  Returns @c true if a page before the batch was reloaded.
+ */
+bool MMSnapUpdateMapIsPageReloaded(MMSnapUpdateMapRef updateMap, long page);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MMSnapUpdateMap_h */
@@ -117,6 +117,90 @@ typedef NS_ENUM(NSUInteger, MMSnapScrollMode){
 
 @end
 
+/**
+ *  View controllers in a snap controller can adopt this protocol to preserve the state of their views when the snap
+ *  controller unloads them to save memory.
+ *
+ *  @note When a view controller doesn't implement these methods and its view is a @c UIScrollView, the content offset
+ *  is preserved.
+ */
+@protocol MMSnapViewStateRestoring <NSObject>
+@optional
+
+/**
+ *  Asks the view controller for the state of its view, just before the snap controller unloads it.
+ *
+ *  @param snapController The snap controller unloading the view.
+ *
+ *  @return An object describing the state of the view, for example its scroll position, or @c nil.
+ */
+- (id)viewStateForUnloadingInSnapController:(MMSnapController *)snapController;
+
+/**
+ *  Tells the view controller that its view was loaded again after being unloaded by the snap controller.
+ *
+ *  @param snapController The snap controller.
+ *  @param state          The object returned by @c -viewStateForUnloadingInSnapController: before the view was unloaded.
+ */
+- (void)snapController:(MMSnapController *)snapController restoreViewState:(id)state;
+
+@end
+
+/**
+ *  Describes the view controller stack of a snap controller by page, so view controllers are only created for the pages
+ *  around the visible ones.
+ *
+ *  @note Pages are identified by an object, compared with @c -isEqual:, that stays the same as long as the page is in the
+ *  stack. A view controller pushed onto a snap controller with a data source is its own identifier.
+ */
+@protocol MMSnapControllerDataSource <NSObject>
+
+/**
+ *  Returns the number of pages in the view controller stack.
+ *
+ *  @param snapController The snap controller.
+ */
+- (NSInteger)numberOfPagesInSnapController:(MMSnapController *)snapController;
+
+/**
+ *  Returns the identifier of a page.
+ *
+ *  @param snapController The snap controller.
+ *  @param page           The index of the page.
+ */
+- (id)snapController:(MMSnapController *)snapController identifierForPage:(NSInteger)page;
+
+/**
+ *  Returns a new view controller for the page with an identifier, just before it's needed.
+ *
+ *  @param snapController The snap controller.
+ *  @param identifier     The identifier of the page.
+ */
+- (UIViewController *)snapController:(MMSnapController *)snapController viewControllerForIdentifier:(id)identifier;
+
+@optional
+
+/**
+ *  Returns the metrics of the page with an identifier, without creating its view controller.
+ *
+ *  @param snapController The snap controller.
+ *  @param identifier     The identifier of the page.
+ *
+ *  @note Pages are as wide as the snap controller when this method isn't implemented.
+ */
+- (MMViewControllerMetrics)snapController:(MMSnapController *)snapController metricsForIdentifier:(id)identifier;
+
+/**
+ *  Called after the snap controller discarded the view controller of a page far from the visible ones.
+ *
+ *  @param snapController The snap controller.
+ *  @param viewController The view controller that was discarded.
+ *  @param identifier     The identifier of its page, for which a new view controller is requested when needed again.
+ */
+- (void)snapController:(MMSnapController *)snapController didDiscardViewController:(UIViewController *)viewController forIdentifier:(id)identifier;
+
+@end
+
 @interface MMSnapController : UIViewController
 
 /**
@@ -149,9 +233,46 @@ typedef NS_ENUM(NSUInteger, MMSnapScrollMode){
 
 /**
  *  The view controllers currently on the view controller stack.
+ *
+ *  @note With a data source, only the view controllers created so far are returned, and this property can't be set.
  */
 @property (copy, nonatomic) NSArray <__kindof UIViewController *> *viewControllers;
 
+/**
+ *  The data source describing the view controller stack, instead of @c viewControllers.
+ *
+ *  @note The default value of this property is @c nil. Setting a data source removes the current view controllers and
+ *  reloads the pages. Metrics come from the data source, so the cost of displaying the first pages doesn't depend on the
+ *  depth of the stack. Pushes and pops change the pages until the next @c -reloadData, and popping pages whose view
+ *  controllers were never created doesn't return them.
+ */
+@property (weak, nonatomic) id <MMSnapControllerDataSource> dataSource;
+
+/**
+ *  A Boolean value that determines whether the view controllers created by the data source for pages farther than
+ *  @c numberOfPagesKeptLoadedAroundVisiblePages from the visible ones are discarded once they end being displayed.
+ *
+ *  @note The default value of this property is @c NO. A memory warning discards them regardless. View controllers pushed
+ *  onto the snap controller are never discarded.
+ */
+@property (assign, nonatomic) BOOL discardsDistantViewControllers;
+
+/**
+ *  Reloads the pages from the data source.
+ *
+ *  @note Pages whose identifiers are still part of the stack keep their view controllers.
+ */
+- (void)reloadData;
+
+/**
+ *  Returns the view controller of a page, asking the data source to create it if needed.
+ *
+ *  @param page The index of the page.
+ *
+ *  @return The view controller, or @c nil if the page is out of bounds.
+ */
+- (__kindof UIViewController *)viewControllerAtPage:(NSInteger)page;
+
 /**
  *  The view controllers currently visible on the interface.
  */
@@ -174,6 +295,80 @@ typedef NS_ENUM(NSUInteger, MMSnapScrollMode){
  */
 @property (readonly, nonatomic) MMSnapScrollMode scrollMode;
 
+/**
+ *  A thread-safe block returning the metrics of a view controller, used instead of the delegate method
+ *  @c -snapController:metricsForViewController: when set.
+ *
+ *  @note The block is called on a background queue for the view controllers that aren't visible, so resizes and rotations
+ *  don't block the main thread while every view controller is measured. It must not touch UIKit, and should only use the
+ *  view controller it receives as a key to state that is safe to read from any thread.
+ */
+@property (copy, nonatomic) MMViewControllerMetrics (^metricsProvider)(__kindof UIViewController *viewController);
+
+/**
+ *  The maximum number of view controller views kept loaded.
+ *
+ *  @note The default value of this property is @c 0, which keeps every view loaded. Otherwise, the views of view
+ *  controllers far from the visible ones are unloaded, least recently displayed first, and loaded again when needed.
+ */
+@property (assign, nonatomic) NSUInteger maximumNumberOfLoadedViews;
+
+/**
+ *  The maximum estimated memory (in bytes) used by the loaded view controller views.
+ *
+ *  @note The default value of this property is @c 0, for no limit. A view is estimated as a single backing store at the
+ *  size of its page.
+ */
+@property (assign, nonatomic) unsigned long long maximumLoadedViewsByteCount;
+
+/**
+ *  Views of view controllers within this number of pages of the visible ones are never unloaded.
+ *
+ *  @note The default value of this property is @c 2. When a limit on the loaded views is set, a memory warning unloads
+ *  every other view.
+ */
+@property (assign, nonatomic) NSUInteger numberOfPagesKeptLoadedAroundVisiblePages;
+
+/**
+ *  The number of times the layout of the pages was validated since the last changes to the view controller stack were
+ *  committed, including the validations made by the commit itself.
+ *
+ *  @note Pushes, pops, changes of @c viewControllers and scrolls made while the interface is loaded are committed
+ *  together on the next layout pass, in a single update of the pages and a single layout validation, and end up scrolling
+ *  to the last view controller that was pushed or scrolled to. Pushing several view controllers in a row, or popping and
+ *  pushing in the same run loop turn, should leave this property at @c 1 after the next layout pass.
+ */
+@property (readonly, nonatomic) NSUInteger numberOfLayoutValidationsInLastTransaction;
+
+/**
+ *  The time a page must stay visible, or hidden, during a drag or a deceleration before its view controller receives
+ *  the appearance callbacks.
+ *
+ *  @note The default value of this property is @c 0, which sends the callbacks as soon as pages are displayed or end
+ *  being displayed. Otherwise the callbacks are delivered together after a layout pass, once the visibility of a page
+ *  lasted this long or the scrolling settled, and the view controllers of the pages crossed during a fling don't appear
+ *  at all. Delegate callbacks are never deferred.
+ */
+@property (assign, nonatomic) NSTimeInterval appearanceCoalescingInterval;
+
+/**
+ *  The number of layout passes that propagated the safe area insets to child view controllers during the last second.
+ *
+ *  @note Insets are only propagated to the view controllers of the pages that appeared, disappeared, or whose visible
+ *  part started or stopped crossing the edges of the safe area since the previous layout pass, so scrolling through
+ *  pages within the safe area doesn't propagate anything. Rates above @c 240 are reported as @c 240.
+ */
+@property (readonly, nonatomic) NSUInteger safeAreaPropagationsPerSecond;
+
+/**
+ *  A Boolean value that determines whether the views of the view controllers sliding behind the following ones are
+ *  displayed as a rasterized snapshot instead of their live view hierarchy.
+ *
+ *  @note The default value of this property is @c NO. See @c -rasterizesDisappearingPages of @c MMSnapScrollView. Call
+ *  @c -invalidateRasterizationForViewController: when the content of a view controller changes.
+ */
+@property (assign, nonatomic) BOOL rasterizesDisappearingViewControllers;
+
 /**
  *  Scrolls the interface to the specified view controller.
  *
@@ -242,6 +437,33 @@ typedef NS_ENUM(NSUInteger, MMSnapScrollMode){
  */
 - (id)footerViewForViewController:(UIViewController *)viewController;
 
+/**
+ *  Discards the snapshot of the view of a view controller whose content changed.
+ *
+ *  @param viewController A view controller in the stack.
+ *
+ *  @note Only needed when @c rasterizesDisappearingViewControllers is @c YES. The live view is displayed again right away
+ *  if it was swapped for its snapshot.
+ */
+- (void)invalidateRasterizationForViewController:(UIViewController *)viewController;
+
+/**
+ *  Starts recording the layout passes, updates, pushes and pops of the receiver to a binary trace, which can be
+ *  replayed without UIKit by @c MMSnapTraceReplay.
+ *
+ *  @param path The path of the trace, replaced if it exists.
+ *
+ *  @return @c NO if the file could not be created.
+ *
+ *  @note Loads the view of the receiver. See @c -startRecordingTraceToFile: of @c MMSnapScrollView.
+ */
+- (BOOL)startRecordingTraceToFile:(NSString *)path;
+
+/**
+ *  Writes the buffered events and closes the trace being recorded, if any.
+ */
+- (void)stopRecordingTrace;
+
 @end
 
 @interface MMSnapSupplementaryView : UIView
@@ -270,9 +492,20 @@ typedef NS_ENUM(NSUInteger, MMSnapScrollMode){
 
 /**
  *  Called after the snap controller has updated its stack.
+ *
+ *  @note Only supplementary views of view controllers displayed in or next to the visible pages are notified right away.
+ *  The others are notified of the last change, and of the last snap, just before their view controller is displayed.
  */
 - (void)snapControllerViewControllersDidChange;
 
+/**
+ *  Called before a supplementary view of a removed view controller is reused for another view controller.
+ *
+ *  @note Reset any state specific to the previous view controller. The view is removed from its superview before this
+ *  method is called.
+ */
+- (void)prepareForReuse;
+
 /**
  *  The snap controller of the recipient.
  */
@@ -10,8 +10,13 @@
 #import "MMSnapScrollView.h"
 #import "MMSnapHeaderView.h"
 #import "MMSnapFooterView.h"
+#import "MMSnapAppearanceCoalescer.h"
+#import "MMSnapDiff.h"
+#import "MMSnapEvictionPolicy.h"
+#import "MMSnapSafeAreaTracker.h"
+#import <QuartzCore/QuartzCore.h>
 
-@interface MMSnapController () <MMSnapScrollViewDataSource, MMSnapScrollViewDelegate>
+@interface MMSnapController () <MMSnapScrollViewDataSource, MMSnapScrollViewPrefetchingDataSource, MMSnapScrollViewDelegate>
 {
     struct {
         unsigned int delegateWillDisplayViewController : 1;
@@ -21,14 +26,59 @@
         unsigned int delegateDidSnapViewController : 1;
         unsigned int delegateWillTransitionToScrollMode : 1;
     } _delegateFlags;
+    
+    struct {
+        unsigned int dataSourceMetricsForIdentifier : 1;
+        unsigned int dataSourceDidDiscardViewController : 1;
+    } _dataSourceFlags;
+    
+    MMSnapEvictionPolicyRef _evictionPolicy;
+    
+    // Headers and footers by view controller, and the ones of removed view controllers, kept for reuse.
+    NSMapTable *_headerViews;
+    NSMapTable *_footerViews;
+    NSMutableArray *_reusableHeaderViews;
+    NSMutableArray *_reusableFooterViews;
+    
+    // Supplementary views far from the visible pages aren't notified, they catch up when they are about to be displayed.
+    NSUInteger _viewControllersGeneration;
+    NSUInteger _snapGeneration;
+    __weak UIViewController *_snapTargetViewController;
+    
+    // The pages displayed by the scroll view while changes to the stack wait for the next layout pass, or nil if there
+    // are none, along with the last scroll target requested in the meantime or before the view was loaded.
+    NSArray *_displayedPages;
+    BOOL _transactionAnimated;
+    __weak UIViewController *_transactionScrollTarget;
+    BOOL _transactionScrollAnimated;
+    NSUInteger _transactionLayoutValidationCount;
+    
+    // Pending appearance callbacks, when they are coalesced, and whether a flush is scheduled for the next deadline.
+    MMSnapAppearanceCoalescerRef _appearanceCoalescer;
+    BOOL _appearanceFlushScheduled;
+    
+    // The layout snapshot decoded with the restorable state, restored on the next layout pass.
+    NSString *_restoredLayoutSnapshotPath;
+    
+    // The safe area insets last propagated to the visible pages.
+    MMSnapSafeAreaTrackerRef _safeAreaTracker;
+    
+    // With a data source, the identifiers of the pages, or nil without one, and the view controllers created for them so
+    // far along with the reverse mapping. Pushed view controllers are their own identifiers.
+    NSArray *_pageIdentifiers;
+    NSMapTable *_viewControllersByIdentifier;
+    NSMapTable *_identifiersByViewController;
 }
 
 @property (readonly, nonatomic) MMSnapScrollView *scrollView;
 
-@property (strong, nonatomic) NSMutableArray *headerFooterViewArray;
 @property (strong, nonatomic) Class headerViewClass;
 @property (strong, nonatomic) Class footerViewClass;
 
+@property (strong, nonatomic) NSMapTable *unloadedViewStates;
+
+- (UIViewController *)_viewControllerBeforeViewController:(UIViewController *)viewController;
+
 @end
 
 typedef NS_ENUM(NSUInteger, MMSnapViewType) {
@@ -39,13 +89,23 @@ typedef NS_ENUM(NSUInteger, MMSnapViewType) {
 @interface MMSnapSupplementaryView ()
 
 @property (assign, nonatomic, setter=_setViewType:) MMSnapViewType _viewType;
+@property (assign, nonatomic, setter=_setViewControllersGeneration:) NSUInteger _viewControllersGeneration;
+@property (assign, nonatomic, setter=_setSnapGeneration:) NSUInteger _snapGeneration;
 @property (weak, nonatomic, readwrite) UIViewController *viewController;
 @property (weak, nonatomic, readwrite) MMSnapController *snapController;
 
 @end
 
+// Supplementary views of removed view controllers kept for reuse, per type.
+static const NSUInteger MMSnapControllerMaximumReusableSupplementaryViews = 4;
+
+// Supplementary views of pages this close to the visible pages are notified right away.
+static const NSUInteger MMSnapControllerSupplementaryViewNotificationDistance = 1;
+
 @implementation MMSnapController
 
+@synthesize viewControllers = _viewControllers;
+
 #pragma mark - Init.
 
 - (instancetype)init
@@ -76,34 +136,101 @@ typedef NS_ENUM(NSUInteger, MMSnapViewType) {
 {
     self = [super init];
     if (self) {
+        _evictionPolicy = MMSnapEvictionPolicyCreate();
+        _safeAreaTracker = MMSnapSafeAreaTrackerCreate();
+        _unloadedViewStates = [NSMapTable weakToStrongObjectsMapTable];
+        
+        const NSPointerFunctionsOptions keyOptions = NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality;
+        _headerViews = [[NSMapTable alloc] initWithKeyOptions:keyOptions valueOptions:NSPointerFunctionsStrongMemory capacity:0];
+        _footerViews = [[NSMapTable alloc] initWithKeyOptions:keyOptions valueOptions:NSPointerFunctionsStrongMemory capacity:0];
+        _reusableHeaderViews = [NSMutableArray array];
+        _reusableFooterViews = [NSMutableArray array];
+        _viewControllersByIdentifier = [NSMapTable strongToStrongObjectsMapTable];
+        _identifiersByViewController = [[NSMapTable alloc] initWithKeyOptions:keyOptions valueOptions:NSPointerFunctionsStrongMemory capacity:0];
+        
+        self.numberOfPagesKeptLoadedAroundVisiblePages = 2;
         self.viewControllers = [viewControllers copy];
     }
     return self;
 }
 
+- (void)dealloc
+{
+    MMSnapEvictionPolicyRelease(_evictionPolicy);
+    MMSnapAppearanceCoalescerRelease(_appearanceCoalescer);
+    MMSnapSafeAreaTrackerRelease(_safeAreaTracker);
+}
+
 #pragma mark - Containment.
 
+// Pages are view controllers, or the identifiers of the data source, compared by identity.
+static BOOL MMSnapControllerDiffPages(NSArray *oldPages, NSArray *newPages, MMSnapDiffResult *result)
+{
+    const NSUInteger oldCount = oldPages.count;
+    const NSUInteger newCount = newPages.count;
+    
+    const void **oldItems = malloc(MAX(oldCount, 1) * sizeof(void *));
+    const void **newItems = malloc(MAX(newCount, 1) * sizeof(void *));
+    
+    BOOL success = NO;
+    if (oldItems && newItems) {
+        NSUInteger idx = 0;
+        for (id page in oldPages) {
+            oldItems[idx++] = (__bridge const void *)page;
+        }
+        
+        idx = 0;
+        for (id page in newPages) {
+            newItems[idx++] = (__bridge const void *)page;
+        }
+        
+        success = MMSnapDiffCompute(oldItems, oldCount, newItems, newCount, result);
+    }
+    
+    free(oldItems);
+    free(newItems);
+    
+    return success;
+}
+
+- (NSArray *)viewControllers
+{
+    // Only the view controllers created so far, in the order of their pages.
+    if (_pageIdentifiers) {
+        return [self _createdViewControllersForPages:_pageIdentifiers];
+    }
+    return _viewControllers;
+}
+
 - (void)setViewControllers:(NSArray *)viewControllers
 {
-    if ([viewControllers isEqualToArray:_viewControllers]) {
+    // The data source describes the stack instead.
+    NSAssert(!_pageIdentifiers || viewControllers.count == 0, @"attempt to set the view controllers of a snap controller with a data source.");
+    if (_pageIdentifiers || [viewControllers isEqualToArray:_viewControllers]) {
         return;
     }
     
+    // Find the view controllers that join or leave the stack in linear time, the pages themselves are diffed once when
+    // the transaction is committed. View controllers that were reordered stay children and keep their views.
+    NSSet *oldViewControllers = [NSSet setWithArray:_viewControllers];
+    NSSet *newViewControllers = [NSSet setWithArray:viewControllers];
+    
     NSIndexSet *removedIndexes = [_viewControllers indexesOfObjectsPassingTest:^BOOL(id obj, NSUInteger idx, BOOL *stop) {
-        UIViewController *vc = obj;
-        
-        return ![viewControllers containsObject:vc];
+        return ![newViewControllers containsObject:obj];
     }];
-    
     NSIndexSet *insertedIndexes = [viewControllers indexesOfObjectsPassingTest:^BOOL(id obj, NSUInteger idx, BOOL *stop) {
-        UIViewController *vc = obj;
-        
-        return ![self->_viewControllers containsObject:vc];
+        return ![oldViewControllers containsObject:obj];
     }];
     
     NSArray *inserted = [viewControllers objectsAtIndexes:insertedIndexes];
     NSArray *removed = [_viewControllers objectsAtIndexes:removedIndexes];
     
+    // Forget the views of the removed view controllers.
+    for (UIViewController *viewController in removed) {
+        MMSnapEvictionPolicyRemoveKey(_evictionPolicy, (__bridge const void *)viewController);
+        [self.unloadedViewStates removeObjectForKey:viewController];
+    }
+    
     // Supplementary views.
     [self _removeSupplementaryViewsForViewControllers:removed];
     [self _insertSupplementaryViewsForViewControllers:inserted];
@@ -112,31 +239,163 @@ typedef NS_ENUM(NSUInteger, MMSnapViewType) {
     [removed makeObjectsPerformSelector:@selector(willMoveToParentViewController:) withObject:nil];
     [inserted makeObjectsPerformSelector:@selector(willMoveToParentViewController:) withObject:self];
     
+    [self _beginTransactionAnimated:YES];
+    
     _viewControllers = viewControllers;
     
     // End transaction.
     [removed makeObjectsPerformSelector:@selector(removeFromParentViewController)];
     [inserted makeObjectsPerformSelector:@selector(didMoveToParentViewController:) withObject:self];
     
-    BOOL isViewLoaded = self.isViewLoaded;
-    
     for (UIViewController *vc in viewControllers) {
         if (vc.parentViewController != self) {
             [self addChildViewController:vc];
         }
     }
+}
+
+#pragma mark - Transactions.
+
+- (void)_beginTransactionAnimated:(BOOL)animated
+{
+    // Nothing is displayed yet, the scroll view loads every page with the view.
+    if (!self.isViewLoaded) {
+        return;
+    }
+    
+    if (_displayedPages) {
+        _transactionAnimated = _transactionAnimated || animated;
+        return;
+    }
+    
+    _displayedPages = [self _pages] ?: @[];
+    _transactionAnimated = animated;
+    
+    // Committed on the next layout pass, or on the next run loop turn if the view isn't laid out until then.
+    [self.view setNeedsLayout];
+    
+    __weak typeof(self) weakSelf = self;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [weakSelf _commitTransaction];
+    });
+}
+
+- (void)_commitTransaction
+{
+    NSArray *displayedPages = _displayedPages;
+    if (!displayedPages) {
+        return;
+    }
+    
+    // The data source describes the new stack from now on.
+    _displayedPages = nil;
+    NSArray *pages = [self _pages];
     
-    // Update the UI.
-    if (isViewLoaded) {
-        [self.scrollView performBatchUpdates:^{
-            [self.scrollView deletePages:removedIndexes animated:YES];
-            [self.scrollView insertPages:insertedIndexes animated:YES];
-        } completion:^(BOOL changesWereMade) {
-            if (changesWereMade) {
-                [self _notifyViewControllersDidChange];
+    MMSnapScrollView *scrollView = self.scrollView;
+    _transactionLayoutValidationCount = scrollView.numberOfLayoutValidations;
+    
+    // Resolve every push, pop and change of the stack into a single update of the pages.
+    BOOL didUpdate = NO;
+    
+    MMSnapDiffResult diff;
+    if (MMSnapControllerDiffPages(displayedPages, pages, &diff)) {
+        if (diff.deleteCount > 0 || diff.insertCount > 0 || diff.moveCount > 0) {
+            NSMutableIndexSet *removedIndexes = [NSMutableIndexSet indexSet];
+            for (long idx = 0; idx < diff.deleteCount; idx++) {
+                [removedIndexes addIndex:diff.deletes[idx]];
             }
-        }];
+            NSArray *removedPages = [displayedPages objectsAtIndexes:removedIndexes];
+            NSArray *removedViewControllers = [self _createdViewControllersForPages:removedPages];
+            
+            NSMutableIndexSet *insertedIndexes = [NSMutableIndexSet indexSet];
+            for (long idx = 0; idx < diff.insertCount; idx++) {
+                [insertedIndexes addIndex:diff.inserts[idx]];
+            }
+            
+            void (^updates)(void) = ^{
+                [scrollView performBatchUpdates:^{
+                    [scrollView deletePages:removedIndexes animated:YES];
+                    [scrollView insertPages:insertedIndexes animated:YES];
+                    
+                    for (long idx = 0; idx < diff.moveCount; idx++) {
+                        [scrollView movePage:diff.moves[idx].from toPage:diff.moves[idx].to];
+                    }
+                } completion:nil];
+            };
+            
+            if (_transactionAnimated) {
+                updates();
+            } else {
+                [UIView performWithoutAnimation:updates];
+            }
+            
+            [self _removeAppearanceTransitionsForViewControllers:removedViewControllers];
+            
+            for (UIViewController *viewController in removedViewControllers) {
+                MMSnapSafeAreaTrackerRemoveKey(_safeAreaTracker, (__bridge const void *)viewController);
+                [self invalidateRasterizationForViewController:viewController];
+            }
+            
+            [self _forgetViewControllersForIdentifiers:removedPages];
+            
+            didUpdate = YES;
+        }
+        
+        MMSnapDiffResultFree(&diff);
+    } else {
+        [scrollView reloadData];
+        MMSnapSafeAreaTrackerInvalidate(_safeAreaTracker);
+        
+        NSMutableSet *removedPages = [NSMutableSet setWithArray:displayedPages];
+        [removedPages minusSet:[NSSet setWithArray:pages]];
+        [self _forgetViewControllersForIdentifiers:removedPages.allObjects];
+        
+        didUpdate = YES;
+    }
+    
+    // Then scroll to the last target, if it's still on the stack.
+    UIViewController *scrollTarget = _transactionScrollTarget;
+    _transactionScrollTarget = nil;
+    
+    const NSUInteger page = scrollTarget ? [pages indexOfObjectIdenticalTo:[self _pageForViewController:scrollTarget]] : NSNotFound;
+    if (page != NSNotFound) {
+        [scrollView scrollToPage:page animated:_transactionScrollAnimated];
+    }
+    
+    if (didUpdate) {
+        [self _notifyViewControllersDidChange];
+    }
+}
+
+- (NSUInteger)numberOfLayoutValidationsInLastTransaction
+{
+    if (!self.isViewLoaded) {
+        return 0;
+    }
+    return self.scrollView.numberOfLayoutValidations - _transactionLayoutValidationCount;
+}
+
+- (NSArray *)_pages
+{
+    return _pageIdentifiers ?: _viewControllers;
+}
+
+- (NSArray *)_displayedPages
+{
+    return _displayedPages ?: [self _pages];
+}
+
+- (id)_pageForViewController:(UIViewController *)viewController
+{
+    return [_identifiersByViewController objectForKey:viewController] ?: viewController;
+}
+
+- (NSUInteger)_pageOfViewController:(UIViewController *)viewController
+{
+    if (!viewController) {
+        return NSNotFound;
     }
+    return [[self _pages] indexOfObjectIdenticalTo:[self _pageForViewController:viewController]];
 }
 
 - (BOOL)shouldAutomaticallyForwardAppearanceMethods
@@ -165,12 +424,13 @@ typedef NS_ENUM(NSUInteger, MMSnapViewType) {
         return nil;
     }
     
-    NSArray *viewControllers = self.viewControllers;
     NSMutableArray *visibleViewControllers = [NSMutableArray arrayWithCapacity:pages.count];
     
     [pages enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
-        UIViewController *vc = viewControllers[idx];
-        [visibleViewControllers addObject:vc];
+        UIViewController *vc = [self _viewControllerAtPage:idx];
+        if (vc) {
+            [visibleViewControllers addObject:vc];
+        }
     }];
     
     return visibleViewControllers;
@@ -196,7 +456,9 @@ typedef NS_ENUM(NSUInteger, MMSnapViewType) {
 {
     MMSnapScrollView *scrollView = [[MMSnapScrollView alloc] initWithFrame:CGRectZero];
     scrollView.dataSource = self;
+    scrollView.prefetchDataSource = self;
     scrollView.delegate = self;
+    scrollView.rasterizesDisappearingPages = _rasterizesDisappearingViewControllers;
     
     self.view = scrollView;
 }
@@ -206,6 +468,30 @@ typedef NS_ENUM(NSUInteger, MMSnapViewType) {
     return (MMSnapScrollView *)self.view;
 }
 
+- (void)viewWillLayoutSubviews
+{
+    [super viewWillLayoutSubviews];
+    
+    // Commit the changes to the stack before the scroll view lays out its pages.
+    [self _commitTransaction];
+    
+    // Lay out the first frame after state restoration with the widths of the previous launch, if they still apply.
+    if (_restoredLayoutSnapshotPath) {
+        [self.scrollView restoreLayoutFromSnapshotFile:_restoredLayoutSnapshotPath traits:[self _layoutSnapshotTraits]];
+        _restoredLayoutSnapshotPath = nil;
+    }
+}
+
+- (void)viewDidLayoutSubviews
+{
+    [super viewDidLayoutSubviews];
+    
+    // Catch the pages up with the safe area, then deliver the appearance callbacks of the pages displayed or hidden
+    // during the layout pass.
+    [self _propagateSafeAreaInsetsIfNeeded];
+    [self _flushAppearanceTransitions];
+}
+
 - (void)viewDidLoad
 {
     [super viewDidLoad];
@@ -215,6 +501,16 @@ typedef NS_ENUM(NSUInteger, MMSnapViewType) {
     } else {
         self.scrollView.pagingEnabled = (UI_USER_INTERFACE_IDIOM() == UIUserInterfaceIdiomPhone);
     }
+    
+    // Scroll to the last target requested before the view was loaded, if it's still on the stack. The scroll view
+    // defers it until its pages are laid out in a window.
+    UIViewController *scrollTarget = _transactionScrollTarget;
+    _transactionScrollTarget = nil;
+    
+    const NSUInteger page = [self _pageOfViewController:scrollTarget];
+    if (page != NSNotFound) {
+        [self.scrollView scrollToPage:page animated:_transactionScrollAnimated];
+    }
 }
 
 #pragma mark - Delegate.
@@ -235,214 +531,569 @@ typedef NS_ENUM(NSUInteger, MMSnapViewType) {
     _delegateFlags.delegateWillTransitionToScrollMode = [delegate respondsToSelector:@selector(snapController:willTransitionToScrollMode:transitionCoordinator:)];
 }
 
-#pragma mark - Scroll to.
-
-- (void)scrollToViewController:(UIViewController *)viewController animated:(BOOL)animated
+- (void)setMetricsProvider:(MMViewControllerMetrics (^)(__kindof UIViewController *))metricsProvider
 {
-    NSUInteger idx = [self.viewControllers indexOfObject:viewController];
-    
-    // No can do.
-    if (idx == NSNotFound) {
-        return;
-    }
+    _metricsProvider = [metricsProvider copy];
     
-    [self.scrollView scrollToPage:idx animated:animated];
-}
-
-- (MMSnapScrollMode)scrollMode
-{
-    if (self.scrollView.isPagingEnabled) {
-        return MMSnapScrollModePaging;
+    if (self.isViewLoaded) {
+        [self.scrollView invalidateLayout];
     }
-    return MMSnapScrollModeNearestSnapPoint;
 }
 
-#pragma mark - Operations.
+#pragma mark - Data source.
 
-- (void)pushViewController:(UIViewController *)viewController animated:(BOOL)animated
+- (void)setDataSource:(id<MMSnapControllerDataSource>)dataSource
 {
-    // No can do.
-    if ([self.viewControllers containsObject:viewController]) {
+    if (dataSource == _dataSource) {
         return;
     }
     
-    // Add as child.
-    [self addChildViewController:viewController];
+    // The previous stack goes away, the data source describes the new one.
+    if (_pageIdentifiers) {
+        [self _setPageIdentifiers:@[]];
+    } else {
+        self.viewControllers = @[];
+    }
     
-    // Update data source.
-    _viewControllers = [_viewControllers arrayByAddingObject:viewController];
+    _dataSource = dataSource;
     
-    // Now the data source is updated, just commit the operations.
-    NSInteger page = self.viewControllers.count - 1;
+    _dataSourceFlags.dataSourceMetricsForIdentifier = [dataSource respondsToSelector:@selector(snapController:metricsForIdentifier:)];
+    _dataSourceFlags.dataSourceDidDiscardViewController = [dataSource respondsToSelector:@selector(snapController:didDiscardViewController:forIdentifier:)];
     
-    [self.scrollView insertPages:[NSIndexSet indexSetWithIndex:page] animated:animated];
-    [self.scrollView scrollToPage:page animated:animated];
+    _pageIdentifiers = dataSource ? @[] : nil;
     
-    // Note update.
-    [self _notifyViewControllersDidChange];
+    [self reloadData];
 }
 
-- (NSArray *)popToViewController:(UIViewController *)viewController animated:(BOOL)animated
+- (void)reloadData
 {
-    NSUInteger idx = [self.viewControllers indexOfObject:viewController];
-    
-    // Don't do anything if view controller is nowhere to be found.
-    if (idx == NSNotFound) {
-        return nil;
+    id <MMSnapControllerDataSource> dataSource = _dataSource;
+    if (!dataSource || !_pageIdentifiers) {
+        return;
     }
     
-    // No can do.
-    if (self.viewControllers.count == 1) {
-        return nil;
+    // Identifiers equal to the ones of the current pages are replaced by them, so pages are compared by identity.
+    NSMapTable *knownIdentifiers = [NSMapTable strongToStrongObjectsMapTable];
+    for (id identifier in _pageIdentifiers) {
+        [knownIdentifiers setObject:identifier forKey:identifier];
     }
     
-    NSRange range = NSMakeRange(idx + 1, (self.viewControllers.count - 1) - idx);
-    NSArray *popViewControllers = [self.viewControllers subarrayWithRange:range];
+    const NSInteger count = MAX([dataSource numberOfPagesInSnapController:self], 0);
+    NSMutableArray *pageIdentifiers = [NSMutableArray arrayWithCapacity:(NSUInteger)count];
     
-    // Remove from parent.
-    for (UIViewController *vc in popViewControllers) {
-        [vc willMoveToParentViewController:nil];
-        [vc removeFromParentViewController];
+    for (NSInteger page = 0; page < count; page++) {
+        id identifier = [dataSource snapController:self identifierForPage:page];
+        NSAssert(identifier != nil, @"data source returned a nil identifier for page %ld.", (long)page);
+        
+        if (identifier) {
+            [pageIdentifiers addObject:[knownIdentifiers objectForKey:identifier] ?: identifier];
+        }
     }
     
-    // Update data source.
-    _viewControllers = [_viewControllers subarrayWithRange:NSMakeRange(0, range.location)];
+    [self _setPageIdentifiers:pageIdentifiers];
+}
+
+- (void)_setPageIdentifiers:(NSArray *)pageIdentifiers
+{
+    NSSet *identifiers = [NSSet setWithArray:pageIdentifiers];
+    NSMutableArray *removedIdentifiers = [NSMutableArray array];
+    NSMutableArray *removedViewControllers = [NSMutableArray array];
+    
+    // View controllers of removed pages stop being children right away, the ones of pages removed and added back
+    // before the next layout pass become children again.
+    for (id identifier in [[_viewControllersByIdentifier keyEnumerator] allObjects]) {
+        UIViewController *viewController = [_viewControllersByIdentifier objectForKey:identifier];
+        const BOOL isPage = [identifiers containsObject:identifier];
+        
+        if (!isPage) {
+            [removedIdentifiers addObject:identifier];
+        }
+        
+        if (!isPage && viewController.parentViewController == self) {
+            [viewController willMoveToParentViewController:nil];
+            [viewController removeFromParentViewController];
+            [removedViewControllers addObject:viewController];
+        } else if (isPage && viewController.parentViewController != self) {
+            [self addChildViewController:viewController];
+            [viewController didMoveToParentViewController:self];
+        }
+    }
     
-    // Now the data source is updated, just commit the operations.
-    [self.scrollView deletePages:[NSIndexSet indexSetWithIndexesInRange:range] animated:animated];
+    [self _removeSupplementaryViewsForViewControllers:removedViewControllers];
     
-    // Remove supplementary views.
-    [self _removeSupplementaryViewsForViewControllers:popViewControllers];
+    // Update data source, the pages are updated on the next layout pass.
+    [self _beginTransactionAnimated:YES];
     
-    // Note update.
-    [self _notifyViewControllersDidChange];
+    _pageIdentifiers = [pageIdentifiers copy];
     
-    return popViewControllers;
+    // Without a transaction to commit, the view controllers of the removed pages are forgotten right away.
+    if (!_displayedPages) {
+        [self _forgetViewControllersForIdentifiers:removedIdentifiers];
+    }
 }
 
-- (NSArray *)popToRootViewControllerAnimated:(BOOL)animated
+- (UIViewController *)viewControllerAtPage:(NSInteger)page
 {
-    // No can do.
-    if (self.viewControllers.count == 0 || self.visibleViewControllers.firstObject == self.viewControllers.firstObject) {
+    NSArray *pages = [self _pages];
+    
+    if (page < 0 || page >= (NSInteger)pages.count) {
         return nil;
     }
-    
-    return [self popToViewController:self.viewControllers.firstObject animated:animated];
+    return [self _viewControllerForPage:pages[page] creatingIfNeeded:YES];
 }
 
-- (UIViewController *)popViewControllerAnimated:(BOOL)animated
+- (UIViewController *)_viewControllerForPage:(id)page creatingIfNeeded:(BOOL)creatingIfNeeded
 {
-    UIViewController *topViewController = self.viewControllers.lastObject;
-    if (topViewController) {
-        NSUInteger pop = [self.viewControllers indexOfObject:topViewController] - 1;
-        
-        if (pop < self.viewControllers.count) {
-            return [self popToViewController:self.viewControllers[pop] animated:animated].firstObject;
-        }
+    if (!page) {
+        return nil;
     }
-    return nil;
+    
+    UIViewController *viewController = [_viewControllersByIdentifier objectForKey:page];
+    if (viewController) {
+        return viewController;
+    }
+    
+    // Without a data source, pages are view controllers.
+    if ([page isKindOfClass:[UIViewController class]]) {
+        return page;
+    }
+    
+    id <MMSnapControllerDataSource> dataSource = _dataSource;
+    if (!creatingIfNeeded || !dataSource) {
+        return nil;
+    }
+    
+    viewController = [dataSource snapController:self viewControllerForIdentifier:page];
+    if (!viewController) {
+        return nil;
+    }
+    
+    [self addChildViewController:viewController];
+    
+    [_viewControllersByIdentifier setObject:viewController forKey:page];
+    [_identifiersByViewController setObject:page forKey:viewController];
+    
+    [viewController didMoveToParentViewController:self];
+    
+    return viewController;
 }
 
-#pragma mark - Size classes.
-
-- (void)_configureScrollViewWithTraitCollection:(UITraitCollection *)traitCollection
+- (NSArray *)_createdViewControllersForPages:(NSArray *)pages
 {
-    [self _configureScrollViewWithTraitCollection:traitCollection transitionCoordinator:nil];
+    NSMutableArray *viewControllers = [NSMutableArray arrayWithCapacity:MIN(pages.count, _viewControllersByIdentifier.count)];
+    
+    for (id page in pages) {
+        UIViewController *viewController = [self _viewControllerForPage:page creatingIfNeeded:NO];
+        if (viewController) {
+            [viewControllers addObject:viewController];
+        }
+    }
+    return viewControllers;
 }
 
-- (void)_configureScrollViewWithTraitCollection:(UITraitCollection *)traitCollection transitionCoordinator:(id<UIViewControllerTransitionCoordinator>)coordinator
+- (void)_forgetViewControllersForIdentifiers:(NSArray *)identifiers
 {
-    BOOL horizontallyCompact = traitCollection.horizontalSizeClass == UIUserInterfaceSizeClassCompact;
-    BOOL pagingEnabled = horizontallyCompact;
-    
-    if (pagingEnabled != self.scrollView.isPagingEnabled) {
-        MMSnapScrollMode scrollMode = pagingEnabled ? MMSnapScrollModePaging : MMSnapScrollModeNearestSnapPoint;
+    for (id identifier in identifiers) {
+        UIViewController *viewController = [_viewControllersByIdentifier objectForKey:identifier];
+        if (!viewController) {
+            continue;
+        }
         
-        if (_delegateFlags.delegateWillTransitionToScrollMode) {
-            [self.delegate snapController:self willTransitionToScrollMode:scrollMode transitionCoordinator:coordinator];
+        if (viewController.parentViewController == self) {
+            [viewController willMoveToParentViewController:nil];
+            [viewController removeFromParentViewController];
         }
         
-        [self.scrollView setPagingEnabled:pagingEnabled];
-        [self.scrollView invalidateLayout];
+        MMSnapEvictionPolicyRemoveKey(_evictionPolicy, (__bridge const void *)viewController);
+        [self.unloadedViewStates removeObjectForKey:viewController];
+        
+        [_viewControllersByIdentifier removeObjectForKey:identifier];
+        [_identifiersByViewController removeObjectForKey:viewController];
     }
 }
 
-- (void)willTransitionToTraitCollection:(UITraitCollection *)newCollection withTransitionCoordinator:(id<UIViewControllerTransitionCoordinator>)coordinator
-{
-    [super willTransitionToTraitCollection:newCollection withTransitionCoordinator:coordinator];
-    [self _configureScrollViewWithTraitCollection:newCollection transitionCoordinator:coordinator];
-}
-
-- (void)traitCollectionDidChange:(UITraitCollection *)previousTraitCollection
-{
-    [super traitCollectionDidChange:previousTraitCollection];
-    [self _configureScrollViewWithTraitCollection:self.traitCollection];
-}
-
-#pragma mark - Snap scroll view data source.
-
-- (CGFloat)scrollView:(MMSnapScrollView *)scrollView widthForViewAtPage:(NSInteger)page
+- (void)_discardDistantViewControllersIgnoringSetting:(BOOL)ignoreSetting
 {
-    const CGRect bounds = self.view.bounds;
+    if (!_pageIdentifiers || _displayedPages || !self.isViewLoaded || (!_discardsDistantViewControllers && !ignoreSetting)) {
+        return;
+    }
     
-    if (_delegateFlags.delegateCustomWidthForViewController) {
-        UIViewController *viewController = [self _viewControllerAtPage:page];
-        
-        const MMViewControllerMetrics metrics = [self.delegate snapController:self metricsForViewController:viewController];
+    NSArray *pages = _pageIdentifiers;
+    NSIndexSet *visiblePages = self.scrollView.pagesForVisibleViews;
+    
+    // The view controllers of the pages around the visible ones stay.
+    NSHashTable *keptIdentifiers = [NSHashTable hashTableWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality];
+    
+    if (visiblePages.count > 0 && pages.count > 0) {
+        const NSUInteger distance = _numberOfPagesKeptLoadedAroundVisiblePages;
+        const NSUInteger firstPage = (visiblePages.firstIndex > distance) ? visiblePages.firstIndex - distance : 0;
+        const NSUInteger lastPage = MIN(visiblePages.lastIndex + distance, pages.count - 1);
         
-        if (metrics == MMViewControllerMetricsFullscreen) {
-            return CGRectGetWidth(bounds);
+        for (NSUInteger page = firstPage; page <= lastPage; page++) {
+            [keptIdentifiers addObject:pages[page]];
         }
+    }
+    
+    NSMutableArray *discardedIdentifiers = [NSMutableArray array];
+    NSMutableArray *discardedViewControllers = [NSMutableArray array];
+    
+    for (id identifier in _viewControllersByIdentifier) {
+        UIViewController *viewController = [_viewControllersByIdentifier objectForKey:identifier];
         
-        BOOL pagingEnabled;
-        if ([UITraitCollection class]) {
-            BOOL horizontallyCompact = self.traitCollection.horizontalSizeClass == UIUserInterfaceSizeClassCompact;
-            pagingEnabled = horizontallyCompact;
-        } else {
-            pagingEnabled = UI_USER_INTERFACE_IDIOM() == UIUserInterfaceIdiomPhone;
+        // Pushed view controllers aren't created again, and views still on screen are kept until next time.
+        if (viewController == identifier || [keptIdentifiers containsObject:identifier] || (viewController.isViewLoaded && viewController.view.window)) {
+            continue;
         }
         
-        if (!pagingEnabled) {
-            UIUserInterfaceIdiom userInterfaceIdiom;
-            if ([UITraitCollection class]) {
-                userInterfaceIdiom = self.traitCollection.userInterfaceIdiom;
-            } else {
-                userInterfaceIdiom = UI_USER_INTERFACE_IDIOM();
-            }
-            
-            CGFloat compactWidth = 320.0f;
-            
-#if __IPHONE_OS_VERSION_MAX_ALLOWED >= 110000
-            if (@available(iOS 11.0, *)) {
-                const UIEdgeInsets safeAreaInsets = self.view.safeAreaInsets;
-                const CGFloat estimatedMargin = MAX(safeAreaInsets.left, safeAreaInsets.right);
-                
-                compactWidth += estimatedMargin;
-            }
-#endif
-            
-            if (metrics == MMViewControllerMetricsCompact) {
-                return compactWidth;
-            } else if (metrics == MMViewControllerMetricsLarge) {
-                if (CGRectGetWidth(bounds) > CGRectGetHeight(bounds)) {
-                    return CGRectGetWidth(bounds) - compactWidth;
-                } else {
-                    return CGRectGetWidth(bounds);
-                }
-            }
-        }
+        [discardedIdentifiers addObject:identifier];
+        [discardedViewControllers addObject:viewController];
+    }
+    
+    if (discardedIdentifiers.count == 0) {
+        return;
+    }
+    
+    [self _removeAppearanceTransitionsForViewControllers:discardedViewControllers];
+    [self _removeSupplementaryViewsForViewControllers:discardedViewControllers];
+    
+    for (UIViewController *viewController in discardedViewControllers) {
+        MMSnapSafeAreaTrackerRemoveKey(_safeAreaTracker, (__bridge const void *)viewController);
+        [self invalidateRasterizationForViewController:viewController];
+        
+        if (viewController.isViewLoaded) {
+            [viewController.view removeFromSuperview];
+        }
+    }
+    
+    [self _forgetViewControllersForIdentifiers:discardedIdentifiers];
+    
+    if (_dataSourceFlags.dataSourceDidDiscardViewController) {
+        id <MMSnapControllerDataSource> dataSource = _dataSource;
+        
+        [discardedIdentifiers enumerateObjectsUsingBlock:^(id identifier, NSUInteger idx, BOOL *stop) {
+            [dataSource snapController:self didDiscardViewController:discardedViewControllers[idx] forIdentifier:identifier];
+        }];
+    }
+}
+
+#pragma mark - Scroll to.
+
+- (void)scrollToViewController:(UIViewController *)viewController animated:(BOOL)animated
+{
+    NSUInteger idx = [self _pageOfViewController:viewController];
+    
+    // No can do.
+    if (idx == NSNotFound) {
+        return;
+    }
+    
+    // Pages waiting for the next layout pass or for the view to load aren't there to scroll to yet.
+    if (_displayedPages || !self.isViewLoaded) {
+        [self _setTransactionScrollTarget:viewController animated:animated];
+        return;
+    }
+    
+    [self.scrollView scrollToPage:idx animated:animated];
+}
+
+- (void)_setTransactionScrollTarget:(UIViewController *)viewController animated:(BOOL)animated
+{
+    // Targets requested before the view is loaded are scrolled to once it is.
+    if (!_displayedPages && self.isViewLoaded) {
+        return;
+    }
+    
+    _transactionScrollTarget = viewController;
+    _transactionScrollAnimated = animated;
+}
+
+- (MMSnapScrollMode)scrollMode
+{
+    if (self.scrollView.isPagingEnabled) {
+        return MMSnapScrollModePaging;
+    }
+    return MMSnapScrollModeNearestSnapPoint;
+}
+
+#pragma mark - Operations.
+
+- (void)pushViewController:(UIViewController *)viewController animated:(BOOL)animated
+{
+    // No can do.
+    if (!viewController || [self _pageOfViewController:viewController] != NSNotFound) {
+        return;
+    }
+    
+    // Add as child.
+    [self addChildViewController:viewController];
+    
+    if (self.isViewLoaded) {
+        [self.scrollView recordTraceMarker:MMSnapScrollViewTraceMarkerPush page:[self _pages].count];
+    }
+    
+    // Update data source, the pages are updated and scrolled on the next layout pass.
+    [self _beginTransactionAnimated:animated];
+    [self _setTransactionScrollTarget:viewController animated:animated];
+    
+    if (_pageIdentifiers) {
+        [_viewControllersByIdentifier setObject:viewController forKey:viewController];
+        [_identifiersByViewController setObject:viewController forKey:viewController];
+        
+        _pageIdentifiers = [_pageIdentifiers arrayByAddingObject:viewController];
+    } else {
+        _viewControllers = [_viewControllers arrayByAddingObject:viewController];
+    }
+}
+
+- (NSArray *)popToViewController:(UIViewController *)viewController animated:(BOOL)animated
+{
+    NSUInteger idx = [self _pageOfViewController:viewController];
+    
+    // Don't do anything if view controller is nowhere to be found.
+    if (idx == NSNotFound) {
+        return nil;
+    }
+    
+    return [self _popToPage:idx animated:animated];
+}
+
+- (NSArray *)_popToPage:(NSUInteger)page animated:(BOOL)animated
+{
+    NSArray *pages = [self _pages];
+    
+    // No can do.
+    if (page >= pages.count || pages.count == 1) {
+        return nil;
+    }
+    
+    // Pages of the data source that were never displayed have no view controller to pop.
+    NSRange range = NSMakeRange(page + 1, (pages.count - 1) - page);
+    NSArray *popPages = [pages subarrayWithRange:range];
+    NSArray *popViewControllers = [self _createdViewControllersForPages:popPages];
+    
+    // Remove from parent.
+    for (UIViewController *vc in popViewControllers) {
+        [vc willMoveToParentViewController:nil];
+        [vc removeFromParentViewController];
+    }
+    
+    if (self.isViewLoaded) {
+        [self.scrollView recordTraceMarker:MMSnapScrollViewTraceMarkerPop page:range.location];
+    }
+    
+    // Update data source, the pages are updated on the next layout pass.
+    [self _beginTransactionAnimated:animated];
+    
+    if (_pageIdentifiers) {
+        _pageIdentifiers = [pages subarrayWithRange:NSMakeRange(0, range.location)];
+    } else {
+        _viewControllers = [pages subarrayWithRange:NSMakeRange(0, range.location)];
+    }
+    
+    // Remove supplementary views.
+    [self _removeSupplementaryViewsForViewControllers:popViewControllers];
+    
+    // Without a transaction to commit, the view controllers of the popped pages are forgotten right away.
+    if (!_displayedPages) {
+        [self _forgetViewControllersForIdentifiers:popPages];
+    }
+    
+    return popViewControllers;
+}
+
+- (NSArray *)popToRootViewControllerAnimated:(BOOL)animated
+{
+    // No can do.
+    if ([self _pages].count == 0 || [self _pageOfViewController:self.visibleViewControllers.firstObject] == 0) {
+        return nil;
+    }
+    
+    return [self _popToPage:0 animated:animated];
+}
+
+- (UIViewController *)popViewControllerAnimated:(BOOL)animated
+{
+    const NSUInteger count = [self _pages].count;
+    if (count > 1) {
+        return [self _popToPage:count - 2 animated:animated].firstObject;
+    }
+    return nil;
+}
+
+#pragma mark - Size classes.
+
+- (void)_configureScrollViewWithTraitCollection:(UITraitCollection *)traitCollection
+{
+    [self _configureScrollViewWithTraitCollection:traitCollection transitionCoordinator:nil];
+}
+
+- (void)_configureScrollViewWithTraitCollection:(UITraitCollection *)traitCollection transitionCoordinator:(id<UIViewControllerTransitionCoordinator>)coordinator
+{
+    BOOL horizontallyCompact = traitCollection.horizontalSizeClass == UIUserInterfaceSizeClassCompact;
+    BOOL pagingEnabled = horizontallyCompact;
+    
+    if (pagingEnabled != self.scrollView.isPagingEnabled) {
+        MMSnapScrollMode scrollMode = pagingEnabled ? MMSnapScrollModePaging : MMSnapScrollModeNearestSnapPoint;
+        
+        if (_delegateFlags.delegateWillTransitionToScrollMode) {
+            [self.delegate snapController:self willTransitionToScrollMode:scrollMode transitionCoordinator:coordinator];
+        }
+        
+        [self.scrollView setPagingEnabled:pagingEnabled];
+        [self.scrollView invalidateLayout];
     }
-    return CGRectGetWidth(bounds);
-}
-
-- (UIView *)scrollView:(MMSnapScrollView *)scrollView viewAtPage:(NSInteger)page
-{
-    return [self _viewControllerAtPage:page].view;
+}
+
+- (void)willTransitionToTraitCollection:(UITraitCollection *)newCollection withTransitionCoordinator:(id<UIViewControllerTransitionCoordinator>)coordinator
+{
+    [super willTransitionToTraitCollection:newCollection withTransitionCoordinator:coordinator];
+    [self _configureScrollViewWithTraitCollection:newCollection transitionCoordinator:coordinator];
+}
+
+- (void)traitCollectionDidChange:(UITraitCollection *)previousTraitCollection
+{
+    [super traitCollectionDidChange:previousTraitCollection];
+    [self _configureScrollViewWithTraitCollection:self.traitCollection];
+}
+
+#pragma mark - Snap scroll view data source.
+
+// Everything needed to turn metrics into a width, captured on the main thread.
+typedef struct {
+    CGSize size;
+    CGFloat compactWidth;
+    BOOL pagingEnabled;
+} _MMSnapControllerWidthEnvironment;
+
+static CGFloat _MMSnapControllerWidthForMetrics(MMViewControllerMetrics metrics, _MMSnapControllerWidthEnvironment environment)
+{
+    if (metrics == MMViewControllerMetricsFullscreen || environment.pagingEnabled) {
+        return environment.size.width;
+    }
+    
+    if (metrics == MMViewControllerMetricsCompact) {
+        return environment.compactWidth;
+    } else if (metrics == MMViewControllerMetricsLarge) {
+        if (environment.size.width > environment.size.height) {
+            return environment.size.width - environment.compactWidth;
+        }
+    }
+    return environment.size.width;
+}
+
+- (_MMSnapControllerWidthEnvironment)_widthEnvironment
+{
+    BOOL pagingEnabled;
+    if ([UITraitCollection class]) {
+        BOOL horizontallyCompact = self.traitCollection.horizontalSizeClass == UIUserInterfaceSizeClassCompact;
+        pagingEnabled = horizontallyCompact;
+    } else {
+        pagingEnabled = UI_USER_INTERFACE_IDIOM() == UIUserInterfaceIdiomPhone;
+    }
+    
+    CGFloat compactWidth = 320.0f;
+    
+#if __IPHONE_OS_VERSION_MAX_ALLOWED >= 110000
+    if (@available(iOS 11.0, *)) {
+        const UIEdgeInsets safeAreaInsets = self.view.safeAreaInsets;
+        const CGFloat estimatedMargin = MAX(safeAreaInsets.left, safeAreaInsets.right);
+        
+        compactWidth += estimatedMargin;
+    }
+#endif
+    
+    return (_MMSnapControllerWidthEnvironment){
+        .size = self.view.bounds.size,
+        .compactWidth = compactWidth,
+        .pagingEnabled = pagingEnabled
+    };
+}
+
+- (CGFloat)scrollView:(MMSnapScrollView *)scrollView widthForViewAtPage:(NSInteger)page
+{
+    // Pages of the data source are measured without creating their view controllers.
+    if (_pageIdentifiers) {
+        NSArray *pages = [self _displayedPages];
+        id identifier = (page >= 0 && page < (NSInteger)pages.count) ? pages[page] : nil;
+        
+        if (![identifier isKindOfClass:[UIViewController class]]) {
+            if (identifier && _dataSourceFlags.dataSourceMetricsForIdentifier) {
+                return _MMSnapControllerWidthForMetrics([_dataSource snapController:self metricsForIdentifier:identifier], [self _widthEnvironment]);
+            }
+            return CGRectGetWidth(self.view.bounds);
+        }
+    }
+    
+    MMViewControllerMetrics (^metricsProvider)(UIViewController *) = self.metricsProvider;
+    
+    if (metricsProvider || _delegateFlags.delegateCustomWidthForViewController) {
+        UIViewController *viewController = [self _viewControllerAtPage:page];
+        
+        MMViewControllerMetrics metrics;
+        if (metricsProvider) {
+            metrics = metricsProvider(viewController);
+        } else {
+            metrics = [self.delegate snapController:self metricsForViewController:viewController];
+        }
+        
+        return _MMSnapControllerWidthForMetrics(metrics, [self _widthEnvironment]);
+    }
+    return CGRectGetWidth(self.view.bounds);
+}
+
+- (MMSnapScrollViewWidthProvider)widthProviderForScrollView:(MMSnapScrollView *)scrollView
+{
+    // The data source is only asked for metrics on the main thread.
+    MMViewControllerMetrics (^metricsProvider)(UIViewController *) = self.metricsProvider;
+    if (!metricsProvider || _pageIdentifiers) {
+        return nil;
+    }
+    
+    // The block outlives this layout validation, so it only captures immutable state.
+    NSArray *viewControllers = [self _displayedPages];
+    const _MMSnapControllerWidthEnvironment environment = [self _widthEnvironment];
+    
+    return ^CGFloat(NSInteger page) {
+        if (page < 0 || page >= (NSInteger)viewControllers.count) {
+            return environment.size.width;
+        }
+        return _MMSnapControllerWidthForMetrics(metricsProvider(viewControllers[page]), environment);
+    };
+}
+
+- (UIView *)scrollView:(MMSnapScrollView *)scrollView viewAtPage:(NSInteger)page
+{
+    return [self _loadViewOfViewController:[self _viewControllerAtPage:page]];
 }
 
 - (NSInteger)numberOfPagesInScrollView:(MMSnapScrollView *)scrollView
 {
-    return self.viewControllers.count;
+    return [self _displayedPages].count;
+}
+
+#pragma mark - Snap scroll view prefetching data source.
+
+- (void)scrollView:(MMSnapScrollView *)scrollView prefetchPages:(NSIndexSet *)pages
+{
+    const CGFloat pageHeight = CGRectGetHeight(UIEdgeInsetsInsetRect(scrollView.bounds, scrollView.contentInset));
+    
+    [pages enumerateIndexesUsingBlock:^(NSUInteger page, BOOL *stop) {
+        UIViewController *viewController = [self _viewControllerAtPage:page];
+        
+        // Loads the view if needed.
+        UIView *view = [self _loadViewOfViewController:viewController];
+        [self _useViewOfViewController:viewController atPage:page];
+        
+        // Lay out views that aren't on screen at the size they will be displayed, so the first frame doesn't pay for it.
+        if (view && !view.window) {
+            const CGFloat width = [self scrollView:scrollView widthForViewAtPage:page];
+            
+            view.bounds = CGRectMake(0.0f, 0.0f, width, pageHeight);
+            [view layoutIfNeeded];
+        }
+    }];
+    
+    [self _unloadViewsIgnoringBudget:NO];
 }
 
 #pragma mark - Snap scroll view delegate.
@@ -451,14 +1102,16 @@ typedef NS_ENUM(NSUInteger, MMSnapViewType) {
 {
     UIViewController *viewController = [self _viewControllerAtPage:page];
     if (viewController) {
-        [viewController beginAppearanceTransition:YES animated:(scrollView.isDecelerating || scrollView.isTracking)];
-        [viewController endAppearanceTransition];
+        [self _useViewOfViewController:viewController atPage:page];
+        [self _setViewController:viewController visible:YES animated:(scrollView.isDecelerating || scrollView.isTracking)];
         
-        for (MMSnapSupplementaryView *view in self.headerFooterViewArray) {
-            if (view.viewController == viewController) {
-                [view snapControllerWillDisplayViewController];
-                break;
+        for (MMSnapSupplementaryView *view in @[ [_headerViews objectForKey:viewController] ?: [NSNull null], [_footerViews objectForKey:viewController] ?: [NSNull null] ]) {
+            if (view == (id)[NSNull null]) {
+                continue;
             }
+            
+            [self _deliverPendingNotificationsToSupplementaryView:view];
+            [view snapControllerWillDisplayViewController];
         }
         
         if (_delegateFlags.delegateWillDisplayViewController) {
@@ -471,13 +1124,15 @@ typedef NS_ENUM(NSUInteger, MMSnapViewType) {
 {
     UIViewController *viewController = [self _viewControllerAtPage:page];
     if (viewController) {
-        [viewController beginAppearanceTransition:NO animated:(scrollView.isDecelerating || scrollView.isTracking)];
-        [viewController endAppearanceTransition];
+        [self _setViewController:viewController visible:NO animated:(scrollView.isDecelerating || scrollView.isTracking)];
         
         if (_delegateFlags.delegateDidEndDisplayingViewController) {
             [self.delegate snapController:self didEndDisplayingViewController:viewController];
         }
     }
+    
+    [self _unloadViewsIgnoringBudget:NO];
+    [self _discardDistantViewControllersIgnoringSetting:NO];
 }
 
 - (void)scrollView:(MMSnapScrollView *)scrollView willSnapToView:(UIView *)view atPage:(NSInteger)page
@@ -488,9 +1143,12 @@ typedef NS_ENUM(NSUInteger, MMSnapViewType) {
             [self.delegate snapController:self willSnapToViewController:viewController];
         }
         
-        for (MMSnapSupplementaryView *view in self.headerFooterViewArray) {
-            [view snapControllerWillSnapToViewController:viewController];
-        }
+        _snapGeneration++;
+        _snapTargetViewController = viewController;
+        
+        [self _enumerateSupplementaryViewsNearVisiblePagesUsingBlock:^(MMSnapSupplementaryView *view) {
+            [self _deliverPendingNotificationsToSupplementaryView:view];
+        }];
     }
 }
 
@@ -500,27 +1158,254 @@ typedef NS_ENUM(NSUInteger, MMSnapViewType) {
     if (_delegateFlags.delegateDidSnapViewController) {
         [self.delegate snapController:self didSnapToViewController:viewController];
     }
+    
+    // The scrolling settled, whatever is still pending is there to stay.
+    [self _flushAppearanceTransitionsSettled:YES];
+}
+
+#pragma mark - Appearance.
+
+- (void)setAppearanceCoalescingInterval:(NSTimeInterval)appearanceCoalescingInterval
+{
+    appearanceCoalescingInterval = MAX(appearanceCoalescingInterval, 0.0);
+    if (appearanceCoalescingInterval == _appearanceCoalescingInterval) {
+        return;
+    }
+    
+    _appearanceCoalescingInterval = appearanceCoalescingInterval;
+    
+    if (appearanceCoalescingInterval == 0.0) {
+        // Catch up with the pending callbacks, later ones are sent right away.
+        [self _flushAppearanceTransitionsSettled:YES];
+        
+        MMSnapAppearanceCoalescerRelease(_appearanceCoalescer);
+        _appearanceCoalescer = NULL;
+    } else if (_appearanceCoalescer) {
+        MMSnapAppearanceCoalescerSetThreshold(_appearanceCoalescer, appearanceCoalescingInterval);
+    } else {
+        _appearanceCoalescer = MMSnapAppearanceCoalescerCreate(appearanceCoalescingInterval);
+        
+        // The visible view controllers have already appeared, so their callbacks are recorded as delivered.
+        NSArray *visibleViewControllers = self.visibleViewControllers;
+        if (_appearanceCoalescer && visibleViewControllers.count > 0) {
+            const CFTimeInterval time = CACurrentMediaTime();
+            for (UIViewController *viewController in visibleViewControllers) {
+                MMSnapAppearanceCoalescerSetVisible(_appearanceCoalescer, (__bridge const void *)viewController, true, time);
+            }
+            
+            MMSnapAppearanceEvent events[visibleViewControllers.count];
+            MMSnapAppearanceCoalescerFlush(_appearanceCoalescer, time, true, events, (long)visibleViewControllers.count);
+        }
+    }
+}
+
+- (void)_setViewController:(UIViewController *)viewController visible:(BOOL)visible animated:(BOOL)animated
+{
+    if (_appearanceCoalescer && MMSnapAppearanceCoalescerSetVisible(_appearanceCoalescer, (__bridge const void *)viewController, visible, CACurrentMediaTime())) {
+        return;
+    }
+    
+    [viewController beginAppearanceTransition:visible animated:animated];
+    [viewController endAppearanceTransition];
+}
+
+- (void)_flushAppearanceTransitions
+{
+    if (!_appearanceCoalescer || !self.isViewLoaded) {
+        return;
+    }
+    
+    MMSnapScrollView *scrollView = self.scrollView;
+    [self _flushAppearanceTransitionsSettled:!(scrollView.isTracking || scrollView.isDecelerating)];
 }
 
-#pragma mark - Scroll view delegate.
+- (void)_flushAppearanceTransitionsSettled:(BOOL)settled
+{
+    if (!_appearanceCoalescer) {
+        return;
+    }
+    
+    // Delivered in chunks, transitions that don't fit stay pending for the next one and keep their order.
+    MMSnapAppearanceEvent events[32];
+    const long capacity = sizeof(events) / sizeof(events[0]);
+    
+    long count = capacity;
+    while (count == capacity && MMSnapAppearanceCoalescerGetPendingCount(_appearanceCoalescer) > 0) {
+        count = MMSnapAppearanceCoalescerFlush(_appearanceCoalescer, CACurrentMediaTime(), settled, events, capacity);
+        
+        for (long idx = 0; idx < count; idx++) {
+            UIViewController *viewController = (__bridge UIViewController *)events[idx].key;
+            
+            [viewController beginAppearanceTransition:events[idx].appearing animated:!settled];
+            [viewController endAppearanceTransition];
+        }
+    }
+    
+    // Pages that stay put while the finger rests on the scroll view don't cause layout passes, so wake up at the next
+    // deadline. Deadlines only move forward while scrolling, a flush scheduled earlier schedules the following one.
+    double deadline;
+    if (!_appearanceFlushScheduled && MMSnapAppearanceCoalescerGetNextDeadline(_appearanceCoalescer, &deadline)) {
+        _appearanceFlushScheduled = YES;
+        [self performSelector:@selector(_scheduledFlushAppearanceTransitions) withObject:nil afterDelay:MAX(deadline - CACurrentMediaTime(), 0.0)];
+    }
+}
 
-- (void)scrollViewDidScroll:(UIScrollView *)scrollView
+- (void)_scheduledFlushAppearanceTransitions
+{
+    _appearanceFlushScheduled = NO;
+    [self _flushAppearanceTransitions];
+}
+
+- (void)_removeAppearanceTransitionsForViewControllers:(NSArray *)viewControllers
+{
+    if (!_appearanceCoalescer) {
+        return;
+    }
+    
+    // Removed view controllers may go away before their callbacks are due, the ones that appeared disappear now.
+    for (UIViewController *viewController in viewControllers) {
+        if (MMSnapAppearanceCoalescerRemoveKey(_appearanceCoalescer, (__bridge const void *)viewController)) {
+            [viewController beginAppearanceTransition:NO animated:NO];
+            [viewController endAppearanceTransition];
+        }
+    }
+}
+
+#pragma mark - Safe area.
+
+- (void)_propagateSafeAreaInsetsIfNeeded
 {
     static BOOL invalidateSafeAreaInvocationNeeded;
     static SEL invalidateSafeAreaSelector;
+    static SEL invalidateChildSafeAreaSelector;
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
         NSString *invalidateSafeAreaSelectorString = [@[ @"_updateCont", @"entOverlayInsetsF", @"orSelfAndChildren" ] componentsJoinedByString:@""];
+        NSString *invalidateChildSafeAreaSelectorString = [@[ @"_updateCont", @"entOverlayInsetsF", @"romParentIfNecessary" ] componentsJoinedByString:@""];
         
         invalidateSafeAreaSelector = NSSelectorFromString(invalidateSafeAreaSelectorString);
+        invalidateChildSafeAreaSelector = NSSelectorFromString(invalidateChildSafeAreaSelectorString);
         invalidateSafeAreaInvocationNeeded = [self respondsToSelector:invalidateSafeAreaSelector];
     });
     
-    if (invalidateSafeAreaInvocationNeeded) {
+    if (!invalidateSafeAreaInvocationNeeded || !self.isViewLoaded) {
+        return;
+    }
+    
+    MMSnapScrollView *scrollView = self.scrollView;
+    NSIndexSet *pages = scrollView.pagesForVisibleViews;
+    
+    const long count = (long)pages.count;
+    const long capacity = count + MMSnapSafeAreaTrackerGetPageCount(_safeAreaTracker);
+    if (capacity == 0) {
+        return;
+    }
+    
+    // Heap buffers, the number of visible pages and remembered pages isn't bounded.
+    MMSnapLayoutRect *rects = malloc((size_t)MAX(count, 1) * sizeof(MMSnapLayoutRect));
+    const void **keys = malloc((size_t)MAX(count, 1) * sizeof(void *));
+    const void **changedKeys = malloc((size_t)capacity * sizeof(void *));
+    if (!rects || !keys || !changedKeys) {
+        free(rects);
+        free(keys);
+        free(changedKeys);
+        return;
+    }
+    
+    long idx = 0;
+    
+    for (NSUInteger page = pages.firstIndex; page != NSNotFound; page = [pages indexGreaterThanIndex:page]) {
+        UIViewController *viewController = [self _viewControllerAtPage:page];
+        UIView *view = [scrollView viewAtPage:page];
+        if (!viewController || !view) {
+            continue;
+        }
+        
+        const CGRect frame = view.frame;
+        rects[idx] = (MMSnapLayoutRect){ CGRectGetMinX(frame), CGRectGetMinY(frame), CGRectGetWidth(frame), CGRectGetHeight(frame) };
+        keys[idx] = (__bridge const void *)viewController;
+        idx++;
+    }
+    
+    // Children only see the safe area of the view in paging mode, see MMSnapController+MMSafeAreaInsetsWorkaround.
+    UIEdgeInsets safeAreaInsets = UIEdgeInsetsZero;
+#if __IPHONE_OS_VERSION_MAX_ALLOWED >= 110000
+    if (@available(iOS 11.0, *)) {
+        if (self.scrollMode == MMSnapScrollModePaging) {
+            safeAreaInsets = self.view.safeAreaInsets;
+        }
+    }
+#endif
+    
+    const CGRect bounds = scrollView.bounds;
+    const MMSnapLayoutRect layoutBounds = { CGRectGetMinX(bounds), CGRectGetMinY(bounds), CGRectGetWidth(bounds), CGRectGetHeight(bounds) };
+    const MMSnapSafeAreaInsets insets = { safeAreaInsets.top, safeAreaInsets.left, safeAreaInsets.bottom, safeAreaInsets.right };
+    
+    const long changedCount = MMSnapSafeAreaTrackerUpdate(_safeAreaTracker, rects, keys, idx, layoutBounds, insets, CACurrentMediaTime(), changedKeys, capacity);
+    free(rects);
+    free(keys);
+    
+    if (changedCount == 0) {
+        free(changedKeys);
+        return;
+    }
+    
+    // Only the pages whose insets changed are told to update, unless UIKit can't do that.
+    BOOL invalidatesChildren = (changedCount > 0);
+    for (long changedIdx = 0; changedIdx < changedCount && invalidatesChildren; changedIdx++) {
+        invalidatesChildren = [(__bridge UIViewController *)changedKeys[changedIdx] respondsToSelector:invalidateChildSafeAreaSelector];
+    }
+    
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Warc-performSelector-leaks"
+    if (invalidatesChildren) {
+        for (long changedIdx = 0; changedIdx < changedCount; changedIdx++) {
+            [(__bridge UIViewController *)changedKeys[changedIdx] performSelector:invalidateChildSafeAreaSelector];
+        }
+    } else {
         [self performSelector:invalidateSafeAreaSelector];
+    }
 #pragma clang diagnostic pop
+    
+    free(changedKeys);
+}
+
+- (NSUInteger)safeAreaPropagationsPerSecond
+{
+    return (NSUInteger)MMSnapSafeAreaTrackerGetPropagationsPerSecond(_safeAreaTracker, CACurrentMediaTime());
+}
+
+#pragma mark - Rasterization.
+
+- (void)setRasterizesDisappearingViewControllers:(BOOL)rasterizesDisappearingViewControllers
+{
+    _rasterizesDisappearingViewControllers = rasterizesDisappearingViewControllers;
+    
+    if (self.isViewLoaded) {
+        self.scrollView.rasterizesDisappearingPages = rasterizesDisappearingViewControllers;
+    }
+}
+
+- (void)invalidateRasterizationForViewController:(UIViewController *)viewController
+{
+    if (!self.isViewLoaded || !viewController.isViewLoaded) {
+        return;
+    }
+    
+    [self.scrollView invalidateRasterizationForView:viewController.view];
+}
+
+#pragma mark - Traces.
+
+- (BOOL)startRecordingTraceToFile:(NSString *)path
+{
+    return [self.scrollView startRecordingTraceToFile:path];
+}
+
+- (void)stopRecordingTrace
+{
+    if (self.isViewLoaded) {
+        [self.scrollView stopRecordingTrace];
     }
 }
 
@@ -529,7 +1414,7 @@ typedef NS_ENUM(NSUInteger, MMSnapViewType) {
 - (void)showViewController:(UIViewController *)vc sender:(id)sender
 {
     if (vc) {
-        if ([self.viewControllers containsObject:vc]) {
+        if ([self _pageOfViewController:vc] != NSNotFound) {
             [self scrollToViewController:vc animated:YES];
         } else {
             [self pushViewController:vc animated:YES];
@@ -537,16 +1422,158 @@ typedef NS_ENUM(NSUInteger, MMSnapViewType) {
     }
 }
 
-#pragma mark - Header / footer support.
+#pragma mark - View unloading.
+
+static long MMSnapControllerPageForViewController(const void *key, void *context)
+{
+    MMSnapController *snapController = (__bridge MMSnapController *)context;
+    
+    const NSUInteger page = [[snapController _displayedPages] indexOfObjectIdenticalTo:[snapController _pageForViewController:(__bridge id)key]];
+    return (page != NSNotFound) ? (long)page : MMSnapPageNotFound;
+}
+
+- (void)setMaximumNumberOfLoadedViews:(NSUInteger)maximumNumberOfLoadedViews
+{
+    _maximumNumberOfLoadedViews = maximumNumberOfLoadedViews;
+    
+    [self _updateEvictionBudget];
+}
+
+- (void)setMaximumLoadedViewsByteCount:(unsigned long long)maximumLoadedViewsByteCount
+{
+    _maximumLoadedViewsByteCount = maximumLoadedViewsByteCount;
+    
+    [self _updateEvictionBudget];
+}
+
+- (void)setNumberOfPagesKeptLoadedAroundVisiblePages:(NSUInteger)numberOfPagesKeptLoadedAroundVisiblePages
+{
+    _numberOfPagesKeptLoadedAroundVisiblePages = numberOfPagesKeptLoadedAroundVisiblePages;
+    
+    [self _updateEvictionBudget];
+}
+
+- (void)_updateEvictionBudget
+{
+    const MMSnapEvictionBudget budget = {
+        .maximumCount = (long)_maximumNumberOfLoadedViews,
+        .maximumByteCount = _maximumLoadedViewsByteCount,
+        .keptDistance = (long)_numberOfPagesKeptLoadedAroundVisiblePages
+    };
+    MMSnapEvictionPolicySetBudget(_evictionPolicy, budget);
+    
+    [self _unloadViewsIgnoringBudget:NO];
+}
+
+- (void)didReceiveMemoryWarning
+{
+    [super didReceiveMemoryWarning];
+    
+    [self _unloadViewsIgnoringBudget:YES];
+    [self _discardDistantViewControllersIgnoringSetting:YES];
+}
+
+- (UIView *)_loadViewOfViewController:(UIViewController *)viewController
+{
+    const BOOL wasViewLoaded = viewController.isViewLoaded;
+    
+    UIView *view = viewController.view;
+    
+    // Restore the state saved when the view was unloaded.
+    if (!wasViewLoaded && viewController) {
+        id state = [self.unloadedViewStates objectForKey:viewController];
+        if (state) {
+            [self.unloadedViewStates removeObjectForKey:viewController];
+            
+            if ([viewController respondsToSelector:@selector(snapController:restoreViewState:)]) {
+                [(id <MMSnapViewStateRestoring>)viewController snapController:self restoreViewState:state];
+            } else if ([view isKindOfClass:[UIScrollView class]] && [state isKindOfClass:[NSValue class]]) {
+                [(UIScrollView *)view setContentOffset:[state CGPointValue]];
+            }
+        }
+    }
+    return view;
+}
+
+- (void)_useViewOfViewController:(UIViewController *)viewController atPage:(NSInteger)page
+{
+    if (!MMSnapEvictionPolicyIsLimited(_evictionPolicy) || !viewController) {
+        return;
+    }
+    
+    // Estimate a single backing store at the size of the page.
+    MMSnapScrollView *scrollView = self.scrollView;
+    
+    const CGFloat scale = scrollView.contentScaleFactor;
+    const CGFloat width = [self scrollView:scrollView widthForViewAtPage:page];
+    const CGFloat height = CGRectGetHeight(UIEdgeInsetsInsetRect(scrollView.bounds, scrollView.contentInset));
+    const unsigned long long byteCount = (unsigned long long)MAX(width * scale, 0.0f) * (unsigned long long)MAX(height * scale, 0.0f) * 4;
+    
+    MMSnapEvictionPolicyUseKey(_evictionPolicy, (__bridge const void *)viewController, byteCount);
+}
 
-- (NSMutableArray *)headerFooterViewArray
+- (void)_unloadViewsIgnoringBudget:(BOOL)ignoreBudget
 {
-    if (!_headerFooterViewArray) {
-        _headerFooterViewArray = [NSMutableArray array];
+    MMSnapEvictionPolicyRef evictionPolicy = _evictionPolicy;
+    
+    const long capacity = MMSnapEvictionPolicyGetCount(evictionPolicy);
+    if (!MMSnapEvictionPolicyIsLimited(evictionPolicy) || capacity == 0 || !self.isViewLoaded) {
+        return;
+    }
+    
+    MMSnapScrollView *scrollView = self.scrollView;
+    
+    CGRect visibleRect = scrollView.bounds;
+    visibleRect.origin = scrollView.contentOffset;
+    
+    NSIndexSet *visiblePages = [scrollView pagesForViewsInRect:visibleRect];
+    const MMSnapPageRange visible = { (visiblePages.count > 0) ? (long)visiblePages.firstIndex : 0, (long)visiblePages.count };
+    
+    const void **keys = malloc((size_t)capacity * sizeof(void *));
+    if (!keys) {
+        return;
     }
-    return _headerFooterViewArray;
+    
+    const long count = MMSnapEvictionPolicyEvict(evictionPolicy, visible, MMSnapControllerPageForViewController, (__bridge void *)self, ignoreBudget, keys, capacity);
+    
+    for (long idx = 0; idx < count; idx++) {
+        [self _unloadViewOfViewController:(__bridge UIViewController *)keys[idx]];
+    }
+    free(keys);
 }
 
+- (void)_unloadViewOfViewController:(UIViewController *)viewController
+{
+    if (!viewController.isViewLoaded) {
+        return;
+    }
+    
+    UIView *view = viewController.view;
+    
+    // Views still on screen, for example fading out after an update, are kept until next time.
+    if (view.window) {
+        [self _useViewOfViewController:viewController atPage:[[self _displayedPages] indexOfObjectIdenticalTo:[self _pageForViewController:viewController]]];
+        return;
+    }
+    
+    id state = nil;
+    if ([viewController respondsToSelector:@selector(viewStateForUnloadingInSnapController:)]) {
+        state = [(id <MMSnapViewStateRestoring>)viewController viewStateForUnloadingInSnapController:self];
+    } else if ([view isKindOfClass:[UIScrollView class]]) {
+        state = [NSValue valueWithCGPoint:[(UIScrollView *)view contentOffset]];
+    }
+    
+    if (state) {
+        [self.unloadedViewStates setObject:state forKey:viewController];
+    }
+    
+    [view removeFromSuperview];
+    [self.scrollView invalidateRasterizationForView:view];
+    viewController.view = nil;
+}
+
+#pragma mark - Header / footer support.
+
 - (UIView *)headerViewForViewController:(UIViewController *)viewController
 {
     return [self _supplementaryViewWithType:MMSnapViewTypeHeader forViewForViewController:viewController];
@@ -557,85 +1584,210 @@ typedef NS_ENUM(NSUInteger, MMSnapViewType) {
     return [self _supplementaryViewWithType:MMSnapViewTypeFooter forViewForViewController:viewController];
 }
 
+- (NSMapTable *)_supplementaryViewsWithType:(MMSnapViewType)type
+{
+    return (type == MMSnapViewTypeHeader) ? _headerViews : _footerViews;
+}
+
 - (UIView *)_supplementaryViewWithType:(MMSnapViewType)type forViewForViewController:(UIViewController *)viewController
 {
-    if (![self.viewControllers containsObject:viewController]) {
+    // Every view controller in the stack is a child, so this avoids searching the stack.
+    if (!viewController || viewController.parentViewController != self) {
         return nil;
     }
     
-    MMSnapSupplementaryView *view = nil;
-    
-    for (MMSnapSupplementaryView *v in self.headerFooterViewArray.copy) {
-        if (v._viewType == type && v.viewController == viewController) {
-            view = v;
-            break;
-        }
-    }
+    NSMapTable *views = [self _supplementaryViewsWithType:type];
     
+    MMSnapSupplementaryView *view = [views objectForKey:viewController];
     if (!view) {
-        Class viewClass;
-        if (type == MMSnapViewTypeHeader) {
-            viewClass = self.headerViewClass ?: [MMSnapHeaderView class];
-        } else if (type == MMSnapViewTypeFooter) {
-            viewClass = self.footerViewClass ?: [MMSnapFooterView class];
-        }
-        
-        view = [[viewClass alloc] initWithFrame:CGRectZero];
+        view = [self _dequeueSupplementaryViewWithType:type];
         view.snapController = self;
         view.viewController = viewController;
         view._viewType = type;
-        
-        [view didMoveToSnapController];
+        view._viewControllersGeneration = _viewControllersGeneration;
+        view._snapGeneration = _snapGeneration;
         
         if (view) {
-            [self.headerFooterViewArray addObject:view];
+            [views setObject:view forKey:viewController];
         }
+        
+        [view didMoveToSnapController];
     }
     
     return view;
 }
 
+- (MMSnapSupplementaryView *)_dequeueSupplementaryViewWithType:(MMSnapViewType)type
+{
+    Class viewClass;
+    NSMutableArray *reusableViews;
+    
+    if (type == MMSnapViewTypeHeader) {
+        viewClass = self.headerViewClass ?: [MMSnapHeaderView class];
+        reusableViews = _reusableHeaderViews;
+    } else {
+        viewClass = self.footerViewClass ?: [MMSnapFooterView class];
+        reusableViews = _reusableFooterViews;
+    }
+    
+    MMSnapSupplementaryView *view = reusableViews.lastObject;
+    if (view && [view isMemberOfClass:viewClass]) {
+        [reusableViews removeLastObject];
+        
+        // Views of removed view controllers are left in place until reused, so they can fade out along with them.
+        [view removeFromSuperview];
+        [view prepareForReuse];
+        
+        return view;
+    }
+    
+    return [[viewClass alloc] initWithFrame:CGRectZero];
+}
+
+- (void)_enqueueSupplementaryView:(MMSnapSupplementaryView *)view
+{
+    NSMutableArray *reusableViews = (view._viewType == MMSnapViewTypeHeader) ? _reusableHeaderViews : _reusableFooterViews;
+    
+    if (reusableViews.count < MMSnapControllerMaximumReusableSupplementaryViews) {
+        [reusableViews addObject:view];
+    }
+}
+
 - (void)_insertSupplementaryViewsForViewControllers:(NSArray *)viewControllers
 {
-    for (MMSnapSupplementaryView *view in self.headerFooterViewArray.copy) {
-        if ([viewControllers containsObject:view.viewController]) {
-            [view didMoveToSnapController];
-        }
+    for (UIViewController *viewController in viewControllers) {
+        [(MMSnapSupplementaryView *)[_headerViews objectForKey:viewController] didMoveToSnapController];
+        [(MMSnapSupplementaryView *)[_footerViews objectForKey:viewController] didMoveToSnapController];
     }
 }
 
 - (void)_removeSupplementaryViewsForViewControllers:(NSArray *)viewControllers
 {
-    for (MMSnapSupplementaryView *view in self.headerFooterViewArray.copy) {
-        if ([viewControllers containsObject:view.viewController]) {
+    for (UIViewController *viewController in viewControllers) {
+        for (NSMapTable *views in @[ _headerViews, _footerViews ]) {
+            MMSnapSupplementaryView *view = [views objectForKey:viewController];
+            if (!view) {
+                continue;
+            }
+            
             [view willMoveFromSnapController];
+            
+            [views removeObjectForKey:viewController];
+            [self _enqueueSupplementaryView:view];
         }
     }
 }
 
 - (void)_notifyViewControllersDidChange
 {
-    for (MMSnapSupplementaryView *view in self.headerFooterViewArray.copy) {
+    _viewControllersGeneration++;
+    
+    [self _enumerateSupplementaryViewsNearVisiblePagesUsingBlock:^(MMSnapSupplementaryView *view) {
+        [self _deliverPendingNotificationsToSupplementaryView:view];
+    }];
+}
+
+- (void)_deliverPendingNotificationsToSupplementaryView:(MMSnapSupplementaryView *)view
+{
+    if (view._snapGeneration != _snapGeneration) {
+        view._snapGeneration = _snapGeneration;
+        
+        UIViewController *snapTargetViewController = _snapTargetViewController;
+        if (snapTargetViewController) {
+            [view snapControllerWillSnapToViewController:snapTargetViewController];
+        }
+    }
+    
+    if (view._viewControllersGeneration != _viewControllersGeneration) {
+        view._viewControllersGeneration = _viewControllersGeneration;
+        
         [view snapControllerViewControllersDidChange];
     }
 }
 
+- (void)_enumerateSupplementaryViewsNearVisiblePagesUsingBlock:(void (^)(MMSnapSupplementaryView *view))block
+{
+    if (!self.isViewLoaded) {
+        return;
+    }
+    
+    NSIndexSet *visiblePages = self.scrollView.pagesForVisibleViews;
+    NSArray *pages = [self _displayedPages];
+    
+    if (visiblePages.count == 0 || pages.count == 0) {
+        return;
+    }
+    
+    const NSUInteger distance = MMSnapControllerSupplementaryViewNotificationDistance;
+    const NSUInteger firstPage = (visiblePages.firstIndex > distance) ? visiblePages.firstIndex - distance : 0;
+    const NSUInteger lastPage = MIN(visiblePages.lastIndex + distance, pages.count - 1);
+    
+    for (NSUInteger page = firstPage; page <= lastPage; page++) {
+        UIViewController *viewController = [self _viewControllerForPage:pages[page] creatingIfNeeded:NO];
+        if (!viewController) {
+            continue;
+        }
+        
+        MMSnapSupplementaryView *headerView = [_headerViews objectForKey:viewController];
+        if (headerView) {
+            block(headerView);
+        }
+        
+        MMSnapSupplementaryView *footerView = [_footerViews objectForKey:viewController];
+        if (footerView) {
+            block(footerView);
+        }
+    }
+}
+
 #pragma mark - Getter.
 
 - (UIViewController *)_viewControllerAtPage:(NSInteger)page
 {
-    if (page < self.viewControllers.count) {
-        return self.viewControllers[page];
+    NSArray *pages = [self _displayedPages];
+    
+    if (page < pages.count) {
+        return [self _viewControllerForPage:pages[page] creatingIfNeeded:YES];
     }
     return nil;
 }
 
+- (UIViewController *)_viewControllerBeforeViewController:(UIViewController *)viewController
+{
+    const NSUInteger page = [self _pageOfViewController:viewController];
+    if (page == NSNotFound || page == 0) {
+        return nil;
+    }
+    return [self viewControllerAtPage:page - 1];
+}
+
 @end
 
 @implementation MMSnapController (StateRestoration)
 
 static NSString * MMViewControllerChildrenKey = @"kUIViewControllerChildrenKey";
 static NSString * MMViewControllerVisibleViewControllerKey = @"MMViewControllerVisibleViewControllerKey";
+static NSString * MMViewControllerLayoutSnapshotKey = @"MMViewControllerLayoutSnapshotKey";
+
+- (NSString *)_layoutSnapshotPath
+{
+    NSString *directory = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+    NSString *identifier = [self.restorationIdentifier stringByReplacingOccurrencesOfString:@"/" withString:@"-"] ?: @"";
+    
+    return [directory stringByAppendingPathComponent:[NSString stringWithFormat:@"MMSnapController-%@.layout", identifier]];
+}
+
+- (uint64_t)_layoutSnapshotTraits
+{
+    if (![UITraitCollection class]) {
+        return 0;
+    }
+    
+    // Page widths usually depend on the size classes and the scale, on top of the size of the view.
+    UITraitCollection *traitCollection = self.traitCollection;
+    
+    return (uint64_t)traitCollection.horizontalSizeClass | ((uint64_t)traitCollection.verticalSizeClass << 8) | ((uint64_t)lround(traitCollection.displayScale * 100.0) << 16);
+}
 
 - (void)encodeRestorableStateWithCoder:(NSCoder *)coder
 {
@@ -662,6 +1814,12 @@ static NSString * MMViewControllerVisibleViewControllerKey = @"MMViewControllerV
         
         // Encode restoring view controllers.
         [coder encodeObject:restoringViewControllers forKey:MMViewControllerChildrenKey];
+        
+        // Save the widths of the pages, so the next launch doesn't measure them before drawing.
+        NSString *layoutSnapshotPath = [self _layoutSnapshotPath];
+        if (self.isViewLoaded && [self.scrollView writeLayoutSnapshotToFile:layoutSnapshotPath traits:[self _layoutSnapshotTraits]]) {
+            [coder encodeObject:layoutSnapshotPath.lastPathComponent forKey:MMViewControllerLayoutSnapshotKey];
+        }
     }
     
     [super encodeRestorableStateWithCoder:coder];
@@ -676,6 +1834,16 @@ static NSString * MMViewControllerVisibleViewControllerKey = @"MMViewControllerV
         [self scrollToViewController:selectedViewController animated:NO];
     }
     
+    // The caches directory may have moved since, only the name of the snapshot is kept.
+    NSString *layoutSnapshotName = [coder decodeObjectForKey:MMViewControllerLayoutSnapshotKey];
+    if (restoredViewControllers && layoutSnapshotName) {
+        _restoredLayoutSnapshotPath = [[[self _layoutSnapshotPath] stringByDeletingLastPathComponent] stringByAppendingPathComponent:layoutSnapshotName];
+        
+        if (self.isViewLoaded) {
+            [self.view setNeedsLayout];
+        }
+    }
+    
     [super decodeRestorableStateWithCoder:coder];
 }
 
@@ -686,14 +1854,7 @@ static NSString * MMViewControllerVisibleViewControllerKey = @"MMViewControllerV
 - (UIViewController *)previousViewController
 {
     __strong MMSnapController *snapController = self.snapController;
-    if (snapController) {
-        NSArray *viewControllers = snapController.viewControllers;
-        NSUInteger idx = [viewControllers indexOfObject:self.viewController];
-        if (idx != NSNotFound && idx - 1 < viewControllers.count) {
-            return viewControllers[idx - 1];
-        }
-    }
-    return nil;
+    return [snapController _viewControllerBeforeViewController:self.viewController];
 }
 
 - (void)snapControllerWillDisplayViewController
@@ -726,4 +1887,9 @@ static NSString * MMViewControllerVisibleViewControllerKey = @"MMViewControllerV
     
 }
 
+- (void)prepareForReuse
+{
+    
+}
+
 @end
@@ -16,6 +16,10 @@ extern const CGFloat MMSnapFooterFlexibleWidth;
 
 - (void)setItems:(NSArray *)items animated:(BOOL)animated;
 
+// Item sizes are measured once and reused until the items or the width of the footer change. Call this after changing
+// the content of an item view, like the title of a button.
+- (void)invalidateItemSizes;
+
 @property (strong, nonatomic) UIColor *separatorColor UI_APPEARANCE_SELECTOR;
 
 @property (strong, nonatomic) UIView *backgroundView;
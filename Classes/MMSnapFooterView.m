@@ -7,8 +7,18 @@
 //
 
 #import "MMSnapFooterView.h"
+#import "MMSnapToolbarLayout.h"
 
-@interface MMSnapFooterView ()
+@interface MMSnapFooterView () {
+    // The items as seen by the toolbar solver, and the frames it produced, sized for the current items.
+    MMSnapToolbarItem *_toolbarItems;
+    MMSnapLayoutRect *_toolbarFrames;
+    NSUInteger _toolbarItemsCapacity;
+    
+    // The size the views were measured against. Measurements are reused until the items or this size change.
+    CGSize _measuredItemSize;
+    BOOL _itemSizesValid;
+}
 
 @property (assign, nonatomic) CGFloat regularHeight;
 @property (strong, nonatomic) UIView *separatorView;
@@ -20,6 +30,11 @@ const CGFloat MMSnapFooterFlexibleWidth = CGFLOAT_MAX;
 #define SYSTEM_VERSION_GREATER_THAN_OR_EQUAL_TO(v) \
 ([[[UIDevice currentDevice] systemVersion] compare:v options:NSNumericSearch] != NSOrderedAscending)
 
+static inline CGRect _CGRectFromMMSnapLayoutRect(MMSnapLayoutRect rect)
+{
+    return CGRectMake(rect.x, rect.y, rect.width, rect.height);
+}
+
 @implementation MMSnapFooterView
 
 - (instancetype)initWithFrame:(CGRect)frame
@@ -53,10 +68,13 @@ const CGFloat MMSnapFooterFlexibleWidth = CGFLOAT_MAX;
     return self;
 }
 
-#pragma mark - Layout.
+- (void)dealloc
+{
+    free(_toolbarItems);
+    free(_toolbarFrames);
+}
 
-static const NSString *MMSnapFooterInfoObjectKey = @"Object";
-static const NSString *MMSnapFooterInfoSizeKey = @"Size";
+#pragma mark - Layout.
 
 - (void)layoutSubviews
 {
@@ -79,104 +97,54 @@ static const NSString *MMSnapFooterInfoSizeKey = @"Size";
     const CGRect contentRect = UIEdgeInsetsInsetRect(bounds, contentInset);
     const CGFloat regularHeight = self.regularHeight;
     
-    const CGFloat maximumContentWidth = CGRectGetWidth(contentRect);
     const CGSize maximumItemSize = contentRect.size;
     
-    CGFloat contentWidth = 0.0f;
-    NSUInteger flexibleItemsCount = 0;
-    
     NSArray *items = self.items;
-    NSMutableArray *itemsToLayout = [NSMutableArray arrayWithCapacity:items.count];
+    const NSUInteger count = items.count;
     
-    for (id item in items) {
-        // Find out size for this item.
-        CGSize itemSize = CGSizeZero;
-        
-        if ([item isKindOfClass:[UIView class]]) {
-            itemSize = [(UIView *)item sizeThatFits:maximumItemSize];
-            itemSize.width = MIN(itemSize.width, maximumItemSize.width);
-            
-        } else if ([item isKindOfClass:[MMSnapFooterSpace class]]) {
-            CGFloat width = [(MMSnapFooterSpace *)item width];
-            
-            if (width == MMSnapFooterFlexibleWidth) {
-                flexibleItemsCount++;
-            } else {
-                itemSize = CGSizeMake(width, 0);
-            }
-        }
-        
-        NSDictionary *info = @{ MMSnapFooterInfoSizeKey : [NSValue valueWithCGSize:itemSize],
-                                MMSnapFooterInfoObjectKey : item };
-        
-        [itemsToLayout addObject:info];
+    // Views are only measured again when the items or the room available to them change.
+    if (!_itemSizesValid || !CGSizeEqualToSize(maximumItemSize, _measuredItemSize)) {
+        [self _measureItemsFittingSize:maximumItemSize];
     }
     
-    const NSInteger actualItemsCount = itemsToLayout.count - flexibleItemsCount;
-    const NSInteger interSeparationCount = (itemsToLayout.count - 1);
-    
-    CGFloat interSeparationWidth = actualItemsCount == 1 ? 0.0f : interSeparationCount * spacing;
-    
-    NSUInteger idx = 0;
-    for (NSDictionary *info in itemsToLayout.copy) {
-        CGSize itemSize = [info[MMSnapFooterInfoSizeKey] CGSizeValue];
-        
-        CGFloat proposedContentWidth = contentWidth + itemSize.width + interSeparationWidth;
-        if (proposedContentWidth > maximumContentWidth) {
-            [itemsToLayout removeObjectsInRange:NSMakeRange(idx, itemsToLayout.count - idx)];
-            break;
+    // Spaces are cheap to read and their width can change at any time.
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        MMSnapToolbarItem *toolbarItem = &_toolbarItems[idx];
+        if (toolbarItem->kind == MMSnapToolbarItemKindView) {
+            continue;
         }
         
-        contentWidth += itemSize.width;
-        idx++;
-    }
-    
-    CGFloat flexibleUnitWidth = 0.0f;
-    if (flexibleItemsCount > 0) {
-        flexibleUnitWidth = ((maximumContentWidth - contentWidth - interSeparationWidth) / flexibleItemsCount);
-    }
-    
-    // Layout.
-    CGFloat contentOffset = CGRectGetMinX(contentRect);
-    
-    for (NSDictionary *info in itemsToLayout) {
-        id item = info[MMSnapFooterInfoObjectKey];
-        CGSize itemSize = [info[MMSnapFooterInfoSizeKey] CGSizeValue];
-        
+        id item = items[idx];
         if ([item isKindOfClass:[MMSnapFooterSpace class]]) {
             CGFloat width = [(MMSnapFooterSpace *)item width];
             
-            if (width == MMSnapFooterFlexibleWidth) {
-                itemSize = CGSizeMake(flexibleUnitWidth, 0);
-            }
-        }
-        
-        CGRect rect = (CGRect){
-            .origin.x = roundf(contentOffset),
-            .origin.y = roundf((regularHeight - itemSize.height) / 2.0f),
-            .size = itemSize
-        };
-        
-        if ([item isKindOfClass:[UIView class]]) {
-            [(UIView *)item setFrame:rect];
-        }
-        
-        contentOffset = CGRectGetMaxX(rect);
-        
-        if (interSeparationWidth > 0.0f) {
-            contentOffset += spacing;
+            toolbarItem->kind = (width == MMSnapFooterFlexibleWidth) ? MMSnapToolbarItemKindFlexibleSpace : MMSnapToolbarItemKindFixedSpace;
+            toolbarItem->width = (width == MMSnapFooterFlexibleWidth) ? 0.0f : width;
         }
     }
     
-    // Hide items that won't fit.
+    const MMSnapToolbarMetrics metrics = {
+        .minX = CGRectGetMinX(contentRect),
+        .width = CGRectGetWidth(contentRect),
+        .height = regularHeight,
+        .spacing = spacing
+    };
+    
+    const long fittingCount = MMSnapToolbarLayoutSolve(_toolbarItems, (long)count, metrics, _toolbarFrames);
+    
+    // Layout, hiding items that won't fit.
+    NSUInteger idx = 0;
     for (id item in items) {
-        if ([item isKindOfClass:[UIView class]]) {
-            NSUInteger idx = [itemsToLayout indexOfObjectPassingTest:^BOOL(NSDictionary *info, NSUInteger idx, BOOL *stop) {
-                return (info[MMSnapFooterInfoObjectKey] == item);
-            }];
+        if (_toolbarItems[idx].kind == MMSnapToolbarItemKindView) {
+            const BOOL fits = ((long)idx < fittingCount);
+            if (fits) {
+                [(UIView *)item setFrame:_CGRectFromMMSnapLayoutRect(_toolbarFrames[idx])];
+            }
             
-            [item setHidden:(idx == NSNotFound)];
+            [(UIView *)item setHidden:!fits];
         }
+        
+        idx++;
     }
     
     const CGFloat separatorHeight = 1.0f / [UIScreen mainScreen].scale;
@@ -200,6 +168,61 @@ static const NSString *MMSnapFooterInfoSizeKey = @"Size";
     return size;
 }
 
+- (void)_measureItemsFittingSize:(CGSize)maximumItemSize
+{
+    NSArray *items = self.items;
+    const NSUInteger count = items.count;
+    
+    if (count > _toolbarItemsCapacity) {
+        MMSnapToolbarItem *toolbarItems = realloc(_toolbarItems, count * sizeof(MMSnapToolbarItem));
+        MMSnapLayoutRect *toolbarFrames = realloc(_toolbarFrames, count * sizeof(MMSnapLayoutRect));
+        
+        if (toolbarItems) {
+            _toolbarItems = toolbarItems;
+        }
+        if (toolbarFrames) {
+            _toolbarFrames = toolbarFrames;
+        }
+        
+        if (!toolbarItems || !toolbarFrames) {
+            [NSException raise:NSMallocException format:@"Unable to allocate the layout of %lu toolbar items.", (unsigned long)count];
+        }
+        
+        _toolbarItemsCapacity = count;
+    }
+    
+    NSUInteger idx = 0;
+    for (id item in items) {
+        MMSnapToolbarItem toolbarItem = { MMSnapToolbarItemKindFixedSpace, 0.0, 0.0 };
+        
+        if ([item isKindOfClass:[UIView class]]) {
+            CGSize itemSize = [(UIView *)item sizeThatFits:maximumItemSize];
+            itemSize.width = MIN(itemSize.width, maximumItemSize.width);
+            
+            toolbarItem = (MMSnapToolbarItem){ MMSnapToolbarItemKindView, itemSize.width, itemSize.height };
+        }
+        
+        _toolbarItems[idx++] = toolbarItem;
+    }
+    
+    _measuredItemSize = maximumItemSize;
+    _itemSizesValid = YES;
+}
+
+- (void)invalidateItemSizes
+{
+    _itemSizesValid = NO;
+    
+    [self setNeedsLayout];
+}
+
+- (void)prepareForReuse
+{
+    [super prepareForReuse];
+    
+    [self setItems:nil animated:NO];
+}
+
 #pragma mark - Properties.
 
 - (void)setItems:(NSArray *)items
@@ -220,6 +243,7 @@ static const NSString *MMSnapFooterInfoSizeKey = @"Size";
     }
     
     _items = items;
+    _itemSizesValid = NO;
     
     for (id item in items) {
         if ([item isKindOfClass:[UIView class]]) {
@@ -44,4 +44,8 @@ typedef NS_ENUM(NSUInteger, MMSnapHeaderAction) {
 // If set to @c YES, animations that relate to scrolling will be enabled.
 @property (assign, nonatomic) BOOL contentIsBeingScrolled;
 
+// Text measurement. The sizes of the labels and buttons are cached across headers, keyed by their text, attributes,
+// font, content size category and constraining size. Returns the ratio of measurements answered from the cache.
++ (double)textMeasurementCacheHitRate;
+
 @end
@@ -7,6 +7,7 @@
 //
 
 #import "MMSnapHeaderView.h"
+#import "MMSnapLRUCache.h"
 
 @interface MMSnapHeaderView () {
     struct {
@@ -21,6 +22,9 @@
     } _configurationOptions;
     
     CGSize _largeTitleSize;
+    
+    // The last key each label and button was measured with, so its cached size can be invalidated.
+    NSMapTable *_measurementKeys;
 }
 
 @property (strong, nonatomic) UILabel *titleLabel;
@@ -52,6 +56,21 @@
 
 @end
 
+@interface _MMSnapTextMeasurementKey : NSObject
+
+@end
+
+@interface _MMSnapTextMeasurementCache : NSObject
+
++ (instancetype)sharedCache;
+
+- (CGSize)sizeOfView:(UIView *)view thatFits:(CGSize)size key:(_MMSnapTextMeasurementKey **)key;
+- (void)removeSizeForKey:(_MMSnapTextMeasurementKey *)key;
+
+@property (readonly, nonatomic) double hitRate;
+
+@end
+
 @implementation MMSnapHeaderView
 
 #define UIKitLocalizedString(key) [[NSBundle bundleWithIdentifier:@"com.apple.UIKit"] localizedStringForKey:key value:@"" table:nil]
@@ -76,6 +95,7 @@
         // Defaults.
         _separatorColor = [UIColor colorWithWhite:0.0f alpha:0.2f];
         _largeTitleSize = CGSizeZero;
+        _measurementKeys = [NSMapTable weakToStrongObjectsMapTable];
         
         // Configuration.
         _configurationOptions.showsHeading = YES;
@@ -291,10 +311,10 @@
     CGSize sSize = CGSizeZero;
     
     if (usesCustomTitleView) {
-        sizeNeededToFitTitle = [_titleView sizeThatFits:fit];
+        sizeNeededToFitTitle = [self _sizeOfView:_titleView thatFits:fit];
     } else {
-        tSize = [_titleLabel sizeThatFits:fit];
-        sSize = [_subtitleLabel sizeThatFits:fit];
+        tSize = [self _sizeOfView:_titleLabel thatFits:fit];
+        sSize = [self _sizeOfView:_subtitleLabel thatFits:fit];
         
         if (usesMultilineHeading) {
             sizeNeededToFitTitle = CGSizeMake(MAX(tSize.width, sSize.width), tSize.height + sSize.height);
@@ -309,11 +329,11 @@
         if (pagingEnabled) {
             CGFloat rightCompression = 0.0f;
             if (showsRightButton) {
-                rightCompression = [_rightButton sizeThatFits:fit].width;
+                rightCompression = [self _sizeOfView:_rightButton thatFits:fit].width;
             }
             
             CGFloat availableTitleBackWidth = CGRectGetWidth(contentRect) - rightCompression - edgeSpacing;
-            CGFloat regularBackButtonWidth = [_regularBackButton sizeThatFits:fit].width;
+            CGFloat regularBackButtonWidth = [self _sizeOfView:_regularBackButton thatFits:fit].width;
             
             useRegularBackButton = (regularBackButtonWidth + interSpacing + sizeNeededToFitTitle.width < availableTitleBackWidth);
             if (useRegularBackButton) {
@@ -329,14 +349,14 @@
     }
     
     // Layout for once!
-    CGSize leftButtonSize = [actualLeftButton sizeThatFits:fit];
+    CGSize leftButtonSize = [self _sizeOfView:actualLeftButton thatFits:fit];
     CGRect leftButtonRect = (CGRect){
         .origin.x = CGRectGetMinX(contentRect),
         .origin.y = ceilf((CGRectGetHeight(contentRect) - leftButtonSize.height) / 2.0f),
         .size = leftButtonSize
     };
     
-    CGSize rightButtonSize = [_rightButton sizeThatFits:fit];
+    CGSize rightButtonSize = [self _sizeOfView:_rightButton thatFits:fit];
     CGRect rightButtonRect = (CGRect){
         .origin.x = CGRectGetMaxX(contentRect) - rightButtonSize.width,
         .origin.y = ceilf((CGRectGetHeight(contentRect) - rightButtonSize.height) / 2.0f),
@@ -512,6 +532,36 @@
     _configurationOptions.usingCustomTitleView = usesCustomTitleView;
 }
 
+- (CGSize)_sizeOfView:(UIView *)view thatFits:(CGSize)size
+{
+    if (!view) {
+        return CGSizeZero;
+    }
+    
+    _MMSnapTextMeasurementKey *key = nil;
+    const CGSize result = [[_MMSnapTextMeasurementCache sharedCache] sizeOfView:view thatFits:size key:&key];
+    
+    if (key) {
+        [_measurementKeys setObject:key forKey:view];
+    }
+    
+    return result;
+}
+
+- (void)_invalidateMeasurementOfView:(UIView *)view
+{
+    _MMSnapTextMeasurementKey *key = [_measurementKeys objectForKey:view];
+    if (key) {
+        [[_MMSnapTextMeasurementCache sharedCache] removeSizeForKey:key];
+        [_measurementKeys removeObjectForKey:view];
+    }
+}
+
++ (double)textMeasurementCacheHitRate
+{
+    return [_MMSnapTextMeasurementCache sharedCache].hitRate;
+}
+
 - (CGSize)sizeThatFits:(CGSize)size
 {
     CGFloat height = self.regularHeight;
@@ -575,6 +625,26 @@
     [self setNeedsLayout];
 }
 
+- (void)prepareForReuse
+{
+    [super prepareForReuse];
+    
+    self.title = nil;
+    self.subtitle = nil;
+    self.titleView = nil;
+    self.backButtonTitle = nil;
+    self.hidesBackButton = NO;
+    self.backButtonAction = MMSnapHeaderActionScroll;
+    self.displaysLargeTitle = NO;
+    self.leftButton = nil;
+    self.rightButton = nil;
+    self.contentIsBeingScrolled = NO;
+    
+    [self.regularBackButton setTitle:nil forState:UIControlStateNormal];
+    [self setBackActionAvailable:NO];
+    [self setRotatesBackButton:NO];
+}
+
 #pragma mark - Back rotation.
 
 - (void)setRotatesBackButton:(BOOL)rotatesBackButton
@@ -631,10 +701,13 @@
 - (void)setTitle:(NSString *)title
 {
     if (![title isEqualToString:self.title]) {
+        [self _invalidateMeasurementOfView:_titleLabel];
+        [self _invalidateMeasurementOfView:_largeTitleLabel];
+        
         _title = title;
         _titleLabel.text = title;
         _largeTitleLabel.text = title;
-        _largeTitleSize = [_largeTitleLabel sizeThatFits:(CGSize){ CGFLOAT_MAX, CGFLOAT_MAX }];
+        _largeTitleSize = [self _sizeOfView:_largeTitleLabel thatFits:(CGSize){ CGFLOAT_MAX, CGFLOAT_MAX }];
         
         [self _assignFonts];
         [self setNeedsLayout];
@@ -644,6 +717,8 @@
 - (void)setSubtitle:(NSString *)subtitle
 {
     if (![subtitle isEqualToString:self.subtitle]) {
+        [self _invalidateMeasurementOfView:_subtitleLabel];
+        
         _subtitle = subtitle;
         _subtitleLabel.text = subtitle;
         
@@ -723,6 +798,8 @@
 - (void)setTitleTextAttributes:(NSDictionary *)titleTextAttributes
 {
     if (![titleTextAttributes isEqualToDictionary:_titleTextAttributes]) {
+        [self _invalidateMeasurementOfView:_titleLabel];
+        
         _titleTextAttributes = titleTextAttributes;
         
         [self _applyTextAttribures:titleTextAttributes toTextLabel:_titleLabel];
@@ -733,6 +810,8 @@
 - (void)setSubtitleTextAttributes:(NSDictionary *)subtitleTextAttributes
 {
     if (![subtitleTextAttributes isEqualToDictionary:_subtitleTextAttributes]) {
+        [self _invalidateMeasurementOfView:_subtitleLabel];
+        
         _subtitleTextAttributes = subtitleTextAttributes;
         
         [self _applyTextAttribures:subtitleTextAttributes toTextLabel:_subtitleLabel];
@@ -917,3 +996,194 @@
 }
 
 @end
+
+#pragma mark - Text measurement.
+
+static BOOL _MMSnapClassOverridesSelector(Class class, Class baseClass, SEL selector)
+{
+    return [class instanceMethodForSelector:selector] != [baseClass instanceMethodForSelector:selector];
+}
+
+static inline BOOL _MMSnapObjectsEqual(id object, id otherObject)
+{
+    return (object == otherObject) || [object isEqual:otherObject];
+}
+
+@implementation _MMSnapTextMeasurementKey {
+    Class _viewClass;
+    id _text;
+    UIFont *_font;
+    UIImage *_image;
+    NSInteger _numberOfLines;
+    UIEdgeInsets _contentEdgeInsets;
+    UIEdgeInsets _titleEdgeInsets;
+    UIEdgeInsets _imageEdgeInsets;
+    NSString *_contentSizeCategory;
+    CGSize _fittingSize;
+    NSUInteger _hash;
+}
+
++ (instancetype)keyForView:(UIView *)view fittingSize:(CGSize)size contentSizeCategory:(NSString *)contentSizeCategory
+{
+    // Only views sized by the stock implementations are cached, since a subclass can depend on any state.
+    _MMSnapTextMeasurementKey *key = [[self alloc] init];
+    
+    if ([view isKindOfClass:[UILabel class]]) {
+        if (_MMSnapClassOverridesSelector(view.class, [UILabel class], @selector(sizeThatFits:)) ||
+            _MMSnapClassOverridesSelector(view.class, [UILabel class], @selector(textRectForBounds:limitedToNumberOfLines:))) {
+            return nil;
+        }
+        
+        UILabel *label = (UILabel *)view;
+        
+        // The attributed text carries the text attributes and the font.
+        key->_text = [label.attributedText copy];
+        key->_font = label.font;
+        key->_numberOfLines = label.numberOfLines;
+    } else if ([view isKindOfClass:[UIButton class]]) {
+        if (_MMSnapClassOverridesSelector(view.class, [UIButton class], @selector(sizeThatFits:)) ||
+            _MMSnapClassOverridesSelector(view.class, [UIButton class], @selector(titleRectForContentRect:)) ||
+            _MMSnapClassOverridesSelector(view.class, [UIButton class], @selector(imageRectForContentRect:))) {
+            return nil;
+        }
+        
+        UIButton *button = (UIButton *)view;
+        
+        key->_text = [button.currentAttributedTitle copy] ?: [button.currentTitle copy];
+        key->_font = button.titleLabel.font;
+        key->_image = button.currentImage;
+        key->_contentEdgeInsets = button.contentEdgeInsets;
+        key->_titleEdgeInsets = button.titleEdgeInsets;
+        key->_imageEdgeInsets = button.imageEdgeInsets;
+    } else {
+        return nil;
+    }
+    
+    key->_viewClass = view.class;
+    key->_contentSizeCategory = contentSizeCategory;
+    key->_fittingSize = size;
+    key->_hash = [key->_text hash] ^ ([key->_font hash] * 31) ^ ((NSUInteger)(size.width * 8.0f) * 131) ^ (NSUInteger)size.height;
+    
+    return key;
+}
+
+- (NSUInteger)hash
+{
+    return _hash;
+}
+
+- (BOOL)isEqual:(id)object
+{
+    if (object == self) {
+        return YES;
+    }
+    if (![object isKindOfClass:[_MMSnapTextMeasurementKey class]]) {
+        return NO;
+    }
+    
+    _MMSnapTextMeasurementKey *key = object;
+    
+    return key->_hash == _hash &&
+    key->_viewClass == _viewClass &&
+    CGSizeEqualToSize(key->_fittingSize, _fittingSize) &&
+    key->_numberOfLines == _numberOfLines &&
+    key->_image == _image &&
+    UIEdgeInsetsEqualToEdgeInsets(key->_contentEdgeInsets, _contentEdgeInsets) &&
+    UIEdgeInsetsEqualToEdgeInsets(key->_titleEdgeInsets, _titleEdgeInsets) &&
+    UIEdgeInsetsEqualToEdgeInsets(key->_imageEdgeInsets, _imageEdgeInsets) &&
+    _MMSnapObjectsEqual(key->_font, _font) &&
+    _MMSnapObjectsEqual(key->_contentSizeCategory, _contentSizeCategory) &&
+    _MMSnapObjectsEqual(key->_text, _text);
+}
+
+@end
+
+static unsigned long _MMSnapTextMeasurementKeyHash(const void *key)
+{
+    return (unsigned long)CFHash(key);
+}
+
+static bool _MMSnapTextMeasurementKeyEqual(const void *key, const void *otherKey)
+{
+    return CFEqual(key, otherKey);
+}
+
+static const MMSnapLRUCacheKeyCallbacks _MMSnapTextMeasurementKeyCallbacks = {
+    CFRetain, CFRelease, _MMSnapTextMeasurementKeyHash, _MMSnapTextMeasurementKeyEqual
+};
+
+@implementation _MMSnapTextMeasurementCache {
+    MMSnapLRUCacheRef _cache;
+    NSString *_contentSizeCategory;
+}
+
++ (instancetype)sharedCache
+{
+    static _MMSnapTextMeasurementCache *sharedCache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedCache = [[self alloc] init];
+    });
+    return sharedCache;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        // Enough for the labels and buttons of every header of a deep stack, in both orientations.
+        _cache = MMSnapLRUCacheCreate(&_MMSnapTextMeasurementKeyCallbacks, sizeof(CGSize), 256);
+        _contentSizeCategory = [UIApplication sharedApplication].preferredContentSizeCategory;
+        
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(_contentSizeCategoryDidChange:) name:UIContentSizeCategoryDidChangeNotification object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    
+    MMSnapLRUCacheRelease(_cache);
+}
+
+- (CGSize)sizeOfView:(UIView *)view thatFits:(CGSize)size key:(_MMSnapTextMeasurementKey **)outKey
+{
+    _MMSnapTextMeasurementKey *key = [_MMSnapTextMeasurementKey keyForView:view fittingSize:size contentSizeCategory:_contentSizeCategory];
+    if (!key) {
+        return [view sizeThatFits:size];
+    }
+    
+    CGSize result;
+    if (!MMSnapLRUCacheGetValue(_cache, (__bridge const void *)key, &result)) {
+        result = [view sizeThatFits:size];
+        
+        MMSnapLRUCacheSetValue(_cache, (__bridge const void *)key, &result);
+    }
+    
+    if (outKey) {
+        *outKey = key;
+    }
+    
+    return result;
+}
+
+- (void)removeSizeForKey:(_MMSnapTextMeasurementKey *)key
+{
+    MMSnapLRUCacheRemoveValue(_cache, (__bridge const void *)key);
+}
+
+- (double)hitRate
+{
+    return MMSnapLRUCacheGetHitRate(_cache);
+}
+
+- (void)_contentSizeCategoryDidChange:(NSNotification *)notification
+{
+    // Dynamic type changes the metrics of every font, even the ones not derived from the category.
+    _contentSizeCategory = notification.userInfo[UIContentSizeCategoryNewValueKey] ?: [UIApplication sharedApplication].preferredContentSizeCategory;
+    
+    MMSnapLRUCacheRemoveAllValues(_cache);
+}
+
+@end
@@ -10,6 +10,14 @@
 
 @class MMSnapScrollView;
 
+/**
+ *  A block returning the width of a page, called from a background queue.
+ *
+ *  @note The block must be safe to call from any thread and must not touch UIKit. Capture whatever it needs, like the
+ *  bounds of the scroll view or the model of each page, when it's created.
+ */
+typedef CGFloat (^MMSnapScrollViewWidthProvider)(NSInteger page);
+
 /**
  *  A @c MMSnapScrollViewDataSource object is used to provide layout information and views in a @c MMSnapScrollView.
  */
@@ -45,6 +53,50 @@
  */
 - (UIView *)scrollView:(MMSnapScrollView *)scrollView viewAtPage:(NSInteger)page;
 
+@optional
+
+/**
+ *  Asks the data source for a thread-safe block computing the widths of the pages, for a single layout validation.
+ *
+ *  @param scrollView The scroll view requesting this information.
+ *
+ *  @return A block returning the width of a page, or @c nil to use @c -scrollView:widthForViewAtPage: instead.
+ *
+ *  @note Called on the main thread every time the layout is validated. The widths of the visible pages, and of the pages
+ *  that were never measured, are computed right away. The other pages keep their previous widths while the new ones are
+ *  computed on a background queue, and are swapped in at once if the layout didn't change again in the meantime.
+ */
+- (MMSnapScrollViewWidthProvider)widthProviderForScrollView:(MMSnapScrollView *)scrollView;
+
+@end
+
+/**
+ *  A @c MMSnapScrollViewPrefetchingDataSource object is told ahead of time about the pages that are about to scroll into
+ *  view, so it can prepare their views before the scroll view asks for them.
+ */
+@protocol MMSnapScrollViewPrefetchingDataSource <NSObject>
+@required
+
+/**
+ *  Tells the prefetching data source to prepare the views of the specified pages.
+ *
+ *  @param scrollView The scroll view issuing the prefetch.
+ *  @param pages      An index set of pages that are near the visible pages, in the direction of the scrolling.
+ *
+ *  @note The views are requested later through @c -scrollView:viewAtPage: of the data source, as usual.
+ */
+- (void)scrollView:(MMSnapScrollView *)scrollView prefetchPages:(NSIndexSet *)pages;
+
+@optional
+
+/**
+ *  Tells the prefetching data source that the specified pages are no longer expected to be displayed soon.
+ *
+ *  @param scrollView The scroll view cancelling the prefetch.
+ *  @param pages      An index set of pages that were prefetched and left the prefetching window without being displayed.
+ */
+- (void)scrollView:(MMSnapScrollView *)scrollView cancelPrefetchingForPages:(NSIndexSet *)pages;
+
 @end
 
 /**
@@ -92,6 +144,59 @@
 
 @end
 
+/**
+ *  The phases of the layout passes and updates of a @c MMSnapScrollView, as recorded by its instrumentation.
+ */
+typedef NS_ENUM(NSInteger, MMSnapScrollViewLayoutPhase) {
+    /**
+     *  A whole layout pass.
+     */
+    MMSnapScrollViewLayoutPhaseLayoutPass,
+    /**
+     *  Measuring the pages with an invalidated width and updating the content size.
+     */
+    MMSnapScrollViewLayoutPhaseLayoutValidation,
+    /**
+     *  Computing the range of visible pages.
+     */
+    MMSnapScrollViewLayoutPhaseVisibleRange,
+    /**
+     *  A single call to @c -scrollView:viewAtPage: of the data source.
+     */
+    MMSnapScrollViewLayoutPhaseViewRequest,
+    /**
+     *  A single separator view dequeued or created.
+     */
+    MMSnapScrollViewLayoutPhaseSeparatorDequeue,
+    /**
+     *  A single call to @c -scrollView:willDisplayView:atPage: or @c -scrollView:didEndDisplayingView:atPage: of the delegate.
+     */
+    MMSnapScrollViewLayoutPhaseDisplayCallback,
+    /**
+     *  Applying a group of insert, delete, move or reload operations.
+     */
+    MMSnapScrollViewLayoutPhaseUpdates
+};
+
+/**
+ *  A function called on the main thread every time the instrumentation records the duration of a phase.
+ */
+typedef void (*MMSnapScrollViewInstrumentationObserver)(MMSnapScrollViewLayoutPhase phase, uint64_t durationInNanoseconds, void *context);
+
+/**
+ *  The markers a @c MMSnapScrollView records in its trace on behalf of its owner.
+ */
+typedef NS_ENUM(NSInteger, MMSnapScrollViewTraceMarker) {
+    /**
+     *  A view controller was pushed at a page.
+     */
+    MMSnapScrollViewTraceMarkerPush,
+    /**
+     *  View controllers were popped, leaving a number of pages.
+     */
+    MMSnapScrollViewTraceMarkerPop
+};
+
 @interface MMSnapScrollView : UIScrollView
 
 /**
@@ -104,6 +209,68 @@
  */
 @property (weak, nonatomic) id <MMSnapScrollViewDataSource> dataSource;
 
+/**
+ *  The object that prepares the views of the pages before they scroll into view.
+ */
+@property (weak, nonatomic) id <MMSnapScrollViewPrefetchingDataSource> prefetchDataSource;
+
+/**
+ *  The number of pages prefetched ahead of the visible pages, in the direction of the scrolling.
+ *
+ *  @note The default value of this property is @c 2. Before the scroll view has been scrolled, a single page is prefetched
+ *  on each side of the visible pages. Set to @c 0 to disable prefetching.
+ */
+@property (assign, nonatomic) NSInteger prefetchingLookAhead;
+
+/**
+ *  The number of views requested from the data source for pages that had been prefetched.
+ */
+@property (readonly, nonatomic) NSUInteger numberOfPrefetchHits;
+
+/**
+ *  The number of views requested from the data source for pages that had not been prefetched.
+ *
+ *  @note Only counted while there is a prefetching data source. A high ratio of misses suggests a larger look-ahead.
+ */
+@property (readonly, nonatomic) NSUInteger numberOfPrefetchMisses;
+
+/**
+ *  The number of layout passes that laid out the visible pages.
+ */
+@property (readonly, nonatomic) NSUInteger numberOfLayoutPasses;
+
+/**
+ *  The number of times a separator was updated, on all layout passes.
+ *
+ *  @note A separator is only updated when its frame, its @c percentDisappeared or its @c showsAsColumnSeparator changed
+ *  since the previous layout pass. While scrolling, that is usually only the separator of the page disappearing behind
+ *  the content offset.
+ */
+@property (readonly, nonatomic) NSUInteger numberOfSeparatorUpdates;
+
+/**
+ *  The number of separators updated on the last layout pass.
+ */
+@property (readonly, nonatomic) NSUInteger numberOfSeparatorUpdatesInLastLayoutPass;
+
+/**
+ *  The maximum width of the content handed to @c UIScrollView, or @c 0 for no limit.
+ *
+ *  @note The default value of this property is @c 0. When the pages are wider than this value, the content size of the
+ *  scroll view only covers a window of them around the content offset, which is silently moved and recentered as the
+ *  content offset nears its edges, so the offsets and frames seen by UIKit stay small and exact however many pages
+ *  there are. The window is at least eight times as wide as the scroll view, and is only moved between animations.
+ */
+@property (assign, nonatomic) CGFloat maximumContentWidth;
+
+/**
+ *  The offset of the content origin among all pages. Add it to @c contentOffset to get the global offset of the scroll
+ *  view, or to the frames of the views to get their global origin.
+ *
+ *  @note Always @c 0 unless @c maximumContentWidth limits the content size.
+ */
+@property (readonly, nonatomic) double contentWindowOrigin;
+
 /**
  *  Reloads the pages of the receiver.
  *
@@ -120,6 +287,155 @@
  */
 - (void)invalidateLayout;
 
+/**
+ *  Invalidates the layout information of the specified pages.
+ *
+ *  @param pages An index set of pages whose width changed.
+ *
+ *  @note Only the widths of the specified pages are requested again from the data source, and only the pages after them
+ *  are moved. Prefer this method over @c -invalidateLayout when you know which pages changed.
+ */
+- (void)invalidateLayoutForPages:(NSIndexSet *)pages;
+
+/**
+ *  The number of widths requested from the data source during the last layout validation.
+ *
+ *  @note Useful to verify that updates are measuring only the pages they affect. For example, inserting a page at the end
+ *  of the scroll view should request a single width. Widths computed off the main thread with a width provider aren't
+ *  counted.
+ */
+@property (readonly, nonatomic) NSInteger numberOfWidthQueriesInLastLayoutPass;
+
+/**
+ *  The number of times the layout was validated against the data source, by layout passes and by updates.
+ *
+ *  @note Every validation measures the pages that changed and sets the content size, so batching updates with
+ *  @c -performBatchUpdates:completion: validates the layout once instead of once per update.
+ */
+@property (readonly, nonatomic) NSUInteger numberOfLayoutValidations;
+
+/**
+ *  Writes the widths of the pages, along with the size of the scroll view and its global content offset, to a binary
+ *  layout snapshot.
+ *
+ *  @param path   The path of the snapshot, replaced atomically.
+ *  @param traits An opaque value describing everything else the widths depend on, such as the size classes.
+ *
+ *  @return @c NO if some widths are still being measured, or the file could not be written.
+ */
+- (BOOL)writeLayoutSnapshotToFile:(NSString *)path traits:(uint64_t)traits;
+
+/**
+ *  Lays out the pages with the widths of a layout snapshot, without asking the data source for them.
+ *
+ *  @param path   The path of the snapshot.
+ *  @param traits The traits the widths are expected to have been computed for.
+ *
+ *  @return @c YES if the snapshot was used, which requires it to have been taken at the current size, with the same
+ *  traits and number of pages.
+ *
+ *  @note Meant to be called once before the first layout pass, typically while restoring state. The snapshot is
+ *  memory-mapped and the content offset it holds is restored along with the widths. The pages are measured again after
+ *  the first layout pass, the visible pages first and the other ones a few at a time while the scroll view isn't
+ *  scrolling, displaying the restored widths until new ones are known.
+ */
+- (BOOL)restoreLayoutFromSnapshotFile:(NSString *)path traits:(uint64_t)traits;
+
+/**
+ *  A Boolean value that determines whether the pages sliding behind the following pages are displayed as a rasterized
+ *  snapshot instead of their live view hierarchy.
+ *
+ *  @note The default value of this property is @c NO. Otherwise, a page is swapped for a snapshot once a fifth of it is
+ *  covered, and swapped back once less than a tenth of it is covered. While swapped, the view of the page is hidden, so
+ *  it doesn't receive touches and changes to its content aren't displayed until @c -invalidateRasterizationForView: is
+ *  called. Snapshots stay cached after their page re-emerges, within @c maximumRasterizedPagesByteCount, until the page
+ *  stops being displayed.
+ */
+@property (assign, nonatomic) BOOL rasterizesDisappearingPages;
+
+/**
+ *  The maximum memory (in bytes) used by the cached snapshots of the disappearing pages.
+ *
+ *  @note The default value of this property is 32 MB. The least recently displayed snapshots are discarded first, the
+ *  displayed ones never are, and pages whose snapshot doesn't fit stay live. A memory warning discards every snapshot
+ *  that isn't displayed.
+ */
+@property (assign, nonatomic) unsigned long long maximumRasterizedPagesByteCount;
+
+/**
+ *  Discards the snapshot of a view whose content changed.
+ *
+ *  @param view The view of a page.
+ *
+ *  @note A displayed snapshot is swapped back for the view right away, and a new snapshot is taken on the next layout
+ *  pass if the page is still disappearing.
+ */
+- (void)invalidateRasterizationForView:(UIView *)view;
+
+/**
+ *  A Boolean value that determines whether the durations of the phases of layout passes and updates are recorded.
+ *
+ *  @note The default value of this property is @c NO, which costs a single comparison per phase. Samples are recorded into
+ *  fixed-size histograms without allocating or locking, and disabling the instrumentation discards them. Building with
+ *  @c MM_SNAP_INSTRUMENTATION=0 removes the instrumentation entirely, and this property then stays @c NO.
+ */
+@property (assign, nonatomic, getter=isInstrumentationEnabled) BOOL instrumentationEnabled;
+
+/**
+ *  The statistics recorded for each phase while instrumentation is enabled, or @c nil if it's disabled.
+ *
+ *  @note Keyed by phase name (@c layoutPass, @c layoutValidation, @c visibleRange, @c viewRequest, @c separatorDequeue,
+ *  @c displayCallback and @c updates). Each value is a dictionary with a @c count and the @c totalDuration,
+ *  @c maximumDuration, @c medianDuration and @c 99thPercentileDuration in seconds. Percentiles are accurate within a factor of two.
+ */
+@property (readonly, nonatomic) NSDictionary *instrumentationStatistics;
+
+/**
+ *  Discards the samples recorded so far.
+ */
+- (void)resetInstrumentation;
+
+/**
+ *  Sets a function called after each sample is recorded, for example to forward hitches to a tracing tool.
+ *
+ *  @param observer The function to call, or @c NULL to stop calling it.
+ *  @param context  A pointer passed to @c observer.
+ *
+ *  @note Only called while instrumentation is enabled.
+ */
+- (void)setInstrumentationObserver:(MMSnapScrollViewInstrumentationObserver)observer context:(void *)context;
+
+/**
+ *  Starts recording the layout passes, updates and page widths of the receiver to a binary trace, which can be replayed
+ *  without UIKit by @c MMSnapTraceReplay to measure the cost of each event and how many pages it displayed or removed.
+ *
+ *  @param path The path of the trace, replaced if it exists.
+ *
+ *  @return @c NO if the file could not be created.
+ *
+ *  @note Events are buffered in memory allocated up front, and written on the main thread once a few thousand are
+ *  buffered and when recording stops. A trace already being recorded is stopped first.
+ */
+- (BOOL)startRecordingTraceToFile:(NSString *)path;
+
+/**
+ *  Writes the buffered events and closes the trace being recorded, if any.
+ */
+- (void)stopRecordingTrace;
+
+/**
+ *  A Boolean value indicating whether a trace is being recorded.
+ */
+@property (readonly, nonatomic, getter=isRecordingTrace) BOOL recordingTrace;
+
+/**
+ *  Records a marker in the trace being recorded, if any.
+ *
+ *  @param marker The marker.
+ *  @param page   The page the marker applies to.
+ */
+- (void)recordTraceMarker:(MMSnapScrollViewTraceMarker)marker page:(NSInteger)page;
+
 /**
  *  Returns the number of pages for the receiver.
  *
@@ -188,6 +504,29 @@
  */
 - (void)insertPages:(NSIndexSet *)pages animated:(BOOL)animated;
 
+/**
+ *  Reloads the views at the locations identified by an index set of pages, with an option to animate the reload.
+ *
+ *  @param pages    An index set of pages identifying the views to reload.
+ *  @param animated @c YES if you want to animate the reload, @c NO if it should be immediate.
+ *
+ *  @note The widths of the pages are requested again. A visible view is kept if the data source returns it again for its
+ *  page, otherwise it is replaced by the new view.
+ */
+- (void)reloadPages:(NSIndexSet *)pages animated:(BOOL)animated;
+
+/**
+ *  Moves the view at the specified page to a new location in the receiver.
+ *
+ *  @param page    The page identifying the view to move.
+ *  @param newPage The page that is the destination of the move.
+ *
+ *  @note The view is kept alive instead of being removed and requested again from the data source. Inside
+ *  @c -performBatchUpdates:completion:, @c page is expressed in terms of the pages before the update and @c newPage
+ *  in terms of the pages after it.
+ */
+- (void)movePage:(NSInteger)page toPage:(NSInteger)newPage;
+
 /**
  *  The class to use for displaying the separators in the scroll view.
  *
@@ -198,9 +537,9 @@
 @property (strong, nonatomic) Class separatorViewClass;
 
 /**
- *  Animates multiple insert and delete operations as a group.
+ *  Animates multiple insert, delete, move and reload operations as a group.
  *
- *  @param updates    The block that performs the relevant insert or delete operations.
+ *  @param updates    The block that performs the relevant insert, delete, move or reload operations.
  *  @param completion A completion handler block to execute when all of the operations are finished. This block takes a single Boolean parameter that contains the value @c YES if all of the related animations completed successfully or @c NO if they were interrupted. This parameter may be @c nil.
  */
 - (void)performBatchUpdates:(dispatch_block_t)updates completion:(void (^)(BOOL))completion;
@@ -222,7 +561,8 @@
  *  The amount of the disappear transition (specified as a percentage of the overall duration) that is complete.
  *
  *  @note Use this value to update your separator's drawing accordingly. For example, the default separator appearance draws a shadow
- *  and determines its opacity from the value of this property.
+ *  and determines its opacity from the value of this property. The scroll view only sets this property and
+ *  @c showsAsColumnSeparator when their values change, inside a transaction that disables implicit animations.
  */
 @property (nonatomic) CGFloat percentDisappeared;
 
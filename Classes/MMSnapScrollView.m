@@ -8,6 +8,18 @@
 
 #import "MMSnapScrollView.h"
 #import "MMSpringScrollAnimator.h"
+#import "MMSnapAsyncLayout.h"
+#import "MMSnapContentWindow.h"
+#import "MMSnapInstrumentation.h"
+#import "MMSnapLayoutCore.h"
+#import "MMSnapLayoutSnapshot.h"
+#import "MMSnapPageIndex.h"
+#import "MMSnapPageRing.h"
+#import "MMSnapPrefetchWindow.h"
+#import "MMSnapRasterizationPolicy.h"
+#import "MMSnapSeparatorTracker.h"
+#import "MMSnapTrace.h"
+#import "MMSnapUpdateMap.h"
 #import <QuartzCore/QuartzCore.h>
 
 @interface _MMSnapScrollViewDelegateProxy : NSObject
@@ -19,14 +31,6 @@
 
 @end
 
-@interface _MMSnapScrollViewLayoutAttributes : NSObject
-
-@property (assign, nonatomic) CGRect frame;
-@property (assign, nonatomic) CGPoint center;
-@property (assign, nonatomic) CGSize size;
-
-@end
-
 @interface _MMStockSnapViewSeparatorView : UIView <MMSnapViewSeparatorView>
 
 @property (strong, nonatomic) CALayer *thickLayer;
@@ -34,31 +38,67 @@
 
 @end
 
-static NSString *_MMElementCategoryPage = @"PageView";
-static NSString *_MMElementCategorySeparator = @"SeparatorView";
-
 typedef NS_ENUM(NSUInteger, _MMSnapScrollViewUpdateAction) {
     _MMSnapScrollViewUpdateActionReload,
     _MMSnapScrollViewUpdateActionDelete,
     _MMSnapScrollViewUpdateActionInsert
 };
 
-@interface _MMSnapScrollViewUpdateItem : NSObject
+static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
+
+static const MMSnapPageRingCallbacks _MMSnapScrollViewVisiblePagesCallbacks = { CFRetain, CFRelease };
 
-- (instancetype)initWithUpdateAction:(_MMSnapScrollViewUpdateAction)updateAction forPage:(NSInteger)page;
+// Events buffered by a trace recorder before they are written, about a minute of layout passes.
+static const long _MMSnapScrollViewTraceCapacity = 4096;
 
-@property (readonly, nonatomic) _MMSnapScrollViewUpdateAction updateAction;
+// Pages measured again per run loop turn after a layout snapshot was restored.
+static const NSUInteger _MMSnapScrollViewRevalidationChunkLength = 64;
 
-@property (assign, nonatomic) NSInteger page;
-@property (assign, nonatomic) NSInteger initialPage;
-@property (assign, nonatomic) NSInteger finalPage;
+static inline void _MMSnapScrollViewRecordTraceEvent(MMSnapTraceRecorderRef recorder, MMSnapTraceEventType type, NSInteger page, NSInteger otherPage, double x, double y, uint16_t flags)
+{
+    if (recorder) {
+        const MMSnapTraceEvent event = { CACurrentMediaTime(), type, flags, page, otherPage, x, y };
+        MMSnapTraceRecorderRecord(recorder, &event);
+    }
+}
 
-- (NSComparisonResult)comparePages:(_MMSnapScrollViewUpdateItem *)otherItem;
-- (NSComparisonResult)inverseComparePages:(_MMSnapScrollViewUpdateItem *)otherItem;
+static inline id _MMSnapScrollViewVisibleElement(MMSnapPageRingRef visiblePages, NSInteger page, MMSnapPageRingElement element)
+{
+    return (__bridge id)MMSnapPageRingGetElement(visiblePages, page, element);
+}
 
-@end
+static inline MMSnapLayoutRect _MMSnapLayoutRectFromCGRect(CGRect rect)
+{
+    return (MMSnapLayoutRect){ CGRectGetMinX(rect), CGRectGetMinY(rect), CGRectGetWidth(rect), CGRectGetHeight(rect) };
+}
 
-static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
+static inline CGRect _CGRectFromMMSnapLayoutRect(MMSnapLayoutRect rect)
+{
+    return CGRectMake(rect.x, rect.y, rect.width, rect.height);
+}
+
+static NSIndexSet *_MMSnapScrollViewPagesNotInPrefetchWindow(const MMSnapPrefetchWindow *window, const MMSnapPrefetchWindow *otherWindow, MMSnapPageRange excludedPages)
+{
+    if (MMSnapPrefetchWindowGetPageCount(window) == 0) {
+        return nil;
+    }
+    
+    // Straight from the ranges of the window, which a large look ahead makes arbitrarily long.
+    NSMutableIndexSet *indexSet = [NSMutableIndexSet indexSet];
+    const MMSnapPageRange ranges[] = { window->leading, window->trailing };
+    
+    for (size_t rangeIdx = 0; rangeIdx < sizeof(ranges) / sizeof(ranges[0]); rangeIdx++) {
+        const long endPage = ranges[rangeIdx].location + ranges[rangeIdx].length;
+        
+        for (long page = ranges[rangeIdx].location; page < endPage; page++) {
+            const BOOL excluded = (page >= excludedPages.location && page < excludedPages.location + excludedPages.length);
+            if (!excluded && !MMSnapPrefetchWindowContainsPage(otherWindow, page)) {
+                [indexSet addIndex:(NSUInteger)page];
+            }
+        }
+    }
+    return indexSet;
+}
 
 @interface MMSnapScrollView () <UIScrollViewDelegate> {
     struct {
@@ -67,23 +107,84 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
         unsigned int delegateWillSnapToPage : 1;
         unsigned int delegateDidSnapToPage : 1;
     } _delegateFlags;
+    
+    struct {
+        unsigned int dataSourceWidthProvider : 1;
+    } _dataSourceFlags;
+    
+    struct {
+        unsigned int prefetchDataSourceCancelPrefetching : 1;
+    } _prefetchDataSourceFlags;
+    
+    MMSnapPageIndexRef _pageIndex;
+    MMSnapUpdateMapRef _updateMap;
+    
+    // Views and separators of the visible pages, and the spare storage used to remap them during updates.
+    MMSnapPageRingRef _visiblePages;
+    MMSnapPageRingRef _updatedVisiblePages;
+    
+    NSArray *_visibleViews;
+    unsigned long _visibleViewsMutationCount;
+    
+    // Widths computed off the main thread when the data source provides a width provider, stamped with the generation
+    // of the layout they were requested for.
+    MMSnapAsyncLayoutRef _asyncLayout;
+    BOOL _awaitingWidths;
+    
+    // The generation computed in the background, the number of pages it computes and how many of them are still at the
+    // same index, and whether its widths were published and wait for scrolling to stop or for the layout to validate.
+    unsigned long _widthsGeneration;
+    long _widthsPageCount;
+    long _widthsAlignedPageCount;
+    BOOL _widthsPending;
+    
+    // Whether the widths were restored from a layout snapshot, and are to be measured again after the next layout pass,
+    // and the restored pages still waiting to be measured again.
+    BOOL _revalidatesRestoredLayout;
+    NSMutableIndexSet *_restoredPagesToRevalidate;
+    
+    // The part of the pages exposed as content when its width is bounded, whose origin is the global offset of the
+    // content origin.
+    MMSnapContentWindow _contentWindow;
+    
+    // Page and separator rects of the current layout pass, and the separator states applied on the previous one.
+    MMSnapSeparatorTrackerRef _separatorTracker;
+    
+    // Pages prefetched around the visible pages, and the last scrolling direction that shaped them.
+    MMSnapPrefetchWindow _prefetchWindow;
+    NSInteger _prefetchDirection;
+    CGFloat _prefetchContentOffsetX;
+    
+    // Histograms of the phases of layout passes and updates, only created while instrumentation is enabled.
+    MMSnapInstrumentationRef _instrumentation;
+    MMSnapScrollViewInstrumentationObserver _instrumentationObserver;
+    void *_instrumentationObserverContext;
+    
+    // Snapshots of the disappearing pages keyed by their view, and the image views displaying them in place of the
+    // views they were taken from. Both only hold the views of the displayed pages.
+    MMSnapRasterizationPolicyRef _rasterizationPolicy;
+    NSMapTable *_rasterizedPageImages;
+    NSMapTable *_rasterizedPageViews;
+    
+    // The trace being recorded, if any, and the size of the bounds it last recorded.
+    MMSnapTraceRecorderRef _traceRecorder;
+    CGSize _traceBoundsSize;
 }
 
 @property (strong, nonatomic) _MMSnapScrollViewDelegateProxy *delegateProxy;
 
 @property (assign, nonatomic, readwrite) NSInteger numberOfPages;
+@property (assign, nonatomic, readwrite) NSUInteger numberOfPrefetchHits;
+@property (assign, nonatomic, readwrite) NSUInteger numberOfPrefetchMisses;
 @property (assign, nonatomic, getter=isContentSizeInvalidated) BOOL contentSizeInvalidated;
 @property (assign, nonatomic) NSInteger snappedPage;
 @property (assign, nonatomic) NSInteger deferScrollToPage;
 @property (assign, nonatomic) BOOL deferScrollToPageAnimated;
 
-@property (strong, nonatomic) NSMutableDictionary *updates;
 @property (assign, nonatomic, getter=isUpdating) BOOL updating;
 
-@property (strong, nonatomic) NSMutableDictionary *visibleViewsDictionary;
-@property (strong, nonatomic) NSMutableArray *layoutAttributes;
+@property (assign, nonatomic) CGFloat pageHeight;
 
-@property (strong, nonatomic) NSMutableDictionary *visibleSeparatorsDictionary;
 @property (strong, nonatomic) NSMutableSet *separatorReuseQueue;
 @property (assign, nonatomic) CGFloat separatorClassDefinedWidth;
 
@@ -92,19 +193,6 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
 
 @end
 
-@implementation NSIndexSet (Array)
-
-- (NSArray *)array
-{
-    NSMutableArray *array = [NSMutableArray arrayWithCapacity:self.count];
-    [self enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
-        [array addObject:[NSNumber numberWithInteger:idx]];
-    }];
-    return array;
-}
-
-@end
-
 @implementation MMSnapScrollView
 
 - (id)initWithCoder:(NSCoder *)aDecoder
@@ -127,22 +215,28 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
 
 - (void)_commonInit
 {
-    _visibleViewsDictionary = [NSMutableDictionary dictionary];
-    _visibleSeparatorsDictionary = [NSMutableDictionary dictionary];
+    _visiblePages = MMSnapPageRingCreate(&_MMSnapScrollViewVisiblePagesCallbacks);
+    _updatedVisiblePages = MMSnapPageRingCreate(&_MMSnapScrollViewVisiblePagesCallbacks);
     _viewsToRemoveAfterScrollAnimation = [NSMutableSet set];
     _separatorReuseQueue = [NSMutableSet set];
-    _layoutAttributes = [NSMutableArray array];
+    _pageIndex = MMSnapPageIndexCreate();
     _contentSizeInvalidated = YES;
     _snappedPage = NSNotFound;
     _deferScrollToPage = NSNotFound;
     _separatorClassDefinedWidth = _MMStockSnapViewSeparatorWidth;
-    _updates = [NSMutableDictionary dictionary];
-    
-    // Custom animator for content offset updates.
+    _prefetchingLookAhead = 2;
+    _updateMap = MMSnapUpdateMapCreate();
+    _separatorTracker = MMSnapSeparatorTrackerCreate();
+    _asyncLayout = MMSnapAsyncLayoutCreate();
+    _rasterizationPolicy = MMSnapRasterizationPolicyCreate();
+    _rasterizedPageImages = [NSMapTable strongToStrongObjectsMapTable];
+    _rasterizedPageViews = [NSMapTable strongToStrongObjectsMapTable];
+    
+    // Custom animator for content offset updates. The spring runs in real time and settles in about half a second.
     _scrollToAnimator = [[MMSpringScrollAnimator alloc] initWithTargetScrollView:self];
     _scrollToAnimator.mass = 1;
-    _scrollToAnimator.stiffness = 280;
-    _scrollToAnimator.damping = 50;
+    _scrollToAnimator.stiffness = 925;
+    _scrollToAnimator.damping = 91;
     _scrollToAnimator.delegate = self;
     
     // Adds a snap to page gesture recognizer.
@@ -169,25 +263,41 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
     
     // Delegate ownership.
     [super setDelegate:self];
+    
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(_didReceiveMemoryWarning:) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
 }
 
-- (NSIndexSet *)pagesForViewsInRect:(CGRect)rect
+- (void)dealloc
 {
-    NSArray *layoutAttributes = self.layoutAttributes;
-    NSArray *array = [self _layoutAttributesForElementsInRect:rect];
+    MMSnapPageIndexRelease(_pageIndex);
+    MMSnapUpdateMapRelease(_updateMap);
+    MMSnapPageRingRelease(_visiblePages);
+    MMSnapPageRingRelease(_updatedVisiblePages);
+    MMSnapSeparatorTrackerRelease(_separatorTracker);
+    MMSnapInstrumentationRelease(_instrumentation);
+    MMSnapRasterizationPolicyRelease(_rasterizationPolicy);
+    MMSnapTraceRecorderRelease(_traceRecorder);
     
-    NSIndexSet *indexSet = [layoutAttributes indexesOfObjectsPassingTest:^BOOL(id obj, NSUInteger idx, BOOL *stop) {
-        if ([array containsObject:obj]) {
-            return YES;
-        }
-        return NO;
-    }];
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
     
-    return indexSet;
+    // Workers computing widths keep their own reference.
+    MMSnapAsyncLayoutRelease(_asyncLayout);
+}
+
+- (NSIndexSet *)pagesForViewsInRect:(CGRect)rect
+{
+    const NSRange range = [self _pageRangeForRect:rect];
+    if (range.length == 0) {
+        return [NSIndexSet indexSet];
+    }
+    
+    return [NSIndexSet indexSetWithIndexesInRange:range];
 }
 
 - (void)layoutSubviews
 {
+    const uint64_t startTime = MMSnapInstrumentationBegin(_instrumentation);
+    
     [super layoutSubviews];
     
     // Validate layout if needed.
@@ -196,140 +306,281 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
         [self _validateContentOffset];
     }
     
+    // Recenter the content window around the content offset, unless an animation is heading to an offset within it.
+    if (_maximumContentWidth > 0.0f && !self.isDecelerating) {
+        [self _updateContentWindow];
+    }
+    
+    if (_traceRecorder) {
+        [self _recordTraceLayoutPass];
+    }
+    
     // Perform the layout.
     [self _performLayout];
     
     // Notify snap if layout affected snap point.
     [self _notifySnapIfNeeded];
+    
+    // The first frame is laid out with the restored widths, the data source catches up right after it.
+    if (_revalidatesRestoredLayout) {
+        _revalidatesRestoredLayout = NO;
+        
+        __weak typeof(self) weakSelf = self;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [weakSelf _revalidateRestoredLayout];
+        });
+    }
+    
+    MMSnapInstrumentationEnd(_instrumentation, MMSnapInstrumentationPhaseLayoutPass, startTime);
 }
 
 - (void)_performLayout
 {
-    NSMutableDictionary *visibleViewsDictionary = self.visibleViewsDictionary;
-    NSMutableDictionary *visibleSeparatorsDictionary = self.visibleSeparatorsDictionary;
+    MMSnapPageRingRef visiblePages = _visiblePages;
     
     id <MMSnapScrollViewDataSource> dataSource = self.dataSource;
     id <MMSnapScrollViewDelegate> delegate = self.delegate;
+    id <MMSnapScrollViewPrefetchingDataSource> prefetchDataSource = self.prefetchDataSource;
     
-    BOOL notifyWillDisplayView = _delegateFlags.delegateWillDisplayView;
     BOOL notifyDidEndDisplayingView = _delegateFlags.delegateDidEndDisplayingView;
     
     CGRect visibleRect = self.bounds;
     visibleRect.origin = self.contentOffset;
     
     // Calculate visible indexes.
-    NSIndexSet *visiblePages = [self pagesForViewsInRect:visibleRect];
+    const uint64_t visibleRangeStartTime = MMSnapInstrumentationBegin(_instrumentation);
+    const NSRange visibleRange = [self _pageRangeForRect:visibleRect];
+    MMSnapInstrumentationEnd(_instrumentation, MMSnapInstrumentationPhaseVisibleRange, visibleRangeStartTime);
     
     // Remove views that should be hidden.
-    NSMutableIndexSet *removedIndexes = [NSMutableIndexSet indexSet];
+    const NSInteger firstDisplayedPage = MMSnapPageRingGetFirstPage(visiblePages);
+    const NSInteger lastDisplayedPage = firstDisplayedPage + MMSnapPageRingGetPageCount(visiblePages);
     
-    [visibleViewsDictionary enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
-        NSInteger page = [key integerValue];
-        UIView *view = obj;
-        UIView <MMSnapViewSeparatorView> *separatorView = visibleSeparatorsDictionary[key];
+    for (NSInteger page = firstDisplayedPage; page < lastDisplayedPage; page++) {
+        if (NSLocationInRange(page, visibleRange)) {
+            continue;
+        }
+        
+        UIView *view = _MMSnapScrollViewVisibleElement(visiblePages, page, MMSnapPageRingElementView);
+        UIView <MMSnapViewSeparatorView> *separatorView = _MMSnapScrollViewVisibleElement(visiblePages, page, MMSnapPageRingElementSeparator);
+        
+        MMSnapPageRingSetElement(visiblePages, page, MMSnapPageRingElementView, NULL);
+        MMSnapPageRingSetElement(visiblePages, page, MMSnapPageRingElementSeparator, NULL);
         
-        if (![visiblePages containsIndex:page]) {
+        if (view) {
             [view removeFromSuperview];
             
             if (notifyDidEndDisplayingView) {
+                const uint64_t callbackStartTime = MMSnapInstrumentationBegin(_instrumentation);
                 [delegate scrollView:self didEndDisplayingView:view atPage:page];
+                MMSnapInstrumentationEnd(_instrumentation, MMSnapInstrumentationPhaseDisplayCallback, callbackStartTime);
             }
-            
-            [self _enqueueSeparatorView:separatorView];
-            
-            [removedIndexes addIndex:page];
         }
-    }];
+        
+        [self _enqueueSeparatorView:separatorView];
+    }
+    
+    // Lay out the visible pages and their separators at once.
+    const NSInteger endVisiblePage = (visibleRange.length > 0) ? (NSInteger)NSMaxRange(visibleRange) : 0;
     
-    NSArray *removeIndexesArray = removedIndexes.array;
-    [visibleViewsDictionary removeObjectsForKeys:removeIndexesArray];
-    [visibleSeparatorsDictionary removeObjectsForKeys:removeIndexesArray];
+    if (MMSnapPageIndexNeedsValidation(_pageIndex)) {
+        [self _validateLayout];
+    }
+    
+    MMSnapSeparatorTrackerRef separatorTracker = _separatorTracker;
+    
+    const MMSnapLayout layout = [self _layout];
+    const MMSnapPageRange layoutRange = { (long)visibleRange.location, (long)visibleRange.length };
+    MMSnapSeparatorTrackerUpdate(separatorTracker, &layout, layoutRange, _numberOfPages, !self.pagingEnabled);
     
     // Insert views that should be visible.
-    [visiblePages enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
-        NSInteger page = idx;
-        id key = @(page);
-        
-        UIView *view = [visibleViewsDictionary objectForKey:key];
-        UIView <MMSnapViewSeparatorView> *separatorView = [visibleSeparatorsDictionary objectForKey:key];
-        
-        BOOL showsSeparator = ((page + 1) < self->_numberOfPages);
-        
-        CGFloat disappearPercent = 0.0f;
-        CGRect rect = [self _rectForViewAtPage:page disappearPercent:&disappearPercent];
-        
-        CGRect separatorRect = CGRectZero;
-        if (showsSeparator) {
-            CGRect referenceRect = [self _rectForViewAtPage:(page + 1) disappearPercent:NULL];
-            separatorRect = [self _separatorRectWithReferenceRect:referenceRect];
-        }
+    for (NSInteger page = (NSInteger)visibleRange.location; page < endVisiblePage; page++) {
+        UIView *view = _MMSnapScrollViewVisibleElement(visiblePages, page, MMSnapPageRingElementView);
+        UIView <MMSnapViewSeparatorView> *separatorView = _MMSnapScrollViewVisibleElement(visiblePages, page, MMSnapPageRingElementSeparator);
         
         // Insert the view if not displaying:
         BOOL isDisplayingViewAtIndex = (view != nil);
         if (!isDisplayingViewAtIndex) {
-            view = [dataSource scrollView:self viewAtPage:page];
-            
-            NSAssert(view != nil, @"view cannot be nil.");
-            
-            [visibleViewsDictionary setObject:view forKey:key];
-            
-            UIView *nextView = [visibleViewsDictionary objectForKey:@(page + 1)];
-            if (nextView) {
-                [self insertSubview:view belowSubview:nextView];
-            } else {
-                [self addSubview:view];
+            if (prefetchDataSource) {
+                if (MMSnapPrefetchWindowContainsPage(&_prefetchWindow, page)) {
+                    _numberOfPrefetchHits++;
+                } else {
+                    _numberOfPrefetchMisses++;
+                }
             }
             
-            if (notifyWillDisplayView) {
-                [delegate scrollView:self willDisplayView:view atPage:page];
-            }
+            const uint64_t requestStartTime = MMSnapInstrumentationBegin(_instrumentation);
+            view = [dataSource scrollView:self viewAtPage:page];
+            MMSnapInstrumentationEnd(_instrumentation, MMSnapInstrumentationPhaseViewRequest, requestStartTime);
             
-            // Insert separator view.
+            [self _displayView:view atPage:page];
+        }
+        
+        // Insert separator view, also after the separator class changed.
+        if (!separatorView) {
+            const uint64_t dequeueStartTime = MMSnapInstrumentationBegin(_instrumentation);
             separatorView = [self _dequeueSeparatorForPage:page];
+            MMSnapInstrumentationEnd(_instrumentation, MMSnapInstrumentationPhaseSeparatorDequeue, dequeueStartTime);
             
-            [visibleSeparatorsDictionary setObject:separatorView forKey:key];
+            MMSnapPageRingSetElement(visiblePages, page, MMSnapPageRingElementSeparator, (__bridge const void *)separatorView);
             
             [self addSubview:separatorView];
         }
         
         // Update view frame.
-        [view setFrame:rect];
-        
-        // Update separator frame.
-        [separatorView setFrame:separatorRect];
-        [separatorView setPercentDisappeared:disappearPercent];
-    }];
+        [view setFrame:_CGRectFromMMSnapLayoutRect(MMSnapSeparatorTrackerGetPageRect(separatorTracker, page))];
+    }
+    
+    // Update the separators whose state changed since the previous pass.
+    [self _applySeparatorStatesInRange:visibleRange];
+    
+    // Swap the pages sliding behind the following pages for their snapshot.
+    if (_rasterizesDisappearingPages) {
+        [self _updateRasterizedPagesInRange:visibleRange];
+    }
+    
+    // Prepare the pages that are about to scroll into view.
+    if (prefetchDataSource) {
+        [self _updatePrefetchingWithVisibleRange:visibleRange];
+    }
 }
 
-- (CGRect)_rectForViewAtPage:(NSInteger)page disappearPercent:(CGFloat *)disappearPercent
+- (void)_applySeparatorStatesInRange:(NSRange)range
 {
-    _MMSnapScrollViewLayoutAttributes *layoutAttributes = [self _layoutAttributesForPage:page];
-    CGRect rect = [layoutAttributes frame];
+    MMSnapPageRingRef visiblePages = _visiblePages;
+    MMSnapSeparatorTrackerRef separatorTracker = _separatorTracker;
     
-    CGRect bounds = self.bounds;
-    CGPoint contentOffset = self.contentOffset;
+    const NSInteger endPage = (range.length > 0) ? (NSInteger)NSMaxRange(range) : 0;
     
-    // Add parallax offset if:
-    // a. This page should be disappearing because of the content offset.
-    // b. This page can completely dissapear.
-    const BOOL isBehindContentOffset = (CGRectGetMinX(rect) < contentOffset.x);
-    const BOOL canDisappear = CGRectGetMaxX(rect) <= self.contentSize.width - CGRectGetWidth(bounds);
+    BOOL inTransaction = NO;
     
-    if (canDisappear && isBehindContentOffset) {
-        CGFloat distance = CGRectGetMinX(bounds) - CGRectGetMinX(rect);
-        CGFloat maximum = CGRectGetWidth(rect);
+    for (NSInteger page = (NSInteger)range.location; page < endPage; page++) {
+        UIView <MMSnapViewSeparatorView> *separatorView = _MMSnapScrollViewVisibleElement(visiblePages, page, MMSnapPageRingElementSeparator);
+        
+        const MMSnapSeparatorChange change = MMSnapSeparatorTrackerApplySeparator(separatorTracker, page, (__bridge const void *)separatorView);
+        if (change == MMSnapSeparatorChangeNone) {
+            continue;
+        }
+        
+        const MMSnapSeparatorState *state = MMSnapSeparatorTrackerGetState(separatorTracker, page);
         
-        CGFloat percent = MAX(MIN(distance / maximum, 1.0f), 0.0f);
-        CGFloat offset = percent * (maximum / 2);
+        // Frames are set outside of the transaction, so they still follow enclosing animations.
+        if (change & MMSnapSeparatorChangeRect) {
+            [separatorView setFrame:_CGRectFromMMSnapLayoutRect(state->rect)];
+        }
+        
+        if (!(change & (MMSnapSeparatorChangePercentDisappeared | MMSnapSeparatorChangeShowsAsColumnSeparator))) {
+            continue;
+        }
         
-        rect.origin.x = -offset + contentOffset.x;
+        // Appearance changes of every separator are committed at once, without implicit animations.
+        if (!inTransaction) {
+            [CATransaction begin];
+            [CATransaction setDisableActions:YES];
+            inTransaction = YES;
+        }
         
-        if (disappearPercent) {
-            *disappearPercent = percent;
+        if (change & MMSnapSeparatorChangeShowsAsColumnSeparator) {
+            [separatorView setShowsAsColumnSeparator:state->showsAsColumnSeparator];
+        }
+        if (change & MMSnapSeparatorChangePercentDisappeared) {
+            [separatorView setPercentDisappeared:state->percentDisappeared];
         }
     }
     
-    return rect;
+    if (inTransaction) {
+        [CATransaction commit];
+    }
+}
+
+- (void)_updatePrefetchingWithVisibleRange:(NSRange)visibleRange
+{
+    // Keep the last scrolling direction while the offset doesn't change, so the window doesn't flip back and forth on
+    // layout passes triggered by something else.
+    const CGFloat contentOffsetX = self.contentOffset.x;
+    if (contentOffsetX > _prefetchContentOffsetX) {
+        _prefetchDirection = 1;
+    } else if (contentOffsetX < _prefetchContentOffsetX) {
+        _prefetchDirection = -1;
+    }
+    _prefetchContentOffsetX = contentOffsetX;
+    
+    const MMSnapPageRange visiblePages = { (long)visibleRange.location, (long)visibleRange.length };
+    const MMSnapPrefetchWindow previousWindow = _prefetchWindow;
+    const MMSnapPrefetchWindow window = MMSnapPrefetchWindowMake(visiblePages, _numberOfPages, _prefetchDirection, _prefetchingLookAhead);
+    
+    _prefetchWindow = window;
+    
+    // Pages that left the window without becoming visible.
+    if (_prefetchDataSourceFlags.prefetchDataSourceCancelPrefetching) {
+        NSIndexSet *pages = _MMSnapScrollViewPagesNotInPrefetchWindow(&previousWindow, &window, visiblePages);
+        if (pages.count > 0) {
+            [self.prefetchDataSource scrollView:self cancelPrefetchingForPages:pages];
+        }
+    }
+    
+    // Pages that entered the window.
+    NSIndexSet *pages = _MMSnapScrollViewPagesNotInPrefetchWindow(&window, &previousWindow, (MMSnapPageRange){ 0, 0 });
+    if (pages.count > 0) {
+        [self.prefetchDataSource scrollView:self prefetchPages:pages];
+    }
+}
+
+- (void)_resetPrefetchWindow
+{
+    _prefetchWindow = (MMSnapPrefetchWindow){ { 0, 0 }, { 0, 0 } };
+}
+
+- (void)_displayView:(UIView *)view atPage:(NSInteger)page
+{
+    NSAssert(view != nil, @"view cannot be nil.");
+    
+    MMSnapPageRingSetElement(_visiblePages, page, MMSnapPageRingElementView, (__bridge const void *)view);
+    
+    UIView *nextView = _MMSnapScrollViewVisibleElement(_visiblePages, page + 1, MMSnapPageRingElementView);
+    if (nextView) {
+        [self insertSubview:view belowSubview:nextView];
+    } else {
+        [self addSubview:view];
+    }
+    
+    if (_delegateFlags.delegateWillDisplayView) {
+        const uint64_t callbackStartTime = MMSnapInstrumentationBegin(_instrumentation);
+        [self.delegate scrollView:self willDisplayView:view atPage:page];
+        MMSnapInstrumentationEnd(_instrumentation, MMSnapInstrumentationPhaseDisplayCallback, callbackStartTime);
+    }
+}
+
+- (CGRect)_rectForViewAtPage:(NSInteger)page disappearPercent:(CGFloat *)disappearPercent
+{
+    if (MMSnapPageIndexNeedsValidation(_pageIndex)) {
+        [self _validateLayout];
+    }
+    
+    const MMSnapLayout layout = [self _layout];
+    
+    double percent = disappearPercent ? *disappearPercent : 0.0;
+    const MMSnapLayoutRect rect = MMSnapLayoutGetPageRect(&layout, page, &percent);
+    
+    if (disappearPercent) {
+        *disappearPercent = percent;
+    }
+    
+    return _CGRectFromMMSnapLayoutRect(rect);
+}
+
+- (MMSnapLayout)_layout
+{
+    const CGPoint contentOffset = self.contentOffset;
+    const CGSize size = self.bounds.size;
+    
+    return (MMSnapLayout){
+        .pageIndex = _pageIndex,
+        .bounds = { contentOffset.x, contentOffset.y, size.width, size.height },
+        .pageHeight = _pageHeight,
+        .separatorWidth = _separatorClassDefinedWidth,
+        .windowOrigin = _contentWindow.origin
+    };
 }
 
 - (void)_validateLayout
@@ -344,31 +595,234 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
     self.contentSizeInvalidated = NO;
 }
 
+static double MMSnapScrollViewWidthForPage(long page, void *context)
+{
+    MMSnapScrollView *scrollView = (__bridge MMSnapScrollView *)context;
+    
+    const double width = [scrollView.dataSource scrollView:scrollView widthForViewAtPage:page];
+    _MMSnapScrollViewRecordTraceEvent(scrollView->_traceRecorder, MMSnapTraceEventPageWidth, page, 0, width, 0.0, 0);
+    
+    return width;
+}
+
+typedef struct {
+    __unsafe_unretained MMSnapScrollViewWidthProvider widthProvider;
+    MMSnapPageIndexRef pageIndex;
+    MMSnapTraceRecorderRef traceRecorder;
+    MMSnapPageRange visiblePages;
+    long queryCount;
+    long deferredCount;
+    long firstValidatedPage;
+} _MMSnapScrollViewWidthProviderContext;
+
+static double MMSnapScrollViewProvidedWidthForPage(long page, void *context)
+{
+    _MMSnapScrollViewWidthProviderContext *providerContext = context;
+    
+    // Pages are validated in ascending order.
+    if (providerContext->firstValidatedPage > page) {
+        providerContext->firstValidatedPage = page;
+    }
+    
+    const MMSnapPageRange visiblePages = providerContext->visiblePages;
+    const BOOL visible = (page >= visiblePages.location && page < visiblePages.location + visiblePages.length);
+    
+    // The page index still holds the previous width, which is displayed until the new one is computed.
+    const double previousWidth = MMSnapPageIndexGetWidth(providerContext->pageIndex, page);
+    
+    if (visible || previousWidth <= 0.0) {
+        providerContext->queryCount++;
+        
+        const double width = providerContext->widthProvider(page);
+        _MMSnapScrollViewRecordTraceEvent(providerContext->traceRecorder, MMSnapTraceEventPageWidth, page, 0, width, 0.0, 0);
+        
+        return width;
+    }
+    
+    providerContext->deferredCount++;
+    return previousWidth;
+}
+
+static dispatch_queue_t _MMSnapScrollViewLayoutQueue(void)
+{
+    static dispatch_queue_t queue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        dispatch_queue_attr_t attributes = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_USER_INITIATED, 0);
+        queue = dispatch_queue_create("com.matiasmartinez.MMSnapScrollView.layout", attributes);
+    });
+    return queue;
+}
+
 - (void)_validateLayoutIfNeeded
 {
-    id dataSource = self.dataSource;
+    const uint64_t startTime = MMSnapInstrumentationBegin(_instrumentation);
     
-    [_layoutAttributes removeAllObjects];
+    _numberOfLayoutValidations++;
     
     CGRect rect = UIEdgeInsetsInsetRect(self.bounds, self.contentInset);
     
-    CGFloat origin = 0;
-    for (NSInteger idx = 0; idx < _numberOfPages; idx++) {
-        rect.origin.y = 0;
-        rect.origin.x = origin;
-        rect.size.width = [dataSource scrollView:self widthForViewAtPage:idx];
+    MMSnapScrollViewWidthProvider widthProvider = nil;
+    if (_dataSourceFlags.dataSourceWidthProvider && (MMSnapPageIndexNeedsValidation(_pageIndex) || _awaitingWidths)) {
+        widthProvider = [self.dataSource widthProviderForScrollView:self];
+    }
+    
+    BOOL appliesPendingWidths = NO;
+    
+    if (widthProvider) {
+        // Measure the visible pages and the pages that were never measured now, and the other ones off the main thread.
+        const MMSnapLayout layout = [self _layout];
         
-        _MMSnapScrollViewLayoutAttributes *layoutAttributes = [[_MMSnapScrollViewLayoutAttributes alloc] init];
-        layoutAttributes.frame = rect;
+        _MMSnapScrollViewWidthProviderContext context = {
+            .widthProvider = widthProvider,
+            .pageIndex = _pageIndex,
+            .traceRecorder = _traceRecorder,
+            .visiblePages = MMSnapLayoutGetVisiblePages(&layout),
+            .firstValidatedPage = LONG_MAX
+        };
+        MMSnapPageIndexValidate(_pageIndex, MMSnapScrollViewProvidedWidthForPage, &context);
         
-        [_layoutAttributes addObject:layoutAttributes];
+        _numberOfWidthQueriesInLastLayoutPass = context.queryCount;
         
-        origin = CGRectGetMaxX(rect);
+        // The pass in flight still holds if only pages appended after it were measured, so pushing pages doesn't
+        // restart it over and over.
+        const BOOL coveredByPassInFlight = (_awaitingWidths && context.deferredCount == 0 && _widthsAlignedPageCount == _widthsPageCount && context.firstValidatedPage >= _widthsPageCount);
+        
+        if (coveredByPassInFlight) {
+            appliesPendingWidths = _widthsPending;
+        } else {
+            // Widths still being computed for the previous layout are stale.
+            const unsigned long generation = MMSnapAsyncLayoutInvalidate(_asyncLayout);
+            
+            // Pages deferred by a previous validation are still waiting for their widths too.
+            if (context.deferredCount > 0 || _awaitingWidths) {
+                [self _computeWidthsWithWidthProvider:widthProvider generation:generation];
+            }
+        }
+    } else {
+        MMSnapAsyncLayoutInvalidate(_asyncLayout);
+        _awaitingWidths = NO;
+        _widthsPending = NO;
+        
+        // Only query the widths of the pages that were invalidated, inserted or moved since the last pass.
+        _numberOfWidthQueriesInLastLayoutPass = MMSnapPageIndexValidate(_pageIndex, MMSnapScrollViewWidthForPage, (__bridge void *)self);
     }
     
+    _pageHeight = CGRectGetHeight(rect);
+    
     // Update with new content size.
-    CGSize contentSize = CGSizeMake(origin, CGRectGetHeight(rect));
-    [self _setContentSize:contentSize];
+    [self _updateContentWindow];
+    
+    // Widths published while the layout needed validation.
+    if (appliesPendingWidths) {
+        [self _applyPendingWidthsIfNeeded];
+    }
+    
+    MMSnapInstrumentationEnd(_instrumentation, MMSnapInstrumentationPhaseLayoutValidation, startTime);
+}
+
+- (void)_computeWidthsWithWidthProvider:(MMSnapScrollViewWidthProvider)widthProvider generation:(unsigned long)generation
+{
+    MMSnapAsyncLayoutRef asyncLayout = MMSnapAsyncLayoutRetain(_asyncLayout);
+    const long count = MMSnapPageIndexGetCount(_pageIndex);
+    
+    _awaitingWidths = YES;
+    _widthsGeneration = generation;
+    _widthsPageCount = count;
+    _widthsAlignedPageCount = count;
+    _widthsPending = NO;
+    
+    __weak typeof(self) weakSelf = self;
+    
+    dispatch_async(_MMSnapScrollViewLayoutQueue(), ^{
+        double *widths = MMSnapAsyncLayoutBeginWriting(asyncLayout, generation, count);
+        
+        if (widths) {
+            for (long page = 0; page < count; page++) {
+                // Give up as soon as the layout changes again.
+                if (page % 64 == 0 && !MMSnapAsyncLayoutIsCurrent(asyncLayout, generation)) {
+                    break;
+                }
+                widths[page] = widthProvider(page);
+            }
+            
+            if (MMSnapAsyncLayoutEndWriting(asyncLayout, generation)) {
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    [weakSelf _applyWidthsOfGeneration:generation];
+                });
+            }
+        }
+        
+        MMSnapAsyncLayoutRelease(asyncLayout);
+    });
+}
+
+- (void)_applyWidthsOfGeneration:(unsigned long)generation
+{
+    if (generation != _widthsGeneration || !_awaitingWidths) {
+        return;
+    }
+    
+    _widthsPending = YES;
+    
+    [self _applyPendingWidthsIfNeeded];
+}
+
+- (void)_applyPendingWidthsIfNeeded
+{
+    if (!_widthsPending) {
+        return;
+    }
+    
+    // Pages invalidated in the meantime are validated first, which either keeps these widths or computes new ones.
+    if (MMSnapPageIndexNeedsValidation(_pageIndex)) {
+        return;
+    }
+    
+    // Swapping widths under the finger or a running animation would move the content, wait for scrolling to stop.
+    if (self.isTracking || self.isDecelerating || self.scrollToAnimator.isAnimating) {
+        return;
+    }
+    
+    _widthsPending = NO;
+    
+    const NSInteger anchorPage = self.pagesForVisibleViews.firstIndex;
+    const BOOL anchored = (anchorPage != NSNotFound && anchorPage < MMSnapPageIndexGetCount(_pageIndex));
+    const double anchorOrigin = anchored ? MMSnapPageIndexGetOrigin(_pageIndex, anchorPage) : 0.0;
+    const double globalOffsetX = MMSnapContentWindowGetGlobalX(&_contentWindow, self.contentOffset.x);
+    
+    // Pages appended since the widths were requested keep the widths they were measured with.
+    const long changeCount = MMSnapAsyncLayoutApplyLeadingPages(_asyncLayout, _widthsGeneration, _pageIndex, _widthsPageCount);
+    if (changeCount < 0) {
+        return;
+    }
+    
+    _awaitingWidths = NO;
+    
+    if (changeCount == 0) {
+        return;
+    }
+    
+    if (_traceRecorder) {
+        [self _recordTracePageWidths];
+    }
+    
+    // Swap in the new layout, shifting the content offset by as much as the first visible page moved, so it stays in
+    // place on screen along with the part of it scrolled past.
+    const double shift = anchored ? MMSnapPageIndexGetOrigin(_pageIndex, anchorPage) - anchorOrigin : 0.0;
+    const double contentWidth = MMSnapPageIndexGetContentWidth(_pageIndex);
+    const CGFloat viewportWidth = CGRectGetWidth(self.bounds);
+    const double contentOffsetX = MAX(MIN(globalOffsetX + shift, contentWidth - viewportWidth), 0.0);
+    
+    [self _setContentWindow:MMSnapContentWindowMake(contentWidth, [self _maximumContentWindowLength], contentOffsetX, viewportWidth)];
+    [self setContentOffset:CGPointMake(MMSnapContentWindowGetLocalX(&_contentWindow, contentOffsetX), 0.0f)];
+    
+    // A scroll deferred until the pages were laid out lands on the new layout.
+    if (_deferScrollToPage != NSNotFound) {
+        [self _validateContentOffset];
+    }
+    
+    [self setNeedsLayout];
 }
 
 - (void)_validateContentOffset
@@ -408,25 +862,63 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
     // Update number of pages.
     _numberOfPages = [dataSource numberOfPagesInScrollView:self];
     
-    // Clean up visible views.
-    [_visibleViewsDictionary.allValues makeObjectsPerformSelector:@selector(removeFromSuperview)];
-    [_visibleViewsDictionary removeAllObjects];
+    _MMSnapScrollViewRecordTraceEvent(_traceRecorder, MMSnapTraceEventReloadData, _numberOfPages, 0, 0.0, 0.0, 0);
     
-    // Enqueue separators.
-    for (UIView <MMSnapViewSeparatorView> *separatorView in _visibleSeparatorsDictionary.allValues) {
-        [self _enqueueSeparatorView:separatorView];
+    // Clean up visible views and enqueue separators.
+    MMSnapPageRingRef visiblePages = _visiblePages;
+    const NSInteger firstDisplayedPage = MMSnapPageRingGetFirstPage(visiblePages);
+    const NSInteger lastDisplayedPage = firstDisplayedPage + MMSnapPageRingGetPageCount(visiblePages);
+    
+    for (NSInteger page = firstDisplayedPage; page < lastDisplayedPage; page++) {
+        [_MMSnapScrollViewVisibleElement(visiblePages, page, MMSnapPageRingElementView) removeFromSuperview];
+        [self _enqueueSeparatorView:_MMSnapScrollViewVisibleElement(visiblePages, page, MMSnapPageRingElementSeparator)];
     }
-    [_visibleSeparatorsDictionary removeAllObjects];
+    MMSnapPageRingRemoveAllElements(visiblePages);
+    
+    // Prefetched pages are no longer meaningful.
+    [self _resetPrefetchWindow];
     
     // Clean snap page.
     _snappedPage = NSNotFound;
     _deferScrollToPage = NSNotFound;
     
+    // Widths still being computed for the previous pages are stale.
+    MMSnapAsyncLayoutInvalidate(_asyncLayout);
+    _awaitingWidths = NO;
+    _widthsPending = NO;
+    _restoredPagesToRevalidate = nil;
+    
+    // Every page needs to be measured again.
+    MMSnapPageIndexRemoveAllPages(_pageIndex);
+    MMSnapPageIndexInsertPages(_pageIndex, 0, _numberOfPages);
+    
     // Invalidate layout.
     [self invalidateLayout];
 }
 
 - (void)invalidateLayout
+{
+    MMSnapPageIndexInvalidateAllPages(_pageIndex);
+    
+    [self _invalidateContentSize];
+}
+
+- (void)invalidateLayoutForPages:(NSIndexSet *)pages
+{
+    if (pages.count == 0) {
+        return;
+    }
+    
+    MMSnapPageIndexRef pageIndex = _pageIndex;
+    
+    [pages enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        MMSnapPageIndexInvalidatePage(pageIndex, idx);
+    }];
+    
+    [self _invalidateContentSize];
+}
+
+- (void)_invalidateContentSize
 {
     if (self.isContentSizeInvalidated) {
         return;
@@ -436,35 +928,462 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
     [self setNeedsLayout];
 }
 
-- (_MMSnapScrollViewLayoutAttributes *)_layoutAttributesForPage:(NSInteger)page
+#pragma mark - Content window.
+
+- (void)setMaximumContentWidth:(CGFloat)maximumContentWidth
 {
-    if (page < _numberOfPages) {
-        BOOL hasAttributes = (page < _layoutAttributes.count);
-        if (!hasAttributes) {
-            [self _validateLayout];
+    maximumContentWidth = MAX(maximumContentWidth, 0.0f);
+    
+    if (_maximumContentWidth != maximumContentWidth) {
+        _maximumContentWidth = maximumContentWidth;
+        
+        // The content size is set again along with the window on the next layout pass.
+        self.contentSizeInvalidated = YES;
+        [self setNeedsLayout];
+    }
+}
+
+- (double)contentWindowOrigin
+{
+    return _contentWindow.origin;
+}
+
+- (CGFloat)_maximumContentWindowLength
+{
+    // UIScrollView pages by multiples of its width, so windows are made of whole pages too.
+    const CGFloat viewportWidth = CGRectGetWidth(self.bounds);
+    if (self.pagingEnabled && viewportWidth > 0.0f) {
+        return ceil(_maximumContentWidth / viewportWidth) * viewportWidth;
+    }
+    return _maximumContentWidth;
+}
+
+- (void)_updateContentWindow
+{
+    const double contentWidth = MMSnapPageIndexGetContentWidth(_pageIndex);
+    const CGFloat maximumLength = [self _maximumContentWindowLength];
+    const CGFloat contentOffsetX = self.contentOffset.x;
+    const CGFloat viewportWidth = CGRectGetWidth(self.bounds);
+    
+    MMSnapContentWindow window = _contentWindow;
+    
+    if (MMSnapContentWindowNeedsRecentering(&window, contentWidth, maximumLength, contentOffsetX, viewportWidth)) {
+        const double globalOffsetX = MMSnapContentWindowGetGlobalX(&window, contentOffsetX);
+        
+        window = MMSnapContentWindowMake(contentWidth, maximumLength, globalOffsetX, viewportWidth);
+    }
+    
+    [self _setContentWindow:window];
+}
+
+- (void)_updateContentWindowToIncludeContentOffsetX:(CGFloat)targetContentOffsetX
+{
+    const double contentWidth = MMSnapPageIndexGetContentWidth(_pageIndex);
+    const CGFloat maximumLength = [self _maximumContentWindowLength];
+    const CGFloat viewportWidth = CGRectGetWidth(self.bounds);
+    
+    MMSnapContentWindow window = _contentWindow;
+    
+    if (!MMSnapContentWindowNeedsRecentering(&window, contentWidth, maximumLength, targetContentOffsetX, viewportWidth)) {
+        return;
+    }
+    
+    const double globalOffsetX = MMSnapContentWindowGetGlobalX(&window, self.contentOffset.x);
+    const double globalTargetX = MMSnapContentWindowGetGlobalX(&window, targetContentOffsetX);
+    
+    window = MMSnapContentWindowMakeIncludingTarget(contentWidth, maximumLength, globalOffsetX, globalTargetX, viewportWidth);
+    
+    [self _setContentWindow:window];
+}
+
+- (void)_setContentWindow:(MMSnapContentWindow)window
+{
+    // In paging mode, windows also start on a page boundary.
+    const CGFloat viewportWidth = CGRectGetWidth(self.bounds);
+    if (self.pagingEnabled && viewportWidth > 0.0f) {
+        window.origin -= fmod(window.origin, viewportWidth);
+    }
+    
+    const double shift = window.origin - _contentWindow.origin;
+    
+    _contentWindow = window;
+    
+    const CGSize contentSize = CGSizeMake(window.length, _pageHeight);
+    if (!CGSizeEqualToSize(contentSize, self.contentSize)) {
+        [self _setContentSize:contentSize];
+    }
+    
+    if (shift == 0.0) {
+        return;
+    }
+    
+    // Shift the content offset by as much as the window, so the pages stay in place on screen.
+    CGPoint contentOffset = self.contentOffset;
+    contentOffset.x = MAX(MIN(contentOffset.x - shift, window.length - viewportWidth), 0.0f);
+    
+    _prefetchContentOffsetX -= shift;
+    
+    [self setContentOffset:contentOffset];
+    [self setNeedsLayout];
+}
+
+#pragma mark - Layout snapshots.
+
+- (BOOL)writeLayoutSnapshotToFile:(NSString *)path traits:(uint64_t)traits
+{
+    // Placeholder widths waiting for the width provider aren't worth restoring.
+    if (_awaitingWidths) {
+        return NO;
+    }
+    
+    const CGSize size = self.bounds.size;
+    const MMSnapLayoutSnapshotKey key = { size.width, size.height, traits };
+    const double contentOffsetX = MMSnapContentWindowGetGlobalX(&_contentWindow, self.contentOffset.x);
+    
+    return MMSnapLayoutSnapshotWriteFile(path.fileSystemRepresentation, _pageIndex, key, contentOffsetX);
+}
+
+- (BOOL)restoreLayoutFromSnapshotFile:(NSString *)path traits:(uint64_t)traits
+{
+    MMSnapLayoutSnapshotRef snapshot = MMSnapLayoutSnapshotOpenFile(path.fileSystemRepresentation);
+    if (!snapshot) {
+        return NO;
+    }
+    
+    const CGSize size = self.bounds.size;
+    const MMSnapLayoutSnapshotKey key = { size.width, size.height, traits };
+    
+    BOOL restored = NO;
+    if (MMSnapLayoutSnapshotMatchesKey(snapshot, key) && MMSnapLayoutSnapshotGetPageCount(snapshot) == _numberOfPages) {
+        restored = MMSnapLayoutSnapshotApply(snapshot, _pageIndex);
+        
+        // Every page is measured again if the widths could not be copied.
+        if (!restored) {
+            MMSnapPageIndexRemoveAllPages(_pageIndex);
+            MMSnapPageIndexInsertPages(_pageIndex, 0, _numberOfPages);
         }
-        return _layoutAttributes[page];
     }
-    return nil;
+    
+    const double globalOffsetX = MMSnapLayoutSnapshotGetContentOffsetX(snapshot);
+    MMSnapLayoutSnapshotRelease(snapshot);
+    
+    if (!restored) {
+        return NO;
+    }
+    
+    // Widths still being computed for the previous layout are stale.
+    MMSnapAsyncLayoutInvalidate(_asyncLayout);
+    _awaitingWidths = NO;
+    _widthsPending = NO;
+    
+    // Set the content size and offset right away. The next layout pass validates the layout without measuring any page.
+    const double contentWidth = MMSnapPageIndexGetContentWidth(_pageIndex);
+    const double contentOffsetX = MAX(MIN(globalOffsetX, contentWidth - size.width), 0.0);
+    
+    _pageHeight = CGRectGetHeight(UIEdgeInsetsInsetRect(self.bounds, self.contentInset));
+    [self _setContentWindow:MMSnapContentWindowMake(contentWidth, [self _maximumContentWindowLength], contentOffsetX, size.width)];
+    [self setContentOffset:CGPointMake(MMSnapContentWindowGetLocalX(&_contentWindow, contentOffsetX), 0.0f)];
+    
+    _revalidatesRestoredLayout = YES;
+    [self _invalidateContentSize];
+    
+    return YES;
 }
 
-#pragma mark - Separator views.
+- (void)_revalidateRestoredLayout
+{
+    // Widths provided off the main thread are measured for the visible pages right away, and in the background for the
+    // other ones.
+    if (_dataSourceFlags.dataSourceWidthProvider) {
+        [self invalidateLayout];
+        return;
+    }
+    
+    // Otherwise the visible pages are measured first, and the other ones a chunk per run loop turn.
+    NSIndexSet *visiblePages = self.pagesForVisibleViews;
+    
+    _restoredPagesToRevalidate = [NSMutableIndexSet indexSetWithIndexesInRange:NSMakeRange(0, _numberOfPages)];
+    [_restoredPagesToRevalidate removeIndexes:visiblePages];
+    
+    [self invalidateLayoutForPages:visiblePages];
+    [self _revalidateRestoredPagesLater];
+}
 
-- (Class)_inheritedSeparatorClass
+- (void)_revalidateRestoredPagesLater
 {
-    return _separatorViewClass ?: [_MMStockSnapViewSeparatorView class];
+    if (_restoredPagesToRevalidate.count == 0) {
+        _restoredPagesToRevalidate = nil;
+        return;
+    }
+    
+    // Performed in the default run loop mode, so nothing is measured while the scroll view tracks a touch.
+    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(_revalidateRestoredPages) object:nil];
+    [self performSelector:@selector(_revalidateRestoredPages) withObject:nil afterDelay:0.0];
 }
 
-- (CGRect)_separatorRectWithReferenceRect:(CGRect)rect
+- (void)_revalidateRestoredPages
 {
-    CGFloat separatorWidth = _separatorClassDefinedWidth;
-    CGRect separatorRect = (CGRect){
-        .origin.x = CGRectGetMinX(rect) - separatorWidth,
-        .size.width = separatorWidth,
-        .size.height = CGRectGetHeight(rect),
-    };
+    NSMutableIndexSet *pages = _restoredPagesToRevalidate;
+    if (!pages) {
+        return;
+    }
+    
+    // Widths changing under a running animation would move the content.
+    if (!self.isDecelerating) {
+        NSMutableIndexSet *chunk = [NSMutableIndexSet indexSet];
+        for (NSUInteger page = pages.firstIndex; page != NSNotFound && chunk.count < _MMSnapScrollViewRevalidationChunkLength; page = [pages indexGreaterThanIndex:page]) {
+            [chunk addIndex:page];
+        }
+        [pages removeIndexes:chunk];
+        
+        [self invalidateLayoutForPages:chunk];
+    }
     
-    return separatorRect;
+    [self _revalidateRestoredPagesLater];
+}
+
+- (void)_invalidateRestoredPagesToRevalidate
+{
+    if (!_restoredPagesToRevalidate) {
+        return;
+    }
+    
+    // Measured with the next validation instead.
+    MMSnapPageIndexRef pageIndex = _pageIndex;
+    [_restoredPagesToRevalidate enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        MMSnapPageIndexInvalidatePage(pageIndex, idx);
+    }];
+    
+    _restoredPagesToRevalidate = nil;
+}
+
+- (CGRect)_frameForPage:(NSInteger)page
+{
+    if (page < 0 || page >= _numberOfPages) {
+        return CGRectZero;
+    }
+    
+    if (MMSnapPageIndexNeedsValidation(_pageIndex)) {
+        [self _validateLayout];
+    }
+    
+    const MMSnapLayout layout = [self _layout];
+    
+    return _CGRectFromMMSnapLayoutRect(MMSnapLayoutGetPageFrame(&layout, page));
+}
+
+#pragma mark - Rasterized pages.
+
+- (void)setRasterizesDisappearingPages:(BOOL)rasterizesDisappearingPages
+{
+    if (_rasterizesDisappearingPages == rasterizesDisappearingPages) {
+        return;
+    }
+    
+    _rasterizesDisappearingPages = rasterizesDisappearingPages;
+    
+    if (!rasterizesDisappearingPages) {
+        [self _discardRasterizedPages];
+    }
+    [self setNeedsLayout];
+}
+
+- (unsigned long long)maximumRasterizedPagesByteCount
+{
+    return MMSnapRasterizationPolicyGetConfiguration(_rasterizationPolicy).maximumByteCount;
+}
+
+- (void)setMaximumRasterizedPagesByteCount:(unsigned long long)maximumRasterizedPagesByteCount
+{
+    MMSnapRasterizationConfiguration configuration = MMSnapRasterizationPolicyGetConfiguration(_rasterizationPolicy);
+    configuration.maximumByteCount = maximumRasterizedPagesByteCount;
+    MMSnapRasterizationPolicySetConfiguration(_rasterizationPolicy, configuration);
+    
+    [self _evictRasterizedPagesToByteCount:maximumRasterizedPagesByteCount];
+}
+
+- (void)invalidateRasterizationForView:(UIView *)view
+{
+    if (!view) {
+        return;
+    }
+    
+    if (MMSnapRasterizationPolicyInvalidate(_rasterizationPolicy, (__bridge const void *)view)) {
+        [self _showLiveView:view];
+        [self setNeedsLayout];
+    }
+    [_rasterizedPageImages removeObjectForKey:view];
+}
+
+- (void)_updateRasterizedPagesInRange:(NSRange)range
+{
+    MMSnapRasterizationPolicyRef policy = _rasterizationPolicy;
+    MMSnapPageRingRef visiblePages = _visiblePages;
+    
+    // Pages that stopped being displayed, whatever removed them, get their live view back and their snapshot dropped,
+    // so the cache doesn't keep the views of deleted or unloaded pages alive.
+    for (UIView *view in _rasterizedPageImages.keyEnumerator.allObjects) {
+        if (MMSnapPageRingGetPageOfElement(visiblePages, (__bridge const void *)view) == MMSnapPageNotFound) {
+            MMSnapRasterizationPolicyInvalidate(policy, (__bridge const void *)view);
+            [_rasterizedPageImages removeObjectForKey:view];
+            [self _showLiveView:view];
+        }
+    }
+    
+    for (UIView *view in _rasterizedPageViews.keyEnumerator.allObjects) {
+        if (MMSnapPageRingGetPageOfElement(visiblePages, (__bridge const void *)view) == MMSnapPageNotFound) {
+            MMSnapRasterizationPolicyInvalidate(policy, (__bridge const void *)view);
+            [self _showLiveView:view];
+        }
+    }
+    
+    const NSInteger endPage = (range.length > 0) ? (NSInteger)NSMaxRange(range) : 0;
+    
+    for (NSInteger page = (NSInteger)range.location; page < endPage; page++) {
+        UIView *view = _MMSnapScrollViewVisibleElement(visiblePages, page, MMSnapPageRingElementView);
+        if (!view) {
+            continue;
+        }
+        
+        const MMSnapSeparatorState *state = MMSnapSeparatorTrackerGetState(_separatorTracker, page);
+        const double percentDisappeared = state ? state->percentDisappeared : 0.0;
+        
+        switch (MMSnapRasterizationPolicyUpdate(policy, (__bridge const void *)view, percentDisappeared)) {
+            case MMSnapRasterizationActionNone:
+                break;
+            case MMSnapRasterizationActionRasterize:
+                [self _rasterizeView:view];
+                break;
+            case MMSnapRasterizationActionShowSnapshot:
+                [self _showSnapshot:[_rasterizedPageImages objectForKey:view] forView:view];
+                break;
+            case MMSnapRasterizationActionShowLiveView:
+                [self _showLiveView:view];
+                break;
+        }
+        
+        UIImageView *snapshotView = [_rasterizedPageViews objectForKey:view];
+        if (!snapshotView) {
+            continue;
+        }
+        
+        // Snapshots taken at another size, for example before rotating, are taken again.
+        if (!CGSizeEqualToSize(snapshotView.image.size, view.bounds.size)) {
+            [self invalidateRasterizationForView:view];
+            continue;
+        }
+        
+        // Follow the parallax of the page.
+        [snapshotView setFrame:view.frame];
+    }
+    
+    [self _evictRasterizedPagesToByteCount:self.maximumRasterizedPagesByteCount];
+}
+
+- (void)_rasterizeView:(UIView *)view
+{
+    const CGSize size = view.bounds.size;
+    if (size.width <= 0.0f || size.height <= 0.0f) {
+        return;
+    }
+    
+    // Pages whose snapshot wouldn't fit in the budget stay live, and aren't rendered at all.
+    const CGFloat scale = self.window.screen.scale ?: [UIScreen mainScreen].scale;
+    const unsigned long long byteCount = (unsigned long long)ceil(size.width * scale) * (unsigned long long)ceil(size.height * scale) * 4;
+    
+    if (!MMSnapRasterizationPolicySetSnapshot(_rasterizationPolicy, (__bridge const void *)view, byteCount)) {
+        return;
+    }
+    
+    UIGraphicsBeginImageContextWithOptions(size, view.opaque, scale);
+    [view drawViewHierarchyInRect:view.bounds afterScreenUpdates:NO];
+    UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    
+    if (!image) {
+        MMSnapRasterizationPolicyInvalidate(_rasterizationPolicy, (__bridge const void *)view);
+        return;
+    }
+    
+    [_rasterizedPageImages setObject:image forKey:view];
+    [self _showSnapshot:image forView:view];
+}
+
+- (void)_showSnapshot:(UIImage *)image forView:(UIView *)view
+{
+    // The policy still remembered a snapshot that was discarded since.
+    if (!image) {
+        MMSnapRasterizationPolicyInvalidate(_rasterizationPolicy, (__bridge const void *)view);
+        return;
+    }
+    
+    UIImageView *snapshotView = [_rasterizedPageViews objectForKey:view];
+    if (!snapshotView) {
+        snapshotView = [[UIImageView alloc] init];
+        [_rasterizedPageViews setObject:snapshotView forKey:view];
+    }
+    
+    [snapshotView setImage:image];
+    [snapshotView setFrame:view.frame];
+    
+    // Right above the view, so the following pages still cover it.
+    [self insertSubview:snapshotView aboveSubview:view];
+    [view setHidden:YES];
+}
+
+- (void)_showLiveView:(UIView *)view
+{
+    UIImageView *snapshotView = [_rasterizedPageViews objectForKey:view];
+    if (!snapshotView) {
+        return;
+    }
+    
+    [snapshotView removeFromSuperview];
+    [_rasterizedPageViews removeObjectForKey:view];
+    
+    [view setHidden:NO];
+}
+
+- (void)_evictRasterizedPagesToByteCount:(unsigned long long)byteCount
+{
+    const long capacity = MMSnapRasterizationPolicyGetCount(_rasterizationPolicy);
+    if (capacity == 0) {
+        return;
+    }
+    
+    const void **keys = malloc((size_t)capacity * sizeof(void *));
+    if (!keys) {
+        return;
+    }
+    
+    const long count = MMSnapRasterizationPolicyEvict(_rasterizationPolicy, byteCount, keys, capacity);
+    
+    for (long idx = 0; idx < count; idx++) {
+        [_rasterizedPageImages removeObjectForKey:(__bridge UIView *)keys[idx]];
+    }
+    free(keys);
+}
+
+- (void)_discardRasterizedPages
+{
+    for (UIView *view in _rasterizedPageViews.keyEnumerator.allObjects) {
+        [self _showLiveView:view];
+    }
+    
+    MMSnapRasterizationPolicyRemoveAll(_rasterizationPolicy);
+    [_rasterizedPageImages removeAllObjects];
+}
+
+- (void)_didReceiveMemoryWarning:(NSNotification *)notification
+{
+    [self _evictRasterizedPagesToByteCount:0];
+}
+
+#pragma mark - Separator views.
+
+- (Class)_inheritedSeparatorClass
+{
+    return _separatorViewClass ?: [_MMStockSnapViewSeparatorView class];
 }
 
 - (UIView <MMSnapViewSeparatorView> *)_dequeueSeparatorForPage:(NSInteger)page
@@ -476,7 +1395,6 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
     }
     
     [separatorView setUserInteractionEnabled:NO];
-    [separatorView setShowsAsColumnSeparator:!self.pagingEnabled];
     
     [_separatorReuseQueue removeObject:separatorView];
     
@@ -491,21 +1409,43 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
     }
 }
 
+- (NSUInteger)numberOfSeparatorUpdates
+{
+    return MMSnapSeparatorTrackerGetStatistics(_separatorTracker).updateCount;
+}
+
+- (NSUInteger)numberOfSeparatorUpdatesInLastLayoutPass
+{
+    return MMSnapSeparatorTrackerGetStatistics(_separatorTracker).lastPassUpdateCount;
+}
+
+- (NSUInteger)numberOfLayoutPasses
+{
+    return MMSnapSeparatorTrackerGetStatistics(_separatorTracker).passCount;
+}
+
 #pragma mark - Scroll to.
 
 - (void)scrollToPage:(NSInteger)page animated:(BOOL)animated
 {
     animated = animated && [UIView areAnimationsEnabled];
     
+    _MMSnapScrollViewRecordTraceEvent(_traceRecorder, MMSnapTraceEventScrollToPage, page, 0, 0.0, 0.0, animated ? MMSnapTraceEventFlagAnimated : 0);
+    
     if (page < _numberOfPages) {
-        if (!self.window || _layoutAttributes.count < page) {
+        if (!self.window || MMSnapPageIndexGetCount(_pageIndex) < page) {
             _deferScrollToPage = page;
             _deferScrollToPageAnimated = animated;
             return;
         }
         
-        _MMSnapScrollViewLayoutAttributes *attributes = [self _layoutAttributesForPage:page];
-        CGRect frame = attributes.frame;
+        CGRect frame = [self _frameForPage:page];
+        
+        // Move the content window over the page first, so it can be scrolled to.
+        if (_maximumContentWidth > 0.0f) {
+            [self _updateContentWindowToIncludeContentOffsetX:CGRectGetMinX(frame)];
+            frame = [self _frameForPage:page];
+        }
         
         CGRect bounds = self.bounds;
         CGSize contentSize = self.contentSize;
@@ -519,7 +1459,7 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
             }
             
             if (animated) {
-                [self.scrollToAnimator animateScrollToContentOffset:contentOffset duration:0.55];
+                [self.scrollToAnimator animateScrollToContentOffset:contentOffset];
             } else {
                 [self setContentOffset:contentOffset];
             }
@@ -544,6 +1484,25 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
     [self _updatePages:pages withAction:_MMSnapScrollViewUpdateActionDelete animated:animated];
 }
 
+- (void)movePage:(NSInteger)page toPage:(NSInteger)newPage
+{
+    if (page == newPage) {
+        return;
+    }
+    
+    BOOL updating = self.isUpdating;
+    if (!updating) {
+        [self _beginUpdates];
+    }
+    
+    MMSnapUpdateMapMovePage(_updateMap, page, newPage);
+    _MMSnapScrollViewRecordTraceEvent(_traceRecorder, MMSnapTraceEventMovePage, page, newPage, 0.0, 0.0, 0);
+    
+    if (!updating) {
+        [self _endUpdatesAnimated:YES];
+    }
+}
+
 - (void)_updatePages:(NSIndexSet *)pages withAction:(_MMSnapScrollViewUpdateAction)action animated:(BOOL)animated
 {
     if (pages.count == 0) {
@@ -555,11 +1514,24 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
         [self _beginUpdates];
     }
     
-    NSMutableArray *updates = [self _updatesArrayForAction:action];
+    MMSnapUpdateMapRef updateMap = _updateMap;
+    MMSnapTraceRecorderRef traceRecorder = _traceRecorder;
     
     [pages enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
-        _MMSnapScrollViewUpdateItem *update = [[_MMSnapScrollViewUpdateItem alloc] initWithUpdateAction:action forPage:idx];
-        [updates addObject:update];
+        switch (action) {
+            case _MMSnapScrollViewUpdateActionReload:
+                MMSnapUpdateMapReloadPage(updateMap, idx);
+                _MMSnapScrollViewRecordTraceEvent(traceRecorder, MMSnapTraceEventReloadPage, idx, 0, 0.0, 0.0, 0);
+                break;
+            case _MMSnapScrollViewUpdateActionDelete:
+                MMSnapUpdateMapDeletePage(updateMap, idx);
+                _MMSnapScrollViewRecordTraceEvent(traceRecorder, MMSnapTraceEventDeletePage, idx, 0, 0.0, 0.0, 0);
+                break;
+            case _MMSnapScrollViewUpdateActionInsert:
+                MMSnapUpdateMapInsertPage(updateMap, idx);
+                _MMSnapScrollViewRecordTraceEvent(traceRecorder, MMSnapTraceEventInsertPage, idx, 0, 0.0, 0.0, 0);
+                break;
+        }
     }];
     
     if (!updating) {
@@ -593,87 +1565,132 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
 
 - (BOOL)_endUpdatesAnimated:(BOOL)animated
 {
-    NSArray *removeUpdateItems = [[self _updatesArrayForAction:_MMSnapScrollViewUpdateActionDelete]
-                                  sortedArrayUsingSelector:@selector(inverseComparePages:)];
+    const uint64_t startTime = MMSnapInstrumentationBegin(_instrumentation);
     
-    NSArray *insertUpdateItems = [[self _updatesArrayForAction:_MMSnapScrollViewUpdateActionInsert]
-                                  sortedArrayUsingSelector:@selector(comparePages:)];
+    MMSnapUpdateMapRef updateMap = _updateMap;
+    MMSnapPageIndexRef pageIndex = _pageIndex;
     
-    NSMutableArray *layoutUpdateItems = [NSMutableArray array];
-    [layoutUpdateItems addObjectsFromArray:removeUpdateItems];
-    [layoutUpdateItems addObjectsFromArray:insertUpdateItems];
-    
-    NSArray *categories = @[ _MMElementCategoryPage, _MMElementCategorySeparator ];
-    NSMutableDictionary *newVisibleViews = [NSMutableDictionary dictionaryWithCapacity:categories.count];
-    for (NSString *category in categories) {
-        newVisibleViews[category] = [self _orderedViewsWithElementCategory:category].mutableCopy;
+    // Sort the updates once, so each visible page is then mapped with a binary search instead of replaying the updates
+    // over every page.
+    if (!MMSnapUpdateMapPrepare(updateMap)) {
+        [NSException raise:NSInternalInconsistencyException format:@"attempt to perform conflicting updates, a page can only be deleted, moved or reloaded once and receive a single page."];
     }
     
-    for (_MMSnapScrollViewUpdateItem *updateItem in layoutUpdateItems) {
-        for (NSMutableArray *array in newVisibleViews.allValues) {
-            switch (updateItem.updateAction) {
-                case _MMSnapScrollViewUpdateActionDelete:
-                    [array removeObjectAtIndex:updateItem.initialPage];
-                    break;
-                case _MMSnapScrollViewUpdateActionInsert:
-                    [array insertObject:[NSNull null] atIndex:updateItem.finalPage];
-                    break;
-                default:
-                    break;
-            }
-        }
-    }
+    const NSInteger deleteCount = MMSnapUpdateMapGetDeleteCount(updateMap);
+    const NSInteger insertCount = MMSnapUpdateMapGetInsertCount(updateMap);
+    const BOOL didUpdate = (MMSnapUpdateMapGetUpdateCount(updateMap) > 0);
+    
+    _MMSnapScrollViewRecordTraceEvent(_traceRecorder, MMSnapTraceEventEndUpdates, 0, 0, 0.0, 0.0, animated ? MMSnapTraceEventFlagAnimated : 0);
     
     // Update number of pages.
-    const NSInteger numberOfPages = (_numberOfPages - removeUpdateItems.count + insertUpdateItems.count);
+    const NSInteger numberOfPages = (_numberOfPages - deleteCount + insertCount);
     
     // Assert if data source is wrong.
     if (numberOfPages != [_dataSource numberOfPagesInScrollView:self]) {
-        [NSException raise:@"invalid number of pages" format:@"attempt to insert (%lu) and delete (%lu) pages, but there are only %ld pages after the update.", (unsigned long)insertUpdateItems.count, (unsigned long)removeUpdateItems.count, (long)_numberOfPages];
+        [NSException raise:@"invalid number of pages" format:@"attempt to insert (%lu) and delete (%lu) pages, but there are only %ld pages after the update.", (unsigned long)insertCount, (unsigned long)deleteCount, (long)_numberOfPages];
+    }
+    
+    // Mirror the updates in the page index, so only the inserted, moved and reloaded pages are measured.
+    long removedCount = 0, addedCount = 0, reloadedCount = 0;
+    const long *removedPages = MMSnapUpdateMapGetRemovedPages(updateMap, &removedCount);
+    const long *addedPages = MMSnapUpdateMapGetAddedPages(updateMap, &addedCount);
+    const long *reloadedPages = MMSnapUpdateMapGetReloadedPages(updateMap, &reloadedCount);
+    
+    // Restored pages waiting to be measured again are tracked by the page index across the updates.
+    [self _invalidateRestoredPagesToRevalidate];
+    
+    MMSnapPageIndexRemovePagesAtIndexes(pageIndex, removedPages, removedCount);
+    MMSnapPageIndexInsertPagesAtIndexes(pageIndex, addedPages, addedCount);
+    
+    // Pages are removed and added in ascending order, the widths computed in the background still match the pages
+    // before the first of them.
+    if (removedCount > 0) {
+        _widthsAlignedPageCount = MIN(_widthsAlignedPageCount, removedPages[0]);
+    }
+    if (addedCount > 0) {
+        _widthsAlignedPageCount = MIN(_widthsAlignedPageCount, addedPages[0]);
+    }
+    
+    for (long idx = 0; idx < reloadedCount; idx++) {
+        MMSnapPageIndexInvalidatePage(pageIndex, MMSnapUpdateMapGetFinalPage(updateMap, reloadedPages[idx]));
     }
     
     _numberOfPages = numberOfPages;
     
+    // Pages moved, so prefetch again around the visible pages on the next layout pass.
+    [self _resetPrefetchWindow];
+    
     // Validate layout.
     [self _validateLayoutIfNeeded];
     
-    // Update visible views dict.
+    // Only the visible pages are mapped to their new location. Moved pages keep their views.
+    MMSnapPageRingRef visiblePages = _visiblePages;
+    MMSnapPageRingRef updatedVisiblePages = _updatedVisiblePages;
+    
+    NSMutableDictionary *reloadedViews = [NSMutableDictionary dictionary];
     NSMutableSet *viewsToRemove = [NSMutableSet set];
     
-    [newVisibleViews enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
-        NSString *category = key;
-        NSArray *array = obj;
+    const NSInteger firstDisplayedPage = MMSnapPageRingGetFirstPage(visiblePages);
+    const NSInteger lastDisplayedPage = firstDisplayedPage + MMSnapPageRingGetPageCount(visiblePages);
+    
+    for (NSInteger page = firstDisplayedPage; page < lastDisplayedPage; page++) {
+        UIView *view = _MMSnapScrollViewVisibleElement(visiblePages, page, MMSnapPageRingElementView);
+        UIView *separatorView = _MMSnapScrollViewVisibleElement(visiblePages, page, MMSnapPageRingElementSeparator);
         
-        NSMutableDictionary *dict = nil;
-        if ([category isEqualToString:_MMElementCategoryPage]) {
-            dict = self->_visibleViewsDictionary;
-        } else if ([category isEqualToString:_MMElementCategorySeparator]) {
-            dict = self->_visibleSeparatorsDictionary;
-        } else {
-            [[NSException exceptionWithName:NSInternalInconsistencyException reason:[NSString stringWithFormat:@"Invalid element category named `%@`", category] userInfo:nil] raise];
+        if (!view && !separatorView) {
+            continue;
         }
         
-        // Snapshot before.
-        NSSet *visibleViewsBeforeUpdate = [NSSet setWithArray:dict.allValues];
+        const NSInteger finalPage = MMSnapUpdateMapGetFinalPage(updateMap, page);
         
-        // Remove existing entries.
-        [dict removeAllObjects];
-        
-        // Update with new order.
-        [array enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
-            UIView *view = (obj != [NSNull null]) ? obj : nil;
-            NSInteger page = idx;
-            
+        if (finalPage == MMSnapPageNotFound) {
             if (view) {
-                [dict setObject:view forKey:@(page)];
+                [viewsToRemove addObject:view];
             }
-        }];
+            if (separatorView) {
+                [viewsToRemove addObject:separatorView];
+            }
+            continue;
+        }
+        
+        if (view && MMSnapUpdateMapIsPageReloaded(updateMap, page)) {
+            reloadedViews[@(finalPage)] = view;
+        }
+        
+        MMSnapPageRingSetElement(updatedVisiblePages, finalPage, MMSnapPageRingElementView, (__bridge const void *)view);
+        MMSnapPageRingSetElement(updatedVisiblePages, finalPage, MMSnapPageRingElementSeparator, (__bridge const void *)separatorView);
+    }
+    
+    // Swap the storage, the previous one is kept empty for the next update.
+    MMSnapPageRingRemoveAllElements(visiblePages);
+    
+    _visiblePages = updatedVisiblePages;
+    _updatedVisiblePages = visiblePages;
+    
+    // Reloaded pages keep their view if the data source returns it again, otherwise the new view replaces it.
+    [reloadedViews enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
+        const NSInteger page = [key integerValue];
+        
+        UIView *view = obj;
+        
+        const uint64_t requestStartTime = MMSnapInstrumentationBegin(self->_instrumentation);
+        UIView *newView = [self.dataSource scrollView:self viewAtPage:page];
+        MMSnapInstrumentationEnd(self->_instrumentation, MMSnapInstrumentationPhaseViewRequest, requestStartTime);
+        
+        if (newView == view) {
+            return;
+        }
+        
+        if (self->_delegateFlags.delegateDidEndDisplayingView) {
+            const uint64_t callbackStartTime = MMSnapInstrumentationBegin(self->_instrumentation);
+            [self.delegate scrollView:self didEndDisplayingView:view atPage:page];
+            MMSnapInstrumentationEnd(self->_instrumentation, MMSnapInstrumentationPhaseDisplayCallback, callbackStartTime);
+        }
         
-        // Remove what's left.
-        NSMutableSet *unused = visibleViewsBeforeUpdate.mutableCopy;
-        [unused minusSet:[NSSet setWithArray:dict.allValues]];
+        [viewsToRemove addObject:view];
         
-        [viewsToRemove unionSet:unused];
+        [newView setFrame:[self _rectForViewAtPage:page disappearPercent:NULL]];
+        [self _displayView:newView atPage:page];
     }];
     
     // Animate views.
@@ -686,9 +1703,15 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
             }
         } completion:^(BOOL finished) {
             for (UIView *view in viewsToRemove) {
-                [view removeFromSuperview];
                 [view setAlpha:1.0f];
                 
+                // The data source may have handed the view out again while it was fading.
+                if (MMSnapPageRingGetPageOfElement(self->_visiblePages, (__bridge const void *)view) != MMSnapPageNotFound) {
+                    continue;
+                }
+                
+                [view removeFromSuperview];
+                
                 if ([view conformsToProtocol:@protocol(MMSnapViewSeparatorView)]) {
                     [self _enqueueSeparatorView:(UIView <MMSnapViewSeparatorView> *)view];
                 }
@@ -700,46 +1723,160 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
     [self setNeedsLayout];
     
     // Clear the updates.
-    [self.updates removeAllObjects];
+    MMSnapUpdateMapRemoveAllUpdates(updateMap);
     
     // Set flag.
     self.updating = NO;
     
-    return (layoutUpdateItems.count > 0);
+    MMSnapInstrumentationEnd(_instrumentation, MMSnapInstrumentationPhaseUpdates, startTime);
+    
+    return didUpdate;
 }
 
-- (NSArray *)_orderedViewsWithElementCategory:(NSString *)elementCategory
+#pragma mark - Instrumentation.
+
+_Static_assert((NSInteger)MMSnapScrollViewLayoutPhaseUpdates == (NSInteger)MMSnapInstrumentationPhaseUpdates, "layout phases must match the instrumentation phases");
+
+static void _MMSnapScrollViewInstrumentationObserver(MMSnapInstrumentationPhase phase, uint64_t nanoseconds, void *context)
 {
-    NSDictionary *storage = nil;
-    if ([elementCategory isEqualToString:_MMElementCategoryPage]) {
-        storage = _visibleViewsDictionary;
-    } else if ([elementCategory isEqualToString:_MMElementCategorySeparator]) {
-        storage = _visibleSeparatorsDictionary;
-    }
+    MMSnapScrollView *scrollView = (__bridge MMSnapScrollView *)context;
     
-    const NSInteger numberOfPages = _numberOfPages;
+    scrollView->_instrumentationObserver((MMSnapScrollViewLayoutPhase)phase, nanoseconds, scrollView->_instrumentationObserverContext);
+}
+
+- (void)setInstrumentationEnabled:(BOOL)instrumentationEnabled
+{
+#if MM_SNAP_INSTRUMENTATION
+    if (instrumentationEnabled == (_instrumentation != NULL)) {
+        return;
+    }
     
-    NSMutableArray *array = [NSMutableArray arrayWithCapacity:numberOfPages];
-    for (NSUInteger page = 0; page < numberOfPages; page++) {
-        id key = @(page);
-        [array addObject:storage[key] ?: [NSNull null]];
+    if (instrumentationEnabled) {
+        _instrumentation = MMSnapInstrumentationCreate();
+        
+        if (_instrumentationObserver) {
+            MMSnapInstrumentationSetObserver(_instrumentation, _MMSnapScrollViewInstrumentationObserver, (__bridge void *)self);
+        }
+    } else {
+        MMSnapInstrumentationRelease(_instrumentation);
+        _instrumentation = NULL;
     }
+#endif
+}
+
+- (BOOL)isInstrumentationEnabled
+{
+    return (_instrumentation != NULL);
+}
+
+- (void)setInstrumentationObserver:(MMSnapScrollViewInstrumentationObserver)observer context:(void *)context
+{
+    _instrumentationObserver = observer;
+    _instrumentationObserverContext = context;
     
-    return array;
+    if (_instrumentation) {
+        MMSnapInstrumentationSetObserver(_instrumentation, observer ? _MMSnapScrollViewInstrumentationObserver : NULL, (__bridge void *)self);
+    }
 }
 
-- (NSMutableArray *)_updatesArrayForAction:(_MMSnapScrollViewUpdateAction)action
+- (NSDictionary *)instrumentationStatistics
 {
-    id key = @(action);
+    if (!_instrumentation) {
+        return nil;
+    }
+    
+    NSMutableDictionary *statistics = [NSMutableDictionary dictionaryWithCapacity:MMSnapInstrumentationPhaseCount];
     
-    NSMutableArray *array = _updates[key];
-    if (!array) {
-        array = [NSMutableArray array];
+    for (NSInteger phase = 0; phase < MMSnapInstrumentationPhaseCount; phase++) {
+        MMSnapInstrumentationStatistics phaseStatistics;
+        MMSnapInstrumentationGetStatistics(_instrumentation, (MMSnapInstrumentationPhase)phase, &phaseStatistics);
         
-        _updates[key] = array;
+        NSString *name = @(MMSnapInstrumentationGetPhaseName((MMSnapInstrumentationPhase)phase));
+        
+        statistics[name] = @{
+            @"count" : @(phaseStatistics.count),
+            @"totalDuration" : @(phaseStatistics.totalNanoseconds / 1e9),
+            @"maximumDuration" : @(phaseStatistics.maximumNanoseconds / 1e9),
+            @"medianDuration" : @(MMSnapInstrumentationStatisticsGetPercentile(&phaseStatistics, 0.5) / 1e9),
+            @"99thPercentileDuration" : @(MMSnapInstrumentationStatisticsGetPercentile(&phaseStatistics, 0.99) / 1e9),
+        };
+    }
+    
+    return statistics;
+}
+
+- (void)resetInstrumentation
+{
+    if (_instrumentation) {
+        MMSnapInstrumentationReset(_instrumentation);
+    }
+}
+
+#pragma mark - Traces.
+
+- (BOOL)startRecordingTraceToFile:(NSString *)path
+{
+    [self stopRecordingTrace];
+    
+    _traceRecorder = MMSnapTraceRecorderCreate(path.fileSystemRepresentation, _MMSnapScrollViewTraceCapacity);
+    if (!_traceRecorder) {
+        return NO;
+    }
+    
+    // The pages as they are, so the trace can be replayed from its start.
+    const CGSize size = self.bounds.size;
+    const double contentOffsetX = MMSnapContentWindowGetGlobalX(&_contentWindow, self.contentOffset.x);
+    
+    _traceBoundsSize = size;
+    
+    _MMSnapScrollViewRecordTraceEvent(_traceRecorder, MMSnapTraceEventBegin, MMSnapPageIndexGetCount(_pageIndex), 0, contentOffsetX, 0.0, 0);
+    _MMSnapScrollViewRecordTraceEvent(_traceRecorder, MMSnapTraceEventBounds, 0, 0, size.width, size.height, 0);
+    [self _recordTracePageWidths];
+    
+    return YES;
+}
+
+- (void)stopRecordingTrace
+{
+    MMSnapTraceRecorderRelease(_traceRecorder);
+    _traceRecorder = NULL;
+}
+
+- (BOOL)isRecordingTrace
+{
+    return (_traceRecorder != NULL);
+}
+
+- (void)recordTraceMarker:(MMSnapScrollViewTraceMarker)marker page:(NSInteger)page
+{
+    const MMSnapTraceEventType type = (marker == MMSnapScrollViewTraceMarkerPush) ? MMSnapTraceEventPush : MMSnapTraceEventPop;
+    _MMSnapScrollViewRecordTraceEvent(_traceRecorder, type, page, 0, 0.0, 0.0, 0);
+}
+
+- (void)_recordTraceLayoutPass
+{
+    const CGSize size = self.bounds.size;
+    if (!CGSizeEqualToSize(size, _traceBoundsSize)) {
+        _traceBoundsSize = size;
+        _MMSnapScrollViewRecordTraceEvent(_traceRecorder, MMSnapTraceEventBounds, 0, 0, size.width, size.height, 0);
     }
     
-    return array;
+    // Offsets are global, so the trace doesn't depend on the content window.
+    const CGPoint contentOffset = self.contentOffset;
+    _MMSnapScrollViewRecordTraceEvent(_traceRecorder, MMSnapTraceEventContentOffset, 0, 0, MMSnapContentWindowGetGlobalX(&_contentWindow, contentOffset.x), contentOffset.y, 0);
+}
+
+- (void)_recordTracePageWidths
+{
+    const long count = MMSnapPageIndexGetCount(_pageIndex);
+    
+    // Pages waiting for their first width have none yet.
+    for (long page = 0; page < count; page++) {
+        const double width = MMSnapPageIndexGetWidth(_pageIndex, page);
+        if (width > 0.0) {
+            _MMSnapScrollViewRecordTraceEvent(_traceRecorder, MMSnapTraceEventPageWidth, page, 0, width, 0.0, 0);
+        }
+    }
 }
 
 #pragma mark - Boilerplate.
@@ -766,14 +1903,37 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
     }
     
     _dataSource = dataSource;
+    _dataSourceFlags.dataSourceWidthProvider = [dataSource respondsToSelector:@selector(widthProviderForScrollView:)];
     
     [self reloadData];
 }
 
+- (void)setPrefetchDataSource:(id<MMSnapScrollViewPrefetchingDataSource>)prefetchDataSource
+{
+    if (prefetchDataSource == self.prefetchDataSource) {
+        return;
+    }
+    
+    _prefetchDataSource = prefetchDataSource;
+    _prefetchDataSourceFlags.prefetchDataSourceCancelPrefetching = [prefetchDataSource respondsToSelector:@selector(scrollView:cancelPrefetchingForPages:)];
+    
+    [self _resetPrefetchWindow];
+    [self setNeedsLayout];
+}
+
+- (void)setPrefetchingLookAhead:(NSInteger)prefetchingLookAhead
+{
+    _prefetchingLookAhead = MAX(prefetchingLookAhead, 0);
+    
+    [self setNeedsLayout];
+}
+
 - (void)setBounds:(CGRect)bounds
 {
     if (!CGRectEqualToRect(bounds, self.bounds)) {
         if (!CGSizeEqualToSize(bounds.size, self.bounds.size)) {
+            // Page widths are usually derived from the bounds, so all of them are measured again.
+            MMSnapPageIndexInvalidateAllPages(_pageIndex);
             self.contentSizeInvalidated = YES;
         }
         
@@ -785,6 +1945,7 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
 {
     if (!CGRectEqualToRect(frame, self.frame)) {
         if (!CGSizeEqualToSize(frame.size, self.frame.size)) {
+            MMSnapPageIndexInvalidateAllPages(_pageIndex);
             self.contentSizeInvalidated = YES;
         }
         
@@ -805,6 +1966,7 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
 - (void)setContentInset:(UIEdgeInsets)contentInset
 {
     if (!UIEdgeInsetsEqualToEdgeInsets(contentInset, self.contentInset)) {
+        // Insets only affect the height of the pages, widths are kept.
         self.contentSizeInvalidated = YES;
         
         [super setContentInset:contentInset];
@@ -817,11 +1979,8 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
     if (self.isPagingEnabled != pagingEnabled) {
         [super setPagingEnabled:pagingEnabled];
         
-        [self.visibleSeparatorsDictionary enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
-            UIView <MMSnapViewSeparatorView> *separatorView = obj;
-            
-            [separatorView setShowsAsColumnSeparator:!pagingEnabled];
-        }];
+        // Separators switch between page and column appearance on the next layout pass.
+        [self setNeedsLayout];
     }
 }
 
@@ -832,21 +1991,16 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
 
 #pragma mark - Layout attributes methods.
 
-- (NSArray *)_layoutAttributesForElementsInRect:(CGRect)rect
+- (NSRange)_pageRangeForRect:(CGRect)rect
 {
-    NSArray *array = self.layoutAttributes;
-    if (array.count == 0) {
-        return nil;
-    }
+    const MMSnapLayout layout = [self _layout];
     
-    NSMutableArray *matches = [NSMutableArray array];
-    for (_MMSnapScrollViewLayoutAttributes *layoutAttributes in array) {
-        if (CGRectIntersectsRect(rect, layoutAttributes.frame)) {
-            [matches addObject:layoutAttributes];
-        }
+    const MMSnapPageRange range = MMSnapLayoutGetPagesInRect(&layout, _MMSnapLayoutRectFromCGRect(CGRectStandardize(rect)));
+    if (range.length == 0) {
+        return NSMakeRange(NSNotFound, 0);
     }
     
-    return [matches copy];
+    return NSMakeRange(range.location, range.length);
 }
 
 #pragma mark - UIScrollViewDelegate
@@ -867,8 +2021,15 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
 - (void)scrollViewWillEndDragging:(UIScrollView *)scrollView withVelocity:(CGPoint)velocity targetContentOffset:(inout CGPoint *)targetContentOffset
 {
     // If UIScrollView's paging is off, do our own targetContentOffset calculations.
+    BOOL animatesToTargetContentOffset = NO;
     if (!self.pagingEnabled) {
         *targetContentOffset = [self _targetContentOffsetForProposedContentOffset:*targetContentOffset withScrollingVelocity:velocity];
+        
+        // Hand the release velocity to the spring, unless the content is out of bounds and UIScrollView has to bounce it.
+        const CGFloat contentOffsetX = scrollView.contentOffset.x;
+        const CGFloat maximumContentOffsetX = MAX(self.contentSize.width - CGRectGetWidth(self.bounds), 0.0f);
+        
+        animatesToTargetContentOffset = (contentOffsetX >= 0.0f && contentOffsetX <= maximumContentOffsetX);
     }
     
     // Notify the delegate snapping will happen.
@@ -879,15 +2040,47 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
     if ([self.delegate respondsToSelector:@selector(scrollViewWillEndDragging:withVelocity:targetContentOffset:)]) {
         [self.delegate scrollViewWillEndDragging:scrollView withVelocity:velocity targetContentOffset:targetContentOffset];
     }
+    
+    // The gesture velocity is measured in points per millisecond.
+    if (animatesToTargetContentOffset && !CGPointEqualToPoint(*targetContentOffset, scrollView.contentOffset)) {
+        const CGPoint contentOffset = *targetContentOffset;
+        
+        *targetContentOffset = scrollView.contentOffset;
+        
+        [self.scrollToAnimator animateScrollToContentOffset:contentOffset initialVelocity:CGPointMake(velocity.x * 1000.0f, 0.0f)];
+    }
+}
+
+- (void)scrollViewDidEndDragging:(UIScrollView *)scrollView willDecelerate:(BOOL)decelerate
+{
+    // Widths computed while dragging are swapped in once the scroll view settles, right away if it doesn't move on.
+    if (!decelerate) {
+        __weak typeof(self) weakSelf = self;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [weakSelf _applyPendingWidthsIfNeeded];
+        });
+    }
+    
+    if ([self.delegate respondsToSelector:@selector(scrollViewDidEndDragging:willDecelerate:)]) {
+        [self.delegate scrollViewDidEndDragging:scrollView willDecelerate:decelerate];
+    }
 }
 
 - (void)scrollViewDidEndDecelerating:(UIScrollView *)scrollView
 {
+    // The content window was left in place while decelerating.
+    if (_maximumContentWidth > 0.0f) {
+        [self setNeedsLayout];
+    }
+    
     // Notify the delegate snapping did happen.
     if (_delegateFlags.delegateDidSnapToPage) {
         [self _notifySnapToTargetContentOffset:scrollView.contentOffset completed:YES];
     }
     
+    // Widths computed while scrolling are swapped in now.
+    [self _applyPendingWidthsIfNeeded];
+    
     if ([self.delegate respondsToSelector:@selector(scrollViewDidEndDecelerating:)]) {
         [self.delegate scrollViewDidEndDecelerating:scrollView];
     }
@@ -903,6 +2096,14 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
     // Remove views after a delete animation is complete.
     [self _removeQueuedViewsToRemove];
     
+    // The content window was left in place while animating.
+    if (_maximumContentWidth > 0.0f) {
+        [self setNeedsLayout];
+    }
+    
+    // Widths computed while animating are swapped in now.
+    [self _applyPendingWidthsIfNeeded];
+    
     if ([self.delegate respondsToSelector:@selector(scrollViewDidEndScrollingAnimation:)]) {
         [self.delegate scrollViewDidEndScrollingAnimation:scrollView];
     }
@@ -940,36 +2141,9 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
 
 - (CGPoint)_targetContentOffsetForProposedContentOffset:(CGPoint)proposedContentOffset withScrollingVelocity:(CGPoint)velocity
 {
-    CGRect targetRect = CGRectMake(proposedContentOffset.x, 0.0, self.bounds.size.width, self.bounds.size.height);
-    
-    NSArray *array = [self _layoutAttributesForElementsInRect:targetRect];
-    
-    CGFloat offsetAdjustment = targetRect.origin.x;
-    
-    _MMSnapScrollViewLayoutAttributes *first = array.firstObject;
-    if (first) {
-        CGRect frame = first.frame;
-        
-        // Go to next/prev one.
-        if (CGRectGetMinX(targetRect) > CGRectGetMidX(frame) || fabs(velocity.x) > 0) {
-            // Don't go over contentSize (keep this page if so).
-            if (CGRectGetMaxX(frame) < self.contentSize.width) {
-                offsetAdjustment = CGRectGetMaxX(frame);
-            } else {
-                offsetAdjustment = CGRectGetMinX(frame);
-            }
-            
-            if (fabs(velocity.x) > 0 && velocity.x < 0) {
-                offsetAdjustment = CGRectGetMinX(frame);
-            }
-        }
-        // Or to this one.
-        else {
-            offsetAdjustment = CGRectGetMinX(frame);
-        }
-    }
+    const MMSnapLayout layout = [self _layout];
     
-    return CGPointMake(offsetAdjustment, proposedContentOffset.y);
+    return CGPointMake(MMSnapLayoutGetTargetContentOffsetX(&layout, proposedContentOffset.x, velocity.x), proposedContentOffset.y);
 }
 
 - (void)_removeQueuedViewsToRemove
@@ -1016,8 +2190,15 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
     CGRect rect = self.bounds;
     rect.origin = self.contentOffset;
     
-    for (UIView *visibleView in self.visibleViews) {
-        if ([view isDescendantOfView:visibleView]) {
+    // Walk the visible pages directly, this runs on every touch.
+    MMSnapPageRingRef visiblePages = _visiblePages;
+    const NSInteger firstDisplayedPage = MMSnapPageRingGetFirstPage(visiblePages);
+    const NSInteger lastDisplayedPage = firstDisplayedPage + MMSnapPageRingGetPageCount(visiblePages);
+    
+    for (NSInteger page = firstDisplayedPage; page < lastDisplayedPage; page++) {
+        UIView *visibleView = _MMSnapScrollViewVisibleElement(visiblePages, page, MMSnapPageRingElementView);
+        
+        if (visibleView && [view isDescendantOfView:visibleView]) {
             BOOL completelyVisible = CGRectContainsRect(rect, visibleView.frame);
             
             // Return self because we don't want to deliver touches to this subview.
@@ -1041,29 +2222,25 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
         CGRect rect = self.bounds;
         rect.origin = self.contentOffset;
         
-        NSArray *layoutAttributes = self.layoutAttributes;
-        NSIndexSet *pagesInRect = [self pagesForViewsInRect:rect];
+        const NSRange pagesInRect = [self _pageRangeForRect:rect];
         
-        [pagesInRect enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
-            NSInteger page = idx;
-            CGRect frame = [layoutAttributes[idx] frame];
+        for (NSUInteger page = pagesInRect.location; pagesInRect.length > 0 && page < NSMaxRange(pagesInRect); page++) {
+            CGRect frame = [self _frameForPage:page];
             
             BOOL containsPoint = CGRectContainsPoint(frame, point);
             BOOL completelyVisible = CGRectContainsRect(rect, frame);
             BOOL snaps = (containsPoint && !completelyVisible);
             if (snaps) {
-                if (page != NSNotFound) {
-                    NSInteger newPage = page;
-                    
-                    if (newPage != pagesInRect.firstIndex) {
-                        newPage = pagesInRect.firstIndex + 1;
-                    }
-                    
-                    [self scrollToPage:newPage animated:YES];
+                NSInteger newPage = page;
+                
+                if (newPage != pagesInRect.location) {
+                    newPage = pagesInRect.location + 1;
                 }
-                *stop = YES;
+                
+                [self scrollToPage:newPage animated:YES];
+                break;
             }
-        }];
+        }
     }
 }
 
@@ -1071,50 +2248,69 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
 
 - (UIView *)viewAtPage:(NSInteger)page
 {
-    __block UIView *view = nil;
-    [_visibleViewsDictionary enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
-        if ([key integerValue] == page) {
-            view = obj;
-            *stop = YES;
-        }
-    }];
-    return view;
+    return _MMSnapScrollViewVisibleElement(_visiblePages, page, MMSnapPageRingElementView);
 }
 
 - (NSInteger)pageForView:(UIView *)view
 {
-    __block NSNumber *idx = nil;
-    [_visibleViewsDictionary enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
-        if (view == obj) {
-            idx = key;
-            *stop = YES;
-        }
-    }];
-    if (idx) {
-        return [idx integerValue];
+    const NSInteger page = MMSnapPageRingGetPageOfElement(_visiblePages, (__bridge const void *)view);
+    
+    // Separators are stored along with the views.
+    if (page != MMSnapPageNotFound && [self viewAtPage:page] == view) {
+        return page;
     }
     return NSNotFound;
 }
 
 - (NSArray *)visibleViews
 {
-    NSMutableArray *views = [NSMutableArray new];
-    [_visibleViewsDictionary enumerateKeysAndObjectsUsingBlock:^(__unused id key, UIView *obj, BOOL *stop) {
-        if ([obj isKindOfClass:[UIView class]] && CGRectIntersectsRect(self.bounds, obj.frame)) {
-            [views addObject:obj];
+    MMSnapPageRingRef visiblePages = _visiblePages;
+    
+    // Only rebuilt after the visible pages change.
+    const unsigned long mutationCount = MMSnapPageRingGetMutationCount(visiblePages);
+    if (_visibleViews && _visibleViewsMutationCount == mutationCount) {
+        return _visibleViews;
+    }
+    
+    const NSInteger firstDisplayedPage = MMSnapPageRingGetFirstPage(visiblePages);
+    const NSInteger lastDisplayedPage = firstDisplayedPage + MMSnapPageRingGetPageCount(visiblePages);
+    
+    NSMutableArray *views = [NSMutableArray arrayWithCapacity:MMSnapPageRingGetElementCount(visiblePages, MMSnapPageRingElementView)];
+    for (NSInteger page = firstDisplayedPage; page < lastDisplayedPage; page++) {
+        UIView *view = _MMSnapScrollViewVisibleElement(visiblePages, page, MMSnapPageRingElementView);
+        if (view) {
+            [views addObject:view];
         }
-    }];
-    return views;
+    }
+    
+    _visibleViews = views.copy;
+    _visibleViewsMutationCount = mutationCount;
+    
+    return _visibleViews;
 }
 
 - (NSIndexSet *)pagesForVisibleViews
 {
-    if (_visibleViewsDictionary.count == 0) {
+    MMSnapPageRingRef visiblePages = _visiblePages;
+    
+    const NSInteger numberOfViews = MMSnapPageRingGetElementCount(visiblePages, MMSnapPageRingElementView);
+    if (numberOfViews == 0) {
         return nil;
     }
+    
+    const NSInteger firstDisplayedPage = MMSnapPageRingGetFirstPage(visiblePages);
+    const NSInteger numberOfDisplayedPages = MMSnapPageRingGetPageCount(visiblePages);
+    
+    // Visible pages are contiguous outside of updates.
+    if (numberOfViews == numberOfDisplayedPages) {
+        return [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(firstDisplayedPage, numberOfDisplayedPages)];
+    }
+    
     NSMutableIndexSet *indexSet = [NSMutableIndexSet indexSet];
-    for (NSNumber *idx in _visibleViewsDictionary.keyEnumerator) {
-        [indexSet addIndex:idx.integerValue];
+    for (NSInteger page = firstDisplayedPage; page < firstDisplayedPage + numberOfDisplayedPages; page++) {
+        if ([self viewAtPage:page]) {
+            [indexSet addIndex:page];
+        }
     }
     return indexSet.copy;
 }
@@ -1127,12 +2323,21 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
         _separatorViewClass = separatorViewClass;
         _separatorClassDefinedWidth = [separatorViewClass separatorWidth];
         
-        [self.visibleSeparatorsDictionary enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
-            UIView <MMSnapViewSeparatorView> *separatorView = obj;
+        MMSnapPageRingRef visiblePages = _visiblePages;
+        const NSInteger firstDisplayedPage = MMSnapPageRingGetFirstPage(visiblePages);
+        const NSInteger lastDisplayedPage = firstDisplayedPage + MMSnapPageRingGetPageCount(visiblePages);
+        
+        for (NSInteger page = firstDisplayedPage; page < lastDisplayedPage; page++) {
+            UIView <MMSnapViewSeparatorView> *separatorView = _MMSnapScrollViewVisibleElement(visiblePages, page, MMSnapPageRingElementSeparator);
+            
             [self _enqueueSeparatorView:separatorView];
-        }];
+            
+            MMSnapPageRingSetElement(visiblePages, page, MMSnapPageRingElementSeparator, NULL);
+        }
         [self.separatorReuseQueue removeAllObjects];
-        [self.visibleSeparatorsDictionary removeAllObjects];
+        
+        // The freed separators' addresses can be reused by the new ones.
+        MMSnapSeparatorTrackerInvalidate(_separatorTracker);
         
         [self setNeedsLayout];
     }
@@ -1180,25 +2385,35 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
     
     CGFloat alpha = percentDisappeared;
     
-    [CATransaction begin];
-    [CATransaction setValue:(id)kCFBooleanTrue forKey:kCATransactionDisableActions];
+    const BOOL nestedTransaction = ![CATransaction disableActions];
+    if (nestedTransaction) {
+        [CATransaction begin];
+        [CATransaction setValue:(id)kCFBooleanTrue forKey:kCATransactionDisableActions];
+    }
     
     _thickLayer.opacity = (1.0f - alpha);
     _shadowGradientLayer.opacity = alpha;
     
-    [CATransaction commit];
+    if (nestedTransaction) {
+        [CATransaction commit];
+    }
 }
 
 - (void)setShowsAsColumnSeparator:(BOOL)showsAsColumnSeparator
 {
     _showsAsColumnSeparator = showsAsColumnSeparator;
     
-    [CATransaction begin];
-    [CATransaction setValue:(id)kCFBooleanTrue forKey:kCATransactionDisableActions];
+    const BOOL nestedTransaction = ![CATransaction disableActions];
+    if (nestedTransaction) {
+        [CATransaction begin];
+        [CATransaction setValue:(id)kCFBooleanTrue forKey:kCATransactionDisableActions];
+    }
     
     _thickLayer.hidden = !showsAsColumnSeparator;
     
-    [CATransaction commit];
+    if (nestedTransaction) {
+        [CATransaction commit];
+    }
 }
 
 - (void)layoutSubviews
@@ -1227,50 +2442,6 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
 
 @end
 
-@implementation _MMSnapScrollViewLayoutAttributes
-
-- (instancetype)init
-{
-    self = [super init];
-    if (self) {
-        self.frame = CGRectZero;
-    }
-    return self;
-}
-
-- (void)setFrame:(CGRect)frame
-{
-    _frame = frame;
-    _size = _frame.size;
-    _center = (CGPoint){CGRectGetMidX(_frame), CGRectGetMidY(_frame)};
-}
-
-- (void)setCenter:(CGPoint)center
-{
-    _center = center;
-    
-    [self _updateRect];
-}
-
-- (void)setSize:(CGSize)size
-{
-    _size = size;
-    
-    [self _updateRect];
-}
-
-- (void)_updateRect
-{
-    _frame = (CGRect){{ _center.x - _size.width / 2.0f, _center.y - _size.height / 2.0f}, _size };
-}
-
-- (NSString *)description
-{
-    return [NSString stringWithFormat:@"<%@: %p> frame: %@", self.class, self, NSStringFromCGRect(self.frame)];
-}
-
-@end
-
 @implementation _MMSnapScrollViewDelegateProxy
 
 - (instancetype)initWithDelegate:(id<MMSnapScrollViewDelegate>)delegate scrollView:(MMSnapScrollView *)scrollView
@@ -1309,77 +2480,3 @@ static const CGFloat _MMStockSnapViewSeparatorWidth = 10.0f;
 
 @end
 
-@implementation _MMSnapScrollViewUpdateItem
-
-- (instancetype)initWithUpdateAction:(_MMSnapScrollViewUpdateAction)updateAction forPage:(NSInteger)page
-{
-    self = [super init];
-    if (self) {
-        if (updateAction == _MMSnapScrollViewUpdateActionInsert)
-            return [self initWithInitialPage:NSNotFound finalPage:page updateAction:updateAction];
-        else if (updateAction == _MMSnapScrollViewUpdateActionDelete)
-            return [self initWithInitialPage:page finalPage:NSNotFound updateAction:updateAction];
-        else if (updateAction == _MMSnapScrollViewUpdateActionReload)
-            return [self initWithInitialPage:page finalPage:page updateAction:updateAction];
-    }
-    return self;
-}
-
-- (id)initWithInitialPage:(NSInteger)initialPage finalPage:(NSInteger)finalPage updateAction:(_MMSnapScrollViewUpdateAction)updateAction
-{
-    self = [super init];
-    if (self) {
-        _initialPage = initialPage;
-        _finalPage = finalPage;
-        _updateAction = updateAction;
-    }
-    return self;
-}
-
-- (NSInteger)page
-{
-    return _initialPage;
-}
-
-- (NSComparisonResult)comparePages:(_MMSnapScrollViewUpdateItem *)otherItem
-{
-    NSNumber *selfIndex = nil;
-    NSNumber *otherIndex = nil;
-    
-    switch (_updateAction) {
-        case _MMSnapScrollViewUpdateActionInsert:
-            selfIndex = @(_finalPage);
-            otherIndex = @([otherItem initialPage]);
-            break;
-        case _MMSnapScrollViewUpdateActionDelete:
-            selfIndex = @(_initialPage);
-            otherIndex = @([otherItem page]);
-        default: break;
-    }
-    
-    return [selfIndex compare:otherIndex];
-}
-
-- (NSComparisonResult)inverseComparePages:(_MMSnapScrollViewUpdateItem *)otherItem
-{
-    return (NSComparisonResult)([self comparePages:otherItem] * -1);
-}
-
-- (NSString *)description
-{
-    const _MMSnapScrollViewUpdateAction update = _updateAction;
-    const NSInteger page = _page;
-    
-    NSString *action = nil;
-    if (update == _MMSnapScrollViewUpdateActionReload) {
-        action = @"Reload";
-    } else if (update == _MMSnapScrollViewUpdateActionInsert) {
-        action = @"Insert";
-    } else if (update == _MMSnapScrollViewUpdateActionDelete) {
-        action = @"Delete";
-    }
-    return [NSString stringWithFormat:@"<%@: %p> action: %@, page: %@", self.class, self, action, @(page)];
-}
-
-@end
-
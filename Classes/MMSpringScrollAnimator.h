@@ -38,8 +38,41 @@
  *  Starts the animation an finished at the specified content offset.
  *
  *  @param contentOffset The content offset at which stop animating.
+ *
+ *  @note If an animation is in flight, it's retargeted keeping its current position and velocity instead of starting over.
+ *  Otherwise, the animation starts with @c initialVelocity.
+ */
+- (void)animateScrollToContentOffset:(CGPoint)contentOffset;
+
+/**
+ *  Starts the animation with the specified velocity, for example the velocity of a gesture that just ended.
+ *
+ *  @param contentOffset The content offset at which stop animating.
+ *  @param velocity      The velocity of the content offset, in points per second.
+ *
+ *  @note An animation in flight is retargeted from its current position, using @c velocity as its new velocity.
  */
-- (void)animateScrollToContentOffset:(CGPoint)contentOffset duration:(NSTimeInterval)duration;
+- (void)animateScrollToContentOffset:(CGPoint)contentOffset initialVelocity:(CGPoint)velocity;
+
+/**
+ *  Starts the animation an finished at the specified content offset.
+ *
+ *  @param contentOffset The content offset at which stop animating.
+ *  @param duration      Ignored, the spring runs in real time and settles when its parameters determine.
+ */
+- (void)animateScrollToContentOffset:(CGPoint)contentOffset duration:(NSTimeInterval)duration __deprecated_msg("Use -animateScrollToContentOffset: instead.");
+
+/**
+ *  The time it takes for the current animation to settle at its destination, measured from its start or last retarget.
+ *
+ *  @note Computed analytically when the animation starts, so no frames are spent waiting for the spring to come to rest.
+ */
+@property (readonly, nonatomic) NSTimeInterval settleDuration;
+
+/**
+ *  The current velocity of the content offset, in points per second. Zero when not animating.
+ */
+@property (readonly, nonatomic) CGPoint velocity;
 
 /**
  *  Stops the animation at its current state.
@@ -67,12 +100,17 @@
 @property (assign, nonatomic) CGFloat damping;
 
 /*
- * The initial velocity of the object attached to the spring. Defaults
- * to zero, which represents an unmoving object. Negative values
- * represent the object moving away from the spring attachment point,
- * positive values represent the object moving towards the spring
- * attachment point.
+ * The initial velocity (in points per second) of the object attached to the spring, when an animation starts
+ * from rest. Defaults to zero, which represents an unmoving object. Negative values represent the object
+ * moving away from the spring attachment point, positive values represent the object moving towards the
+ * spring attachment point.
  */
 @property (assign, nonatomic) CGFloat initialVelocity;
 
+/*
+ * The distance (in points) to the destination under which the animation is considered finished.
+ * Defaults to half a point.
+ */
+@property (assign, nonatomic) CGFloat precision;
+
 @end
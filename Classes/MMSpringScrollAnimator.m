@@ -7,23 +7,122 @@
 //
 
 #import "MMSpringScrollAnimator.h"
+#import "MMSnapFrameScheduler.h"
+#import "MMSnapSpring.h"
+#import <QuartzCore/QuartzCore.h>
 
-@interface MMSpringScrollAnimator ()
+static MMSnapFrameSchedulerRef MMSpringScrollAnimatorGetScheduler(void);
 
-@property (weak, nonatomic, readwrite) UIScrollView *scrollView;
+/**
+ *  Drives the scheduler shared by every animator with a single display link, which only exists while something animates.
+ */
+@interface MMSpringScrollAnimatorDisplayLinkTarget : NSObject
 
 @property (strong, nonatomic) CADisplayLink *displayLink;
 
-@property (assign, nonatomic) CGPoint contentOffset;
+@end
+
+@implementation MMSpringScrollAnimatorDisplayLinkTarget
+
+- (void)tick:(CADisplayLink *)displayLink
+{
+    // Step to the time the frame will be displayed, so animations run in real time at any refresh rate.
+    CFTimeInterval timestamp = displayLink.timestamp;
+    if ([displayLink respondsToSelector:@selector(targetTimestamp)]) {
+        timestamp = displayLink.targetTimestamp;
+    }
+    
+    MMSnapFrameSchedulerTick(MMSpringScrollAnimatorGetScheduler(), timestamp);
+}
+
+@end
+
+static void MMSpringScrollAnimatorStartDisplayLink(void *info)
+{
+    MMSpringScrollAnimatorDisplayLinkTarget *target = (__bridge MMSpringScrollAnimatorDisplayLinkTarget *)info;
+    
+    target.displayLink = [CADisplayLink displayLinkWithTarget:target selector:@selector(tick:)];
+    
+    if ([target.displayLink respondsToSelector:@selector(setPreferredFramesPerSecond:)]) {
+        target.displayLink.preferredFramesPerSecond = 0; // The display link will fire at the native cadence of the display hardware.
+    }
+    
+    [target.displayLink addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
+}
+
+static void MMSpringScrollAnimatorStopDisplayLink(void *info)
+{
+    MMSpringScrollAnimatorDisplayLinkTarget *target = (__bridge MMSpringScrollAnimatorDisplayLinkTarget *)info;
+    
+    [target.displayLink invalidate];
+    target.displayLink = nil;
+}
+
+static MMSnapFrameSchedulerRef MMSpringScrollAnimatorGetScheduler(void)
+{
+    static MMSnapFrameSchedulerRef scheduler;
+    static MMSpringScrollAnimatorDisplayLinkTarget *target;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        target = [[MMSpringScrollAnimatorDisplayLinkTarget alloc] init];
+        scheduler = MMSnapFrameSchedulerCreate((MMSnapFrameSchedulerClock){
+            MMSpringScrollAnimatorStartDisplayLink,
+            MMSpringScrollAnimatorStopDisplayLink,
+            (__bridge void *)target
+        });
+    });
+    return scheduler;
+}
+
+@interface MMSpringScrollAnimator () {
+    // One spring per axis, both sharing the parameters and the time base.
+    MMSnapSpring _springX;
+    MMSnapSpring _springY;
+}
+
+@property (weak, nonatomic, readwrite) UIScrollView *scrollView;
+
 @property (assign, nonatomic) CGPoint destinationContentOffset;
 
 @property (assign, nonatomic) CFTimeInterval beginTime;
-@property (assign, nonatomic) CFTimeInterval duration;
+@property (assign, nonatomic, readwrite) NSTimeInterval settleDuration;
+
+// Called by the frame scheduler, which evaluates and applies the animations of every animator.
+- (CGPoint)_contentOffsetAtTime:(CFTimeInterval)time velocity:(CGPoint *)velocity;
+- (void)stopAnimation;
 
 @end
 
 @implementation MMSpringScrollAnimator
 
+static bool MMSpringScrollAnimatorEvaluate(void *info, double time, double *x, double *y)
+{
+    MMSpringScrollAnimator *animator = (__bridge MMSpringScrollAnimator *)info;
+    
+    const CFTimeInterval elapsedTime = time - animator.beginTime;
+    if (elapsedTime >= animator.settleDuration) {
+        *x = animator.destinationContentOffset.x;
+        *y = animator.destinationContentOffset.y;
+        return true;
+    }
+    
+    const CGPoint contentOffset = [animator _contentOffsetAtTime:elapsedTime velocity:NULL];
+    *x = contentOffset.x;
+    *y = contentOffset.y;
+    return false;
+}
+
+static void MMSpringScrollAnimatorApply(void *info, double x, double y, bool finished)
+{
+    MMSpringScrollAnimator *animator = (__bridge MMSpringScrollAnimator *)info;
+    
+    [animator.scrollView setContentOffset:CGPointMake(x, y)];
+    
+    if (finished) {
+        [animator stopAnimation];
+    }
+}
+
 - (instancetype)initWithTargetScrollView:(UIScrollView *)scrollView
 {
     self = [super init];
@@ -33,10 +132,16 @@
         self.mass = 1;
         self.stiffness = 100;
         self.initialVelocity = 0;
+        self.precision = 0.5f;
     }
     return self;
 }
 
+- (void)dealloc
+{
+    MMSnapFrameSchedulerRemoveClient(MMSpringScrollAnimatorGetScheduler(), (__bridge void *)self);
+}
+
 - (id<UIScrollViewDelegate>)delegate
 {
     return _delegate ?: self.scrollView.delegate;
@@ -44,90 +149,88 @@
 
 - (void)animateScrollToContentOffset:(CGPoint)contentOffset duration:(NSTimeInterval)duration
 {
-    self.contentOffset = self.scrollView.contentOffset;
-    self.duration = duration;
-    self.beginTime = 0.0;
+    [self animateScrollToContentOffset:contentOffset];
+}
+
+- (void)animateScrollToContentOffset:(CGPoint)contentOffset
+{
+    if (self.isAnimating) {
+        [self animateScrollToContentOffset:contentOffset initialVelocity:self.velocity];
+        return;
+    }
     
-    if (CGPointEqualToPoint(contentOffset, self.contentOffset)) {
+    // Starting from rest, the initial velocity points towards the destination.
+    const CGPoint from = self.scrollView.contentOffset;
+    const CGFloat distance = hypot(contentOffset.x - from.x, contentOffset.y - from.y);
+    
+    CGPoint velocity = CGPointZero;
+    if (distance > 0.0f) {
+        velocity.x = self.initialVelocity * (contentOffset.x - from.x) / distance;
+        velocity.y = self.initialVelocity * (contentOffset.y - from.y) / distance;
+    }
+    
+    [self animateScrollToContentOffset:contentOffset initialVelocity:velocity];
+}
+
+- (void)animateScrollToContentOffset:(CGPoint)contentOffset initialVelocity:(CGPoint)velocity
+{
+    const CFTimeInterval now = CACurrentMediaTime();
+    
+    // Continue from where the animation in flight is now, the scroll view may still show the previous frame.
+    CGPoint from = self.scrollView.contentOffset;
+    if (self.isAnimating) {
+        from = [self _contentOffsetAtTime:(now - self.beginTime) velocity:NULL];
+    }
+    
+    if (CGPointEqualToPoint(contentOffset, from) && CGPointEqualToPoint(velocity, CGPointZero)) {
         return;
     }
     
+    const MMSnapSpringParameters parameters = { self.mass, self.stiffness, self.damping };
+    const double precision = self.precision;
+    
+    MMSnapSpringStart(&_springX, parameters, from.x, velocity.x, contentOffset.x, precision);
+    MMSnapSpringStart(&_springY, parameters, from.y, velocity.y, contentOffset.y, precision);
+    
     self.destinationContentOffset = contentOffset;
+    self.beginTime = now;
+    self.settleDuration = MAX(MMSnapSpringGetSettleTime(&_springX), MMSnapSpringGetSettleTime(&_springY));
     
-    if (!self.displayLink) {
-        self.displayLink = [CADisplayLink displayLinkWithTarget:self selector:@selector(updateContentOffset:)];
-        
-        if ([self.displayLink respondsToSelector:@selector(setPreferredFramesPerSecond:)]) {
-            self.displayLink.preferredFramesPerSecond = 0; // The display link will fire at the native cadence of the display hardware.
-        }
-        
-        [self.displayLink addToRunLoop:[NSRunLoop currentRunLoop] forMode:NSRunLoopCommonModes];
-    } else {
-        self.displayLink.paused = NO;
+    // Offsets moving by less than half a pixel of the screen are not applied.
+    UIScrollView *scrollView = self.scrollView;
+    const CGFloat scale = scrollView.window.screen.scale ?: [UIScreen mainScreen].scale;
+    
+    const MMSnapFrameSchedulerClient client = { MMSpringScrollAnimatorEvaluate, MMSpringScrollAnimatorApply, (__bridge void *)self };
+    MMSnapFrameSchedulerAddClient(MMSpringScrollAnimatorGetScheduler(), client, scrollView.contentOffset.x, scrollView.contentOffset.y, scale);
+}
+
+- (CGPoint)_contentOffsetAtTime:(CFTimeInterval)time velocity:(CGPoint *)velocity
+{
+    double x, y, velocityX, velocityY;
+    MMSnapSpringEvaluate(&_springX, time, &x, &velocityX);
+    MMSnapSpringEvaluate(&_springY, time, &y, &velocityY);
+    
+    if (velocity) {
+        *velocity = CGPointMake(velocityX, velocityY);
     }
+    return CGPointMake(x, y);
 }
 
-- (void)updateContentOffset:(CADisplayLink *)displayLink
-{
-    if (self.beginTime == 0.0) {
-        self.beginTime = displayLink.timestamp;
-    } else {
-        const CFTimeInterval deltaTime = displayLink.timestamp - self.beginTime;
-        const CGFloat progress = (CGFloat)(deltaTime / self.duration);
-        
-        if (progress < 1.0) {
-            if (1 - progress < 0.001) {
-                [self.scrollView setContentOffset:self.destinationContentOffset];
-                [self stopAnimation];
-            } else {
-                CGFloat b = self.damping;
-                CGFloat m = self.mass;
-                CGFloat k = self.stiffness;
-                CGFloat v0 = self.initialVelocity;
-                
-                CGFloat beta = b / (2.0f * m);
-                CGFloat omega0 = sqrtf(k / m);
-                CGFloat omega1 = sqrtf((omega0 * omega0) - (beta * beta));
-                CGFloat omega2 = sqrtf((beta * beta) - (omega0 * omega0));
-                CGFloat x0 = -1.0f;
-                
-                CGFloat t = progress;
-                CGFloat envelope = expf(-beta * t);
-                CGFloat fraction;
-                
-                if (beta < omega0) {
-                    // Underdamped:
-                    fraction = -x0 + envelope * (x0 * cosf(omega1 * t) + ((beta * x0 + v0) / omega1) * sinf(omega1 * t));
-                } else if (beta == omega0) {
-                    // Critically damped:
-                    fraction = -x0 + envelope * (x0 + (beta * x0 + v0) * t);
-                } else {
-                    // Overdamped:
-                    fraction = -x0 + envelope * (x0 * coshf(omega2 * t) + ((beta * x0 + v0) / omega2) * sinhf(omega2 * t));
-                }
-                
-                const CGPoint from = self.contentOffset;
-                const CGPoint to = self.destinationContentOffset;
-                
-                CGFloat deltaX = to.x - from.x;
-                CGFloat deltaY = to.y - from.y;
-                
-                const CGPoint offset = { from.x + fraction * deltaX, from.y + fraction * deltaY };
-                
-                [self.scrollView setContentOffset:offset];
-            }
-        } else {
-            [self.scrollView setContentOffset:self.destinationContentOffset];
-            [self stopAnimation];
-        }
+- (CGPoint)velocity
+{
+    if (!self.isAnimating) {
+        return CGPointZero;
     }
+    
+    CGPoint velocity;
+    [self _contentOffsetAtTime:(CACurrentMediaTime() - self.beginTime) velocity:&velocity];
+    
+    return velocity;
 }
 
 - (void)stopAnimation
 {
-    self.displayLink.paused = YES;
-    self.beginTime = 0.0f;
-    
+    // The scheduler already removed the animation when it finished.
     id <UIScrollViewDelegate> delegate = self.delegate;
     
     if ([delegate respondsToSelector:@selector(scrollViewDidEndScrollingAnimation:)]) {
@@ -137,15 +240,12 @@
 
 - (void)cancelAnimation
 {
-    self.displayLink.paused = YES;
+    MMSnapFrameSchedulerRemoveClient(MMSpringScrollAnimatorGetScheduler(), (__bridge void *)self);
 }
 
 - (BOOL)isAnimating
 {
-    if (self.displayLink) {
-        return !self.displayLink.isPaused;
-    }
-    return NO;
+    return MMSnapFrameSchedulerContainsClient(MMSpringScrollAnimatorGetScheduler(), (__bridge void *)self);
 }
 
 - (void)setMass:(CGFloat)mass
@@ -0,0 +1,25 @@
+//
+//  MMSnapBenchmarkSupport.h
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapBenchmarkSupport_h
+#define MMSnapBenchmarkSupport_h
+
+#include <stdio.h>
+#include <time.h>
+
+// Monotonic time in nanoseconds.
+static inline double MMBenchmarkNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Keeps the optimizer from discarding benchmarked work.
+static volatile long MMBenchmarkSink;
+
+#endif /* MMSnapBenchmarkSupport_h */
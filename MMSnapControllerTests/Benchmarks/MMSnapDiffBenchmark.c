@@ -0,0 +1,66 @@
+//
+//  MMSnapDiffBenchmark.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapDiff.h"
+#include "MMSnapBenchmarkSupport.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Measures the view controller diff for the shapes setViewControllers: sees in practice: restoring a stack from
+// scratch, popping to the root and pushing a new path, and reordering columns.
+
+static double MMBenchmarkDiff(const void *const *oldItems, long oldCount, const void *const *newItems, long newCount, int iterations)
+{
+    const double start = MMBenchmarkNow();
+    for (int i = 0; i < iterations; i++) {
+        MMSnapDiffResult diff;
+        MMSnapDiffCompute(oldItems, oldCount, newItems, newCount, &diff);
+        MMBenchmarkSink += diff.insertCount + diff.deleteCount + diff.moveCount;
+        MMSnapDiffResultFree(&diff);
+    }
+    return (MMBenchmarkNow() - start) / (double)iterations;
+}
+
+int main(void)
+{
+    const long counts[] = { 10, 300, 3000, 30000 };
+    
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        const long count = counts[c];
+        const int iterations = (int)(3000000 / count);
+        
+        const void **stack = malloc((size_t)count * sizeof(void *));
+        const void **reordered = malloc((size_t)count * sizeof(void *));
+        const void **repushed = malloc((size_t)count * sizeof(void *));
+        
+        for (long i = 0; i < count; i++) {
+            stack[i] = (const void *)(uintptr_t)(0x1000 + i * 16);
+            reordered[i] = stack[i];
+            repushed[i] = (i == 0) ? stack[0] : (const void *)(uintptr_t)(0x100000000ULL + (uintptr_t)i * 16);
+        }
+        
+        // Swap adjacent columns.
+        for (long i = 0; i + 1 < count; i += 2) {
+            reordered[i] = stack[i + 1];
+            reordered[i + 1] = stack[i];
+        }
+        
+        const double restore = MMBenchmarkDiff(NULL, 0, stack, count, iterations);
+        const double reorder = MMBenchmarkDiff(stack, count, reordered, count, iterations);
+        const double repush = MMBenchmarkDiff(stack, count, repushed, count, iterations);
+        
+        printf("controllers=%-6ld restore=%9.2f us  reorder=%9.2f us  pop-and-push=%9.2f us\n",
+               count, restore / 1e3, reorder / 1e3, repush / 1e3);
+        
+        free(stack);
+        free(reordered);
+        free(repushed);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,254 @@
+//
+//  MMSnapHeadlessScrollView.h
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapHeadlessScrollView_h
+#define MMSnapHeadlessScrollView_h
+
+#include "MMSnapDiff.h"
+#include "MMSnapLayoutCore.h"
+#include "MMSnapPageIndex.h"
+#include "MMSnapPageRing.h"
+#include "MMSnapSeparatorTracker.h"
+#include "MMSnapUpdateMap.h"
+#include "MMSnapBenchmarkSupport.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The work MMSnapScrollView and MMSnapController do for reloadData, performBatchUpdates:completion:, view controller
+// changes and every _performLayout pass, on the portable core without UIKit. Shared by the performance suite and the
+// trace replay.
+
+typedef struct {
+    MMSnapPageIndexRef pageIndex;
+    MMSnapUpdateMapRef updateMap;
+    MMSnapPageRingRef visiblePages;
+    MMSnapPageRingRef updatedVisiblePages;
+    MMSnapSeparatorTrackerRef separatorTracker;
+    MMSnapLayout layout;
+    
+    // Stand-ins for the view controllers, one per page.
+    const void **controllers;
+    long controllerCount;
+    long controllerCapacity;
+    
+    // Queried for the widths of invalid pages.
+    MMSnapPageWidthFunction widthForPage;
+    void *widthContext;
+    
+    uintptr_t nextIdentifier;
+} MMHeadlessScrollView;
+
+static inline double MMHeadlessWidthForPage(long page, void *context)
+{
+    (void)context;
+    return (page % 3 == 0) ? 704.0 : 320.0;
+}
+
+static inline const void *MMHeadlessMakeIdentifier(MMHeadlessScrollView *scrollView)
+{
+    // Aligned like object pointers, so the hash tables see realistic keys.
+    scrollView->nextIdentifier += 16;
+    return (const void *)scrollView->nextIdentifier;
+}
+
+static inline void MMHeadlessSetControllerCount(MMHeadlessScrollView *scrollView, long count)
+{
+    if (count > scrollView->controllerCapacity) {
+        scrollView->controllerCapacity = count * 2;
+        scrollView->controllers = realloc(scrollView->controllers, (size_t)scrollView->controllerCapacity * sizeof(void *));
+    }
+    for (long idx = scrollView->controllerCount; idx < count; idx++) {
+        scrollView->controllers[idx] = MMHeadlessMakeIdentifier(scrollView);
+    }
+    scrollView->controllerCount = count;
+}
+
+// Returns the number of pages that scrolled in or out.
+static inline long MMHeadlessPerformLayout(MMHeadlessScrollView *scrollView)
+{
+    MMSnapLayout *layout = &scrollView->layout;
+    MMSnapPageRingRef visiblePages = scrollView->visiblePages;
+    
+    if (MMSnapPageIndexNeedsValidation(scrollView->pageIndex)) {
+        MMSnapPageIndexValidate(scrollView->pageIndex, scrollView->widthForPage, scrollView->widthContext);
+    }
+    
+    long churn = 0;
+    
+    const MMSnapPageRange range = MMSnapLayoutGetVisiblePages(layout);
+    const long end = range.location + range.length;
+    
+    // Remove the pages that scrolled out.
+    const long first = MMSnapPageRingGetFirstPage(visiblePages);
+    const long last = first + MMSnapPageRingGetPageCount(visiblePages);
+    
+    for (long page = first; page < last; page++) {
+        if (range.length == 0 || page < range.location || page >= end) {
+            churn += (MMSnapPageRingGetElement(visiblePages, page, MMSnapPageRingElementView) != NULL);
+            MMSnapPageRingSetElement(visiblePages, page, MMSnapPageRingElementView, NULL);
+            MMSnapPageRingSetElement(visiblePages, page, MMSnapPageRingElementSeparator, NULL);
+        }
+    }
+    
+    // Insert the pages that scrolled in and lay out every visible page.
+    MMSnapSeparatorTrackerRef separatorTracker = scrollView->separatorTracker;
+    MMSnapSeparatorTrackerUpdate(separatorTracker, layout, range, MMSnapPageIndexGetCount(scrollView->pageIndex), true);
+    
+    for (long page = range.location; page < end; page++) {
+        if (!MMSnapPageRingGetElement(visiblePages, page, MMSnapPageRingElementView)) {
+            churn++;
+            MMSnapPageRingSetElement(visiblePages, page, MMSnapPageRingElementView, scrollView->controllers[page]);
+        }
+        if (!MMSnapPageRingGetElement(visiblePages, page, MMSnapPageRingElementSeparator)) {
+            MMSnapPageRingSetElement(visiblePages, page, MMSnapPageRingElementSeparator, MMHeadlessMakeIdentifier(scrollView));
+        }
+        
+        const MMSnapLayoutRect rect = MMSnapSeparatorTrackerGetPageRect(separatorTracker, page);
+        MMBenchmarkSink += (long)rect.x;
+    }
+    
+    // Only the separators that changed are touched.
+    for (long page = range.location; page < end; page++) {
+        const void *separator = MMSnapPageRingGetElement(visiblePages, page, MMSnapPageRingElementSeparator);
+        if (MMSnapSeparatorTrackerApplySeparator(separatorTracker, page, separator) != MMSnapSeparatorChangeNone) {
+            const MMSnapSeparatorState *state = MMSnapSeparatorTrackerGetState(separatorTracker, page);
+            MMBenchmarkSink += (long)(state->rect.x + state->percentDisappeared);
+        }
+    }
+    
+    return churn;
+}
+
+// Returns the number of pages that appeared or disappeared.
+static inline long MMHeadlessReloadData(MMHeadlessScrollView *scrollView)
+{
+    const long churn = MMSnapPageRingGetPageCount(scrollView->visiblePages);
+    MMSnapPageRingRemoveAllElements(scrollView->visiblePages);
+    
+    MMSnapPageIndexRemoveAllPages(scrollView->pageIndex);
+    MMSnapPageIndexInsertPages(scrollView->pageIndex, 0, scrollView->controllerCount);
+    
+    return churn + MMHeadlessPerformLayout(scrollView);
+}
+
+// Returns the number of visible pages that were removed, scrolled in or scrolled out.
+static inline long MMHeadlessEndUpdates(MMHeadlessScrollView *scrollView)
+{
+    MMSnapUpdateMapRef updateMap = scrollView->updateMap;
+    MMSnapPageIndexRef pageIndex = scrollView->pageIndex;
+    
+    if (!MMSnapUpdateMapPrepare(updateMap)) {
+        fprintf(stderr, "conflicting updates\n");
+        exit(2);
+    }
+    
+    long removedCount = 0, addedCount = 0, reloadedCount = 0;
+    const long *removedPages = MMSnapUpdateMapGetRemovedPages(updateMap, &removedCount);
+    const long *addedPages = MMSnapUpdateMapGetAddedPages(updateMap, &addedCount);
+    const long *reloadedPages = MMSnapUpdateMapGetReloadedPages(updateMap, &reloadedCount);
+    
+    MMSnapPageIndexRemovePagesAtIndexes(pageIndex, removedPages, removedCount);
+    MMSnapPageIndexInsertPagesAtIndexes(pageIndex, addedPages, addedCount);
+    
+    for (long idx = 0; idx < reloadedCount; idx++) {
+        MMSnapPageIndexInvalidatePage(pageIndex, MMSnapUpdateMapGetFinalPage(updateMap, reloadedPages[idx]));
+    }
+    
+    MMSnapPageIndexValidate(pageIndex, scrollView->widthForPage, scrollView->widthContext);
+    
+    long churn = 0;
+    
+    // Remap the visible pages.
+    MMSnapPageRingRef visiblePages = scrollView->visiblePages;
+    MMSnapPageRingRef updatedVisiblePages = scrollView->updatedVisiblePages;
+    
+    const long first = MMSnapPageRingGetFirstPage(visiblePages);
+    const long last = first + MMSnapPageRingGetPageCount(visiblePages);
+    
+    for (long page = first; page < last; page++) {
+        const long finalPage = MMSnapUpdateMapGetFinalPage(updateMap, page);
+        if (finalPage != MMSnapPageNotFound) {
+            MMSnapPageRingSetElement(updatedVisiblePages, finalPage, MMSnapPageRingElementView, MMSnapPageRingGetElement(visiblePages, page, MMSnapPageRingElementView));
+            MMSnapPageRingSetElement(updatedVisiblePages, finalPage, MMSnapPageRingElementSeparator, MMSnapPageRingGetElement(visiblePages, page, MMSnapPageRingElementSeparator));
+        } else {
+            churn += (MMSnapPageRingGetElement(visiblePages, page, MMSnapPageRingElementView) != NULL);
+        }
+    }
+    MMSnapPageRingRemoveAllElements(visiblePages);
+    
+    scrollView->visiblePages = updatedVisiblePages;
+    scrollView->updatedVisiblePages = visiblePages;
+    
+    MMSnapUpdateMapRemoveAllUpdates(updateMap);
+    
+    return churn + MMHeadlessPerformLayout(scrollView);
+}
+
+// Applies the difference between the current controllers and new ones, like -[MMSnapController setViewControllers:].
+static inline void MMHeadlessSetControllers(MMHeadlessScrollView *scrollView, const void **controllers, long count)
+{
+    MMSnapDiffResult diff;
+    if (!MMSnapDiffCompute(scrollView->controllers, scrollView->controllerCount, controllers, count, &diff)) {
+        fprintf(stderr, "diff failed\n");
+        exit(2);
+    }
+    
+    for (long idx = 0; idx < diff.deleteCount; idx++) {
+        MMSnapUpdateMapDeletePage(scrollView->updateMap, diff.deletes[idx]);
+    }
+    for (long idx = 0; idx < diff.insertCount; idx++) {
+        MMSnapUpdateMapInsertPage(scrollView->updateMap, diff.inserts[idx]);
+    }
+    for (long idx = 0; idx < diff.moveCount; idx++) {
+        MMSnapUpdateMapMovePage(scrollView->updateMap, diff.moves[idx].from, diff.moves[idx].to);
+    }
+    MMSnapDiffResultFree(&diff);
+    
+    if (count > scrollView->controllerCapacity) {
+        scrollView->controllerCapacity = count * 2;
+        scrollView->controllers = realloc(scrollView->controllers, (size_t)scrollView->controllerCapacity * sizeof(void *));
+    }
+    memcpy(scrollView->controllers, controllers, (size_t)count * sizeof(void *));
+    scrollView->controllerCount = count;
+    
+    MMHeadlessEndUpdates(scrollView);
+}
+
+static inline void MMHeadlessInit(MMHeadlessScrollView *scrollView, long pageCount)
+{
+    memset(scrollView, 0, sizeof(MMHeadlessScrollView));
+    
+    scrollView->pageIndex = MMSnapPageIndexCreate();
+    scrollView->updateMap = MMSnapUpdateMapCreate();
+    scrollView->visiblePages = MMSnapPageRingCreate(NULL);
+    scrollView->updatedVisiblePages = MMSnapPageRingCreate(NULL);
+    scrollView->separatorTracker = MMSnapSeparatorTrackerCreate();
+    scrollView->layout = (MMSnapLayout){
+        .pageIndex = scrollView->pageIndex,
+        .bounds = { 0.0, 0.0, 1024.0, 768.0 },
+        .pageHeight = 768.0,
+        .separatorWidth = 10.0
+    };
+    scrollView->widthForPage = MMHeadlessWidthForPage;
+    
+    MMHeadlessSetControllerCount(scrollView, pageCount);
+    MMHeadlessReloadData(scrollView);
+}
+
+static inline void MMHeadlessDestroy(MMHeadlessScrollView *scrollView)
+{
+    MMSnapPageIndexRelease(scrollView->pageIndex);
+    MMSnapUpdateMapRelease(scrollView->updateMap);
+    MMSnapPageRingRelease(scrollView->visiblePages);
+    MMSnapPageRingRelease(scrollView->updatedVisiblePages);
+    MMSnapSeparatorTrackerRelease(scrollView->separatorTracker);
+    free(scrollView->controllers);
+}
+
+#endif /* MMSnapHeadlessScrollView_h */
@@ -0,0 +1,69 @@
+//
+//  MMSnapInstrumentationBenchmark.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapInstrumentation.h"
+#include "MMSnapBenchmarkSupport.h"
+
+// Measures the cost of a probe around a phase: with instrumentation enabled it reads the clock twice and updates a
+// histogram, and with it disabled at runtime it should cost about as much as the empty loop.
+
+static long MMWork(long value)
+{
+    return value * 2654435761L;
+}
+
+int main(void)
+{
+    const long iterations = 10000000;
+    
+    MMSnapInstrumentationRef instrumentation = MMSnapInstrumentationCreate();
+    MMSnapInstrumentationRef volatile enabled = instrumentation;
+    MMSnapInstrumentationRef volatile disabled = NULL;
+    
+    double start = MMBenchmarkNow();
+    for (long idx = 0; idx < iterations; idx++) {
+        MMBenchmarkSink += MMWork(idx);
+    }
+    const double baseline = (MMBenchmarkNow() - start) / (double)iterations;
+    
+    start = MMBenchmarkNow();
+    for (long idx = 0; idx < iterations; idx++) {
+        MMSnapInstrumentationRef probe = disabled;
+        const uint64_t startTime = MMSnapInstrumentationBegin(probe);
+        MMBenchmarkSink += MMWork(idx);
+        MMSnapInstrumentationEnd(probe, MMSnapInstrumentationPhaseViewRequest, startTime);
+    }
+    const double disabledCost = (MMBenchmarkNow() - start) / (double)iterations;
+    
+    start = MMBenchmarkNow();
+    for (long idx = 0; idx < iterations; idx++) {
+        MMSnapInstrumentationRef probe = enabled;
+        const uint64_t startTime = MMSnapInstrumentationBegin(probe);
+        MMBenchmarkSink += MMWork(idx);
+        MMSnapInstrumentationEnd(probe, MMSnapInstrumentationPhaseViewRequest, startTime);
+    }
+    const double enabledCost = (MMBenchmarkNow() - start) / (double)iterations;
+    
+    start = MMBenchmarkNow();
+    for (long idx = 0; idx < iterations; idx++) {
+        MMSnapInstrumentationRecord(instrumentation, MMSnapInstrumentationPhaseViewRequest, (uint64_t)idx & 0xffff);
+    }
+    const double recordCost = (MMBenchmarkNow() - start) / (double)iterations;
+    
+    printf("loop=%6.2f ns  disabled probe=%+6.2f ns  enabled probe=%+6.2f ns  record=%6.2f ns\n",
+           baseline, disabledCost - baseline, enabledCost - baseline, recordCost);
+    
+    MMSnapInstrumentationStatistics statistics;
+    MMSnapInstrumentationGetStatistics(instrumentation, MMSnapInstrumentationPhaseViewRequest, &statistics);
+    printf("samples=%llu p50=%llu ns p99=%llu ns\n", (unsigned long long)statistics.count,
+           (unsigned long long)MMSnapInstrumentationStatisticsGetPercentile(&statistics, 0.5),
+           (unsigned long long)MMSnapInstrumentationStatisticsGetPercentile(&statistics, 0.99));
+    
+    MMSnapInstrumentationRelease(instrumentation);
+    
+    return 0;
+}
@@ -0,0 +1,103 @@
+//
+//  MMSnapLRUCacheBenchmark.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapLRUCache.h"
+#include "MMSnapBenchmarkSupport.h"
+
+#include <string.h>
+
+// Replays the measurements of the headers of a snap controller: every layout pass measures the title, subtitle and
+// back button of the visible columns, scrolling brings new columns in, and rotating changes the constraining width.
+// Reports the cost of a lookup and the hit rate for a few cache capacities.
+
+typedef struct {
+    char text[24];
+    double width;
+} MMMeasurementKey;
+
+static unsigned long MMMeasurementKeyHash(const void *key)
+{
+    const MMMeasurementKey *measurementKey = key;
+    
+    unsigned long hash = 5381;
+    for (const char *c = measurementKey->text; *c; c++) {
+        hash = hash * 33 + (unsigned char)*c;
+    }
+    return hash ^ (unsigned long)(measurementKey->width * 64.0);
+}
+
+static bool MMMeasurementKeyEqual(const void *key, const void *otherKey)
+{
+    const MMMeasurementKey *a = key, *b = otherKey;
+    return a->width == b->width && strcmp(a->text, b->text) == 0;
+}
+
+int main(void)
+{
+    const long capacities[] = { 16, 64, 256, 1024 };
+    const long columnCount = 400;
+    const long visibleColumnCount = 3;
+    const long passes = 200000;
+    
+    // Keys must outlive the cache, since they are not retained.
+    static MMMeasurementKey keys[2][400][3];
+    for (long orientation = 0; orientation < 2; orientation++) {
+        for (long column = 0; column < columnCount; column++) {
+            for (long element = 0; element < 3; element++) {
+                MMMeasurementKey *key = &keys[orientation][column][element];
+                snprintf(key->text, sizeof(key->text), "%s %ld", (element == 0) ? "Title" : (element == 1) ? "Subtitle" : "Back", column);
+                key->width = (orientation == 0) ? 304.0 : 488.0;
+            }
+        }
+    }
+    
+    const MMSnapLRUCacheKeyCallbacks callbacks = { NULL, NULL, MMMeasurementKeyHash, MMMeasurementKeyEqual };
+    
+    for (size_t i = 0; i < sizeof(capacities) / sizeof(capacities[0]); i++) {
+        MMSnapLRUCacheRef cache = MMSnapLRUCacheCreate(&callbacks, sizeof(double) * 2, capacities[i]);
+        
+        long firstColumn = 0;
+        long direction = 1;
+        long lookups = 0;
+        
+        const double start = MMBenchmarkNow();
+        for (long pass = 0; pass < passes; pass++) {
+            // Scroll a column every 20 passes, back and forth, and rotate every 5000 passes.
+            if (pass % 20 == 0) {
+                firstColumn += direction;
+                if (firstColumn <= 0 || firstColumn + visibleColumnCount >= columnCount) {
+                    direction = -direction;
+                }
+            }
+            const long orientation = (pass / 5000) % 2;
+            
+            for (long column = firstColumn; column < firstColumn + visibleColumnCount; column++) {
+                for (long element = 0; element < 3; element++) {
+                    const MMMeasurementKey *key = &keys[orientation][column][element];
+                    
+                    double size[2];
+                    if (!MMSnapLRUCacheGetValue(cache, key, size)) {
+                        size[0] = (double)strlen(key->text) * 8.0;
+                        size[1] = 20.0;
+                        MMSnapLRUCacheSetValue(cache, key, size);
+                    }
+                    MMBenchmarkSink += (long)size[0];
+                    lookups++;
+                }
+            }
+        }
+        const double cost = (MMBenchmarkNow() - start) / (double)lookups;
+        
+        const MMSnapLRUCacheStatistics statistics = MMSnapLRUCacheGetStatistics(cache);
+        printf("capacity=%-5ld lookup=%6.2f ns  hit rate=%6.2f%%  evictions=%lu\n",
+               capacities[i], cost, MMSnapLRUCacheGetHitRate(cache) * 100.0, statistics.evictionCount);
+        
+        MMSnapLRUCacheRelease(cache);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,66 @@
+//
+//  MMSnapLayoutCoreBenchmark.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapLayoutCore.h"
+#include "MMSnapBenchmarkSupport.h"
+
+// Measures a full layout pass (visible range, parallax rects and separators of the visible pages) and snap targeting,
+// as MMSnapScrollView runs them on every frame and at the end of every drag, against page counts up to 1M.
+
+int main(void)
+{
+    const long pageCounts[] = { 1000, 10000, 100000, 1000000 };
+    const int frames = 1000000;
+    
+    for (size_t i = 0; i < sizeof(pageCounts) / sizeof(pageCounts[0]); i++) {
+        const long count = pageCounts[i];
+        
+        MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+        for (long page = 0; page < count; page++) {
+            MMSnapPageIndexAppendPage(pageIndex, (page % 3 == 0) ? 704.0 : 320.0);
+        }
+        
+        MMSnapLayout layout = {
+            .pageIndex = pageIndex,
+            .bounds = { 0.0, 0.0, 1024.0, 768.0 },
+            .pageHeight = 768.0,
+            .separatorWidth = 10.0
+        };
+        
+        const double contentWidth = MMSnapPageIndexGetContentWidth(pageIndex) - layout.bounds.width;
+        
+        unsigned int seed = 7;
+        double start = MMBenchmarkNow();
+        for (int frame = 0; frame < frames; frame++) {
+            seed = seed * 1664525u + 1013904223u;
+            layout.bounds.x = (double)seed / 4294967296.0 * contentWidth;
+            
+            const MMSnapPageRange range = MMSnapLayoutGetVisiblePages(&layout);
+            for (long page = range.location; page < range.location + range.length; page++) {
+                double percent = 0.0;
+                const MMSnapLayoutRect rect = MMSnapLayoutGetPageRect(&layout, page, &percent);
+                const MMSnapLayoutRect separator = MMSnapLayoutGetSeparatorRect(&layout, MMSnapLayoutGetPageRect(&layout, page + 1, NULL));
+                MMBenchmarkSink += (long)(rect.x + separator.x + percent);
+            }
+        }
+        const double layoutCost = (MMBenchmarkNow() - start) / (double)frames;
+        
+        start = MMBenchmarkNow();
+        for (int drag = 0; drag < frames; drag++) {
+            seed = seed * 1664525u + 1013904223u;
+            const double proposed = (double)seed / 4294967296.0 * contentWidth;
+            MMBenchmarkSink += (long)MMSnapLayoutGetTargetContentOffsetX(&layout, proposed, (drag % 3) - 1.0);
+        }
+        const double snapCost = (MMBenchmarkNow() - start) / (double)frames;
+        
+        printf("pages=%-8ld layout pass=%8.2f ns  snap target=%7.2f ns\n", count, layoutCost, snapCost);
+        
+        MMSnapPageIndexRelease(pageIndex);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,58 @@
+//
+//  MMSnapPageIndexBenchmark.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapPageIndex.h"
+#include "MMSnapBenchmarkSupport.h"
+
+#include <math.h>
+
+// Measures visible-range queries against page counts up to 1M. With a binary search, the cost per query should grow
+// with log(n): going from 1K to 1M pages should roughly double it, not multiply it by a thousand.
+
+int main(void)
+{
+    const long pageCounts[] = { 1000, 10000, 100000, 1000000 };
+    const int queries = 1000000;
+    const double viewportWidth = 1024.0;
+    
+    double firstCost = 0.0;
+    
+    for (size_t i = 0; i < sizeof(pageCounts) / sizeof(pageCounts[0]); i++) {
+        const long count = pageCounts[i];
+        
+        MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+        
+        double start = MMBenchmarkNow();
+        for (long page = 0; page < count; page++) {
+            MMSnapPageIndexAppendPage(pageIndex, (page % 3 == 0) ? 704.0 : 320.0);
+        }
+        const double buildCost = (MMBenchmarkNow() - start) / (double)count;
+        
+        const double contentWidth = MMSnapPageIndexGetContentWidth(pageIndex);
+        
+        unsigned int seed = 7;
+        start = MMBenchmarkNow();
+        for (int q = 0; q < queries; q++) {
+            seed = seed * 1664525u + 1013904223u;
+            const double minX = (double)seed / 4294967296.0 * contentWidth;
+            const MMSnapPageRange range = MMSnapPageIndexGetPagesInRange(pageIndex, minX, minX + viewportWidth);
+            MMBenchmarkSink += range.location + range.length;
+        }
+        const double queryCost = (MMBenchmarkNow() - start) / (double)queries;
+        
+        if (i == 0) {
+            firstCost = queryCost;
+        }
+        
+        printf("pages=%-8ld build=%6.2f ns/page  query=%7.2f ns  relative=%5.2fx  log2(n)=%5.2f\n",
+               count, buildCost, queryCost, queryCost / firstCost, log2((double)count));
+        
+        MMSnapPageIndexRelease(pageIndex);
+    }
+    
+    return 0;
+}
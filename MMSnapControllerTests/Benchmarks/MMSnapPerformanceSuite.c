@@ -0,0 +1,343 @@
+//
+//  MMSnapPerformanceSuite.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapHeadlessScrollView.h"
+#include "MMSnapBenchmarkSupport.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Runs the work MMSnapScrollView and MMSnapController do for reloadData, performBatchUpdates:completion:,
+// pushViewController:animated:, popToViewController:animated: and every _performLayout pass, on a headless scroll view
+// built from the portable core, sweeping page counts, batch sizes and scroll-offset sequences.
+//
+// Results are written as JSON, one result per line, and can be compared against a baseline written by a previous run:
+//
+//     MMSnapPerformanceSuite [--quick] [--json results.json] [--baseline baseline.json] [--threshold 0.25]
+//
+// The process exits with a non-zero status if any result is slower than its baseline by more than the threshold.
+
+// Scenarios. Each one performs a single operation and returns the nanoseconds spent in the measured part.
+
+static unsigned int MMSuiteSeed = 11;
+
+static inline long MMSuiteRandom(long bound)
+{
+    MMSuiteSeed = MMSuiteSeed * 1103515245u + 12345u;
+    return (long)((MMSuiteSeed >> 8) % (unsigned int)bound);
+}
+
+typedef double (*MMSuiteScenario)(MMHeadlessScrollView *scrollView, long batch, long step);
+
+static double MMSuiteReloadData(MMHeadlessScrollView *scrollView, long batch, long step)
+{
+    (void)batch;
+    (void)step;
+    
+    const double start = MMBenchmarkNow();
+    MMHeadlessReloadData(scrollView);
+    return MMBenchmarkNow() - start;
+}
+
+static double MMSuiteBatchUpdates(MMHeadlessScrollView *scrollView, long batch, long step)
+{
+    (void)step;
+    
+    // Delete and insert the same number of scattered pages, so the page count stays the same between operations.
+    const long pageCount = scrollView->controllerCount;
+    const long count = (batch < pageCount) ? batch : pageCount;
+    const long stride = pageCount / count;
+    
+    const double start = MMBenchmarkNow();
+    for (long idx = 0; idx < count; idx++) {
+        const long page = idx * stride + MMSuiteRandom(stride);
+        MMSnapUpdateMapDeletePage(scrollView->updateMap, page);
+        MMSnapUpdateMapInsertPage(scrollView->updateMap, page);
+    }
+    MMHeadlessEndUpdates(scrollView);
+    return MMBenchmarkNow() - start;
+}
+
+static double MMSuitePush(MMHeadlessScrollView *scrollView, long batch, long step)
+{
+    (void)step;
+    
+    const long count = scrollView->controllerCount;
+    const void **controllers = malloc((size_t)(count + batch) * sizeof(void *));
+    memcpy(controllers, scrollView->controllers, (size_t)count * sizeof(void *));
+    for (long idx = 0; idx < batch; idx++) {
+        controllers[count + idx] = MMHeadlessMakeIdentifier(scrollView);
+    }
+    
+    const double start = MMBenchmarkNow();
+    MMHeadlessSetControllers(scrollView, controllers, count + batch);
+    const double elapsed = MMBenchmarkNow() - start;
+    
+    // Pop them back, outside the measurement.
+    MMHeadlessSetControllers(scrollView, controllers, count);
+    free(controllers);
+    
+    return elapsed;
+}
+
+static double MMSuitePopTo(MMHeadlessScrollView *scrollView, long batch, long step)
+{
+    (void)step;
+    
+    const long count = scrollView->controllerCount;
+    const long remaining = (count > batch) ? count - batch : 1;
+    
+    const void **controllers = malloc((size_t)count * sizeof(void *));
+    memcpy(controllers, scrollView->controllers, (size_t)count * sizeof(void *));
+    
+    const double start = MMBenchmarkNow();
+    MMHeadlessSetControllers(scrollView, controllers, remaining);
+    const double elapsed = MMBenchmarkNow() - start;
+    
+    // Push them back, outside the measurement.
+    MMHeadlessSetControllers(scrollView, controllers, count);
+    free(controllers);
+    
+    return elapsed;
+}
+
+static double MMSuiteContentOffsetForSequence(MMHeadlessScrollView *scrollView, long sequence, long step)
+{
+    const double maximum = MMSnapPageIndexGetContentWidth(scrollView->pageIndex) - scrollView->layout.bounds.width;
+    if (maximum <= 0.0) {
+        return 0.0;
+    }
+    
+    switch (sequence) {
+        case 0: {
+            // Dragging slowly, a few points per frame.
+            const double offset = fmod(step * 6.0, 2.0 * maximum);
+            return (offset > maximum) ? 2.0 * maximum - offset : offset;
+        }
+        case 1: {
+            // Repeated flings decelerating over a second.
+            const long frame = step % 60;
+            const double distance = 2400.0 * (1.0 - pow(0.9, (double)frame));
+            const double origin = fmod((double)(step / 60) * 2400.0, maximum);
+            return fmin(origin + distance, maximum);
+        }
+        default:
+            // Jumps, like scrolling to random pages.
+            return (double)MMSuiteRandom((long)maximum + 1);
+    }
+}
+
+static double MMSuiteScroll(MMHeadlessScrollView *scrollView, long sequence, long step)
+{
+    scrollView->layout.bounds.x = MMSuiteContentOffsetForSequence(scrollView, sequence, step);
+    
+    const double start = MMBenchmarkNow();
+    MMHeadlessPerformLayout(scrollView);
+    return MMBenchmarkNow() - start;
+}
+
+// Runner.
+
+typedef struct {
+    char name[64];
+    long pages;
+    long batch;
+    double nanosecondsPerOperation;
+} MMSuiteResult;
+
+static double MMSuiteMeasure(MMSuiteScenario scenario, long pages, long batch, bool quick)
+{
+    MMHeadlessScrollView scrollView;
+    MMHeadlessInit(&scrollView, pages);
+    
+    // The best of a few samples, each running for a minimum time, is stable enough to compare between runs.
+    const int sampleCount = quick ? 1 : 5;
+    const double minimumSampleTime = quick ? 1e5 : 5e6;
+    const long minimumOperations = quick ? 1 : 20;
+    
+    double best = INFINITY;
+    long step = 0;
+    
+    for (int sample = 0; sample < sampleCount; sample++) {
+        double elapsed = 0.0;
+        long operations = 0;
+        
+        while (elapsed < minimumSampleTime || operations < minimumOperations) {
+            elapsed += scenario(&scrollView, batch, step++);
+            operations++;
+        }
+        
+        const double perOperation = elapsed / (double)operations;
+        if (perOperation < best) {
+            best = perOperation;
+        }
+    }
+    
+    MMHeadlessDestroy(&scrollView);
+    
+    return best;
+}
+
+static bool MMSuiteWriteResults(FILE *file, const MMSuiteResult *results, long count)
+{
+    fprintf(file, "{\n  \"suite\": \"MMSnapPerformanceSuite\",\n  \"unit\": \"ns\",\n  \"results\": [\n");
+    for (long idx = 0; idx < count; idx++) {
+        fprintf(file, "    {\"name\": \"%s\", \"pages\": %ld, \"batch\": %ld, \"ns_per_op\": %.1f}%s\n",
+                results[idx].name, results[idx].pages, results[idx].batch, results[idx].nanosecondsPerOperation, (idx + 1 < count) ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    
+    return !ferror(file);
+}
+
+// Reads a file written by MMSuiteWriteResults. Returns the number of results, or -1 if the file can't be read.
+static long MMSuiteReadResults(const char *path, MMSuiteResult *results, long capacity)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+    
+    long count = 0;
+    char line[512];
+    
+    while (count < capacity && fgets(line, sizeof(line), file)) {
+        MMSuiteResult result;
+        if (sscanf(line, " {\"name\": \"%63[^\"]\", \"pages\": %ld, \"batch\": %ld, \"ns_per_op\": %lf}",
+                   result.name, &result.pages, &result.batch, &result.nanosecondsPerOperation) == 4) {
+            results[count++] = result;
+        }
+    }
+    fclose(file);
+    
+    return count;
+}
+
+enum { MMSuiteResultCapacity = 256 };
+
+int main(int argc, const char *argv[])
+{
+    const char *jsonPath = NULL;
+    const char *baselinePath = NULL;
+    double threshold = 0.25;
+    bool quick = false;
+    
+    for (int idx = 1; idx < argc; idx++) {
+        if (strcmp(argv[idx], "--json") == 0 && idx + 1 < argc) {
+            jsonPath = argv[++idx];
+        } else if (strcmp(argv[idx], "--baseline") == 0 && idx + 1 < argc) {
+            baselinePath = argv[++idx];
+        } else if (strcmp(argv[idx], "--threshold") == 0 && idx + 1 < argc) {
+            threshold = atof(argv[++idx]);
+        } else if (strcmp(argv[idx], "--quick") == 0) {
+            quick = true;
+        } else {
+            fprintf(stderr, "usage: %s [--quick] [--json results.json] [--baseline baseline.json] [--threshold 0.25]\n", argv[0]);
+            return 2;
+        }
+    }
+    
+    static const long pageCounts[] = { 10, 100, 1000, 10000, 100000 };
+    static const long batchSizes[] = { 1, 10, 100 };
+    static const long noBatch[] = { 0 };
+    static const long singleBatch[] = { 1 };
+    
+    // The batch of the layout scenario selects the scroll-offset sequence: dragging, flinging and jumping.
+    static const long scrollSequences[] = { 0, 1, 2 };
+    
+    static const struct {
+        const char *name;
+        MMSuiteScenario scenario;
+        const long *batches;
+        long batchCount;
+    } scenarios[] = {
+        { "reloadData", MMSuiteReloadData, noBatch, 1 },
+        { "performBatchUpdates", MMSuiteBatchUpdates, batchSizes, 3 },
+        { "pushViewController", MMSuitePush, singleBatch, 1 },
+        { "popToViewController", MMSuitePopTo, batchSizes, 3 },
+        { "performLayout", MMSuiteScroll, scrollSequences, 3 },
+    };
+    
+    MMSuiteResult *results = calloc(MMSuiteResultCapacity, sizeof(MMSuiteResult));
+    long resultCount = 0;
+    
+    for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+        for (size_t p = 0; p < sizeof(pageCounts) / sizeof(pageCounts[0]); p++) {
+            for (long b = 0; b < scenarios[s].batchCount; b++) {
+                MMSuiteResult *result = &results[resultCount++];
+                
+                snprintf(result->name, sizeof(result->name), "%s", scenarios[s].name);
+                result->pages = pageCounts[p];
+                result->batch = scenarios[s].batches[b];
+                result->nanosecondsPerOperation = MMSuiteMeasure(scenarios[s].scenario, result->pages, result->batch, quick);
+                
+                fprintf(stderr, "%-22s pages=%-7ld batch=%-4ld %12.1f ns/op\n", result->name, result->pages, result->batch, result->nanosecondsPerOperation);
+            }
+        }
+    }
+    
+    // Emit the results.
+    FILE *file = jsonPath ? fopen(jsonPath, "w") : stdout;
+    if (!file || !MMSuiteWriteResults(file, results, resultCount)) {
+        fprintf(stderr, "could not write %s\n", jsonPath ? jsonPath : "results");
+        return 2;
+    }
+    if (file != stdout) {
+        fclose(file);
+    }
+    
+    // Compare with the baseline. Sub-microsecond operations get an absolute allowance on top of the threshold, since
+    // a few nanoseconds of timer noise are a large fraction of them.
+    int status = 0;
+    
+    if (baselinePath) {
+        MMSuiteResult *baseline = calloc(MMSuiteResultCapacity, sizeof(MMSuiteResult));
+        const long baselineCount = MMSuiteReadResults(baselinePath, baseline, MMSuiteResultCapacity);
+        
+        if (baselineCount < 0) {
+            fprintf(stderr, "could not read baseline %s\n", baselinePath);
+            status = 2;
+        }
+        
+        long comparedCount = 0;
+        long regressionCount = 0;
+        
+        for (long idx = 0; idx < resultCount; idx++) {
+            for (long b = 0; b < baselineCount; b++) {
+                if (strcmp(results[idx].name, baseline[b].name) != 0 || results[idx].pages != baseline[b].pages || results[idx].batch != baseline[b].batch) {
+                    continue;
+                }
+                
+                const double expected = baseline[b].nanosecondsPerOperation;
+                const double allowed = expected * (1.0 + threshold) + 50.0;
+                
+                comparedCount++;
+                
+                if (results[idx].nanosecondsPerOperation > allowed) {
+                    regressionCount++;
+                    fprintf(stderr, "regression: %s pages=%ld batch=%ld %.1f ns/op, baseline %.1f ns/op (%+.0f%%)\n",
+                            results[idx].name, results[idx].pages, results[idx].batch, results[idx].nanosecondsPerOperation, expected,
+                            (results[idx].nanosecondsPerOperation / expected - 1.0) * 100.0);
+                }
+                break;
+            }
+        }
+        
+        fprintf(stderr, "compared %ld results against %s: %ld regressions over %.0f%%\n", comparedCount, baselinePath, regressionCount, threshold * 100.0);
+        
+        if (regressionCount > 0 || (baselineCount >= 0 && comparedCount == 0)) {
+            status = 1;
+        }
+        free(baseline);
+    }
+    
+    free(results);
+    
+    return status;
+}
@@ -0,0 +1,61 @@
+//
+//  MMSnapToolbarLayoutBenchmark.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapToolbarLayout.h"
+#include "MMSnapBenchmarkSupport.h"
+
+#include <stdlib.h>
+
+// Measures the toolbar solver MMSnapFooterView runs on every layout pass, against toolbars that fit entirely and toolbars
+// that are truncated, with a flexible space between every few items.
+
+int main(void)
+{
+    const long itemCounts[] = { 4, 16, 64, 256, 1024 };
+    const long passes = 4000000;
+    
+    for (size_t i = 0; i < sizeof(itemCounts) / sizeof(itemCounts[0]); i++) {
+        const long count = itemCounts[i];
+        
+        MMSnapToolbarItem *items = malloc((size_t)count * sizeof(MMSnapToolbarItem));
+        MMSnapLayoutRect *frames = malloc((size_t)count * sizeof(MMSnapLayoutRect));
+        
+        for (long idx = 0; idx < count; idx++) {
+            if (idx % 4 == 3) {
+                items[idx] = (MMSnapToolbarItem){ MMSnapToolbarItemKindFlexibleSpace, 0.0, 0.0 };
+            } else if (idx % 4 == 2) {
+                items[idx] = (MMSnapToolbarItem){ MMSnapToolbarItemKindFixedSpace, 20.0, 0.0 };
+            } else {
+                items[idx] = (MMSnapToolbarItem){ MMSnapToolbarItemKindView, 24.0 + (double)(idx % 5) * 6.0, 30.0 };
+            }
+        }
+        
+        // Wide enough for every item, then a phone-sized toolbar.
+        const MMSnapToolbarMetrics fitting = { 8.0, (double)count * 64.0, 44.0, 8.0 };
+        const MMSnapToolbarMetrics truncated = { 8.0, 359.0, 44.0, 8.0 };
+        const long iterations = passes / count;
+        
+        double start = MMBenchmarkNow();
+        for (long pass = 0; pass < iterations; pass++) {
+            MMBenchmarkSink += MMSnapToolbarLayoutSolve(items, count, fitting, frames);
+        }
+        const double fittingCost = (MMBenchmarkNow() - start) / (double)iterations;
+        
+        start = MMBenchmarkNow();
+        for (long pass = 0; pass < iterations; pass++) {
+            MMBenchmarkSink += MMSnapToolbarLayoutSolve(items, count, truncated, frames);
+        }
+        const double truncatedCost = (MMBenchmarkNow() - start) / (double)iterations;
+        
+        printf("items=%-6ld fitting=%10.2f ns  truncated=%10.2f ns\n", count, fittingCost, truncatedCost);
+        
+        free(items);
+        free(frames);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,312 @@
+//
+//  MMSnapTraceReplay.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapTrace.h"
+#include "MMSnapHeadlessScrollView.h"
+#include "MMSnapBenchmarkSupport.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Replays a trace recorded by -[MMSnapScrollView startRecordingTraceToFile:] on a headless scroll view, with the widths
+// the pages had when the trace was recorded, and reports the cost of each kind of event and how many pages scrolled in
+// or out because of it:
+//
+//     MMSnapTraceReplay trace.mmtrace [--repeat 5] [--json results.json]
+//
+// The trace is replayed from the start on every repetition and the fastest repetition is reported, as a JSON object
+// per kind of event.
+
+// Widths.
+
+typedef struct {
+    double *widths;
+    long count;
+    long capacity;
+} MMReplayWidths;
+
+static double MMReplayWidthForPage(long page, void *context)
+{
+    const MMReplayWidths *widths = context;
+    return (page < widths->count) ? widths->widths[page] : 320.0;
+}
+
+static void MMReplaySetWidthCount(MMReplayWidths *widths, long count)
+{
+    if (count > widths->capacity) {
+        widths->capacity = count * 2;
+        widths->widths = realloc(widths->widths, (size_t)widths->capacity * sizeof(double));
+    }
+    for (long page = widths->count; page < count; page++) {
+        widths->widths[page] = 320.0;
+    }
+    widths->count = count;
+}
+
+// Moves the widths to the pages after the pending updates, leaving inserted pages for the trace to fill in.
+static void MMReplayRemapWidths(MMReplayWidths *widths, MMSnapUpdateMapRef updateMap)
+{
+    const long count = widths->count - MMSnapUpdateMapGetDeleteCount(updateMap) + MMSnapUpdateMapGetInsertCount(updateMap);
+    double *updatedWidths = malloc((size_t)(count > 0 ? count : 1) * sizeof(double));
+    
+    for (long page = 0; page < count; page++) {
+        updatedWidths[page] = 320.0;
+    }
+    for (long page = 0; page < widths->count; page++) {
+        const long finalPage = MMSnapUpdateMapGetFinalPage(updateMap, page);
+        if (finalPage != MMSnapPageNotFound && finalPage < count) {
+            updatedWidths[finalPage] = widths->widths[page];
+        }
+    }
+    
+    free(widths->widths);
+    widths->widths = updatedWidths;
+    widths->count = count;
+    widths->capacity = count;
+}
+
+// Replay.
+
+typedef struct {
+    unsigned long count;
+    double nanoseconds;
+    double maximumNanoseconds;
+    long churn;
+} MMReplayResult;
+
+typedef struct {
+    MMSnapTraceEvent *events;
+    long count;
+    long capacity;
+} MMReplayTrace;
+
+static bool MMReplayReadTrace(const char *path, MMReplayTrace *trace)
+{
+    MMSnapTraceReaderRef reader = MMSnapTraceReaderOpen(path);
+    if (!reader) {
+        return false;
+    }
+    
+    MMSnapTraceEvent event;
+    while (MMSnapTraceReaderNext(reader, &event)) {
+        if (trace->count == trace->capacity) {
+            trace->capacity = trace->capacity ? trace->capacity * 2 : 1024;
+            trace->events = realloc(trace->events, (size_t)trace->capacity * sizeof(MMSnapTraceEvent));
+        }
+        trace->events[trace->count++] = event;
+    }
+    MMSnapTraceReaderRelease(reader);
+    
+    return trace->count > 0 && trace->events[0].type == MMSnapTraceEventBegin;
+}
+
+// Applies the widths measured after an event, invalidating the pages whose width changed.
+static long MMReplayApplyWidths(MMHeadlessScrollView *scrollView, MMReplayWidths *widths, const MMSnapTraceEvent *events, long count, bool invalidate)
+{
+    long idx = 0;
+    for (; idx < count && events[idx].type == MMSnapTraceEventPageWidth; idx++) {
+        const long page = events[idx].page;
+        if (page < 0 || page >= widths->count || widths->widths[page] == events[idx].x) {
+            continue;
+        }
+        
+        widths->widths[page] = events[idx].x;
+        if (invalidate && page < MMSnapPageIndexGetCount(scrollView->pageIndex)) {
+            MMSnapPageIndexInvalidatePage(scrollView->pageIndex, page);
+        }
+    }
+    return idx;
+}
+
+static void MMReplayRun(const MMReplayTrace *trace, MMReplayResult *results)
+{
+    const MMSnapTraceEvent *events = trace->events;
+    const MMSnapTraceEvent *begin = &events[0];
+    
+    MMReplayWidths widths = { NULL, 0, 0 };
+    MMReplaySetWidthCount(&widths, begin->page);
+    
+    MMHeadlessScrollView scrollView;
+    MMHeadlessInit(&scrollView, 0);
+    scrollView.widthForPage = MMReplayWidthForPage;
+    scrollView.widthContext = &widths;
+    scrollView.layout.bounds.x = begin->x;
+    
+    // The state at the start of the recording isn't measured.
+    long idx = 1;
+    for (; idx < trace->count && events[idx].type == MMSnapTraceEventBounds; idx++) {
+        scrollView.layout.bounds.width = events[idx].x;
+        scrollView.layout.bounds.height = events[idx].y;
+        scrollView.layout.pageHeight = events[idx].y;
+    }
+    idx += MMReplayApplyWidths(&scrollView, &widths, &events[idx], trace->count - idx, false);
+    
+    MMHeadlessSetControllerCount(&scrollView, begin->page);
+    MMHeadlessReloadData(&scrollView);
+    
+    while (idx < trace->count) {
+        const MMSnapTraceEvent *event = &events[idx++];
+        const MMSnapTraceEvent *following = &events[idx];
+        const long followingCount = trace->count - idx;
+        
+        long churn = 0;
+        const double start = MMBenchmarkNow();
+        
+        switch (event->type) {
+            case MMSnapTraceEventContentOffset:
+                scrollView.layout.bounds.x = event->x;
+                scrollView.layout.bounds.y = event->y;
+                churn = MMHeadlessPerformLayout(&scrollView);
+                break;
+            case MMSnapTraceEventBounds:
+                scrollView.layout.bounds.width = event->x;
+                scrollView.layout.bounds.height = event->y;
+                scrollView.layout.pageHeight = event->y;
+                break;
+            case MMSnapTraceEventReloadData:
+                // Like -[MMSnapScrollView reloadData], the pages are only measured and laid out by the next layout pass.
+                churn = MMSnapPageRingGetPageCount(scrollView.visiblePages);
+                MMSnapPageRingRemoveAllElements(scrollView.visiblePages);
+                MMHeadlessSetControllerCount(&scrollView, event->page);
+                MMSnapPageIndexRemoveAllPages(scrollView.pageIndex);
+                MMSnapPageIndexInsertPages(scrollView.pageIndex, 0, event->page);
+                
+                MMReplaySetWidthCount(&widths, event->page);
+                idx += MMReplayApplyWidths(&scrollView, &widths, following, followingCount, false);
+                break;
+            case MMSnapTraceEventDeletePage:
+                MMSnapUpdateMapDeletePage(scrollView.updateMap, event->page);
+                break;
+            case MMSnapTraceEventInsertPage:
+                MMSnapUpdateMapInsertPage(scrollView.updateMap, event->page);
+                break;
+            case MMSnapTraceEventReloadPage:
+                MMSnapUpdateMapReloadPage(scrollView.updateMap, event->page);
+                break;
+            case MMSnapTraceEventMovePage:
+                MMSnapUpdateMapMovePage(scrollView.updateMap, event->page, event->otherPage);
+                break;
+            case MMSnapTraceEventEndUpdates:
+                if (!MMSnapUpdateMapPrepare(scrollView.updateMap)) {
+                    fprintf(stderr, "conflicting updates at event %ld\n", idx - 1);
+                    exit(2);
+                }
+                MMReplayRemapWidths(&widths, scrollView.updateMap);
+                idx += MMReplayApplyWidths(&scrollView, &widths, following, followingCount, false);
+                MMHeadlessSetControllerCount(&scrollView, widths.count);
+                churn = MMHeadlessEndUpdates(&scrollView);
+                break;
+            case MMSnapTraceEventPageWidth:
+                // Measured ahead of a layout pass, as when pages were invalidated or their widths computed asynchronously.
+                idx += MMReplayApplyWidths(&scrollView, &widths, event, followingCount + 1, true) - 1;
+                break;
+            case MMSnapTraceEventBegin:
+            case MMSnapTraceEventScrollToPage:
+            case MMSnapTraceEventPush:
+            case MMSnapTraceEventPop:
+                // Markers, whose work is recorded by the events that follow them.
+                break;
+        }
+        
+        const double elapsed = MMBenchmarkNow() - start;
+        
+        if (event->type >= MMSnapTraceEventBegin && event->type <= MMSnapTraceEventPop) {
+            MMReplayResult *result = &results[event->type];
+            result->count++;
+            result->nanoseconds += elapsed;
+            result->churn += churn;
+            if (elapsed > result->maximumNanoseconds) {
+                result->maximumNanoseconds = elapsed;
+            }
+        }
+    }
+    
+    MMHeadlessDestroy(&scrollView);
+    free(widths.widths);
+}
+
+int main(int argc, const char *argv[])
+{
+    const char *tracePath = NULL;
+    const char *jsonPath = NULL;
+    long repeatCount = 5;
+    
+    for (int idx = 1; idx < argc; idx++) {
+        if (strcmp(argv[idx], "--json") == 0 && idx + 1 < argc) {
+            jsonPath = argv[++idx];
+        } else if (strcmp(argv[idx], "--repeat") == 0 && idx + 1 < argc) {
+            repeatCount = atol(argv[++idx]);
+        } else if (!tracePath && argv[idx][0] != '-') {
+            tracePath = argv[idx];
+        } else {
+            tracePath = NULL;
+            break;
+        }
+    }
+    
+    if (!tracePath || repeatCount <= 0) {
+        fprintf(stderr, "usage: %s trace.mmtrace [--repeat 5] [--json results.json]\n", argv[0]);
+        return 2;
+    }
+    
+    MMReplayTrace trace = { NULL, 0, 0 };
+    if (!MMReplayReadTrace(tracePath, &trace)) {
+        fprintf(stderr, "could not read trace %s\n", tracePath);
+        return 2;
+    }
+    
+    // Keep the fastest repetition of every kind of event.
+    MMReplayResult best[MMSnapTraceEventPop + 1];
+    memset(best, 0, sizeof(best));
+    
+    for (long repeat = 0; repeat < repeatCount; repeat++) {
+        MMReplayResult results[MMSnapTraceEventPop + 1];
+        memset(results, 0, sizeof(results));
+        
+        MMReplayRun(&trace, results);
+        
+        for (int type = 0; type <= MMSnapTraceEventPop; type++) {
+            if (repeat == 0 || results[type].nanoseconds < best[type].nanoseconds) {
+                best[type] = results[type];
+            }
+        }
+    }
+    
+    FILE *file = jsonPath ? fopen(jsonPath, "w") : stdout;
+    if (!file) {
+        fprintf(stderr, "could not write %s\n", jsonPath);
+        return 2;
+    }
+    
+    fprintf(stderr, "%s: %ld events, %ld pages at the start\n", tracePath, trace.count, trace.events[0].page);
+    fprintf(file, "{\n  \"trace\": \"%s\",\n  \"events\": %ld,\n  \"unit\": \"ns\",\n  \"results\": [\n", tracePath, trace.count);
+    
+    bool first = true;
+    for (int type = MMSnapTraceEventBegin; type <= MMSnapTraceEventPop; type++) {
+        const MMReplayResult *result = &best[type];
+        if (result->count == 0) {
+            continue;
+        }
+        
+        const char *name = MMSnapTraceEventTypeGetName((MMSnapTraceEventType)type);
+        const double mean = result->nanoseconds / (double)result->count;
+        
+        fprintf(stderr, "%-14s count=%-8lu %12.1f ns/event %12.1f ns max %8ld pages churned\n", name, result->count, mean, result->maximumNanoseconds, result->churn);
+        fprintf(file, "%s    {\"name\": \"%s\", \"count\": %lu, \"ns_per_event\": %.1f, \"max_ns\": %.1f, \"churn\": %ld}",
+                first ? "" : ",\n", name, result->count, mean, result->maximumNanoseconds, result->churn);
+        first = false;
+    }
+    fprintf(file, "\n  ]\n}\n");
+    
+    if (file != stdout) {
+        fclose(file);
+    }
+    free(trace.events);
+    
+    return 0;
+}
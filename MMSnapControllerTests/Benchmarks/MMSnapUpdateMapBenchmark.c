@@ -0,0 +1,155 @@
+//
+//  MMSnapUpdateMapBenchmark.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapUpdateMap.h"
+#include "MMSnapPageIndex.h"
+#include "MMSnapBenchmarkSupport.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Measures a batch update on a 10K page scroll view showing four pages. The sparse engine maps the visible pages
+// through the update map and shifts the page index once; the materialized engine builds an array with a slot for every
+// page and replays the updates one at a time, like the scroll view did before.
+
+enum { MMBenchmarkPageCount = 10000, MMBenchmarkVisibleCount = 4 };
+
+static unsigned int MMBenchmarkSeed = 11;
+
+static inline long MMBenchmarkRandom(long bound)
+{
+    MMBenchmarkSeed = MMBenchmarkSeed * 1103515245u + 12345u;
+    return (long)((MMBenchmarkSeed >> 8) % (unsigned int)bound);
+}
+
+static double MMWidthForPage(long page, void *context)
+{
+    (void)context;
+    return (page % 3 == 0) ? 704.0 : 320.0;
+}
+
+// Fills pages with count unique random locations in [0, bound), ascending.
+static void MMBenchmarkPickPages(long *pages, long count, long bound, unsigned char *scratch)
+{
+    memset(scratch, 0, (size_t)bound);
+    for (long picked = 0; picked < count; ) {
+        const long page = MMBenchmarkRandom(bound);
+        if (!scratch[page]) {
+            scratch[page] = 1;
+            picked++;
+        }
+    }
+    for (long page = 0, idx = 0; page < bound; page++) {
+        if (scratch[page]) {
+            pages[idx++] = page;
+        }
+    }
+}
+
+static MMSnapPageIndexRef MMBenchmarkCreatePageIndex(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    for (long page = 0; page < MMBenchmarkPageCount; page++) {
+        MMSnapPageIndexAppendPage(pageIndex, MMWidthForPage(page, NULL));
+    }
+    return pageIndex;
+}
+
+int main(void)
+{
+    const long batchSizes[] = { 1, 10, 100, 1000 };
+    const int iterations = 200;
+    
+    long *deletes = malloc(MMBenchmarkPageCount * sizeof(long));
+    long *inserts = malloc(MMBenchmarkPageCount * sizeof(long));
+    unsigned char *scratch = malloc(MMBenchmarkPageCount * 2);
+    const void **slots = malloc(MMBenchmarkPageCount * 2 * sizeof(void *));
+    
+    for (size_t b = 0; b < sizeof(batchSizes) / sizeof(batchSizes[0]); b++) {
+        const long deleteCount = batchSizes[b] / 2;
+        const long insertCount = batchSizes[b] - deleteCount;
+        const long finalCount = MMBenchmarkPageCount - deleteCount + insertCount;
+        
+        double sparse = 0.0;
+        double materialized = 0.0;
+        
+        MMSnapUpdateMapRef updateMap = MMSnapUpdateMapCreate();
+        
+        for (int i = 0; i < iterations; i++) {
+            MMBenchmarkPickPages(deletes, deleteCount, MMBenchmarkPageCount, scratch);
+            MMBenchmarkPickPages(inserts, insertCount, finalCount, scratch);
+            
+            const long firstVisible = MMBenchmarkRandom(MMBenchmarkPageCount - MMBenchmarkVisibleCount);
+            
+            // Sparse: record, prepare, map the visible pages and shift the page index once.
+            MMSnapPageIndexRef pageIndex = MMBenchmarkCreatePageIndex();
+            
+            double start = MMBenchmarkNow();
+            MMSnapUpdateMapRemoveAllUpdates(updateMap);
+            for (long idx = 0; idx < deleteCount; idx++) {
+                MMSnapUpdateMapDeletePage(updateMap, deletes[idx]);
+            }
+            for (long idx = 0; idx < insertCount; idx++) {
+                MMSnapUpdateMapInsertPage(updateMap, inserts[idx]);
+            }
+            MMSnapUpdateMapPrepare(updateMap);
+            
+            for (long page = firstVisible; page < firstVisible + MMBenchmarkVisibleCount; page++) {
+                MMBenchmarkSink += MMSnapUpdateMapGetFinalPage(updateMap, page);
+            }
+            
+            long removedCount, addedCount;
+            const long *removed = MMSnapUpdateMapGetRemovedPages(updateMap, &removedCount);
+            const long *added = MMSnapUpdateMapGetAddedPages(updateMap, &addedCount);
+            MMSnapPageIndexRemovePagesAtIndexes(pageIndex, removed, removedCount);
+            MMSnapPageIndexInsertPagesAtIndexes(pageIndex, added, addedCount);
+            MMBenchmarkSink += MMSnapPageIndexValidate(pageIndex, MMWidthForPage, NULL);
+            sparse += MMBenchmarkNow() - start;
+            
+            MMSnapPageIndexRelease(pageIndex);
+            
+            // Materialized: a slot per page, updates replayed one at a time.
+            pageIndex = MMBenchmarkCreatePageIndex();
+            
+            start = MMBenchmarkNow();
+            long count = MMBenchmarkPageCount;
+            for (long page = 0; page < count; page++) {
+                slots[page] = (page >= firstVisible && page < firstVisible + MMBenchmarkVisibleCount) ? (const void *)slots : NULL;
+            }
+            for (long idx = deleteCount - 1; idx >= 0; idx--) {
+                memmove(slots + deletes[idx], slots + deletes[idx] + 1, (size_t)(count - deletes[idx] - 1) * sizeof(void *));
+                MMSnapPageIndexRemovePages(pageIndex, deletes[idx], 1);
+                count--;
+            }
+            for (long idx = 0; idx < insertCount; idx++) {
+                memmove(slots + inserts[idx] + 1, slots + inserts[idx], (size_t)(count - inserts[idx]) * sizeof(void *));
+                slots[inserts[idx]] = NULL;
+                MMSnapPageIndexInsertPages(pageIndex, inserts[idx], 1);
+                count++;
+            }
+            for (long page = 0; page < count; page++) {
+                MMBenchmarkSink += (slots[page] != NULL);
+            }
+            MMBenchmarkSink += MMSnapPageIndexValidate(pageIndex, MMWidthForPage, NULL);
+            materialized += MMBenchmarkNow() - start;
+            
+            MMSnapPageIndexRelease(pageIndex);
+        }
+        
+        MMSnapUpdateMapRelease(updateMap);
+        
+        printf("pages=%d updates=%-5ld sparse=%9.2f us  materialized=%9.2f us  speedup=%6.1fx\n",
+               MMBenchmarkPageCount, batchSizes[b], sparse / iterations / 1e3, materialized / iterations / 1e3, materialized / sparse);
+    }
+    
+    free(deletes);
+    free(inserts);
+    free(scratch);
+    free(slots);
+    
+    return 0;
+}
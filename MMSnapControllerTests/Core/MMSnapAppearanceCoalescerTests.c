@@ -0,0 +1,148 @@
+//
+//  MMSnapAppearanceCoalescerTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapAppearanceCoalescer.h"
+#include "MMSnapCoreTestSupport.h"
+
+// Pages are identified by address, any distinct pointers will do.
+static char MMPages[64];
+
+static const double MMFrameDuration = 1.0 / 60.0;
+
+static void testFlingsOnlyDeliverTheSettledPage(void)
+{
+    MMSnapAppearanceCoalescerRef coalescer = MMSnapAppearanceCoalescerCreate(0.1);
+    MMSnapAppearanceEvent events[8];
+    
+    MMSnapAppearanceCoalescerSetVisible(coalescer, &MMPages[0], true, 0.0);
+    MMTAssertEqual(MMSnapAppearanceCoalescerFlush(coalescer, 0.0, true, events, 8), 1);
+    MMTAssert(events[0].key == &MMPages[0] && events[0].appearing, "first page didn't appear");
+    
+    // A fling showing a new page every other frame, flushed after every layout pass.
+    long disappearCount = 0;
+    long appearCount = 0;
+    double time = 0.0;
+    
+    for (long frame = 1; frame <= 80; frame++) {
+        time = frame * MMFrameDuration;
+        
+        const long page = frame / 2;
+        if (page != (frame - 1) / 2) {
+            MMSnapAppearanceCoalescerSetVisible(coalescer, &MMPages[page - 1], false, time);
+            MMSnapAppearanceCoalescerSetVisible(coalescer, &MMPages[page], true, time);
+        }
+        
+        const long count = MMSnapAppearanceCoalescerFlush(coalescer, time, false, events, 8);
+        for (long idx = 0; idx < count; idx++) {
+            if (events[idx].appearing) {
+                appearCount++;
+            } else {
+                MMTAssert(events[idx].key == &MMPages[0], "unexpected disappearance");
+                disappearCount++;
+            }
+        }
+    }
+    
+    // The first page has been gone long enough, the pages crossed never appeared.
+    MMTAssertEqual(disappearCount, 1);
+    MMTAssertEqual(appearCount, 0);
+    
+    // Once the scrolling settles, the last page appears right away.
+    MMTAssertEqual(MMSnapAppearanceCoalescerFlush(coalescer, time, true, events, 8), 1);
+    MMTAssert(events[0].key == &MMPages[40] && events[0].appearing, "last page didn't appear");
+    MMTAssert(MMSnapAppearanceCoalescerIsAppeared(coalescer, &MMPages[40]), "last page not appeared");
+    MMTAssert(!MMSnapAppearanceCoalescerIsAppeared(coalescer, &MMPages[20]), "crossed page appeared");
+    
+    const MMSnapAppearanceCoalescerStatistics statistics = MMSnapAppearanceCoalescerGetStatistics(coalescer);
+    MMTAssertEqual(statistics.deliveredCount, 3);
+    MMTAssertEqual(statistics.droppedCount, 39);
+    MMTAssertEqual(statistics.changeCount, 81);
+    
+    MMSnapAppearanceCoalescerResetStatistics(coalescer);
+    MMTAssertEqual(MMSnapAppearanceCoalescerGetStatistics(coalescer).deliveredCount, 0);
+    
+    MMSnapAppearanceCoalescerRelease(coalescer);
+}
+
+static void testDwellingPagesAreDeliveredWhileScrolling(void)
+{
+    MMSnapAppearanceCoalescerRef coalescer = MMSnapAppearanceCoalescerCreate(0.1);
+    MMSnapAppearanceEvent events[8];
+    
+    double deadline = 0.0;
+    MMTAssert(!MMSnapAppearanceCoalescerGetNextDeadline(coalescer, &deadline), "unexpected deadline");
+    
+    MMSnapAppearanceCoalescerSetVisible(coalescer, &MMPages[1], true, 1.0);
+    MMSnapAppearanceCoalescerSetVisible(coalescer, &MMPages[2], true, 1.05);
+    MMTAssertEqual(MMSnapAppearanceCoalescerGetPendingCount(coalescer), 2);
+    
+    MMTAssert(MMSnapAppearanceCoalescerGetNextDeadline(coalescer, &deadline), "missing deadline");
+    MMTAssertEqualWithAccuracy(deadline, 1.1, 1e-12);
+    
+    // Too early for both.
+    MMTAssertEqual(MMSnapAppearanceCoalescerFlush(coalescer, 1.09, false, events, 8), 0);
+    
+    // The first page stayed long enough.
+    MMTAssertEqual(MMSnapAppearanceCoalescerFlush(coalescer, 1.1, false, events, 8), 1);
+    MMTAssert(events[0].key == &MMPages[1], "wrong page");
+    
+    MMTAssert(MMSnapAppearanceCoalescerGetNextDeadline(coalescer, &deadline), "missing deadline");
+    MMTAssertEqualWithAccuracy(deadline, 1.15, 1e-12);
+    
+    // Leaving before the threshold and coming back doesn't disappear.
+    MMSnapAppearanceCoalescerSetVisible(coalescer, &MMPages[1], false, 1.2);
+    MMSnapAppearanceCoalescerSetVisible(coalescer, &MMPages[1], true, 1.25);
+    
+    // Disappearances come first.
+    MMSnapAppearanceCoalescerSetVisible(coalescer, &MMPages[1], false, 1.3);
+    MMTAssertEqual(MMSnapAppearanceCoalescerFlush(coalescer, 1.3, true, events, 8), 2);
+    MMTAssert(events[0].key == &MMPages[1] && !events[0].appearing, "expected a disappearance first");
+    MMTAssert(events[1].key == &MMPages[2] && events[1].appearing, "expected an appearance");
+    
+    MMTAssertEqual(MMSnapAppearanceCoalescerGetPendingCount(coalescer), 0);
+    MMTAssertEqual(MMSnapAppearanceCoalescerGetStatistics(coalescer).droppedCount, 1);
+    
+    MMSnapAppearanceCoalescerRelease(coalescer);
+}
+
+static void testRemovalAndCapacity(void)
+{
+    MMSnapAppearanceCoalescerRef coalescer = MMSnapAppearanceCoalescerCreate(0.1);
+    MMSnapAppearanceEvent events[8];
+    
+    // More pages than the initial storage.
+    for (long page = 0; page < 20; page++) {
+        MMTAssert(MMSnapAppearanceCoalescerSetVisible(coalescer, &MMPages[page], true, 0.0), "set failed");
+    }
+    
+    // Transitions that don't fit stay pending.
+    MMTAssertEqual(MMSnapAppearanceCoalescerFlush(coalescer, 0.0, true, events, 8), 8);
+    MMTAssert(events[7].key == &MMPages[7], "wrong order");
+    MMTAssertEqual(MMSnapAppearanceCoalescerGetPendingCount(coalescer), 12);
+    
+    // Removed pages aren't delivered.
+    MMTAssert(MMSnapAppearanceCoalescerRemoveKey(coalescer, &MMPages[0]), "page 0 had appeared");
+    MMTAssert(!MMSnapAppearanceCoalescerRemoveKey(coalescer, &MMPages[8]), "page 8 hadn't appeared");
+    MMTAssert(!MMSnapAppearanceCoalescerRemoveKey(coalescer, &MMPages[40]), "page 40 isn't tracked");
+    MMTAssertEqual(MMSnapAppearanceCoalescerGetPendingCount(coalescer), 11);
+    
+    // Pages that never appeared are ignored when they disappear.
+    MMSnapAppearanceCoalescerSetVisible(coalescer, &MMPages[41], false, 0.0);
+    MMTAssertEqual(MMSnapAppearanceCoalescerGetPendingCount(coalescer), 11);
+    MMTAssertEqual(MMSnapAppearanceCoalescerGetStatistics(coalescer).changeCount, 20);
+    
+    MMSnapAppearanceCoalescerRelease(coalescer);
+}
+
+int main(void)
+{
+    MMTRun(testFlingsOnlyDeliverTheSettledPage);
+    MMTRun(testDwellingPagesAreDeliveredWhileScrolling);
+    MMTRun(testRemovalAndCapacity);
+    
+    return MMTExitStatus();
+}
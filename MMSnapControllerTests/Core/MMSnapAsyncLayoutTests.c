@@ -0,0 +1,348 @@
+//
+//  MMSnapAsyncLayoutTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapAsyncLayout.h"
+#include "MMSnapCoreTestSupport.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+static MMSnapPageIndexRef MMMakePageIndex(long count, double width)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    for (long page = 0; page < count; page++) {
+        MMSnapPageIndexAppendPage(pageIndex, width);
+    }
+    return pageIndex;
+}
+
+static void testPublishedWidthsAreApplied(void)
+{
+    MMSnapAsyncLayoutRef asyncLayout = MMSnapAsyncLayoutCreate();
+    MMSnapPageIndexRef pageIndex = MMMakePageIndex(4, 100.0);
+    
+    const unsigned long generation = MMSnapAsyncLayoutInvalidate(asyncLayout);
+    MMTAssert(MMSnapAsyncLayoutIsCurrent(asyncLayout, generation), "generation not current");
+    
+    double *widths = MMSnapAsyncLayoutBeginWriting(asyncLayout, generation, 4);
+    MMTAssert(widths != NULL, "no buffer");
+    widths[0] = 100.0;
+    widths[1] = 200.0;
+    widths[2] = 100.0;
+    widths[3] = 300.0;
+    MMTAssert(MMSnapAsyncLayoutEndWriting(asyncLayout, generation), "not published");
+    
+    // Only the widths that changed are set.
+    MMTAssertEqual(MMSnapAsyncLayoutApply(asyncLayout, generation, pageIndex), 2);
+    MMTAssertEqualWithAccuracy(MMSnapPageIndexGetOrigin(pageIndex, 3), 400.0, 0.0);
+    MMTAssertEqualWithAccuracy(MMSnapPageIndexGetContentWidth(pageIndex), 700.0, 0.0);
+    
+    // A result is applied once.
+    MMTAssertEqual(MMSnapAsyncLayoutApply(asyncLayout, generation, pageIndex), -1);
+    
+    const MMSnapAsyncLayoutStatistics statistics = MMSnapAsyncLayoutGetStatistics(asyncLayout);
+    MMTAssertEqual(statistics.generationCount, 1);
+    MMTAssertEqual(statistics.publishedCount, 1);
+    MMTAssertEqual(statistics.discardedCount, 0);
+    MMTAssertEqual(statistics.appliedCount, 1);
+    
+    MMSnapAsyncLayoutResetStatistics(asyncLayout);
+    MMTAssertEqual(MMSnapAsyncLayoutGetStatistics(asyncLayout).publishedCount, 0);
+    
+    MMSnapPageIndexRelease(pageIndex);
+    MMSnapAsyncLayoutRelease(asyncLayout);
+}
+
+static void testStaleGenerationsAreDiscarded(void)
+{
+    MMSnapAsyncLayoutRef asyncLayout = MMSnapAsyncLayoutCreate();
+    MMSnapPageIndexRef pageIndex = MMMakePageIndex(4, 100.0);
+    
+    const unsigned long staleGeneration = MMSnapAsyncLayoutInvalidate(asyncLayout);
+    double *widths = MMSnapAsyncLayoutBeginWriting(asyncLayout, staleGeneration, 4);
+    MMTAssert(widths != NULL, "no buffer");
+    
+    // The layout changed while the widths were computed.
+    const unsigned long generation = MMSnapAsyncLayoutInvalidate(asyncLayout);
+    MMTAssert(!MMSnapAsyncLayoutIsCurrent(asyncLayout, staleGeneration), "stale generation is current");
+    MMTAssert(!MMSnapAsyncLayoutEndWriting(asyncLayout, staleGeneration), "stale widths published");
+    MMTAssertEqual(MMSnapAsyncLayoutApply(asyncLayout, staleGeneration, pageIndex), -1);
+    MMTAssertEqual(MMSnapAsyncLayoutApply(asyncLayout, generation, pageIndex), -1);
+    MMTAssert(MMSnapAsyncLayoutBeginWriting(asyncLayout, staleGeneration, 4) == NULL, "buffer for a stale generation");
+    
+    // Results for a different number of pages are dropped too.
+    widths = MMSnapAsyncLayoutBeginWriting(asyncLayout, generation, 4);
+    MMTAssert(widths != NULL, "no buffer");
+    for (long page = 0; page < 4; page++) {
+        widths[page] = 50.0;
+    }
+    MMTAssert(MMSnapAsyncLayoutEndWriting(asyncLayout, generation), "not published");
+    
+    MMSnapPageIndexRemovePages(pageIndex, 0, 1);
+    MMTAssertEqual(MMSnapAsyncLayoutApply(asyncLayout, generation, pageIndex), -1);
+    MMTAssertEqualWithAccuracy(MMSnapPageIndexGetWidth(pageIndex, 0), 100.0, 0.0);
+    
+    const MMSnapAsyncLayoutStatistics statistics = MMSnapAsyncLayoutGetStatistics(asyncLayout);
+    MMTAssertEqual(statistics.publishedCount, 1);
+    MMTAssertEqual(statistics.discardedCount, 2);
+    MMTAssertEqual(statistics.appliedCount, 0);
+    
+    // Empty layouts get a buffer too.
+    const unsigned long emptyGeneration = MMSnapAsyncLayoutInvalidate(asyncLayout);
+    MMTAssert(MMSnapAsyncLayoutBeginWriting(asyncLayout, emptyGeneration, 0) != NULL, "no buffer");
+    MMTAssert(MMSnapAsyncLayoutEndWriting(asyncLayout, emptyGeneration), "not published");
+    
+    MMSnapPageIndexRemoveAllPages(pageIndex);
+    MMTAssertEqual(MMSnapAsyncLayoutApply(asyncLayout, emptyGeneration, pageIndex), 0);
+    
+    MMSnapPageIndexRelease(pageIndex);
+    MMSnapAsyncLayoutRelease(asyncLayout);
+}
+
+static void testLeadingWidthsAreAppliedAfterAppends(void)
+{
+    MMSnapAsyncLayoutRef asyncLayout = MMSnapAsyncLayoutCreate();
+    MMSnapPageIndexRef pageIndex = MMMakePageIndex(3, 100.0);
+    
+    const unsigned long generation = MMSnapAsyncLayoutInvalidate(asyncLayout);
+    double *widths = MMSnapAsyncLayoutBeginWriting(asyncLayout, generation, 3);
+    MMTAssert(widths != NULL, "no buffer");
+    for (long page = 0; page < 3; page++) {
+        widths[page] = 200.0;
+    }
+    MMTAssert(MMSnapAsyncLayoutEndWriting(asyncLayout, generation), "not published");
+    
+    // A page was pushed while the widths were computed, it keeps its own width.
+    MMSnapPageIndexAppendPage(pageIndex, 50.0);
+    MMTAssertEqual(MMSnapAsyncLayoutApplyLeadingPages(asyncLayout, generation, pageIndex, 3), 3);
+    MMTAssertEqualWithAccuracy(MMSnapPageIndexGetOrigin(pageIndex, 3), 600.0, 0.0);
+    MMTAssertEqualWithAccuracy(MMSnapPageIndexGetContentWidth(pageIndex), 650.0, 0.0);
+    
+    // Pages that weren't computed can't be applied.
+    const unsigned long nextGeneration = MMSnapAsyncLayoutInvalidate(asyncLayout);
+    widths = MMSnapAsyncLayoutBeginWriting(asyncLayout, nextGeneration, 3);
+    MMTAssert(widths != NULL, "no buffer");
+    for (long page = 0; page < 3; page++) {
+        widths[page] = 100.0;
+    }
+    MMTAssert(MMSnapAsyncLayoutEndWriting(asyncLayout, nextGeneration), "not published");
+    
+    MMTAssertEqual(MMSnapAsyncLayoutApplyLeadingPages(asyncLayout, nextGeneration, pageIndex, 4), -1);
+    MMTAssertEqualWithAccuracy(MMSnapPageIndexGetWidth(pageIndex, 0), 200.0, 0.0);
+    
+    const MMSnapAsyncLayoutStatistics statistics = MMSnapAsyncLayoutGetStatistics(asyncLayout);
+    MMTAssertEqual(statistics.appliedCount, 1);
+    MMTAssertEqual(statistics.discardedCount, 1);
+    
+    MMSnapPageIndexRelease(pageIndex);
+    MMSnapAsyncLayoutRelease(asyncLayout);
+}
+
+typedef struct {
+    MMSnapAsyncLayoutRef asyncLayout;
+    unsigned long generation;
+    double *widths;
+} MMWaitingWorker;
+
+static void *MMWaitForBackBuffer(void *context)
+{
+    MMWaitingWorker *worker = context;
+    worker->widths = MMSnapAsyncLayoutBeginWriting(worker->asyncLayout, worker->generation, 8);
+    return NULL;
+}
+
+static void testWaitingWorkersGiveUpOnInvalidation(void)
+{
+    MMSnapAsyncLayoutRef asyncLayout = MMSnapAsyncLayoutCreate();
+    
+    const unsigned long generation = MMSnapAsyncLayoutInvalidate(asyncLayout);
+    MMTAssert(MMSnapAsyncLayoutBeginWriting(asyncLayout, generation, 8) != NULL, "no buffer");
+    
+    // A second worker for the same generation waits for the back buffer, until the generation becomes stale.
+    MMWaitingWorker worker = { asyncLayout, generation, NULL };
+    pthread_t thread;
+    pthread_create(&thread, NULL, MMWaitForBackBuffer, &worker);
+    
+    MMSnapAsyncLayoutInvalidate(asyncLayout);
+    pthread_join(thread, NULL);
+    
+    MMTAssert(worker.widths == NULL, "buffer for a stale generation");
+    MMTAssert(!MMSnapAsyncLayoutEndWriting(asyncLayout, generation), "stale widths published");
+    
+    MMSnapAsyncLayoutRelease(asyncLayout);
+}
+
+// Workers keep computing the current generation while the owner invalidates and applies. Widths encode the generation
+// they were computed for, so a result mixing two generations would be noticed.
+
+enum { MMWorkerCount = 4, MMStressPageCount = 257, MMStressIterations = 4000 };
+
+typedef struct {
+    MMSnapAsyncLayoutRef asyncLayout;
+    pthread_mutex_t *mutex;
+    const int *stop;
+    int *writerCount;
+    
+    unsigned long overlapCount;
+    unsigned long incompleteCount;
+    unsigned long publishedCount;
+    unsigned long cancelledCount;
+} MMStressWorker;
+
+static inline double MMStressWidth(unsigned long generation, long page)
+{
+    return (double)((generation % 4096) * 1000 + (unsigned long)page + 1);
+}
+
+static int MMStressShouldStop(MMStressWorker *worker)
+{
+    pthread_mutex_lock(worker->mutex);
+    const int stop = *worker->stop;
+    pthread_mutex_unlock(worker->mutex);
+    return stop;
+}
+
+static void *MMComputeWidths(void *context)
+{
+    MMStressWorker *worker = context;
+    MMSnapAsyncLayoutRef asyncLayout = worker->asyncLayout;
+    unsigned long lastGeneration = 0;
+    
+    while (!MMStressShouldStop(worker)) {
+        const unsigned long generation = MMSnapAsyncLayoutGetGeneration(asyncLayout);
+        if (generation == lastGeneration) {
+            sched_yield();
+            continue;
+        }
+        lastGeneration = generation;
+        
+        double *widths = MMSnapAsyncLayoutBeginWriting(asyncLayout, generation, MMStressPageCount);
+        if (!widths) {
+            continue;
+        }
+        
+        pthread_mutex_lock(worker->mutex);
+        if (++(*worker->writerCount) != 1) {
+            worker->overlapCount++;
+        }
+        pthread_mutex_unlock(worker->mutex);
+        
+        long page = 0;
+        for (; page < MMStressPageCount; page++) {
+            if (page % 32 == 0 && !MMSnapAsyncLayoutIsCurrent(asyncLayout, generation)) {
+                break;
+            }
+            widths[page] = MMStressWidth(generation, page);
+        }
+        
+        pthread_mutex_lock(worker->mutex);
+        (*worker->writerCount)--;
+        pthread_mutex_unlock(worker->mutex);
+        
+        // Cancelled workers still release the back buffer, their widths are discarded.
+        if (MMSnapAsyncLayoutEndWriting(asyncLayout, generation)) {
+            worker->publishedCount++;
+            if (page != MMStressPageCount) {
+                worker->incompleteCount++;
+            }
+        } else {
+            worker->cancelledCount++;
+        }
+    }
+    
+    MMSnapAsyncLayoutRelease(asyncLayout);
+    return NULL;
+}
+
+static void testConcurrentWorkersPublishCompleteResults(void)
+{
+    MMSnapAsyncLayoutRef asyncLayout = MMSnapAsyncLayoutCreate();
+    MMSnapPageIndexRef pageIndex = MMMakePageIndex(MMStressPageCount, 0.0);
+    
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    int stop = 0;
+    int writerCount = 0;
+    
+    MMStressWorker workers[MMWorkerCount];
+    pthread_t threads[MMWorkerCount];
+    
+    for (int idx = 0; idx < MMWorkerCount; idx++) {
+        workers[idx] = (MMStressWorker){ MMSnapAsyncLayoutRetain(asyncLayout), &mutex, &stop, &writerCount, 0, 0, 0, 0 };
+        pthread_create(&threads[idx], NULL, MMComputeWidths, &workers[idx]);
+    }
+    
+    unsigned long appliedCount = 0;
+    unsigned long tornCount = 0;
+    
+    for (long iteration = 0; iteration < MMStressIterations; iteration++) {
+        const unsigned long generation = MMSnapAsyncLayoutInvalidate(asyncLayout);
+        
+        // Every other generation is superseded right away, the others are waited for.
+        if (iteration % 2 == 0) {
+            continue;
+        }
+        
+        long changeCount = -1;
+        for (long attempt = 0; attempt < 100000 && changeCount < 0; attempt++) {
+            changeCount = MMSnapAsyncLayoutApply(asyncLayout, generation, pageIndex);
+            if (changeCount < 0) {
+                sched_yield();
+            }
+        }
+        
+        if (changeCount >= 0) {
+            appliedCount++;
+            
+            for (long page = 0; page < MMStressPageCount; page++) {
+                if (MMSnapPageIndexGetWidth(pageIndex, page) != MMStressWidth(generation, page)) {
+                    tornCount++;
+                    break;
+                }
+            }
+        }
+    }
+    
+    pthread_mutex_lock(&mutex);
+    stop = 1;
+    pthread_mutex_unlock(&mutex);
+    
+    // The workers keep the asynchronous layout alive until they're done.
+    const MMSnapAsyncLayoutStatistics statistics = MMSnapAsyncLayoutGetStatistics(asyncLayout);
+    MMSnapAsyncLayoutRelease(asyncLayout);
+    
+    unsigned long overlapCount = 0;
+    unsigned long incompleteCount = 0;
+    unsigned long publishedCount = 0;
+    
+    for (int idx = 0; idx < MMWorkerCount; idx++) {
+        pthread_join(threads[idx], NULL);
+        overlapCount += workers[idx].overlapCount;
+        incompleteCount += workers[idx].incompleteCount;
+        publishedCount += workers[idx].publishedCount;
+    }
+    
+    MMTAssertEqual(overlapCount, 0);
+    MMTAssertEqual(incompleteCount, 0);
+    MMTAssertEqual(tornCount, 0);
+    MMTAssert(appliedCount > 0, "nothing applied");
+    MMTAssertEqual(statistics.appliedCount, appliedCount);
+    MMTAssertEqual(statistics.generationCount, MMStressIterations);
+    MMTAssert(publishedCount >= appliedCount, "applied %lu of %lu", appliedCount, publishedCount);
+    
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+int main(void)
+{
+    MMTRun(testPublishedWidthsAreApplied);
+    MMTRun(testStaleGenerationsAreDiscarded);
+    MMTRun(testLeadingWidthsAreAppliedAfterAppends);
+    MMTRun(testWaitingWorkersGiveUpOnInvalidation);
+    MMTRun(testConcurrentWorkersPublishCompleteResults);
+    
+    return MMTExitStatus();
+}
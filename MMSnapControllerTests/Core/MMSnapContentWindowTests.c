@@ -0,0 +1,137 @@
+//
+//  MMSnapContentWindowTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapContentWindow.h"
+#include "MMSnapCoreTestSupport.h"
+
+static void testUnboundedWindows(void)
+{
+    // Without a maximum, or when the content fits, the window is the content.
+    MMSnapContentWindow window = MMSnapContentWindowMake(3200.0, 0.0, 1000.0, 640.0);
+    MMTAssertEqualWithAccuracy(window.origin, 0.0, 0.0);
+    MMTAssertEqualWithAccuracy(window.length, 3200.0, 0.0);
+    
+    window = MMSnapContentWindowMake(3200.0, 10000.0, 1000.0, 640.0);
+    MMTAssertEqualWithAccuracy(window.origin, 0.0, 0.0);
+    MMTAssertEqualWithAccuracy(window.length, 3200.0, 0.0);
+    MMTAssert(!MMSnapContentWindowNeedsRecentering(&window, 3200.0, 10000.0, 2560.0, 640.0), "unexpected recentering");
+    
+    // The content grew past the maximum.
+    MMTAssert(MMSnapContentWindowNeedsRecentering(&window, 32000.0, 10000.0, 2560.0, 640.0), "expected recentering");
+    
+    // A window too small for the viewport grows.
+    window = MMSnapContentWindowMake(32000.0, 1000.0, 0.0, 640.0);
+    MMTAssertEqualWithAccuracy(window.length, 640.0 * MMSnapContentWindowMinimumViewportCount, 0.0);
+}
+
+static void testBoundedWindowsAreCenteredAndClamped(void)
+{
+    const double contentWidth = 320000.0;
+    
+    MMSnapContentWindow window = MMSnapContentWindowMake(contentWidth, 10000.0, 100000.0, 640.0);
+    MMTAssertEqualWithAccuracy(window.length, 10000.0, 0.0);
+    MMTAssertEqualWithAccuracy(window.origin, 100000.0 + 320.0 - 5000.0, 0.0);
+    MMTAssertEqualWithAccuracy(MMSnapContentWindowGetLocalX(&window, 100000.0), 4680.0, 0.0);
+    MMTAssertEqualWithAccuracy(MMSnapContentWindowGetGlobalX(&window, 4680.0), 100000.0, 0.0);
+    
+    // Origins are whole points.
+    window = MMSnapContentWindowMake(contentWidth, 10000.0, 100000.25, 640.0);
+    MMTAssertEqualWithAccuracy(window.origin, 95320.0, 0.0);
+    
+    // Near the ends of the content, the window stops at the content.
+    window = MMSnapContentWindowMake(contentWidth, 10000.0, 100.0, 640.0);
+    MMTAssertEqualWithAccuracy(window.origin, 0.0, 0.0);
+    MMTAssert(!MMSnapContentWindowNeedsRecentering(&window, contentWidth, 10000.0, 0.0, 640.0), "unexpected recentering");
+    
+    window = MMSnapContentWindowMake(contentWidth, 10000.0, contentWidth - 640.0, 640.0);
+    MMTAssertEqualWithAccuracy(window.origin, contentWidth - 10000.0, 0.0);
+    MMTAssert(!MMSnapContentWindowNeedsRecentering(&window, contentWidth, 10000.0, 10000.0 - 640.0, 640.0), "unexpected recentering");
+    
+    // The content shrank under the window.
+    MMTAssert(MMSnapContentWindowNeedsRecentering(&window, contentWidth - 320.0, 10000.0, 5000.0, 640.0), "expected recentering");
+}
+
+static void testRecenteringNearTheEdges(void)
+{
+    const double contentWidth = 320000.0;
+    const MMSnapContentWindow window = MMSnapContentWindowMake(contentWidth, 10000.0, 100000.0, 640.0);
+    
+    MMTAssert(!MMSnapContentWindowNeedsRecentering(&window, contentWidth, 10000.0, 4680.0, 640.0), "unexpected recentering");
+    MMTAssert(!MMSnapContentWindowNeedsRecentering(&window, contentWidth, 10000.0, 2500.0, 640.0), "unexpected recentering");
+    MMTAssert(MMSnapContentWindowNeedsRecentering(&window, contentWidth, 10000.0, 2499.0, 640.0), "expected recentering");
+    MMTAssert(!MMSnapContentWindowNeedsRecentering(&window, contentWidth, 10000.0, 7500.0 - 640.0, 640.0), "unexpected recentering");
+    MMTAssert(MMSnapContentWindowNeedsRecentering(&window, contentWidth, 10000.0, 7501.0 - 640.0, 640.0), "expected recentering");
+    
+    // A recentered window doesn't need recentering again.
+    const double globalOffsetX = MMSnapContentWindowGetGlobalX(&window, 2000.0);
+    const MMSnapContentWindow recentered = MMSnapContentWindowMake(contentWidth, 10000.0, globalOffsetX, 640.0);
+    MMTAssert(!MMSnapContentWindowNeedsRecentering(&recentered, contentWidth, 10000.0, MMSnapContentWindowGetLocalX(&recentered, globalOffsetX), 640.0), "unexpected recentering");
+}
+
+static void testWindowsIncludingTargets(void)
+{
+    const double contentWidth = 320000.0;
+    
+    // Close targets are included along with the viewport.
+    MMSnapContentWindow window = MMSnapContentWindowMakeIncludingTarget(contentWidth, 10000.0, 100000.0, 101280.0, 640.0);
+    MMTAssert(window.origin <= 100000.0 && window.origin + window.length >= 101280.0 + 640.0, "missing offsets");
+    MMTAssert(!MMSnapContentWindowNeedsRecentering(&window, contentWidth, 10000.0, MMSnapContentWindowGetLocalX(&window, 100000.0), 640.0), "unexpected recentering");
+    MMTAssert(!MMSnapContentWindowNeedsRecentering(&window, contentWidth, 10000.0, MMSnapContentWindowGetLocalX(&window, 101280.0), 640.0), "unexpected recentering");
+    
+    // Far targets get the window.
+    window = MMSnapContentWindowMakeIncludingTarget(contentWidth, 10000.0, 100000.0, 300000.0, 640.0);
+    MMTAssertEqualWithAccuracy(window.origin, 300000.0 + 320.0 - 5000.0, 0.0);
+    
+    window = MMSnapContentWindowMakeIncludingTarget(contentWidth, 10000.0, 100000.0, 0.0, 640.0);
+    MMTAssertEqualWithAccuracy(window.origin, 0.0, 0.0);
+}
+
+static void testDeepStacksKeepLocalOffsetsExact(void)
+{
+    // A million pages of 320 points, well past the integers a float can hold exactly.
+    const double contentWidth = 320.0 * 1000000.0;
+    const double maximumLength = 32768.0;
+    const double viewportWidth = 640.0;
+    
+    MMSnapContentWindow window = MMSnapContentWindowMake(contentWidth, maximumLength, 0.0, viewportWidth);
+    double localOffsetX = 0.0;
+    long recenterCount = 0;
+    
+    // Scroll to the end in steps of a thousand and a third points, recentering like a snap scroll view.
+    const double step = 1000.0 + 1.0 / 3.0;
+    
+    for (double globalOffsetX = 0.0; globalOffsetX + viewportWidth <= contentWidth; globalOffsetX += step) {
+        localOffsetX = MMSnapContentWindowGetLocalX(&window, globalOffsetX);
+        
+        if (MMSnapContentWindowNeedsRecentering(&window, contentWidth, maximumLength, localOffsetX, viewportWidth)) {
+            window = MMSnapContentWindowMake(contentWidth, maximumLength, MMSnapContentWindowGetGlobalX(&window, localOffsetX), viewportWidth);
+            localOffsetX = MMSnapContentWindowGetLocalX(&window, globalOffsetX);
+            recenterCount++;
+        }
+        
+        MMTAssert(localOffsetX >= 0.0 && localOffsetX + viewportWidth <= window.length, "viewport out of window at %f", globalOffsetX);
+        MMTAssertEqualWithAccuracy(MMSnapContentWindowGetGlobalX(&window, localOffsetX), globalOffsetX, 0.0);
+        
+        // Local offsets survive the single precision of a 32-bit CGFloat to well under a pixel.
+        MMTAssertEqualWithAccuracy((float)localOffsetX, localOffsetX, 1.0 / 256.0);
+    }
+    
+    MMTAssert(recenterCount > 0, "the window never moved");
+    MMTAssert(window.origin + window.length <= contentWidth, "window out of content");
+    MMTAssert(window.origin > contentWidth - 2.0 * maximumLength, "window left behind");
+}
+
+int main(void)
+{
+    MMTRun(testUnboundedWindows);
+    MMTRun(testBoundedWindowsAreCenteredAndClamped);
+    MMTRun(testRecenteringNearTheEdges);
+    MMTRun(testWindowsIncludingTargets);
+    MMTRun(testDeepStacksKeepLocalOffsetsExact);
+    
+    return MMTExitStatus();
+}
@@ -0,0 +1,39 @@
+//
+//  MMSnapCoreTestSupport.h
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#ifndef MMSnapCoreTestSupport_h
+#define MMSnapCoreTestSupport_h
+
+#include <math.h>
+#include <stdio.h>
+
+// Minimal assertion helpers for the portable core tests, so they build with nothing but a C compiler.
+
+static int MMTestFailureCount = 0;
+
+#define MMTAssert(condition, ...) do { \
+    if (!(condition)) { \
+        MMTestFailureCount++; \
+        fprintf(stderr, "%s:%d: assertion failed: %s: ", __FILE__, __LINE__, #condition); \
+        fprintf(stderr, __VA_ARGS__); \
+        fprintf(stderr, "\n"); \
+    } \
+} while (0)
+
+#define MMTAssertEqual(a, b) MMTAssert((a) == (b), "%ld != %ld", (long)(a), (long)(b))
+
+#define MMTAssertEqualWithAccuracy(a, b, accuracy) MMTAssert(fabs((double)(a) - (double)(b)) <= (accuracy), "%f != %f", (double)(a), (double)(b))
+
+#define MMTRun(test) do { \
+    const int failures = MMTestFailureCount; \
+    test(); \
+    fprintf(stdout, "%s %s\n", (MMTestFailureCount == failures) ? "passed" : "FAILED", #test); \
+} while (0)
+
+#define MMTExitStatus() (MMTestFailureCount == 0 ? 0 : 1)
+
+#endif /* MMSnapCoreTestSupport_h */
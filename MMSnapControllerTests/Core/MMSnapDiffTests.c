@@ -0,0 +1,167 @@
+//
+//  MMSnapDiffTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapDiff.h"
+#include "MMSnapCoreTestSupport.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MMItem(x) ((const void *)(uintptr_t)(x))
+
+// Replays a diff the way a batch update does: deletes and move sources are removed from the last to the first, then
+// inserts and move destinations are inserted from the first to the last.
+static long MMApplyDiff(const void **items, long count, const void *const *newItems, const MMSnapDiffResult *diff)
+{
+    unsigned char *removed = calloc((size_t)count + 1, 1);
+    const void **moved = calloc((size_t)diff->moveCount + 1, sizeof(void *));
+    
+    for (long k = 0; k < diff->deleteCount; k++) {
+        removed[diff->deletes[k]] = 1;
+    }
+    for (long k = 0; k < diff->moveCount; k++) {
+        removed[diff->moves[k].from] = 1;
+        moved[k] = items[diff->moves[k].from];
+    }
+    
+    long kept = 0;
+    for (long i = 0; i < count; i++) {
+        if (!removed[i]) {
+            items[kept++] = items[i];
+        }
+    }
+    
+    long insert = 0;
+    long move = 0;
+    while (insert < diff->insertCount || move < diff->moveCount) {
+        const bool takeInsert = (move >= diff->moveCount) || (insert < diff->insertCount && diff->inserts[insert] < diff->moves[move].to);
+        const long location = takeInsert ? diff->inserts[insert] : diff->moves[move].to;
+        const void *item = takeInsert ? newItems[location] : moved[move];
+        
+        memmove(items + location + 1, items + location, (size_t)(kept - location) * sizeof(void *));
+        items[location] = item;
+        kept++;
+        
+        if (takeInsert) {
+            insert++;
+        } else {
+            move++;
+        }
+    }
+    
+    free(removed);
+    free(moved);
+    
+    return kept;
+}
+
+static void testIdenticalListsProduceNoChanges(void)
+{
+    const void *items[] = { MMItem(1), MMItem(2), MMItem(3) };
+    MMSnapDiffResult diff;
+    
+    MMTAssert(MMSnapDiffCompute(items, 3, items, 3, &diff), "diff failed");
+    MMTAssertEqual(diff.deleteCount, 0);
+    MMTAssertEqual(diff.insertCount, 0);
+    MMTAssertEqual(diff.moveCount, 0);
+    
+    MMSnapDiffResultFree(&diff);
+}
+
+static void testPushAndPop(void)
+{
+    const void *oldItems[] = { MMItem(1), MMItem(2), MMItem(3) };
+    const void *newItems[] = { MMItem(1), MMItem(4) };
+    MMSnapDiffResult diff;
+    
+    MMSnapDiffCompute(oldItems, 3, newItems, 2, &diff);
+    MMTAssertEqual(diff.deleteCount, 2);
+    MMTAssertEqual(diff.deletes[0], 1);
+    MMTAssertEqual(diff.deletes[1], 2);
+    MMTAssertEqual(diff.insertCount, 1);
+    MMTAssertEqual(diff.inserts[0], 1);
+    MMTAssertEqual(diff.moveCount, 0);
+    
+    MMSnapDiffResultFree(&diff);
+}
+
+static void testReorderIsAMoveNotADeleteAndInsert(void)
+{
+    const void *oldItems[] = { MMItem(1), MMItem(2), MMItem(3), MMItem(4) };
+    const void *newItems[] = { MMItem(2), MMItem(1), MMItem(3), MMItem(4) };
+    MMSnapDiffResult diff;
+    
+    MMSnapDiffCompute(oldItems, 4, newItems, 4, &diff);
+    MMTAssertEqual(diff.deleteCount, 0);
+    MMTAssertEqual(diff.insertCount, 0);
+    MMTAssertEqual(diff.moveCount, 2);
+    MMTAssertEqual(diff.moves[0].from, 1);
+    MMTAssertEqual(diff.moves[0].to, 0);
+    
+    MMSnapDiffResultFree(&diff);
+}
+
+static void testRandomEditsReplayToNewList(void)
+{
+    enum { MaxCount = 64 };
+    
+    srand(3);
+    for (int iteration = 0; iteration < 2000; iteration++) {
+        const void *oldItems[MaxCount];
+        const void *newItems[MaxCount];
+        const void *items[MaxCount * 2];
+        
+        const long oldCount = rand() % MaxCount;
+        for (long i = 0; i < oldCount; i++) {
+            // Small alphabets produce repeated items as well.
+            oldItems[i] = MMItem(1 + rand() % ((iteration % 2) ? 8 : 1000));
+        }
+        
+        long newCount = 0;
+        for (long i = 0; i < oldCount && newCount < MaxCount; i++) {
+            const int operation = rand() % 6;
+            if (operation == 0) {
+                continue;
+            }
+            if (operation == 1 && newCount + 1 < MaxCount) {
+                newItems[newCount++] = MMItem(2000 + rand() % 50);
+            }
+            newItems[newCount++] = oldItems[i];
+        }
+        
+        // Shuffle a few items around.
+        for (int swaps = rand() % 4; swaps > 0 && newCount > 1; swaps--) {
+            const long a = rand() % newCount;
+            const long b = rand() % newCount;
+            const void *item = newItems[a];
+            newItems[a] = newItems[b];
+            newItems[b] = item;
+        }
+        
+        MMSnapDiffResult diff;
+        MMTAssert(MMSnapDiffCompute(oldItems, oldCount, newItems, newCount, &diff), "diff failed");
+        
+        memcpy(items, oldItems, (size_t)oldCount * sizeof(void *));
+        const long count = MMApplyDiff(items, oldCount, newItems, &diff);
+        
+        MMTAssertEqual(count, newCount);
+        MMTAssert(memcmp(items, newItems, (size_t)newCount * sizeof(void *)) == 0, "iteration %d does not replay", iteration);
+        
+        MMSnapDiffResultFree(&diff);
+    }
+}
+
+int main(void)
+{
+    MMTRun(testIdenticalListsProduceNoChanges);
+    MMTRun(testPushAndPop);
+    MMTRun(testReorderIsAMoveNotADeleteAndInsert);
+    MMTRun(testRandomEditsReplayToNewList);
+    
+    return MMTExitStatus();
+}
@@ -0,0 +1,194 @@
+//
+//  MMSnapEvictionPolicyTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapEvictionPolicy.h"
+#include "MMSnapCoreTestSupport.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Keys are pages plus one, so a key is never NULL.
+#define MMKey(page) ((const void *)(uintptr_t)((page) + 1))
+#define MMPage(key) ((long)(uintptr_t)(key) - 1)
+
+static long MMPageForKey(const void *key, void *context)
+{
+    const long pageCount = *(const long *)context;
+    const long page = MMPage(key);
+    return (page < pageCount) ? page : MMSnapPageNotFound;
+}
+
+static void testLeastRecentlyUsedViewsAreEvictedFirst(void)
+{
+    MMSnapEvictionPolicyRef policy = MMSnapEvictionPolicyCreate();
+    MMSnapEvictionPolicySetBudget(policy, (MMSnapEvictionBudget){ .maximumCount = 3, .keptDistance = 0 });
+    
+    for (long page = 0; page < 5; page++) {
+        MMSnapEvictionPolicyUseKey(policy, MMKey(page), 100);
+    }
+    MMSnapEvictionPolicyUseKey(policy, MMKey(0), 100);
+    
+    MMTAssertEqual(MMSnapEvictionPolicyGetCount(policy), 5);
+    MMTAssertEqual(MMSnapEvictionPolicyGetByteCount(policy), 500);
+    
+    long pageCount = 5;
+    const void *keys[8];
+    const long count = MMSnapEvictionPolicyEvict(policy, (MMSnapPageRange){ 4, 1 }, MMPageForKey, &pageCount, false, keys, 8);
+    
+    MMTAssertEqual(count, 2);
+    MMTAssert(keys[0] == MMKey(1) && keys[1] == MMKey(2), "evicted %ld and %ld", MMPage(keys[0]), MMPage(keys[1]));
+    MMTAssertEqual(MMSnapEvictionPolicyGetCount(policy), 3);
+    MMTAssertEqual(MMSnapEvictionPolicyGetByteCount(policy), 300);
+    MMTAssert(MMSnapEvictionPolicyContainsKey(policy, MMKey(0)), "recently used key evicted");
+    MMTAssertEqual(MMSnapEvictionPolicyGetEvictionCount(policy), 2);
+    
+    MMSnapEvictionPolicyRelease(policy);
+}
+
+static void testKeptDistanceAndByteBudget(void)
+{
+    MMSnapEvictionPolicyRef policy = MMSnapEvictionPolicyCreate();
+    MMTAssert(!MMSnapEvictionPolicyIsLimited(policy), "new policy is limited");
+    
+    MMSnapEvictionPolicySetBudget(policy, (MMSnapEvictionBudget){ .maximumByteCount = 250, .keptDistance = 1 });
+    MMTAssert(MMSnapEvictionPolicyIsLimited(policy), "byte budget is not a limit");
+    
+    // The least recently used views are next to the visible page, so they are kept and a farther one goes instead.
+    MMSnapEvictionPolicyUseKey(policy, MMKey(9), 100);
+    MMSnapEvictionPolicyUseKey(policy, MMKey(11), 100);
+    MMSnapEvictionPolicyUseKey(policy, MMKey(20), 100);
+    MMSnapEvictionPolicyUseKey(policy, MMKey(10), 100);
+    
+    long pageCount = 100;
+    const void *keys[8];
+    long count = MMSnapEvictionPolicyEvict(policy, (MMSnapPageRange){ 10, 1 }, MMPageForKey, &pageCount, false, keys, 8);
+    
+    MMTAssertEqual(count, 1);
+    MMTAssert(keys[0] == MMKey(20), "evicted %ld", MMPage(keys[0]));
+    
+    // Pages within the kept distance are never evicted, even when the budget can't be met.
+    MMTAssertEqual(MMSnapEvictionPolicyGetCount(policy), 3);
+    
+    // Growing an estimate counts against the budget.
+    MMSnapEvictionPolicyUseKey(policy, MMKey(50), 10);
+    MMSnapEvictionPolicyUseKey(policy, MMKey(50), 300);
+    MMTAssertEqual(MMSnapEvictionPolicyGetByteCount(policy), 600);
+    
+    count = MMSnapEvictionPolicyEvict(policy, (MMSnapPageRange){ 10, 1 }, MMPageForKey, &pageCount, false, keys, 8);
+    MMTAssertEqual(count, 1);
+    MMTAssert(keys[0] == MMKey(50), "evicted %ld", MMPage(keys[0]));
+    
+    MMSnapEvictionPolicyRelease(policy);
+}
+
+static void testRemovedPagesAreForgotten(void)
+{
+    MMSnapEvictionPolicyRef policy = MMSnapEvictionPolicyCreate();
+    MMSnapEvictionPolicySetBudget(policy, (MMSnapEvictionBudget){ .maximumCount = 1, .keptDistance = 0 });
+    
+    MMSnapEvictionPolicyUseKey(policy, MMKey(8), 1);
+    MMSnapEvictionPolicyUseKey(policy, MMKey(0), 1);
+    
+    // The stack shrank to a single page, so page 8 is gone and must not be reported as an unload.
+    long pageCount = 1;
+    const void *keys[4];
+    const long count = MMSnapEvictionPolicyEvict(policy, (MMSnapPageRange){ 0, 1 }, MMPageForKey, &pageCount, false, keys, 4);
+    
+    MMTAssertEqual(count, 0);
+    MMTAssertEqual(MMSnapEvictionPolicyGetCount(policy), 1);
+    MMTAssertEqual(MMSnapEvictionPolicyGetEvictionCount(policy), 0);
+    
+    MMSnapEvictionPolicyRemoveKey(policy, MMKey(0));
+    MMTAssertEqual(MMSnapEvictionPolicyGetCount(policy), 0);
+    
+    MMSnapEvictionPolicyRelease(policy);
+}
+
+static void testSyntheticScrollTraceStaysWithinBudget(void)
+{
+    enum { MMPageCount = 300, MMVisibleCount = 2, MMMaximumCount = 8, MMKeptDistance = 1 };
+    
+    MMSnapEvictionPolicyRef policy = MMSnapEvictionPolicyCreate();
+    MMSnapEvictionPolicySetBudget(policy, (MMSnapEvictionBudget){ .maximumCount = MMMaximumCount, .keptDistance = MMKeptDistance });
+    
+    bool loaded[MMPageCount] = { false };
+    long loadCount = 0;
+    long pageCount = MMPageCount;
+    const void *keys[MMPageCount];
+    
+    srand(7);
+    
+    long first = 0;
+    for (int step = 0; step < 5000; step++) {
+        // Mostly scroll by one page in a direction that changes now and then, with an occasional jump.
+        const int roll = rand() % 100;
+        if (roll < 3) {
+            first = rand() % (MMPageCount - MMVisibleCount);
+        } else {
+            first += ((step / 200) % 2 == 0) ? 1 : -1;
+        }
+        if (first < 0) {
+            first = 0;
+        }
+        if (first > MMPageCount - MMVisibleCount) {
+            first = MMPageCount - MMVisibleCount;
+        }
+        
+        const MMSnapPageRange visible = { first, MMVisibleCount };
+        
+        // Displaying and prefetching the next page use their views.
+        for (long page = first; page <= first + MMVisibleCount && page < MMPageCount; page++) {
+            if (!loaded[page]) {
+                loaded[page] = true;
+                loadCount++;
+            }
+            MMSnapEvictionPolicyUseKey(policy, MMKey(page), 1);
+        }
+        
+        const long count = MMSnapEvictionPolicyEvict(policy, visible, MMPageForKey, &pageCount, false, keys, MMPageCount);
+        for (long idx = 0; idx < count; idx++) {
+            const long page = MMPage(keys[idx]);
+            MMTAssert(loaded[page], "evicted page %ld that was not loaded", page);
+            MMTAssert(page < first - MMKeptDistance || page >= first + MMVisibleCount + MMKeptDistance, "evicted page %ld near %ld", page, first);
+            loaded[page] = false;
+        }
+        
+        MMTAssert(MMSnapEvictionPolicyGetCount(policy) <= MMMaximumCount, "%ld views loaded at step %d", MMSnapEvictionPolicyGetCount(policy), step);
+        
+        for (long page = first; page < first + MMVisibleCount; page++) {
+            MMTAssert(loaded[page], "visible page %ld was evicted", page);
+        }
+    }
+    
+    // Views are loaded again after being evicted, but only a fraction of the steps.
+    MMTAssert(loadCount < 5000, "%ld loads", loadCount);
+    
+    // A memory warning drops everything but the kept pages.
+    const long count = MMSnapEvictionPolicyEvict(policy, (MMSnapPageRange){ first, MMVisibleCount }, MMPageForKey, &pageCount, true, keys, MMPageCount);
+    MMTAssert(count > 0, "nothing evicted on a memory warning");
+    MMTAssert(MMSnapEvictionPolicyGetCount(policy) <= MMVisibleCount + 2 * MMKeptDistance, "%ld views kept", MMSnapEvictionPolicyGetCount(policy));
+    
+    MMSnapEvictionPolicyRemoveAllKeys(policy);
+    MMTAssertEqual(MMSnapEvictionPolicyGetCount(policy), 0);
+    MMTAssertEqual(MMSnapEvictionPolicyGetByteCount(policy), 0);
+    
+    // The storage is reused after removing every key.
+    MMSnapEvictionPolicyUseKey(policy, MMKey(3), 1);
+    MMTAssert(MMSnapEvictionPolicyContainsKey(policy, MMKey(3)), "key missing after reuse");
+    
+    MMSnapEvictionPolicyRelease(policy);
+}
+
+int main(void)
+{
+    MMTRun(testLeastRecentlyUsedViewsAreEvictedFirst);
+    MMTRun(testKeptDistanceAndByteBudget);
+    MMTRun(testRemovedPagesAreForgotten);
+    MMTRun(testSyntheticScrollTraceStaysWithinBudget);
+    
+    return MMTExitStatus();
+}
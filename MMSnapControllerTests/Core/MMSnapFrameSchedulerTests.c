@@ -0,0 +1,220 @@
+//
+//  MMSnapFrameSchedulerTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapFrameScheduler.h"
+#include "MMSnapCoreTestSupport.h"
+
+typedef struct {
+    long startCount;
+    long stopCount;
+    bool running;
+} MMClock;
+
+static void MMClockStart(void *info)
+{
+    MMClock *clock = info;
+    clock->startCount++;
+    clock->running = true;
+}
+
+static void MMClockStop(void *info)
+{
+    MMClock *clock = info;
+    clock->stopCount++;
+    clock->running = false;
+}
+
+// Moves horizontally from zero at a constant speed, finishing at a destination.
+typedef struct {
+    double speed;
+    double destination;
+    double appliedX;
+    long applyCount;
+    bool finished;
+    MMSnapFrameSchedulerRef restartingScheduler;
+} MMAnimation;
+
+static bool MMAnimationEvaluate(void *info, double time, double *x, double *y)
+{
+    MMAnimation *animation = info;
+    *x = animation->speed * time;
+    *y = 0.0;
+    
+    if (*x >= animation->destination) {
+        *x = animation->destination;
+        return true;
+    }
+    return false;
+}
+
+static void MMAnimationApply(void *info, double x, double y, bool finished);
+
+static MMSnapFrameSchedulerClient MMAnimationClient(MMAnimation *animation)
+{
+    return (MMSnapFrameSchedulerClient){ MMAnimationEvaluate, MMAnimationApply, animation };
+}
+
+static void MMAnimationApply(void *info, double x, double y, bool finished)
+{
+    (void)y;
+    
+    MMAnimation *animation = info;
+    animation->appliedX = x;
+    animation->applyCount++;
+    animation->finished = finished;
+    
+    // Chained animations start again from their completion.
+    if (finished && animation->restartingScheduler) {
+        MMSnapFrameSchedulerRef scheduler = animation->restartingScheduler;
+        animation->restartingScheduler = NULL;
+        animation->destination *= 2.0;
+        MMSnapFrameSchedulerAddClient(scheduler, MMAnimationClient(animation), x, 0.0, 1.0);
+    }
+}
+
+static MMSnapFrameSchedulerRef MMCreateScheduler(MMClock *clock)
+{
+    return MMSnapFrameSchedulerCreate((MMSnapFrameSchedulerClock){ MMClockStart, MMClockStop, clock });
+}
+
+static void testClockRunsOnlyWhileAnimating(void)
+{
+    MMClock clock = { 0, 0, false };
+    MMSnapFrameSchedulerRef scheduler = MMCreateScheduler(&clock);
+    MMTAssert(!clock.running, "clock started without clients");
+    
+    MMAnimation first = { .speed = 600.0, .destination = 100.0 };
+    MMAnimation second = { .speed = 600.0, .destination = 200.0 };
+    MMSnapFrameSchedulerAddClient(scheduler, MMAnimationClient(&first), 0.0, 0.0, 2.0);
+    MMSnapFrameSchedulerAddClient(scheduler, MMAnimationClient(&second), 0.0, 0.0, 2.0);
+    
+    // A single clock for both.
+    MMTAssertEqual(clock.startCount, 1);
+    MMTAssertEqual(MMSnapFrameSchedulerGetClientCount(scheduler), 2);
+    
+    long frame = 0;
+    while (clock.running) {
+        MMSnapFrameSchedulerTick(scheduler, ++frame / 60.0);
+    }
+    
+    // Each lands exactly at its destination, and the clock stops with the last one.
+    MMTAssert(first.finished && second.finished, "animations didn't finish");
+    MMTAssertEqualWithAccuracy(first.appliedX, 100.0, 0.0);
+    MMTAssertEqualWithAccuracy(second.appliedX, 200.0, 0.0);
+    MMTAssertEqual(frame, 20);
+    MMTAssertEqual(clock.stopCount, 1);
+    MMTAssert(!MMSnapFrameSchedulerContainsClient(scheduler, &first), "finished client kept");
+    
+    // Removing the only client stops the clock without applying anything.
+    MMAnimation third = { .speed = 1.0, .destination = 100.0 };
+    MMSnapFrameSchedulerAddClient(scheduler, MMAnimationClient(&third), 0.0, 0.0, 2.0);
+    MMTAssertEqual(clock.startCount, 2);
+    MMSnapFrameSchedulerRemoveClient(scheduler, &third);
+    MMTAssertEqual(clock.stopCount, 2);
+    MMTAssertEqual(third.applyCount, 0);
+    
+    MMSnapFrameSchedulerRelease(scheduler);
+}
+
+static void testStepsAreIndependentOfTheFrameRate(void)
+{
+    MMClock clock = { 0, 0, false };
+    MMSnapFrameSchedulerRef scheduler = MMCreateScheduler(&clock);
+    
+    MMAnimation slow = { .speed = 100.0, .destination = 1000.0 };
+    MMAnimation fast = { .speed = 100.0, .destination = 1000.0 };
+    
+    MMSnapFrameSchedulerAddClient(scheduler, MMAnimationClient(&slow), 0.0, 0.0, 1.0);
+    for (long frame = 1; frame <= 60; frame++) {
+        MMSnapFrameSchedulerTick(scheduler, frame / 60.0);
+    }
+    MMSnapFrameSchedulerRemoveClient(scheduler, &slow);
+    
+    MMSnapFrameSchedulerAddClient(scheduler, MMAnimationClient(&fast), 0.0, 0.0, 1.0);
+    for (long frame = 1; frame <= 120; frame++) {
+        MMSnapFrameSchedulerTick(scheduler, frame / 120.0);
+    }
+    
+    // Twice the frames in the same time, the same position.
+    MMTAssertEqualWithAccuracy(slow.appliedX, 100.0, 1e-9);
+    MMTAssertEqualWithAccuracy(fast.appliedX, 100.0, 1e-9);
+    MMTAssertEqual(slow.applyCount, 60);
+    MMTAssertEqual(fast.applyCount, 120);
+    
+    MMSnapFrameSchedulerRelease(scheduler);
+}
+
+static void testChangesUnderHalfAPixelAreSkipped(void)
+{
+    MMClock clock = { 0, 0, false };
+    MMSnapFrameSchedulerRef scheduler = MMCreateScheduler(&clock);
+    
+    // A tenth of a point per frame on a 3x display, skipping every other frame.
+    MMAnimation animation = { .speed = 6.0, .destination = 10.0 };
+    MMSnapFrameSchedulerAddClient(scheduler, MMAnimationClient(&animation), 0.0, 0.0, 3.0);
+    
+    for (long frame = 1; frame <= 60; frame++) {
+        MMSnapFrameSchedulerTick(scheduler, frame / 60.0);
+    }
+    
+    MMSnapFrameSchedulerStatistics statistics = MMSnapFrameSchedulerGetStatistics(scheduler);
+    MMTAssertEqual(statistics.tickCount, 60);
+    MMTAssertEqual(statistics.applyCount, 30);
+    MMTAssertEqual(statistics.skipCount, 30);
+    MMTAssertEqualWithAccuracy(animation.appliedX, 6.0, 1e-9);
+    
+    // The same speed on a 1x display only moves every five frames.
+    MMSnapFrameSchedulerResetStatistics(scheduler);
+    MMSnapFrameSchedulerAddClient(scheduler, MMAnimationClient(&animation), 0.0, 0.0, 1.0);
+    
+    for (long frame = 1; frame <= 60; frame++) {
+        MMSnapFrameSchedulerTick(scheduler, frame / 60.0);
+    }
+    
+    statistics = MMSnapFrameSchedulerGetStatistics(scheduler);
+    MMTAssertEqual(statistics.applyCount, 12);
+    MMTAssertEqual(statistics.skipCount, 48);
+    
+    // Finishing is always applied, however close.
+    MMSnapFrameSchedulerTick(scheduler, 10.05 / 6.0);
+    MMTAssert(animation.finished, "animation didn't finish");
+    MMTAssertEqualWithAccuracy(animation.appliedX, 10.0, 0.0);
+    
+    MMSnapFrameSchedulerRelease(scheduler);
+}
+
+static void testClientsCanRestartWhenFinishing(void)
+{
+    MMClock clock = { 0, 0, false };
+    MMSnapFrameSchedulerRef scheduler = MMCreateScheduler(&clock);
+    
+    MMAnimation animation = { .speed = 60.0, .destination = 10.0, .restartingScheduler = scheduler };
+    MMSnapFrameSchedulerAddClient(scheduler, MMAnimationClient(&animation), 0.0, 0.0, 1.0);
+    
+    long frame = 0;
+    while (clock.running && frame < 1000) {
+        MMSnapFrameSchedulerTick(scheduler, ++frame / 60.0);
+    }
+    
+    // The clock kept running across the restart.
+    MMTAssertEqualWithAccuracy(animation.appliedX, 20.0, 0.0);
+    MMTAssertEqual(frame, 20);
+    MMTAssertEqual(clock.startCount, 1);
+    MMTAssertEqual(clock.stopCount, 1);
+    
+    MMSnapFrameSchedulerRelease(scheduler);
+}
+
+int main(void)
+{
+    MMTRun(testClockRunsOnlyWhileAnimating);
+    MMTRun(testStepsAreIndependentOfTheFrameRate);
+    MMTRun(testChangesUnderHalfAPixelAreSkipped);
+    MMTRun(testClientsCanRestartWhenFinishing);
+    
+    return MMTExitStatus();
+}
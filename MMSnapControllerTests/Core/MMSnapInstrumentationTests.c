@@ -0,0 +1,199 @@
+//
+//  MMSnapInstrumentationTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapInstrumentation.h"
+#include "MMSnapCoreTestSupport.h"
+
+#include <pthread.h>
+#include <string.h>
+
+static void testSamplesAreBucketedByPowersOfTwo(void)
+{
+    MMSnapInstrumentationRef instrumentation = MMSnapInstrumentationCreate();
+    
+    MMSnapInstrumentationRecord(instrumentation, MMSnapInstrumentationPhaseViewRequest, 0);
+    MMSnapInstrumentationRecord(instrumentation, MMSnapInstrumentationPhaseViewRequest, 1);
+    MMSnapInstrumentationRecord(instrumentation, MMSnapInstrumentationPhaseViewRequest, 1000);
+    MMSnapInstrumentationRecord(instrumentation, MMSnapInstrumentationPhaseViewRequest, 1023);
+    MMSnapInstrumentationRecord(instrumentation, MMSnapInstrumentationPhaseViewRequest, 1024);
+    MMSnapInstrumentationRecord(instrumentation, MMSnapInstrumentationPhaseViewRequest, UINT64_MAX / 2);
+    
+    MMSnapInstrumentationStatistics statistics;
+    MMSnapInstrumentationGetStatistics(instrumentation, MMSnapInstrumentationPhaseViewRequest, &statistics);
+    
+    MMTAssertEqual(statistics.count, 6);
+    MMTAssertEqual(statistics.buckets[0], 2);
+    MMTAssertEqual(statistics.buckets[9], 2);
+    MMTAssertEqual(statistics.buckets[10], 1);
+    MMTAssertEqual(statistics.buckets[MMSnapInstrumentationBucketCount - 1], 1);
+    MMTAssert(statistics.maximumNanoseconds == UINT64_MAX / 2, "maximum not recorded");
+    
+    // Other phases are untouched.
+    MMSnapInstrumentationGetStatistics(instrumentation, MMSnapInstrumentationPhaseLayoutPass, &statistics);
+    MMTAssertEqual(statistics.count, 0);
+    
+    MMSnapInstrumentationRelease(instrumentation);
+}
+
+static void testTotalsMaximumAndPercentiles(void)
+{
+    MMSnapInstrumentationRef instrumentation = MMSnapInstrumentationCreate();
+    
+    // 90 fast passes and 10 hitches.
+    for (int idx = 0; idx < 90; idx++) {
+        MMSnapInstrumentationRecord(instrumentation, MMSnapInstrumentationPhaseLayoutPass, 100000);
+    }
+    for (int idx = 0; idx < 10; idx++) {
+        MMSnapInstrumentationRecord(instrumentation, MMSnapInstrumentationPhaseLayoutPass, 20000000 + idx);
+    }
+    
+    MMSnapInstrumentationStatistics statistics;
+    MMSnapInstrumentationGetStatistics(instrumentation, MMSnapInstrumentationPhaseLayoutPass, &statistics);
+    
+    MMTAssertEqual(statistics.count, 100);
+    MMTAssertEqual(statistics.totalNanoseconds, 90 * 100000 + 10 * 20000000 + 45);
+    MMTAssertEqual(statistics.maximumNanoseconds, 20000009);
+    
+    // Percentiles are the upper bound of their bucket, so within a factor of two and never over the maximum.
+    const uint64_t median = MMSnapInstrumentationStatisticsGetPercentile(&statistics, 0.5);
+    MMTAssert(median >= 100000 && median < 200000, "median %llu", (unsigned long long)median);
+    
+    const uint64_t tail = MMSnapInstrumentationStatisticsGetPercentile(&statistics, 0.99);
+    MMTAssertEqual(tail, 20000009);
+    MMTAssertEqual(MMSnapInstrumentationStatisticsGetPercentile(&statistics, 0.0), 131071);
+    
+    MMSnapInstrumentationReset(instrumentation);
+    MMSnapInstrumentationGetStatistics(instrumentation, MMSnapInstrumentationPhaseLayoutPass, &statistics);
+    MMTAssertEqual(statistics.count, 0);
+    MMTAssertEqual(statistics.maximumNanoseconds, 0);
+    MMTAssertEqual(MMSnapInstrumentationStatisticsGetPercentile(&statistics, 0.5), 0);
+    
+    MMSnapInstrumentationRelease(instrumentation);
+}
+
+typedef struct {
+    int calls;
+    MMSnapInstrumentationPhase lastPhase;
+    uint64_t lastNanoseconds;
+} MMObservation;
+
+static void MMObserve(MMSnapInstrumentationPhase phase, uint64_t nanoseconds, void *context)
+{
+    MMObservation *observation = context;
+    observation->calls++;
+    observation->lastPhase = phase;
+    observation->lastNanoseconds = nanoseconds;
+}
+
+static void testObserverAndProbes(void)
+{
+    MMSnapInstrumentationRef instrumentation = MMSnapInstrumentationCreate();
+    
+    MMObservation observation = { 0, MMSnapInstrumentationPhaseCount, 0 };
+    MMSnapInstrumentationSetObserver(instrumentation, MMObserve, &observation);
+    
+    MMSnapInstrumentationRecord(instrumentation, MMSnapInstrumentationPhaseUpdates, 42);
+    MMTAssertEqual(observation.calls, 1);
+    MMTAssertEqual(observation.lastPhase, MMSnapInstrumentationPhaseUpdates);
+    MMTAssertEqual(observation.lastNanoseconds, 42);
+    
+    const uint64_t startTime = MMSnapInstrumentationBegin(instrumentation);
+    MMTAssert(startTime != 0, "probe didn't start");
+    MMSnapInstrumentationEnd(instrumentation, MMSnapInstrumentationPhaseSeparatorDequeue, startTime);
+    MMTAssertEqual(observation.calls, 2);
+    MMTAssertEqual(observation.lastPhase, MMSnapInstrumentationPhaseSeparatorDequeue);
+    
+    MMSnapInstrumentationSetObserver(instrumentation, NULL, NULL);
+    MMSnapInstrumentationRecord(instrumentation, MMSnapInstrumentationPhaseUpdates, 42);
+    MMTAssertEqual(observation.calls, 2);
+    
+    // Disabled instrumentation records nothing and doesn't read the clock.
+    MMSnapInstrumentationRef disabled = NULL;
+    const uint64_t disabledStartTime = MMSnapInstrumentationBegin(disabled);
+    MMTAssertEqual(disabledStartTime, 0);
+    MMSnapInstrumentationEnd(disabled, MMSnapInstrumentationPhaseLayoutPass, disabledStartTime);
+    MMSnapInstrumentationRecord(NULL, MMSnapInstrumentationPhaseLayoutPass, 1);
+    
+    // Instrumentation enabled in the middle of a phase doesn't record a bogus duration.
+    MMSnapInstrumentationEnd(instrumentation, MMSnapInstrumentationPhaseLayoutPass, disabledStartTime);
+    
+    MMSnapInstrumentationStatistics statistics;
+    MMSnapInstrumentationGetStatistics(instrumentation, MMSnapInstrumentationPhaseLayoutPass, &statistics);
+    MMTAssertEqual(statistics.count, 0);
+    
+    MMTAssert(MMSnapInstrumentationGetTime() >= startTime, "clock went backwards");
+    
+    MMSnapInstrumentationRelease(instrumentation);
+}
+
+enum { MMThreadCount = 4, MMSamplesPerThread = 200000 };
+
+static void *MMRecordSamples(void *context)
+{
+    MMSnapInstrumentationRef instrumentation = context;
+    
+    for (uint64_t idx = 0; idx < MMSamplesPerThread; idx++) {
+        MMSnapInstrumentationRecord(instrumentation, MMSnapInstrumentationPhaseViewRequest, idx % 4096);
+    }
+    return NULL;
+}
+
+static void testConcurrentRecordingLosesNoSamples(void)
+{
+    MMSnapInstrumentationRef instrumentation = MMSnapInstrumentationCreate();
+    
+    pthread_t threads[MMThreadCount];
+    for (int idx = 0; idx < MMThreadCount; idx++) {
+        pthread_create(&threads[idx], NULL, MMRecordSamples, instrumentation);
+    }
+    
+    // Reading while recording is allowed.
+    MMSnapInstrumentationStatistics statistics;
+    MMSnapInstrumentationGetStatistics(instrumentation, MMSnapInstrumentationPhaseViewRequest, &statistics);
+    MMTAssert(statistics.count <= MMThreadCount * MMSamplesPerThread, "too many samples");
+    
+    for (int idx = 0; idx < MMThreadCount; idx++) {
+        pthread_join(threads[idx], NULL);
+    }
+    
+    MMSnapInstrumentationGetStatistics(instrumentation, MMSnapInstrumentationPhaseViewRequest, &statistics);
+    MMTAssertEqual(statistics.count, MMThreadCount * MMSamplesPerThread);
+    MMTAssertEqual(statistics.maximumNanoseconds, 4095);
+    
+    uint64_t bucketTotal = 0;
+    for (int bucket = 0; bucket < MMSnapInstrumentationBucketCount; bucket++) {
+        bucketTotal += statistics.buckets[bucket];
+    }
+    MMTAssertEqual(bucketTotal, MMThreadCount * MMSamplesPerThread);
+    
+    // Each thread records the same sequence, whose sum is known.
+    const uint64_t cycles = MMSamplesPerThread / 4096;
+    const uint64_t remainder = MMSamplesPerThread % 4096;
+    const uint64_t perThread = cycles * (4095 * 4096 / 2) + remainder * (remainder - 1) / 2;
+    MMTAssert(statistics.totalNanoseconds == MMThreadCount * perThread, "total %llu", (unsigned long long)statistics.totalNanoseconds);
+    
+    MMSnapInstrumentationRelease(instrumentation);
+}
+
+static void testPhaseNames(void)
+{
+    for (int phase = 0; phase < MMSnapInstrumentationPhaseCount; phase++) {
+        MMTAssert(strcmp(MMSnapInstrumentationGetPhaseName((MMSnapInstrumentationPhase)phase), "unknown") != 0, "phase %d has no name", phase);
+    }
+    MMTAssert(strcmp(MMSnapInstrumentationGetPhaseName(MMSnapInstrumentationPhaseViewRequest), "viewRequest") == 0, "wrong name");
+}
+
+int main(void)
+{
+    MMTRun(testSamplesAreBucketedByPowersOfTwo);
+    MMTRun(testTotalsMaximumAndPercentiles);
+    MMTRun(testObserverAndProbes);
+    MMTRun(testConcurrentRecordingLosesNoSamples);
+    MMTRun(testPhaseNames);
+    
+    return MMTExitStatus();
+}
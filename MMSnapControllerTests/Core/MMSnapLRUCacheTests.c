@@ -0,0 +1,240 @@
+//
+//  MMSnapLRUCacheTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapLRUCache.h"
+#include "MMSnapCoreTestSupport.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    double width;
+    double height;
+} MMSize;
+
+// String keys with reference counting, like the keys the header view builds for each measured text.
+
+typedef struct {
+    int retainCount;
+    char text[32];
+} MMStringKey;
+
+static int MMLiveKeyCount = 0;
+
+static MMStringKey *MMStringKeyCreate(const char *text)
+{
+    MMStringKey *key = calloc(1, sizeof(MMStringKey));
+    key->retainCount = 1;
+    snprintf(key->text, sizeof(key->text), "%s", text);
+    MMLiveKeyCount++;
+    return key;
+}
+
+static const void *MMStringKeyRetain(const void *key)
+{
+    ((MMStringKey *)key)->retainCount++;
+    return key;
+}
+
+static void MMStringKeyRelease(const void *key)
+{
+    MMStringKey *stringKey = (MMStringKey *)key;
+    if (--stringKey->retainCount == 0) {
+        free(stringKey);
+        MMLiveKeyCount--;
+    }
+}
+
+static unsigned long MMStringKeyHash(const void *key)
+{
+    unsigned long hash = 5381;
+    for (const char *c = ((const MMStringKey *)key)->text; *c; c++) {
+        hash = hash * 33 + (unsigned char)*c;
+    }
+    return hash;
+}
+
+static bool MMStringKeyEqual(const void *key, const void *otherKey)
+{
+    return strcmp(((const MMStringKey *)key)->text, ((const MMStringKey *)otherKey)->text) == 0;
+}
+
+static const MMSnapLRUCacheKeyCallbacks MMStringKeyCallbacks = { MMStringKeyRetain, MMStringKeyRelease, MMStringKeyHash, MMStringKeyEqual };
+
+static bool MMGet(MMSnapLRUCacheRef cache, const char *text, MMSize *size)
+{
+    MMStringKey *key = MMStringKeyCreate(text);
+    const bool found = MMSnapLRUCacheGetValue(cache, key, size);
+    MMStringKeyRelease(key);
+    return found;
+}
+
+static void MMSet(MMSnapLRUCacheRef cache, const char *text, double width)
+{
+    MMStringKey *key = MMStringKeyCreate(text);
+    const MMSize size = { width, 20.0 };
+    MMSnapLRUCacheSetValue(cache, key, &size);
+    MMStringKeyRelease(key);
+}
+
+static void testEqualKeysFindTheirValues(void)
+{
+    MMSnapLRUCacheRef cache = MMSnapLRUCacheCreate(&MMStringKeyCallbacks, sizeof(MMSize), 4);
+    
+    MMSet(cache, "Inbox", 44.0);
+    MMSet(cache, "Drafts", 52.0);
+    
+    // Lookups use distinct but equal keys.
+    MMSize size = { 0.0, 0.0 };
+    MMTAssert(MMGet(cache, "Inbox", &size), "missing value");
+    MMTAssertEqualWithAccuracy(size.width, 44.0, 0.0);
+    MMTAssertEqualWithAccuracy(size.height, 20.0, 0.0);
+    MMTAssert(!MMGet(cache, "Sent", &size), "unexpected value");
+    
+    // Setting an existing key replaces its value.
+    MMSet(cache, "Inbox", 45.0);
+    MMTAssertEqual(MMSnapLRUCacheGetCount(cache), 2);
+    MMTAssert(MMGet(cache, "Inbox", &size), "missing value");
+    MMTAssertEqualWithAccuracy(size.width, 45.0, 0.0);
+    
+    MMSnapLRUCacheRemoveValue(cache, &(MMStringKey){ 1, "Inbox" });
+    MMTAssert(!MMGet(cache, "Inbox", NULL), "value not removed");
+    MMTAssertEqual(MMSnapLRUCacheGetCount(cache), 1);
+    
+    const MMSnapLRUCacheStatistics statistics = MMSnapLRUCacheGetStatistics(cache);
+    MMTAssertEqual(statistics.hitCount, 2);
+    MMTAssertEqual(statistics.missCount, 2);
+    MMTAssertEqualWithAccuracy(MMSnapLRUCacheGetHitRate(cache), 0.5, 1e-9);
+    
+    MMSnapLRUCacheRelease(cache);
+    MMTAssertEqual(MMLiveKeyCount, 0);
+}
+
+static void testLeastRecentlyUsedValuesAreEvicted(void)
+{
+    MMSnapLRUCacheRef cache = MMSnapLRUCacheCreate(&MMStringKeyCallbacks, sizeof(MMSize), 3);
+    
+    MMSet(cache, "a", 1.0);
+    MMSet(cache, "b", 2.0);
+    MMSet(cache, "c", 3.0);
+    
+    // Using "a" makes "b" the least recently used value.
+    MMTAssert(MMGet(cache, "a", NULL), "missing value");
+    MMSet(cache, "d", 4.0);
+    
+    MMTAssertEqual(MMSnapLRUCacheGetCount(cache), 3);
+    MMTAssert(!MMGet(cache, "b", NULL), "least recently used value kept");
+    MMTAssert(MMGet(cache, "a", NULL) && MMGet(cache, "c", NULL) && MMGet(cache, "d", NULL), "recent value evicted");
+    MMTAssertEqual(MMSnapLRUCacheGetStatistics(cache).evictionCount, 1);
+    MMTAssertEqual(MMLiveKeyCount, 3);
+    
+    MMSnapLRUCacheRemoveAllValues(cache);
+    MMTAssertEqual(MMSnapLRUCacheGetCount(cache), 0);
+    MMTAssertEqual(MMLiveKeyCount, 0);
+    
+    // Counters survive removing the values, until they are reset.
+    MMTAssert(MMSnapLRUCacheGetStatistics(cache).hitCount > 0, "counters lost");
+    MMSnapLRUCacheResetStatistics(cache);
+    MMTAssertEqual(MMSnapLRUCacheGetStatistics(cache).hitCount, 0);
+    MMTAssertEqualWithAccuracy(MMSnapLRUCacheGetHitRate(cache), 0.0, 0.0);
+    
+    MMSnapLRUCacheRelease(cache);
+}
+
+// A slow reference, keeping the resident keys in an array from the most to the least recently used.
+typedef struct {
+    long keys[64];
+    long count;
+} MMReference;
+
+static long MMReferenceFind(const MMReference *reference, long k)
+{
+    for (long idx = 0; idx < reference->count; idx++) {
+        if (reference->keys[idx] == k) {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+static void MMReferenceRemove(MMReference *reference, long idx)
+{
+    memmove(&reference->keys[idx], &reference->keys[idx + 1], (size_t)(reference->count - idx - 1) * sizeof(long));
+    reference->count--;
+}
+
+static void MMReferenceUse(MMReference *reference, long k, long capacity)
+{
+    const long idx = MMReferenceFind(reference, k);
+    if (idx >= 0) {
+        MMReferenceRemove(reference, idx);
+    } else if (reference->count == capacity) {
+        reference->count--;
+    }
+    memmove(&reference->keys[1], &reference->keys[0], (size_t)reference->count * sizeof(long));
+    reference->keys[0] = k;
+    reference->count++;
+}
+
+static void testAddressKeysAndRandomizedAgainstReference(void)
+{
+    // Without callbacks, keys are compared by address.
+    enum { capacity = 64, keySpace = 256, operations = 200000 };
+    
+    MMSnapLRUCacheRef cache = MMSnapLRUCacheCreate(NULL, sizeof(long), capacity);
+    MMTAssert(MMSnapLRUCacheCreate(NULL, sizeof(long), 0) == NULL, "empty cache created");
+    
+    MMReference reference = { { 0 }, 0 };
+    long values[keySpace];
+    
+    unsigned int seed = 3;
+    long mismatches = 0;
+    
+    for (long step = 0; step < operations; step++) {
+        seed = seed * 1103515245u + 12345u;
+        const long k = (long)((seed >> 8) % keySpace);
+        const void *key = (const void *)(uintptr_t)((k + 1) * 16);
+        
+        const bool expected = (MMReferenceFind(&reference, k) >= 0);
+        
+        long value = 0;
+        const bool found = MMSnapLRUCacheGetValue(cache, key, &value);
+        if (found != expected || (found && value != values[k])) {
+            mismatches++;
+        }
+        
+        if (!found || (seed & 0x10000)) {
+            values[k] = step;
+            MMSnapLRUCacheSetValue(cache, key, &values[k]);
+        }
+        MMReferenceUse(&reference, k, capacity);
+        
+        if ((seed & 0xff0000) == 0) {
+            MMSnapLRUCacheRemoveValue(cache, key);
+            MMReferenceRemove(&reference, MMReferenceFind(&reference, k));
+        }
+        
+        if (MMSnapLRUCacheGetCount(cache) != reference.count) {
+            mismatches++;
+        }
+    }
+    
+    MMTAssertEqual(mismatches, 0);
+    MMTAssert(MMSnapLRUCacheGetCount(cache) <= capacity, "over capacity");
+    
+    MMSnapLRUCacheRelease(cache);
+}
+
+int main(void)
+{
+    MMTRun(testEqualKeysFindTheirValues);
+    MMTRun(testLeastRecentlyUsedValuesAreEvicted);
+    MMTRun(testAddressKeysAndRandomizedAgainstReference);
+    
+    return MMTExitStatus();
+}
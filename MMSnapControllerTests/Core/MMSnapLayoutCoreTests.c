@@ -0,0 +1,177 @@
+//
+//  MMSnapLayoutCoreTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapLayoutCore.h"
+#include "MMSnapCoreTestSupport.h"
+
+// Ten pages of 320 points in a 640 points wide viewport, like an iPad showing two compact pages side by side.
+static MMSnapLayout MMMakeLayout(MMSnapPageIndexRef pageIndex, double contentOffsetX)
+{
+    MMSnapPageIndexRemoveAllPages(pageIndex);
+    for (long page = 0; page < 10; page++) {
+        MMSnapPageIndexAppendPage(pageIndex, 320.0);
+    }
+    
+    return (MMSnapLayout){
+        .pageIndex = pageIndex,
+        .bounds = { contentOffsetX, 0.0, 640.0, 768.0 },
+        .pageHeight = 768.0,
+        .separatorWidth = 10.0
+    };
+}
+
+static void testPageFramesAndSeparators(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    const MMSnapLayout layout = MMMakeLayout(pageIndex, 0.0);
+    
+    MMSnapLayoutRect frame = MMSnapLayoutGetPageFrame(&layout, 3);
+    MMTAssertEqualWithAccuracy(frame.x, 960.0, 0.0);
+    MMTAssertEqualWithAccuracy(frame.width, 320.0, 0.0);
+    MMTAssertEqualWithAccuracy(frame.height, 768.0, 0.0);
+    
+    frame = MMSnapLayoutGetPageFrame(&layout, 10);
+    MMTAssertEqualWithAccuracy(frame.width, 0.0, 0.0);
+    
+    const MMSnapLayoutRect separator = MMSnapLayoutGetSeparatorRect(&layout, MMSnapLayoutGetPageFrame(&layout, 1));
+    MMTAssertEqualWithAccuracy(separator.x, 310.0, 0.0);
+    MMTAssertEqualWithAccuracy(separator.width, 10.0, 0.0);
+    MMTAssertEqualWithAccuracy(separator.height, 768.0, 0.0);
+    
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+static void testParallax(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    
+    // Halfway through the first page, it moves at half the speed of the content.
+    MMSnapLayout layout = MMMakeLayout(pageIndex, 160.0);
+    
+    double percent = -1.0;
+    MMSnapLayoutRect rect = MMSnapLayoutGetPageRect(&layout, 0, &percent);
+    MMTAssertEqualWithAccuracy(percent, 0.5, 1e-12);
+    MMTAssertEqualWithAccuracy(rect.x, 80.0, 1e-12);
+    
+    // Pages in front of the content offset don't move, and don't report a percentage.
+    percent = -1.0;
+    rect = MMSnapLayoutGetPageRect(&layout, 1, &percent);
+    MMTAssertEqualWithAccuracy(percent, -1.0, 0.0);
+    MMTAssertEqualWithAccuracy(rect.x, 320.0, 0.0);
+    
+    // Fully covered.
+    layout.bounds.x = 400.0;
+    rect = MMSnapLayoutGetPageRect(&layout, 0, &percent);
+    MMTAssertEqualWithAccuracy(percent, 1.0, 0.0);
+    MMTAssertEqualWithAccuracy(rect.x, 240.0, 1e-12);
+    
+    // The last pages can never be covered, so they stay in place even when scrolled past.
+    layout.bounds.x = 2600.0;
+    percent = -1.0;
+    rect = MMSnapLayoutGetPageRect(&layout, 8, &percent);
+    MMTAssertEqualWithAccuracy(percent, -1.0, 0.0);
+    MMTAssertEqualWithAccuracy(rect.x, 2560.0, 0.0);
+    
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+static void testVisiblePages(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    MMSnapLayout layout = MMMakeLayout(pageIndex, 0.0);
+    
+    MMSnapPageRange range = MMSnapLayoutGetVisiblePages(&layout);
+    MMTAssertEqual(range.location, 0);
+    MMTAssertEqual(range.length, 2);
+    
+    layout.bounds.x = 100.0;
+    range = MMSnapLayoutGetVisiblePages(&layout);
+    MMTAssertEqual(range.location, 0);
+    MMTAssertEqual(range.length, 3);
+    
+    // Rectangles outside the pages vertically, or empty, don't contain any page.
+    range = MMSnapLayoutGetPagesInRect(&layout, (MMSnapLayoutRect){ 0.0, 768.0, 640.0, 10.0 });
+    MMTAssertEqual(range.location, MMSnapPageNotFound);
+    MMTAssertEqual(range.length, 0);
+    
+    range = MMSnapLayoutGetPagesInRect(&layout, (MMSnapLayoutRect){ 0.0, 0.0, 0.0, 768.0 });
+    MMTAssertEqual(range.length, 0);
+    
+    range = MMSnapLayoutGetPagesInRect(&layout, (MMSnapLayoutRect){ 3200.0, 0.0, 640.0, 768.0 });
+    MMTAssertEqual(range.length, 0);
+    
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+static void testSnapTargeting(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    const MMSnapLayout layout = MMMakeLayout(pageIndex, 0.0);
+    
+    // Without velocity, the nearest page edge wins.
+    MMTAssertEqualWithAccuracy(MMSnapLayoutGetTargetContentOffsetX(&layout, 1000.0, 0.0), 960.0, 0.0);
+    MMTAssertEqualWithAccuracy(MMSnapLayoutGetTargetContentOffsetX(&layout, 1150.0, 0.0), 1280.0, 0.0);
+    
+    // Velocity picks the direction.
+    MMTAssertEqualWithAccuracy(MMSnapLayoutGetTargetContentOffsetX(&layout, 1000.0, 0.5), 1280.0, 0.0);
+    MMTAssertEqualWithAccuracy(MMSnapLayoutGetTargetContentOffsetX(&layout, 1150.0, -0.5), 960.0, 0.0);
+    
+    // The last page is kept instead of going over the content size.
+    MMTAssertEqualWithAccuracy(MMSnapLayoutGetTargetContentOffsetX(&layout, 2900.0, 0.5), 2880.0, 0.0);
+    
+    // Offsets without pages are kept.
+    MMTAssertEqualWithAccuracy(MMSnapLayoutGetTargetContentOffsetX(&layout, 5000.0, 0.0), 5000.0, 0.0);
+    
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+static void testWindowedLayoutMatchesGlobalLayout(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    const double windowOrigin = 1000.0;
+    
+    for (double offset = windowOrigin; offset <= 2560.0; offset += 37.0) {
+        const MMSnapLayout layout = MMMakeLayout(pageIndex, offset);
+        
+        // The same layout, with the content starting at a global offset.
+        MMSnapLayout windowedLayout = layout;
+        windowedLayout.bounds.x -= windowOrigin;
+        windowedLayout.windowOrigin = windowOrigin;
+        
+        const MMSnapPageRange range = MMSnapLayoutGetVisiblePages(&layout);
+        const MMSnapPageRange windowedRange = MMSnapLayoutGetVisiblePages(&windowedLayout);
+        MMTAssertEqual(windowedRange.location, range.location);
+        MMTAssertEqual(windowedRange.length, range.length);
+        
+        for (long page = range.location; page < range.location + range.length; page++) {
+            double percent = 0.0;
+            double windowedPercent = 0.0;
+            const MMSnapLayoutRect rect = MMSnapLayoutGetPageRect(&layout, page, &percent);
+            const MMSnapLayoutRect windowedRect = MMSnapLayoutGetPageRect(&windowedLayout, page, &windowedPercent);
+            
+            MMTAssertEqualWithAccuracy(windowedRect.x, rect.x - windowOrigin, 0.0);
+            MMTAssertEqualWithAccuracy(windowedRect.width, rect.width, 0.0);
+            MMTAssertEqualWithAccuracy(windowedPercent, percent, 0.0);
+        }
+        
+        const double target = MMSnapLayoutGetTargetContentOffsetX(&layout, offset, 0.5);
+        MMTAssertEqualWithAccuracy(MMSnapLayoutGetTargetContentOffsetX(&windowedLayout, offset - windowOrigin, 0.5), target - windowOrigin, 0.0);
+    }
+    
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+int main(void)
+{
+    MMTRun(testPageFramesAndSeparators);
+    MMTRun(testParallax);
+    MMTRun(testVisiblePages);
+    MMTRun(testSnapTargeting);
+    MMTRun(testWindowedLayoutMatchesGlobalLayout);
+    
+    return MMTExitStatus();
+}
@@ -0,0 +1,174 @@
+//
+//  MMSnapLayoutSnapshotTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapLayoutSnapshot.h"
+#include "MMSnapCoreTestSupport.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const MMSnapLayoutSnapshotKey MMKey = { 1024.0, 768.0, 0x2a };
+
+// Pages of varied widths, like a stack of compact and regular view controllers.
+static MMSnapPageIndexRef MMCreatePageIndex(long count)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    for (long page = 0; page < count; page++) {
+        MMSnapPageIndexAppendPage(pageIndex, (page % 3 == 0) ? 320.0 : 703.5);
+    }
+    return pageIndex;
+}
+
+static unsigned char *MMCreateEncodedSnapshot(long count, size_t *length)
+{
+    MMSnapPageIndexRef pageIndex = MMCreatePageIndex(count);
+    
+    *length = MMSnapLayoutSnapshotGetEncodedSize(count);
+    unsigned char *bytes = malloc(*length);
+    MMTAssertEqual(MMSnapLayoutSnapshotEncode(pageIndex, MMKey, 2048.0, bytes, *length), *length);
+    
+    MMSnapPageIndexRelease(pageIndex);
+    return bytes;
+}
+
+static void testRoundTrip(void)
+{
+    MMSnapPageIndexRef pageIndex = MMCreatePageIndex(1000);
+    
+    size_t length = 0;
+    unsigned char *bytes = MMCreateEncodedSnapshot(1000, &length);
+    MMTAssertEqual(length, 56 + 1000 * 8);
+    
+    MMSnapLayoutSnapshotRef snapshot = MMSnapLayoutSnapshotCreateWithBytes(bytes, length);
+    MMTAssert(snapshot != NULL, "valid snapshot rejected");
+    MMTAssertEqual(MMSnapLayoutSnapshotGetPageCount(snapshot), 1000);
+    MMTAssertEqualWithAccuracy(MMSnapLayoutSnapshotGetContentOffsetX(snapshot), 2048.0, 0.0);
+    MMTAssertEqualWithAccuracy(MMSnapLayoutSnapshotGetWidth(snapshot, 1000), 0.0, 0.0);
+    
+    MMTAssert(MMSnapLayoutSnapshotMatchesKey(snapshot, MMKey), "key doesn't match");
+    MMTAssert(!MMSnapLayoutSnapshotMatchesKey(snapshot, (MMSnapLayoutSnapshotKey){ 768.0, 1024.0, 0x2a }), "rotated key matches");
+    MMTAssert(!MMSnapLayoutSnapshotMatchesKey(snapshot, (MMSnapLayoutSnapshotKey){ 1024.0, 768.0, 0x2b }), "other traits match");
+    
+    // The restored index is valid and lays out exactly like the original one.
+    MMSnapPageIndexRef restoredPageIndex = MMSnapPageIndexCreate();
+    MMSnapPageIndexAppendPage(restoredPageIndex, 10.0);
+    
+    MMTAssert(MMSnapLayoutSnapshotApply(snapshot, restoredPageIndex), "apply failed");
+    MMTAssert(!MMSnapPageIndexNeedsValidation(restoredPageIndex), "restored index needs validation");
+    MMTAssertEqual(MMSnapPageIndexGetCount(restoredPageIndex), 1000);
+    MMTAssertEqualWithAccuracy(MMSnapPageIndexGetContentWidth(restoredPageIndex), MMSnapPageIndexGetContentWidth(pageIndex), 0.0);
+    
+    for (long page = 0; page < 1000; page += 37) {
+        MMTAssertEqualWithAccuracy(MMSnapPageIndexGetOrigin(restoredPageIndex, page), MMSnapPageIndexGetOrigin(pageIndex, page), 0.0);
+        MMTAssertEqualWithAccuracy(MMSnapPageIndexGetWidth(restoredPageIndex, page), MMSnapPageIndexGetWidth(pageIndex, page), 0.0);
+    }
+    
+    MMSnapLayoutSnapshotRelease(snapshot);
+    MMSnapPageIndexRelease(restoredPageIndex);
+    MMSnapPageIndexRelease(pageIndex);
+    free(bytes);
+}
+
+static void testFileRoundTrip(void)
+{
+    char path[] = "/tmp/MMSnapLayoutSnapshotTests.XXXXXX";
+    const int fd = mkstemp(path);
+    MMTAssert(fd >= 0, "couldn't create a temporary file");
+    close(fd);
+    
+    // An empty file isn't a snapshot.
+    MMTAssert(MMSnapLayoutSnapshotOpenFile(path) == NULL, "empty file accepted");
+    
+    MMSnapPageIndexRef pageIndex = MMCreatePageIndex(64);
+    MMTAssert(MMSnapLayoutSnapshotWriteFile(path, pageIndex, MMKey, 320.0), "write failed");
+    
+    MMSnapLayoutSnapshotRef snapshot = MMSnapLayoutSnapshotOpenFile(path);
+    MMTAssert(snapshot != NULL, "written file rejected");
+    MMTAssertEqual(MMSnapLayoutSnapshotGetPageCount(snapshot), 64);
+    MMTAssertEqualWithAccuracy(MMSnapLayoutSnapshotGetWidth(snapshot, 1), 703.5, 0.0);
+    MMTAssertEqual(MMSnapLayoutSnapshotGetKey(snapshot).traits, 0x2a);
+    MMSnapLayoutSnapshotRelease(snapshot);
+    
+    // Page indexes waiting for widths aren't written.
+    MMSnapPageIndexInvalidatePage(pageIndex, 3);
+    MMTAssert(!MMSnapLayoutSnapshotWriteFile(path, pageIndex, MMKey, 320.0), "invalid index written");
+    
+    unlink(path);
+    MMTAssert(MMSnapLayoutSnapshotOpenFile(path) == NULL, "missing file opened");
+    
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+static void testCorruptSnapshotsAreRejected(void)
+{
+    size_t length = 0;
+    unsigned char *bytes = MMCreateEncodedSnapshot(16, &length);
+    unsigned char *corrupt = malloc(length + 8);
+    
+    // Truncated anywhere, header included.
+    for (size_t truncatedLength = 0; truncatedLength < length; truncatedLength += 5) {
+        MMTAssert(MMSnapLayoutSnapshotCreateWithBytes(bytes, truncatedLength) == NULL, "truncated at %zu", truncatedLength);
+    }
+    
+    // Trailing bytes.
+    memcpy(corrupt, bytes, length);
+    MMTAssert(MMSnapLayoutSnapshotCreateWithBytes(corrupt, length + 8) == NULL, "trailing bytes accepted");
+    
+    // Any flipped bit, whether in the magic, the version, the header or a width.
+    for (size_t offset = 0; offset < length; offset++) {
+        memcpy(corrupt, bytes, length);
+        corrupt[offset] ^= 0x10;
+        MMTAssert(MMSnapLayoutSnapshotCreateWithBytes(corrupt, length) == NULL, "flipped bit at %zu accepted", offset);
+    }
+    
+    // Another version of the format, even with a valid checksum.
+    MMSnapPageIndexRef pageIndex = MMCreatePageIndex(16);
+    memcpy(corrupt, bytes, length);
+    corrupt[4] = MMSnapLayoutSnapshotVersion + 1;
+    MMTAssert(MMSnapLayoutSnapshotCreateWithBytes(corrupt, length) == NULL, "other version accepted");
+    
+    // A buffer too small to encode into.
+    MMTAssertEqual(MMSnapLayoutSnapshotEncode(pageIndex, MMKey, 0.0, corrupt, length - 1), 0);
+    
+    // The original is still fine.
+    MMSnapLayoutSnapshotRef snapshot = MMSnapLayoutSnapshotCreateWithBytes(bytes, length);
+    MMTAssert(snapshot != NULL, "valid snapshot rejected");
+    MMSnapLayoutSnapshotRelease(snapshot);
+    
+    MMSnapPageIndexRelease(pageIndex);
+    free(corrupt);
+    free(bytes);
+}
+
+static void testEmptyLayout(void)
+{
+    size_t length = 0;
+    unsigned char *bytes = MMCreateEncodedSnapshot(0, &length);
+    MMTAssertEqual(length, 56);
+    
+    MMSnapLayoutSnapshotRef snapshot = MMSnapLayoutSnapshotCreateWithBytes(bytes, length);
+    MMTAssert(snapshot != NULL, "empty snapshot rejected");
+    
+    MMSnapPageIndexRef pageIndex = MMCreatePageIndex(3);
+    MMTAssert(MMSnapLayoutSnapshotApply(snapshot, pageIndex), "apply failed");
+    MMTAssertEqual(MMSnapPageIndexGetCount(pageIndex), 0);
+    
+    MMSnapLayoutSnapshotRelease(snapshot);
+    MMSnapPageIndexRelease(pageIndex);
+    free(bytes);
+}
+
+int main(void)
+{
+    MMTRun(testRoundTrip);
+    MMTRun(testFileRoundTrip);
+    MMTRun(testCorruptSnapshotsAreRejected);
+    MMTRun(testEmptyLayout);
+    
+    return MMTExitStatus();
+}
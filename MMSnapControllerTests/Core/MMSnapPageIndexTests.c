@@ -0,0 +1,267 @@
+//
+//  MMSnapPageIndexTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapPageIndex.h"
+#include "MMSnapCoreTestSupport.h"
+
+#include <stdlib.h>
+
+static MMSnapPageRange MMLinearPagesInRange(const double *widths, long count, double minX, double maxX)
+{
+    MMSnapPageRange range = { 0, 0 };
+    double origin = 0.0;
+    
+    for (long page = 0; page < count; page++) {
+        const double end = origin + widths[page];
+        if (maxX > minX && origin < maxX && end > minX) {
+            if (range.length == 0) {
+                range.location = page;
+            }
+            range.length++;
+        }
+        origin = end;
+    }
+    return range;
+}
+
+static void testEmptyIndex(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    
+    MMTAssertEqual(MMSnapPageIndexGetCount(pageIndex), 0);
+    MMTAssertEqualWithAccuracy(MMSnapPageIndexGetContentWidth(pageIndex), 0.0, 0.0);
+    MMTAssertEqual(MMSnapPageIndexGetPagesInRange(pageIndex, 0.0, 100.0).length, 0);
+    MMTAssertEqual(MMSnapPageIndexGetPageAtOffset(pageIndex, 0.0), MMSnapPageNotFound);
+    
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+static void testOriginsArePrefixSums(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    
+    MMSnapPageIndexAppendPage(pageIndex, 320.0);
+    MMSnapPageIndexAppendPage(pageIndex, 704.0);
+    MMSnapPageIndexAppendPage(pageIndex, -10.0);
+    MMSnapPageIndexAppendPage(pageIndex, 1024.0);
+    
+    MMTAssertEqual(MMSnapPageIndexGetCount(pageIndex), 4);
+    MMTAssertEqualWithAccuracy(MMSnapPageIndexGetOrigin(pageIndex, 1), 320.0, 0.0);
+    MMTAssertEqualWithAccuracy(MMSnapPageIndexGetWidth(pageIndex, 2), 0.0, 0.0);
+    MMTAssertEqualWithAccuracy(MMSnapPageIndexGetOrigin(pageIndex, 3), 1024.0, 0.0);
+    MMTAssertEqualWithAccuracy(MMSnapPageIndexGetContentWidth(pageIndex), 2048.0, 0.0);
+    
+    MMSnapPageIndexRemoveAllPages(pageIndex);
+    MMTAssertEqual(MMSnapPageIndexGetCount(pageIndex), 0);
+    
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+static void testTouchingEdgesDoNotIntersect(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    
+    for (int i = 0; i < 4; i++) {
+        MMSnapPageIndexAppendPage(pageIndex, 100.0);
+    }
+    
+    MMSnapPageRange range = MMSnapPageIndexGetPagesInRange(pageIndex, 100.0, 200.0);
+    MMTAssertEqual(range.location, 1);
+    MMTAssertEqual(range.length, 1);
+    
+    range = MMSnapPageIndexGetPagesInRange(pageIndex, 150.0, 250.0);
+    MMTAssertEqual(range.location, 1);
+    MMTAssertEqual(range.length, 2);
+    
+    range = MMSnapPageIndexGetPagesInRange(pageIndex, 400.0, 500.0);
+    MMTAssertEqual(range.length, 0);
+    
+    MMTAssertEqual(MMSnapPageIndexGetPageAtOffset(pageIndex, 100.0), 1);
+    MMTAssertEqual(MMSnapPageIndexGetPageAtOffset(pageIndex, 400.0), MMSnapPageNotFound);
+    
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+static void testRangeQueriesMatchLinearScan(void)
+{
+    const long count = 2000;
+    double *widths = malloc((size_t)count * sizeof(double));
+    
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    
+    srand(42);
+    for (long page = 0; page < count; page++) {
+        widths[page] = (double)(rand() % 4) * 160.0;
+        MMSnapPageIndexAppendPage(pageIndex, widths[page]);
+    }
+    
+    const double contentWidth = MMSnapPageIndexGetContentWidth(pageIndex);
+    
+    for (int i = 0; i < 5000; i++) {
+        const double minX = fmod((double)rand(), contentWidth + 500.0) - 250.0;
+        const double maxX = minX + (double)(rand() % 1500);
+        
+        const MMSnapPageRange expected = MMLinearPagesInRange(widths, count, minX, maxX);
+        const MMSnapPageRange range = MMSnapPageIndexGetPagesInRange(pageIndex, minX, maxX);
+        
+        MMTAssertEqual(range.length, expected.length);
+        if (expected.length > 0) {
+            MMTAssertEqual(range.location, expected.location);
+        }
+    }
+    
+    MMSnapPageIndexRelease(pageIndex);
+    free(widths);
+}
+
+static double MMTestWidthForPage(long page, void *context)
+{
+    long *queries = context;
+    (*queries)++;
+    return (page % 2 == 0) ? 320.0 : 704.0;
+}
+
+static void MMAssertOriginsArePrefixSums(MMSnapPageIndexRef pageIndex)
+{
+    double origin = 0.0;
+    for (long page = 0; page < MMSnapPageIndexGetCount(pageIndex); page++) {
+        MMTAssertEqualWithAccuracy(MMSnapPageIndexGetOrigin(pageIndex, page), origin, 0.0);
+        origin += MMSnapPageIndexGetWidth(pageIndex, page);
+    }
+    MMTAssertEqualWithAccuracy(MMSnapPageIndexGetContentWidth(pageIndex), origin, 0.0);
+}
+
+static void testPushAtEndQueriesOneWidth(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    long queries = 0;
+    
+    MMSnapPageIndexInsertPages(pageIndex, 0, 500);
+    MMTAssert(MMSnapPageIndexNeedsValidation(pageIndex), "inserted pages must be validated");
+    MMTAssertEqual(MMSnapPageIndexValidate(pageIndex, MMTestWidthForPage, &queries), 500);
+    
+    MMSnapPageIndexInsertPages(pageIndex, 500, 1);
+    MMTAssertEqual(MMSnapPageIndexValidate(pageIndex, MMTestWidthForPage, &queries), 1);
+    MMTAssertEqual(MMSnapPageIndexGetLastValidationQueryCount(pageIndex), 1);
+    MMTAssertEqual(queries, 501);
+    MMTAssertEqual(MMSnapPageIndexGetCount(pageIndex), 501);
+    
+    MMAssertOriginsArePrefixSums(pageIndex);
+    
+    // Nothing invalidated, nothing queried.
+    MMTAssertEqual(MMSnapPageIndexValidate(pageIndex, MMTestWidthForPage, &queries), 0);
+    
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+static void testRemovingPagesShiftsFollowingOrigins(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    long queries = 0;
+    
+    MMSnapPageIndexInsertPages(pageIndex, 0, 10);
+    MMSnapPageIndexValidate(pageIndex, MMTestWidthForPage, &queries);
+    
+    const double widthOfThirdPage = MMSnapPageIndexGetWidth(pageIndex, 3);
+    
+    MMSnapPageIndexRemovePages(pageIndex, 1, 2);
+    MMTAssertEqual(MMSnapPageIndexGetCount(pageIndex), 8);
+    MMTAssertEqualWithAccuracy(MMSnapPageIndexGetWidth(pageIndex, 1), widthOfThirdPage, 0.0);
+    MMTAssertEqual(MMSnapPageIndexValidate(pageIndex, MMTestWidthForPage, &queries), 0);
+    MMAssertOriginsArePrefixSums(pageIndex);
+    
+    // Popping past the end is clamped.
+    MMSnapPageIndexRemovePages(pageIndex, 5, 100);
+    MMTAssertEqual(MMSnapPageIndexGetCount(pageIndex), 5);
+    MMAssertOriginsArePrefixSums(pageIndex);
+    
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+static void testInvalidatingPagesQueriesOnlyThosePages(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    long queries = 0;
+    
+    MMSnapPageIndexInsertPages(pageIndex, 0, 100);
+    MMSnapPageIndexValidate(pageIndex, MMTestWidthForPage, &queries);
+    
+    MMSnapPageIndexSetWidth(pageIndex, 10, 1.0);
+    MMSnapPageIndexInvalidatePage(pageIndex, 10);
+    MMSnapPageIndexInvalidatePage(pageIndex, 60);
+    MMTAssertEqual(MMSnapPageIndexValidate(pageIndex, MMTestWidthForPage, &queries), 2);
+    MMTAssertEqualWithAccuracy(MMSnapPageIndexGetWidth(pageIndex, 10), 320.0, 0.0);
+    MMAssertOriginsArePrefixSums(pageIndex);
+    
+    // Inserting before an invalidated page keeps tracking it at its new location.
+    MMSnapPageIndexInvalidatePage(pageIndex, 50);
+    MMSnapPageIndexInsertPages(pageIndex, 20, 3);
+    MMSnapPageIndexRemovePages(pageIndex, 0, 1);
+    MMTAssertEqual(MMSnapPageIndexValidate(pageIndex, MMTestWidthForPage, &queries), 4);
+    MMTAssertEqual(MMSnapPageIndexGetCount(pageIndex), 102);
+    MMAssertOriginsArePrefixSums(pageIndex);
+    
+    MMSnapPageIndexInvalidateAllPages(pageIndex);
+    MMTAssertEqual(MMSnapPageIndexValidate(pageIndex, MMTestWidthForPage, &queries), 102);
+    
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+typedef struct {
+    MMSnapPageIndexRef pageIndex;
+    long queries;
+    int invalidates;
+} MMReentrantContext;
+
+static double MMReentrantWidthForPage(long page, void *context)
+{
+    MMReentrantContext *reentrantContext = context;
+    reentrantContext->queries++;
+    
+    // Measuring the third page invalidates itself and a page after the range being validated.
+    if (page == 2 && reentrantContext->invalidates) {
+        reentrantContext->invalidates = 0;
+        MMSnapPageIndexInvalidatePage(reentrantContext->pageIndex, 2);
+        MMSnapPageIndexInvalidatePage(reentrantContext->pageIndex, 8);
+    }
+    return 100.0;
+}
+
+static void testInvalidationsFromTheWidthFunctionAreKept(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    MMReentrantContext context = { pageIndex, 0, 1 };
+    
+    MMSnapPageIndexInsertPages(pageIndex, 0, 10);
+    MMTAssertEqual(MMSnapPageIndexValidate(pageIndex, MMTestWidthForPage, &context.queries), 10);
+    
+    MMSnapPageIndexInvalidatePage(pageIndex, 1);
+    MMSnapPageIndexInvalidatePage(pageIndex, 2);
+    MMTAssertEqual(MMSnapPageIndexValidate(pageIndex, MMReentrantWidthForPage, &context), 2);
+    MMTAssert(MMSnapPageIndexNeedsValidation(pageIndex), "pages invalidated while measuring must be validated");
+    
+    MMTAssertEqual(MMSnapPageIndexValidate(pageIndex, MMReentrantWidthForPage, &context), 2);
+    MMTAssert(!MMSnapPageIndexNeedsValidation(pageIndex), "validated pages must not need validation");
+    MMTAssertEqualWithAccuracy(MMSnapPageIndexGetWidth(pageIndex, 8), 100.0, 0.0);
+    MMAssertOriginsArePrefixSums(pageIndex);
+    
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+int main(void)
+{
+    MMTRun(testEmptyIndex);
+    MMTRun(testOriginsArePrefixSums);
+    MMTRun(testTouchingEdgesDoNotIntersect);
+    MMTRun(testRangeQueriesMatchLinearScan);
+    MMTRun(testPushAtEndQueriesOneWidth);
+    MMTRun(testRemovingPagesShiftsFollowingOrigins);
+    MMTRun(testInvalidatingPagesQueriesOnlyThosePages);
+    MMTRun(testInvalidationsFromTheWidthFunctionAreKept);
+    
+    return MMTExitStatus();
+}
@@ -0,0 +1,165 @@
+//
+//  MMSnapPageRingTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapPageRing.h"
+#include "MMSnapPageIndex.h"
+#include "MMSnapCoreTestSupport.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MMElement(x) ((const void *)(uintptr_t)(x))
+
+static long MMRetainCount = 0;
+
+static const void *MMRetain(const void *value)
+{
+    MMRetainCount++;
+    return value;
+}
+
+static void MMRelease(const void *value)
+{
+    (void)value;
+    MMRetainCount--;
+}
+
+static const MMSnapPageRingCallbacks MMCountingCallbacks = { MMRetain, MMRelease };
+
+static void testSetGetAndLocate(void)
+{
+    MMSnapPageRingRef ring = MMSnapPageRingCreate(&MMCountingCallbacks);
+    
+    MMTAssertEqual(MMSnapPageRingGetPageCount(ring), 0);
+    MMTAssert(MMSnapPageRingGetElement(ring, 3, MMSnapPageRingElementView) == NULL, "empty ring returned an element");
+    
+    MMSnapPageRingSetElement(ring, 5, MMSnapPageRingElementView, MMElement(0x50));
+    MMSnapPageRingSetElement(ring, 5, MMSnapPageRingElementSeparator, MMElement(0x58));
+    MMSnapPageRingSetElement(ring, 3, MMSnapPageRingElementView, MMElement(0x30));
+    
+    MMTAssertEqual(MMSnapPageRingGetFirstPage(ring), 3);
+    MMTAssertEqual(MMSnapPageRingGetPageCount(ring), 3);
+    MMTAssertEqual(MMSnapPageRingGetElementCount(ring, MMSnapPageRingElementView), 2);
+    MMTAssertEqual(MMSnapPageRingGetElementCount(ring, MMSnapPageRingElementSeparator), 1);
+    MMTAssert(MMSnapPageRingGetElement(ring, 4, MMSnapPageRingElementView) == NULL, "hole returned an element");
+    MMTAssert(MMSnapPageRingGetElement(ring, 5, MMSnapPageRingElementSeparator) == MMElement(0x58), "wrong separator");
+    MMTAssertEqual(MMSnapPageRingGetPageOfElement(ring, MMElement(0x58)), 5);
+    MMTAssertEqual(MMSnapPageRingGetPageOfElement(ring, MMElement(0x30)), 3);
+    MMTAssertEqual(MMSnapPageRingGetPageOfElement(ring, MMElement(0x40)), MMSnapPageNotFound);
+    MMTAssertEqual(MMRetainCount, 3);
+    
+    // Removing the first page trims the run.
+    MMSnapPageRingSetElement(ring, 3, MMSnapPageRingElementView, NULL);
+    MMTAssertEqual(MMSnapPageRingGetFirstPage(ring), 5);
+    MMTAssertEqual(MMSnapPageRingGetPageCount(ring), 1);
+    MMTAssertEqual(MMSnapPageRingGetPageOfElement(ring, MMElement(0x30)), MMSnapPageNotFound);
+    
+    // Storing an element again moves it.
+    MMSnapPageRingSetElement(ring, 6, MMSnapPageRingElementView, MMElement(0x50));
+    MMTAssert(MMSnapPageRingGetElement(ring, 5, MMSnapPageRingElementView) == NULL, "moved element left behind");
+    MMTAssertEqual(MMSnapPageRingGetPageOfElement(ring, MMElement(0x50)), 6);
+    MMTAssertEqual(MMRetainCount, 2);
+    
+    MMSnapPageRingRelease(ring);
+    MMTAssertEqual(MMRetainCount, 0);
+}
+
+static void testScrollingAcrossManyPagesWrapsAround(void)
+{
+    MMSnapPageRingRef ring = MMSnapPageRingCreate(NULL);
+    const unsigned long mutations = MMSnapPageRingGetMutationCount(ring);
+    
+    // Slide a window of three pages forward and back, the way scrolling adds and removes pages at the ends.
+    for (long page = 0; page < 1000; page++) {
+        MMSnapPageRingSetElement(ring, page + 2, MMSnapPageRingElementView, MMElement(0x1000 + (page + 2) * 16));
+        if (page > 0) {
+            MMSnapPageRingSetElement(ring, page - 1, MMSnapPageRingElementView, NULL);
+        }
+        if (page == 0) {
+            MMSnapPageRingSetElement(ring, 0, MMSnapPageRingElementView, MMElement(0x1000));
+            MMSnapPageRingSetElement(ring, 1, MMSnapPageRingElementView, MMElement(0x1000 + 16));
+        }
+        
+        MMTAssertEqual(MMSnapPageRingGetFirstPage(ring), page);
+        MMTAssertEqual(MMSnapPageRingGetPageCount(ring), 3);
+        for (long visible = page; visible < page + 3; visible++) {
+            MMTAssert(MMSnapPageRingGetElement(ring, visible, MMSnapPageRingElementView) == MMElement(0x1000 + visible * 16), "page %ld", visible);
+            MMTAssertEqual(MMSnapPageRingGetPageOfElement(ring, MMElement(0x1000 + visible * 16)), visible);
+        }
+    }
+    
+    for (long page = 999; page > 0; page--) {
+        MMSnapPageRingSetElement(ring, page - 1, MMSnapPageRingElementView, MMElement(0x1000 + (page - 1) * 16));
+        MMSnapPageRingSetElement(ring, page + 2, MMSnapPageRingElementView, NULL);
+        
+        MMTAssertEqual(MMSnapPageRingGetFirstPage(ring), page - 1);
+        MMTAssertEqual(MMSnapPageRingGetPageCount(ring), 3);
+        MMTAssertEqual(MMSnapPageRingGetPageOfElement(ring, MMElement(0x1000 + (page - 1) * 16)), page - 1);
+    }
+    
+    MMTAssert(MMSnapPageRingGetMutationCount(ring) != mutations, "mutations not counted");
+    
+    MMSnapPageRingRelease(ring);
+}
+
+static void testRandomOperationsMatchModel(void)
+{
+    enum { PageCount = 64 };
+    const void *model[PageCount][MMSnapPageRingElementCount] = { { NULL } };
+    
+    MMSnapPageRingRef ring = MMSnapPageRingCreate(&MMCountingCallbacks);
+    
+    srand(9);
+    for (int iteration = 0; iteration < 20000; iteration++) {
+        const long page = 20 + rand() % 24;
+        const MMSnapPageRingElement element = rand() % MMSnapPageRingElementCount;
+        const void *value = (rand() % 3 == 0) ? NULL : MMElement(0x100 + (rand() % 40) * 8);
+        
+        // The model moves the element as well.
+        if (value) {
+            for (long p = 0; p < PageCount; p++) {
+                for (int e = 0; e < MMSnapPageRingElementCount; e++) {
+                    if (model[p][e] == value) {
+                        model[p][e] = NULL;
+                    }
+                }
+            }
+        }
+        model[page][element] = value;
+        
+        MMTAssert(MMSnapPageRingSetElement(ring, page, element, value), "set failed");
+        
+        if (iteration % 97 == 0) {
+            long retained = 0;
+            for (long p = 0; p < PageCount; p++) {
+                for (int e = 0; e < MMSnapPageRingElementCount; e++) {
+                    MMTAssert(MMSnapPageRingGetElement(ring, p, e) == model[p][e], "iteration %d page %ld", iteration, p);
+                    if (model[p][e]) {
+                        MMTAssertEqual(MMSnapPageRingGetPageOfElement(ring, model[p][e]), p);
+                        retained++;
+                    }
+                }
+            }
+            MMTAssertEqual(MMRetainCount, retained);
+        }
+    }
+    
+    MMSnapPageRingRemoveAllElements(ring);
+    MMTAssertEqual(MMRetainCount, 0);
+    MMTAssertEqual(MMSnapPageRingGetPageCount(ring), 0);
+    
+    MMSnapPageRingRelease(ring);
+}
+
+int main(void)
+{
+    MMTRun(testSetGetAndLocate);
+    MMTRun(testScrollingAcrossManyPagesWrapsAround);
+    MMTRun(testRandomOperationsMatchModel);
+    
+    return MMTExitStatus();
+}
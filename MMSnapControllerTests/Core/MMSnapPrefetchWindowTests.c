@@ -0,0 +1,94 @@
+//
+//  MMSnapPrefetchWindowTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapPrefetchWindow.h"
+#include "MMSnapCoreTestSupport.h"
+
+static void testWindowFollowsDirection(void)
+{
+    const MMSnapPageRange visible = { 10, 2 };
+    
+    MMSnapPrefetchWindow window = MMSnapPrefetchWindowMake(visible, 100, 1, 2);
+    MMTAssertEqual(window.leading.length, 0);
+    MMTAssertEqual(window.trailing.location, 12);
+    MMTAssertEqual(window.trailing.length, 2);
+    
+    window = MMSnapPrefetchWindowMake(visible, 100, -1, 2);
+    MMTAssertEqual(window.leading.location, 8);
+    MMTAssertEqual(window.leading.length, 2);
+    MMTAssertEqual(window.trailing.length, 0);
+    
+    window = MMSnapPrefetchWindowMake(visible, 100, 0, 2);
+    MMTAssertEqual(window.leading.location, 9);
+    MMTAssertEqual(window.leading.length, 1);
+    MMTAssertEqual(window.trailing.location, 12);
+    MMTAssertEqual(window.trailing.length, 1);
+    MMTAssertEqual(MMSnapPrefetchWindowGetPageCount(&window), 2);
+    
+    MMTAssert(MMSnapPrefetchWindowContainsPage(&window, 9), "leading page missing");
+    MMTAssert(!MMSnapPrefetchWindowContainsPage(&window, 10), "visible page in window");
+}
+
+static void testWindowIsClampedToThePages(void)
+{
+    MMSnapPrefetchWindow window = MMSnapPrefetchWindowMake((MMSnapPageRange){ 0, 2 }, 3, 0, 2);
+    MMTAssertEqual(window.leading.length, 0);
+    MMTAssertEqual(window.trailing.location, 2);
+    MMTAssertEqual(window.trailing.length, 1);
+    
+    window = MMSnapPrefetchWindowMake((MMSnapPageRange){ 1, 2 }, 3, 1, 4);
+    MMTAssertEqual(window.trailing.length, 0);
+    
+    window = MMSnapPrefetchWindowMake((MMSnapPageRange){ 1, 2 }, 3, -1, 4);
+    MMTAssertEqual(window.leading.location, 0);
+    MMTAssertEqual(window.leading.length, 1);
+    
+    window = MMSnapPrefetchWindowMake((MMSnapPageRange){ 0, 0 }, 3, 1, 2);
+    MMTAssertEqual(MMSnapPrefetchWindowGetPageCount(&window), 0);
+}
+
+static void testScrollingForwardPrefetchesNewPagesAndCancelsStaleOnes(void)
+{
+    long pages[8];
+    
+    // Scrolling forward by one page: 12 became visible, 14 is new. Nothing is stale.
+    const MMSnapPrefetchWindow previous = MMSnapPrefetchWindowMake((MMSnapPageRange){ 10, 2 }, 100, 1, 2);
+    const MMSnapPrefetchWindow next = MMSnapPrefetchWindowMake((MMSnapPageRange){ 11, 2 }, 100, 1, 2);
+    
+    long count = MMSnapPrefetchWindowCopyPagesNotInWindow(&next, &previous, (MMSnapPageRange){ 0, 0 }, pages, 8);
+    MMTAssertEqual(count, 1);
+    MMTAssertEqual(pages[0], 14);
+    
+    count = MMSnapPrefetchWindowCopyPagesNotInWindow(&previous, &next, (MMSnapPageRange){ 11, 2 }, pages, 8);
+    MMTAssertEqual(count, 0);
+    
+    // Reversing drops the pages ahead and prefetches the ones behind.
+    const MMSnapPrefetchWindow reversed = MMSnapPrefetchWindowMake((MMSnapPageRange){ 11, 2 }, 100, -1, 2);
+    
+    count = MMSnapPrefetchWindowCopyPagesNotInWindow(&next, &reversed, (MMSnapPageRange){ 11, 2 }, pages, 8);
+    MMTAssertEqual(count, 2);
+    MMTAssertEqual(pages[0], 13);
+    MMTAssertEqual(pages[1], 14);
+    
+    count = MMSnapPrefetchWindowCopyPagesNotInWindow(&reversed, &next, (MMSnapPageRange){ 0, 0 }, pages, 8);
+    MMTAssertEqual(count, 2);
+    MMTAssertEqual(pages[0], 9);
+    MMTAssertEqual(pages[1], 10);
+    
+    // The buffer capacity is honored.
+    count = MMSnapPrefetchWindowCopyPagesNotInWindow(&reversed, &next, (MMSnapPageRange){ 0, 0 }, pages, 1);
+    MMTAssertEqual(count, 1);
+}
+
+int main(void)
+{
+    MMTRun(testWindowFollowsDirection);
+    MMTRun(testWindowIsClampedToThePages);
+    MMTRun(testScrollingForwardPrefetchesNewPagesAndCancelsStaleOnes);
+    
+    return MMTExitStatus();
+}
@@ -0,0 +1,127 @@
+//
+//  MMSnapRasterizationPolicyTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapRasterizationPolicy.h"
+#include "MMSnapCoreTestSupport.h"
+
+// Pages are identified by address, any distinct pointers will do.
+static char MMPages[16];
+
+static const unsigned long long MMSnapshotByteCount = 4ULL * 1024ULL * 1024ULL;
+
+static void testPagesSwapWithHysteresis(void)
+{
+    MMSnapRasterizationPolicyRef policy = MMSnapRasterizationPolicyCreate();
+    const void *page = &MMPages[0];
+    
+    // Sliding behind the next page.
+    MMTAssertEqual(MMSnapRasterizationPolicyUpdate(policy, page, 0.0), MMSnapRasterizationActionNone);
+    MMTAssertEqual(MMSnapRasterizationPolicyUpdate(policy, page, 0.15), MMSnapRasterizationActionNone);
+    MMTAssertEqual(MMSnapRasterizationPolicyUpdate(policy, page, 0.2), MMSnapRasterizationActionRasterize);
+    MMTAssert(MMSnapRasterizationPolicySetSnapshot(policy, page, MMSnapshotByteCount), "snapshot rejected");
+    MMTAssert(MMSnapRasterizationPolicyIsDisplayingSnapshot(policy, page), "snapshot not displayed");
+    
+    // Resting around the threshold keeps the snapshot.
+    MMTAssertEqual(MMSnapRasterizationPolicyUpdate(policy, page, 0.8), MMSnapRasterizationActionNone);
+    MMTAssertEqual(MMSnapRasterizationPolicyUpdate(policy, page, 0.15), MMSnapRasterizationActionNone);
+    MMTAssertEqual(MMSnapRasterizationPolicyUpdate(policy, page, 0.21), MMSnapRasterizationActionNone);
+    
+    // Re-emerging.
+    MMTAssertEqual(MMSnapRasterizationPolicyUpdate(policy, page, 0.05), MMSnapRasterizationActionShowLiveView);
+    MMTAssertEqual(MMSnapRasterizationPolicyUpdate(policy, page, 0.15), MMSnapRasterizationActionNone);
+    
+    // Sliding behind again reuses the cached snapshot.
+    MMTAssertEqual(MMSnapRasterizationPolicyUpdate(policy, page, 0.5), MMSnapRasterizationActionShowSnapshot);
+    
+    const MMSnapRasterizationStatistics statistics = MMSnapRasterizationPolicyGetStatistics(policy);
+    MMTAssertEqual(statistics.rasterizeCount, 1);
+    MMTAssertEqual(statistics.reuseCount, 1);
+    MMTAssertEqual(statistics.restoreCount, 1);
+    
+    MMSnapRasterizationPolicyRelease(policy);
+}
+
+static void testInvalidation(void)
+{
+    MMSnapRasterizationPolicyRef policy = MMSnapRasterizationPolicyCreate();
+    const void *page = &MMPages[0];
+    
+    MMSnapRasterizationPolicyUpdate(policy, page, 0.5);
+    MMSnapRasterizationPolicySetSnapshot(policy, page, MMSnapshotByteCount);
+    
+    // Content changed while displayed as a snapshot, the live view comes back and is snapshotted again.
+    MMTAssert(MMSnapRasterizationPolicyInvalidate(policy, page), "displayed snapshot not reported");
+    MMTAssertEqual(MMSnapRasterizationPolicyGetByteCount(policy), 0);
+    MMTAssertEqual(MMSnapRasterizationPolicyUpdate(policy, page, 0.5), MMSnapRasterizationActionRasterize);
+    MMSnapRasterizationPolicySetSnapshot(policy, page, MMSnapshotByteCount);
+    
+    // Hidden pages keep their snapshot cached, but it's no longer displayed.
+    MMTAssert(MMSnapRasterizationPolicyHide(policy, page), "displayed snapshot not reported");
+    MMTAssert(!MMSnapRasterizationPolicyHide(policy, page), "hidden twice");
+    MMTAssert(MMSnapRasterizationPolicyContainsSnapshot(policy, page), "snapshot forgotten");
+    MMTAssert(!MMSnapRasterizationPolicyInvalidate(policy, page), "hidden snapshot reported as displayed");
+    MMTAssert(!MMSnapRasterizationPolicyContainsSnapshot(policy, page), "snapshot kept");
+    
+    MMSnapRasterizationPolicyRelease(policy);
+}
+
+static void testBudget(void)
+{
+    MMSnapRasterizationPolicyRef policy = MMSnapRasterizationPolicyCreate();
+    
+    MMSnapRasterizationConfiguration configuration = MMSnapRasterizationConfigurationDefault();
+    configuration.maximumByteCount = 3 * MMSnapshotByteCount;
+    MMSnapRasterizationPolicySetConfiguration(policy, configuration);
+    
+    const void *keys[16];
+    
+    // Six pages scroll behind and out, one at a time.
+    for (long page = 0; page < 6; page++) {
+        MMTAssertEqual(MMSnapRasterizationPolicyUpdate(policy, &MMPages[page], 0.5), MMSnapRasterizationActionRasterize);
+        MMTAssert(MMSnapRasterizationPolicySetSnapshot(policy, &MMPages[page], MMSnapshotByteCount), "snapshot %ld rejected", page);
+        MMSnapRasterizationPolicyHide(policy, &MMPages[page]);
+        
+        // Keeping the snapshots of the most recent pages.
+        const long evictedCount = MMSnapRasterizationPolicyEvict(policy, configuration.maximumByteCount, keys, 16);
+        MMTAssertEqual(evictedCount, (page >= 3) ? 1 : 0);
+        if (evictedCount > 0) {
+            MMTAssert(keys[0] == &MMPages[page - 3], "evicted the wrong snapshot");
+        }
+    }
+    MMTAssertEqual(MMSnapRasterizationPolicyGetCount(policy), 3);
+    MMTAssertEqual(MMSnapRasterizationPolicyGetStatistics(policy).evictionCount, 3);
+    
+    // Displayed snapshots are never evicted, and new ones are refused when displayed ones fill the budget.
+    for (long page = 6; page < 9; page++) {
+        MMSnapRasterizationPolicyUpdate(policy, &MMPages[page], 0.5);
+        MMTAssert(MMSnapRasterizationPolicySetSnapshot(policy, &MMPages[page], MMSnapshotByteCount), "snapshot %ld rejected", page);
+    }
+    MMTAssertEqual(MMSnapRasterizationPolicyEvict(policy, configuration.maximumByteCount, keys, 16), 3);
+    MMTAssertEqual(MMSnapRasterizationPolicyUpdate(policy, &MMPages[9], 0.5), MMSnapRasterizationActionRasterize);
+    MMTAssert(!MMSnapRasterizationPolicySetSnapshot(policy, &MMPages[9], MMSnapshotByteCount), "snapshot over budget accepted");
+    MMTAssertEqual(MMSnapRasterizationPolicyGetByteCount(policy), configuration.maximumByteCount);
+    
+    // A memory warning discards everything that isn't displayed.
+    MMSnapRasterizationPolicyHide(policy, &MMPages[6]);
+    MMTAssertEqual(MMSnapRasterizationPolicyEvict(policy, 0, keys, 16), 1);
+    MMTAssert(keys[0] == &MMPages[6], "evicted the wrong snapshot");
+    MMTAssertEqual(MMSnapRasterizationPolicyGetCount(policy), 2);
+    
+    MMSnapRasterizationPolicyRemoveAll(policy);
+    MMTAssertEqual(MMSnapRasterizationPolicyGetByteCount(policy), 0);
+    
+    MMSnapRasterizationPolicyRelease(policy);
+}
+
+int main(void)
+{
+    MMTRun(testPagesSwapWithHysteresis);
+    MMTRun(testInvalidation);
+    MMTRun(testBudget);
+    
+    return MMTExitStatus();
+}
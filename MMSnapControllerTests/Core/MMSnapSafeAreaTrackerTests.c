@@ -0,0 +1,191 @@
+//
+//  MMSnapSafeAreaTrackerTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapSafeAreaTracker.h"
+#include "MMSnapCoreTestSupport.h"
+
+// Pages are identified by address, any distinct pointers will do.
+static char MMPages[64];
+
+static const void *MMKeys[64];
+
+// Forty pages of 320 points in a 1024 points wide viewport.
+static MMSnapLayout MMMakeLayout(MMSnapPageIndexRef pageIndex, double contentOffsetX)
+{
+    if (MMSnapPageIndexGetCount(pageIndex) == 0) {
+        for (long page = 0; page < 40; page++) {
+            MMSnapPageIndexAppendPage(pageIndex, 320.0);
+            MMKeys[page] = &MMPages[page];
+        }
+    }
+    
+    return (MMSnapLayout){
+        .pageIndex = pageIndex,
+        .bounds = { contentOffsetX, 0.0, 1024.0, 768.0 },
+        .pageHeight = 768.0,
+        .separatorWidth = 0.0
+    };
+}
+
+static long MMUpdate(MMSnapSafeAreaTrackerRef tracker, const MMSnapLayout *layout, MMSnapSafeAreaInsets insets, double time, const void **changedKeys)
+{
+    const MMSnapPageRange pages = MMSnapLayoutGetVisiblePages(layout);
+    
+    MMSnapLayoutRect rects[8];
+    for (long idx = 0; idx < pages.length; idx++) {
+        rects[idx] = MMSnapLayoutGetPageRect(layout, pages.location + idx, NULL);
+    }
+    return MMSnapSafeAreaTrackerUpdate(tracker, rects, &MMKeys[pages.location], pages.length, layout->bounds, insets, time, changedKeys, 16);
+}
+
+static void testPageInsets(void)
+{
+    const MMSnapLayoutRect bounds = { 100.0, 0.0, 1024.0, 768.0 };
+    const MMSnapSafeAreaInsets insets = { 0.0, 44.0, 21.0, 44.0 };
+    
+    // Covering the left edge, partly behind it.
+    MMSnapSafeAreaInsets pageInsets = MMSnapSafeAreaGetPageInsets((MMSnapLayoutRect){ 0.0, 0.0, 320.0, 768.0 }, bounds, insets);
+    MMTAssertEqualWithAccuracy(pageInsets.left, 44.0, 0.0);
+    MMTAssertEqualWithAccuracy(pageInsets.right, 0.0, 0.0);
+    MMTAssertEqualWithAccuracy(pageInsets.bottom, 21.0, 0.0);
+    
+    // Within the safe area, horizontally.
+    pageInsets = MMSnapSafeAreaGetPageInsets((MMSnapLayoutRect){ 320.0, 0.0, 320.0, 768.0 }, bounds, insets);
+    MMTAssertEqualWithAccuracy(pageInsets.left, 0.0, 0.0);
+    MMTAssertEqualWithAccuracy(pageInsets.right, 0.0, 0.0);
+    
+    // Partly within the right edge.
+    pageInsets = MMSnapSafeAreaGetPageInsets((MMSnapLayoutRect){ 1100.0, 0.0, 320.0, 768.0 }, bounds, insets);
+    MMTAssertEqualWithAccuracy(pageInsets.right, 24.0, 0.0);
+    
+    // Not visible at all.
+    pageInsets = MMSnapSafeAreaGetPageInsets((MMSnapLayoutRect){ 1280.0, 0.0, 320.0, 768.0 }, bounds, insets);
+    MMTAssertEqualWithAccuracy(pageInsets.right, 0.0, 0.0);
+    MMTAssertEqualWithAccuracy(pageInsets.bottom, 0.0, 0.0);
+}
+
+static void testScrollingWithoutInsetsOnlyReportsVisibilityChanges(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    MMSnapSafeAreaTrackerRef tracker = MMSnapSafeAreaTrackerCreate();
+    const void *changedKeys[16];
+    
+    const MMSnapSafeAreaInsets insets = { 0.0, 0.0, 0.0, 0.0 };
+    
+    MMSnapLayout layout = MMMakeLayout(pageIndex, 0.0);
+    MMTAssertEqual(MMUpdate(tracker, &layout, insets, 0.0, changedKeys), 4);
+    
+    // Scroll across ten pages, a point per frame.
+    long reportedPageCount = 0;
+    for (long frame = 1; frame <= 3200; frame++) {
+        layout = MMMakeLayout(pageIndex, (double)frame);
+        reportedPageCount += MMUpdate(tracker, &layout, insets, frame / 60.0, changedKeys);
+    }
+    
+    // Every page entering and leaving, and nothing else.
+    const MMSnapSafeAreaTrackerStatistics statistics = MMSnapSafeAreaTrackerGetStatistics(tracker);
+    MMTAssertEqual(statistics.updateCount, 3201);
+    MMTAssertEqual(reportedPageCount, 10 + 10);
+    MMTAssert(statistics.propagationCount <= 21, "%lu propagations", statistics.propagationCount);
+    
+    MMSnapSafeAreaTrackerRelease(tracker);
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+static void testScrollingWithInsetsReportsPagesCrossingTheEdges(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    MMSnapSafeAreaTrackerRef tracker = MMSnapSafeAreaTrackerCreate();
+    const void *changedKeys[16];
+    
+    const MMSnapSafeAreaInsets insets = { 0.0, 44.0, 21.0, 44.0 };
+    
+    MMSnapLayout layout = MMMakeLayout(pageIndex, 0.0);
+    MMUpdate(tracker, &layout, insets, 0.0, changedKeys);
+    
+    MMSnapSafeAreaInsets pageInsets;
+    MMTAssert(MMSnapSafeAreaTrackerGetInsets(tracker, &MMPages[3], &pageInsets), "page 3 isn't visible");
+    MMTAssertEqualWithAccuracy(pageInsets.right, 44.0, 0.0);
+    
+    // The pages covering the edges keep their insets.
+    layout = MMMakeLayout(pageIndex, 1.0);
+    MMTAssertEqual(MMUpdate(tracker, &layout, insets, 1.0, changedKeys), 0);
+    
+    // The end of the last page crosses the right edge as the next page appears.
+    layout = MMMakeLayout(pageIndex, 270.0);
+    MMTAssertEqual(MMUpdate(tracker, &layout, insets, 2.0, changedKeys), 2);
+    MMTAssert(changedKeys[0] == &MMPages[3], "unexpected page");
+    MMTAssert(changedKeys[1] == &MMPages[4], "unexpected page");
+    
+    MMTAssert(MMSnapSafeAreaTrackerGetInsets(tracker, &MMPages[3], &pageInsets), "page 3 isn't visible");
+    MMTAssertEqualWithAccuracy(pageInsets.right, 30.0, 0.0);
+    
+    // The same layout again reports nothing.
+    MMTAssertEqual(MMUpdate(tracker, &layout, insets, 2.0, changedKeys), 0);
+    
+    // Insets changing, as when rotating, report every visible page.
+    const MMSnapSafeAreaInsets portraitInsets = { 44.0, 0.0, 34.0, 0.0 };
+    MMTAssertEqual(MMUpdate(tracker, &layout, portraitInsets, 2.0, changedKeys), MMSnapLayoutGetVisiblePages(&layout).length);
+    
+    MMSnapSafeAreaTrackerRelease(tracker);
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+static void testRemovalAndRate(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    MMSnapSafeAreaTrackerRef tracker = MMSnapSafeAreaTrackerCreate();
+    const void *changedKeys[16];
+    
+    const MMSnapSafeAreaInsets insets = { 0.0, 0.0, 0.0, 0.0 };
+    
+    MMSnapLayout layout = MMMakeLayout(pageIndex, 0.0);
+    MMUpdate(tracker, &layout, insets, 0.0, changedKeys);
+    MMTAssertEqual(MMSnapSafeAreaTrackerGetPageCount(tracker), 4);
+    
+    // Removed pages aren't reported as disappearing.
+    MMSnapSafeAreaTrackerRemoveKey(tracker, &MMPages[0]);
+    MMTAssertEqual(MMSnapSafeAreaTrackerGetPageCount(tracker), 3);
+    MMTAssertEqual(MMSnapSafeAreaTrackerUpdate(tracker, NULL, NULL, 0, layout.bounds, insets, 0.0, changedKeys, 16), 3);
+    MMTAssert(changedKeys[0] == &MMPages[1], "unexpected page");
+    MMTAssertEqual(MMSnapSafeAreaTrackerGetPageCount(tracker), 0);
+    
+    // Invalidated pages are all reported again.
+    MMSnapSafeAreaTrackerInvalidate(tracker);
+    MMTAssertEqual(MMUpdate(tracker, &layout, insets, 0.0, changedKeys), 4);
+    
+    // Propagating on every frame for a second, then not at all.
+    MMSnapSafeAreaTrackerResetStatistics(tracker);
+    for (long frame = 1; frame <= 60; frame++) {
+        MMSnapSafeAreaTrackerInvalidate(tracker);
+        MMUpdate(tracker, &layout, insets, 10.0 + frame / 60.0, changedKeys);
+    }
+    MMTAssertEqual(MMSnapSafeAreaTrackerGetPropagationsPerSecond(tracker, 11.0), 60);
+    MMTAssertEqual(MMSnapSafeAreaTrackerGetPropagationsPerSecond(tracker, 11.5), 30);
+    MMTAssertEqual(MMSnapSafeAreaTrackerGetPropagationsPerSecond(tracker, 12.0), 0);
+    
+    // The rate saturates instead of forgetting recent propagations.
+    for (long frame = 1; frame <= 500; frame++) {
+        MMSnapSafeAreaTrackerInvalidate(tracker);
+        MMUpdate(tracker, &layout, insets, 20.0 + frame / 1000.0, changedKeys);
+    }
+    MMTAssertEqual(MMSnapSafeAreaTrackerGetPropagationsPerSecond(tracker, 20.5), 240);
+    MMTAssertEqual(MMSnapSafeAreaTrackerGetStatistics(tracker).propagationCount, 560);
+    
+    MMSnapSafeAreaTrackerRelease(tracker);
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+int main(void)
+{
+    MMTRun(testPageInsets);
+    MMTRun(testScrollingWithoutInsetsOnlyReportsVisibilityChanges);
+    MMTRun(testScrollingWithInsetsReportsPagesCrossingTheEdges);
+    MMTRun(testRemovalAndRate);
+    
+    return MMTExitStatus();
+}
@@ -0,0 +1,207 @@
+//
+//  MMSnapSeparatorTrackerTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapSeparatorTracker.h"
+#include "MMSnapCoreTestSupport.h"
+
+// Ten pages of 320 points in a 640 points wide viewport, like an iPad showing two compact pages side by side.
+static MMSnapLayout MMMakeLayout(MMSnapPageIndexRef pageIndex, double contentOffsetX)
+{
+    MMSnapPageIndexRemoveAllPages(pageIndex);
+    for (long page = 0; page < 10; page++) {
+        MMSnapPageIndexAppendPage(pageIndex, 320.0);
+    }
+    
+    return (MMSnapLayout){
+        .pageIndex = pageIndex,
+        .bounds = { contentOffsetX, 0.0, 640.0, 768.0 },
+        .pageHeight = 768.0,
+        .separatorWidth = 10.0
+    };
+}
+
+// Separators are identified by address, any distinct pointers will do.
+static char MMSeparators[16];
+
+static MMSnapSeparatorChange MMUpdatePass(MMSnapSeparatorTrackerRef tracker, const MMSnapLayout *layout, bool columns, const long *separatorOffsets, MMSnapSeparatorChange *changes)
+{
+    const MMSnapPageRange range = MMSnapLayoutGetVisiblePages(layout);
+    MMTAssert(MMSnapSeparatorTrackerUpdate(tracker, layout, range, 10, columns), "update failed");
+    
+    MMSnapSeparatorChange allChanges = MMSnapSeparatorChangeNone;
+    for (long idx = 0; idx < range.length; idx++) {
+        const long page = range.location + idx;
+        const long separator = separatorOffsets ? separatorOffsets[idx] : page;
+        
+        changes[idx] = MMSnapSeparatorTrackerApplySeparator(tracker, page, &MMSeparators[separator]);
+        allChanges |= changes[idx];
+    }
+    return allChanges;
+}
+
+static void testUnchangedSeparatorsAreSkipped(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    MMSnapSeparatorTrackerRef tracker = MMSnapSeparatorTrackerCreate();
+    MMSnapSeparatorChange changes[4];
+    
+    const MMSnapLayout layout = MMMakeLayout(pageIndex, 0.0);
+    
+    // New separators get their whole state.
+    MMUpdatePass(tracker, &layout, true, NULL, changes);
+    MMTAssertEqual(changes[0], MMSnapSeparatorChangeAll);
+    MMTAssertEqual(changes[1], MMSnapSeparatorChangeAll);
+    MMTAssertEqual(MMSnapSeparatorTrackerGetStatistics(tracker).lastPassUpdateCount, 2);
+    
+    // The same layout again changes nothing.
+    MMTAssertEqual(MMUpdatePass(tracker, &layout, true, NULL, changes), MMSnapSeparatorChangeNone);
+    
+    const MMSnapSeparatorTrackerStatistics statistics = MMSnapSeparatorTrackerGetStatistics(tracker);
+    MMTAssertEqual(statistics.passCount, 2);
+    MMTAssertEqual(statistics.separatorCount, 4);
+    MMTAssertEqual(statistics.updateCount, 2);
+    MMTAssertEqual(statistics.lastPassUpdateCount, 0);
+    
+    MMSnapSeparatorTrackerResetStatistics(tracker);
+    MMTAssertEqual(MMSnapSeparatorTrackerGetStatistics(tracker).passCount, 0);
+    
+    MMSnapSeparatorTrackerRelease(tracker);
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+static void testScrollingOnlyUpdatesTheDisappearingPage(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    MMSnapSeparatorTrackerRef tracker = MMSnapSeparatorTrackerCreate();
+    MMSnapSeparatorChange changes[4];
+    
+    MMSnapLayout layout = MMMakeLayout(pageIndex, 10.0);
+    MMUpdatePass(tracker, &layout, true, NULL, changes);
+    
+    // Pages 0 to 2 are visible. The first one is covered a bit more, the others stay in place.
+    layout.bounds.x = 20.0;
+    MMUpdatePass(tracker, &layout, true, NULL, changes);
+    MMTAssertEqual(changes[0], MMSnapSeparatorChangePercentDisappeared);
+    MMTAssertEqual(changes[1], MMSnapSeparatorChangeNone);
+    MMTAssertEqual(changes[2], MMSnapSeparatorChangeNone);
+    MMTAssertEqual(MMSnapSeparatorTrackerGetStatistics(tracker).lastPassUpdateCount, 1);
+    
+    // Resizing the pages moves every separator.
+    layout.pageHeight = 700.0;
+    MMUpdatePass(tracker, &layout, true, NULL, changes);
+    MMTAssertEqual(changes[0], MMSnapSeparatorChangeRect);
+    MMTAssertEqual(changes[1], MMSnapSeparatorChangeRect);
+    MMTAssertEqual(changes[2], MMSnapSeparatorChangeRect);
+    
+    MMSnapSeparatorTrackerRelease(tracker);
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+static void testStatesMatchTheLayout(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    MMSnapSeparatorTrackerRef tracker = MMSnapSeparatorTrackerCreate();
+    
+    for (double offset = 0.0; offset <= 2560.0; offset += 37.0) {
+        const MMSnapLayout layout = MMMakeLayout(pageIndex, offset);
+        const MMSnapPageRange range = MMSnapLayoutGetVisiblePages(&layout);
+        
+        MMTAssert(MMSnapSeparatorTrackerUpdate(tracker, &layout, range, 10, false), "update failed");
+        
+        for (long page = range.location; page < range.location + range.length; page++) {
+            double percent = 0.0;
+            const MMSnapLayoutRect rect = MMSnapLayoutGetPageRect(&layout, page, &percent);
+            const MMSnapSeparatorState *state = MMSnapSeparatorTrackerGetState(tracker, page);
+            
+            MMTAssertEqualWithAccuracy(MMSnapSeparatorTrackerGetPageRect(tracker, page).x, rect.x, 0.0);
+            MMTAssertEqualWithAccuracy(state->percentDisappeared, percent, 0.0);
+            MMTAssert(!state->showsAsColumnSeparator, "unexpected column separator");
+            
+            if (page == 9) {
+                MMTAssertEqualWithAccuracy(state->rect.width, 0.0, 0.0);
+            } else {
+                const MMSnapLayoutRect separatorRect = MMSnapLayoutGetSeparatorRect(&layout, MMSnapLayoutGetPageRect(&layout, page + 1, NULL));
+                MMTAssertEqualWithAccuracy(state->rect.x, separatorRect.x, 0.0);
+                MMTAssertEqualWithAccuracy(state->rect.width, separatorRect.width, 0.0);
+                MMTAssertEqualWithAccuracy(state->rect.height, separatorRect.height, 0.0);
+            }
+        }
+        
+        MMTAssert(MMSnapSeparatorTrackerGetState(tracker, range.location + range.length) == NULL, "state out of range");
+    }
+    
+    MMSnapSeparatorTrackerRelease(tracker);
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+static void testMovedSeparatorsAreUpdated(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    MMSnapSeparatorTrackerRef tracker = MMSnapSeparatorTrackerCreate();
+    MMSnapSeparatorChange changes[4];
+    
+    const MMSnapLayout layout = MMMakeLayout(pageIndex, 0.0);
+    MMUpdatePass(tracker, &layout, false, NULL, changes);
+    
+    // The separators swapped pages, so both are applied although the states didn't change.
+    const long swapped[] = { 1, 0 };
+    MMUpdatePass(tracker, &layout, false, swapped, changes);
+    MMTAssertEqual(changes[0], MMSnapSeparatorChangeAll);
+    MMTAssertEqual(changes[1], MMSnapSeparatorChangeAll);
+    
+    // A new separator for the first page.
+    const long replaced[] = { 2, 0 };
+    MMUpdatePass(tracker, &layout, false, replaced, changes);
+    MMTAssertEqual(changes[0], MMSnapSeparatorChangeAll);
+    MMTAssertEqual(changes[1], MMSnapSeparatorChangeNone);
+    
+    MMSnapSeparatorTrackerRelease(tracker);
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+static void testColumnModeAndInvalidation(void)
+{
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    MMSnapSeparatorTrackerRef tracker = MMSnapSeparatorTrackerCreate();
+    MMSnapSeparatorChange changes[4];
+    
+    const MMSnapLayout layout = MMMakeLayout(pageIndex, 0.0);
+    MMUpdatePass(tracker, &layout, false, NULL, changes);
+    
+    MMUpdatePass(tracker, &layout, true, NULL, changes);
+    MMTAssertEqual(changes[0], MMSnapSeparatorChangeShowsAsColumnSeparator);
+    MMTAssertEqual(changes[1], MMSnapSeparatorChangeShowsAsColumnSeparator);
+    
+    // Separators whose addresses may have been reused are applied again.
+    MMSnapSeparatorTrackerInvalidate(tracker);
+    MMUpdatePass(tracker, &layout, true, NULL, changes);
+    MMTAssertEqual(changes[0], MMSnapSeparatorChangeAll);
+    MMTAssertEqual(changes[1], MMSnapSeparatorChangeAll);
+    
+    // Pages out of range and missing separators are ignored.
+    MMTAssertEqual(MMSnapSeparatorTrackerApplySeparator(tracker, 5, &MMSeparators[5]), MMSnapSeparatorChangeNone);
+    MMTAssertEqual(MMSnapSeparatorTrackerApplySeparator(tracker, 0, NULL), MMSnapSeparatorChangeNone);
+    
+    // An empty pass forgets every separator.
+    MMTAssert(MMSnapSeparatorTrackerUpdate(tracker, &layout, (MMSnapPageRange){ MMSnapPageNotFound, 0 }, 10, true), "update failed");
+    MMUpdatePass(tracker, &layout, true, NULL, changes);
+    MMTAssertEqual(changes[0], MMSnapSeparatorChangeAll);
+    
+    MMSnapSeparatorTrackerRelease(tracker);
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+int main(void)
+{
+    MMTRun(testUnchangedSeparatorsAreSkipped);
+    MMTRun(testScrollingOnlyUpdatesTheDisappearingPage);
+    MMTRun(testStatesMatchTheLayout);
+    MMTRun(testMovedSeparatorsAreUpdated);
+    MMTRun(testColumnModeAndInvalidation);
+    
+    return MMTExitStatus();
+}
@@ -0,0 +1,139 @@
+//
+//  MMSnapSpringTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapSpring.h"
+#include "MMSnapCoreTestSupport.h"
+
+#include <math.h>
+
+// One parameter set per damping regime. The overdamped one is the configuration of the snap scroll view.
+static const MMSnapSpringParameters MMSpringParameters[] = {
+    { 1.0, 300.0, 10.0 },
+    { 1.0, 400.0, 40.0 },
+    { 1.0, 925.0, 91.0 },
+};
+
+static const MMSnapSpringRegime MMSpringRegimes[] = {
+    MMSnapSpringRegimeUnderdamped,
+    MMSnapSpringRegimeCriticallyDamped,
+    MMSnapSpringRegimeOverdamped,
+};
+
+static const int MMSpringParameterCount = sizeof(MMSpringParameters) / sizeof(MMSpringParameters[0]);
+
+static void testInitialStateAndVelocityMatchTheMotion(void)
+{
+    for (int idx = 0; idx < MMSpringParameterCount; idx++) {
+        MMSnapSpring spring;
+        MMSnapSpringStart(&spring, MMSpringParameters[idx], 100.0, -2000.0, 900.0, 0.5);
+        
+        MMTAssertEqual(spring.regime, MMSpringRegimes[idx]);
+        
+        double position, velocity;
+        MMSnapSpringEvaluate(&spring, 0.0, &position, &velocity);
+        MMTAssertEqualWithAccuracy(position, 100.0, 1e-9);
+        MMTAssertEqualWithAccuracy(velocity, -2000.0, 1e-9);
+        
+        // The reported velocity is the derivative of the position.
+        const double h = 1e-6;
+        for (double time = 0.01; time < 0.5; time += 0.07) {
+            double before, after;
+            MMSnapSpringEvaluate(&spring, time - h, &before, NULL);
+            MMSnapSpringEvaluate(&spring, time + h, &after, NULL);
+            MMSnapSpringEvaluate(&spring, time, NULL, &velocity);
+            
+            MMTAssertEqualWithAccuracy(velocity, (after - before) / (2.0 * h), 1e-3 * fmax(1.0, fabs(velocity)));
+        }
+    }
+}
+
+static void testSettleTimeIsAnUpperBound(void)
+{
+    for (int idx = 0; idx < MMSpringParameterCount; idx++) {
+        MMSnapSpring spring;
+        MMSnapSpringStart(&spring, MMSpringParameters[idx], 0.0, 3000.0, 1024.0, 0.5);
+        
+        const double settleTime = MMSnapSpringGetSettleTime(&spring);
+        MMTAssert(settleTime > 0.0 && settleTime < 5.0, "settle time %f", settleTime);
+        
+        // Evaluate the unbounded motion past the settle time.
+        MMSnapSpring unbounded = spring;
+        unbounded.settleTime = INFINITY;
+        
+        for (double time = settleTime; time < settleTime + 2.0; time += 0.001) {
+            double position;
+            MMSnapSpringEvaluate(&unbounded, time, &position, NULL);
+            MMTAssert(fabs(position - 1024.0) <= 0.5, "regime %d is %f away at %f", idx, fabs(position - 1024.0), time);
+            if (fabs(position - 1024.0) > 0.5) {
+                break;
+            }
+        }
+        
+        // And the object rests on the target afterwards.
+        double position, velocity;
+        MMSnapSpringEvaluate(&spring, settleTime, &position, &velocity);
+        MMTAssertEqual(position, 1024.0);
+        MMTAssertEqual(velocity, 0.0);
+    }
+}
+
+static void testRetargetingKeepsPositionAndVelocity(void)
+{
+    const double frame = 1.0 / 120.0;
+    
+    for (int idx = 0; idx < MMSpringParameterCount; idx++) {
+        MMSnapSpring spring;
+        MMSnapSpringStart(&spring, MMSpringParameters[idx], 0.0, 0.0, 320.0, 0.5);
+        
+        // Retarget every few frames, like repeated scroll to page calls, and compare both sides of each retarget.
+        double target = 320.0;
+        for (int retarget = 0; retarget < 20; retarget++) {
+            const double time = frame * (3 + retarget % 5);
+            
+            double position, velocity;
+            MMSnapSpringEvaluate(&spring, time, &position, &velocity);
+            
+            target += (retarget % 3 == 2) ? -640.0 : 320.0;
+            MMSnapSpringRetarget(&spring, time, target, 0.5);
+            
+            double retargetedPosition, retargetedVelocity;
+            MMSnapSpringEvaluate(&spring, 0.0, &retargetedPosition, &retargetedVelocity);
+            
+            MMTAssertEqualWithAccuracy(retargetedPosition, position, 1e-9);
+            MMTAssertEqualWithAccuracy(retargetedVelocity, velocity, 1e-9);
+            MMTAssertEqualWithAccuracy(spring.target, target, 0.0);
+        }
+        
+        // The motion still converges to the last target.
+        double position;
+        MMSnapSpringEvaluate(&spring, MMSnapSpringGetSettleTime(&spring), &position, NULL);
+        MMTAssertEqualWithAccuracy(position, target, 0.0);
+    }
+}
+
+static void testObjectAtRestOnTheTargetDoesNotMove(void)
+{
+    MMSnapSpring spring;
+    MMSnapSpringStart(&spring, MMSpringParameters[2], 640.0, 0.0, 640.0, 0.5);
+    
+    MMTAssertEqualWithAccuracy(MMSnapSpringGetSettleTime(&spring), 0.0, 0.0);
+    
+    double position, velocity;
+    MMSnapSpringEvaluate(&spring, 0.1, &position, &velocity);
+    MMTAssertEqualWithAccuracy(position, 640.0, 0.0);
+    MMTAssertEqualWithAccuracy(velocity, 0.0, 0.0);
+}
+
+int main(void)
+{
+    MMTRun(testInitialStateAndVelocityMatchTheMotion);
+    MMTRun(testSettleTimeIsAnUpperBound);
+    MMTRun(testRetargetingKeepsPositionAndVelocity);
+    MMTRun(testObjectAtRestOnTheTargetDoesNotMove);
+    
+    return MMTExitStatus();
+}
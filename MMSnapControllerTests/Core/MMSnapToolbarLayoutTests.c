@@ -0,0 +1,115 @@
+//
+//  MMSnapToolbarLayoutTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapToolbarLayout.h"
+#include "MMSnapCoreTestSupport.h"
+
+#define MMTView(w, h) ((MMSnapToolbarItem){ MMSnapToolbarItemKindView, (w), (h) })
+#define MMTSpace(w) ((MMSnapToolbarItem){ MMSnapToolbarItemKindFixedSpace, (w), 0.0 })
+#define MMTFlexible() ((MMSnapToolbarItem){ MMSnapToolbarItemKindFlexibleSpace, 0.0, 0.0 })
+
+static const MMSnapToolbarMetrics MMTMetrics = { .minX = 8.0, .width = 304.0, .height = 44.0, .spacing = 8.0 };
+
+static void testItemsArePackedWithSpacing(void)
+{
+    const MMSnapToolbarItem items[] = { MMTView(40.0, 30.0), MMTSpace(20.0), MMTView(50.0, 20.0) };
+    MMSnapLayoutRect frames[3];
+    
+    MMTAssertEqual(MMSnapToolbarLayoutSolve(items, 3, MMTMetrics, frames), 3);
+    
+    MMTAssertEqualWithAccuracy(frames[0].x, 8.0, 0.0);
+    MMTAssertEqualWithAccuracy(frames[0].y, 7.0, 0.0);
+    MMTAssertEqualWithAccuracy(frames[0].width, 40.0, 0.0);
+    MMTAssertEqualWithAccuracy(frames[1].x, 56.0, 0.0);
+    MMTAssertEqualWithAccuracy(frames[1].y, 22.0, 0.0);
+    MMTAssertEqualWithAccuracy(frames[1].height, 0.0, 0.0);
+    MMTAssertEqualWithAccuracy(frames[2].x, 84.0, 0.0);
+    MMTAssertEqualWithAccuracy(frames[2].y, 12.0, 0.0);
+}
+
+static void testSingleItemIsNotSeparated(void)
+{
+    // A lone item is laid out at the leading edge even if it would not fit with the spacing of the flexible spaces.
+    const MMSnapToolbarItem items[] = { MMTFlexible(), MMTView(300.0, 20.0), MMTFlexible() };
+    MMSnapLayoutRect frames[3];
+    
+    MMTAssertEqual(MMSnapToolbarLayoutSolve(items, 3, MMTMetrics, frames), 3);
+    MMTAssertEqualWithAccuracy(frames[0].width, 2.0, 0.0);
+    MMTAssertEqualWithAccuracy(frames[1].x, 10.0, 0.0);
+    MMTAssertEqualWithAccuracy(frames[2].x, 310.0, 0.0);
+    MMTAssertEqualWithAccuracy(frames[2].width, 2.0, 0.0);
+}
+
+static void testFlexibleSpacesShareRemainingWidth(void)
+{
+    // The flexible spaces split what's left after the views and three separations.
+    const MMSnapToolbarItem items[] = { MMTView(50.0, 30.0), MMTFlexible(), MMTView(100.0, 30.0), MMTFlexible() };
+    MMSnapLayoutRect frames[4];
+    
+    MMTAssertEqual(MMSnapToolbarLayoutSolve(items, 4, MMTMetrics, frames), 4);
+    MMTAssertEqualWithAccuracy(frames[1].width, (304.0 - 150.0 - 24.0) / 2.0, 0.0);
+    MMTAssertEqualWithAccuracy(frames[2].x, 8.0 + 50.0 + 8.0 + 65.0 + 8.0, 0.0);
+    MMTAssertEqualWithAccuracy(frames[3].x + frames[3].width, 8.0 + 304.0, 0.0);
+}
+
+static void testItemsThatDontFitAreTruncated(void)
+{
+    // Separation takes 3 * 8 = 24, leaving 280: the third view overflows, and so does everything after it.
+    const MMSnapToolbarItem items[] = { MMTView(120.0, 30.0), MMTView(120.0, 30.0), MMTView(60.0, 30.0), MMTView(10.0, 30.0) };
+    MMSnapLayoutRect frames[4];
+    
+    MMTAssertEqual(MMSnapToolbarLayoutSolve(items, 4, MMTMetrics, frames), 2);
+    MMTAssertEqualWithAccuracy(frames[1].x, 136.0, 0.0);
+}
+
+static void testTruncatedFlexibleSpacesStillShareTheWidth(void)
+{
+    const MMSnapToolbarItem items[] = { MMTView(100.0, 30.0), MMTFlexible(), MMTView(400.0, 30.0), MMTFlexible() };
+    MMSnapLayoutRect frames[4];
+    
+    MMTAssertEqual(MMSnapToolbarLayoutSolve(items, 4, MMTMetrics, frames), 2);
+    MMTAssertEqualWithAccuracy(frames[1].width, (304.0 - 100.0 - 24.0) / 2.0, 0.0);
+}
+
+static void testOriginsAreRounded(void)
+{
+    const MMSnapToolbarItem items[] = { MMTFlexible(), MMTView(33.0, 21.0), MMTFlexible(), MMTFlexible() };
+    MMSnapLayoutRect frames[4];
+    
+    MMTAssertEqual(MMSnapToolbarLayoutSolve(items, 4, MMTMetrics, frames), 4);
+    
+    // A single view isn't separated, so each flexible space is (304 - 33) / 3 = 90.33 wide and origins are rounded as
+    // they accumulate.
+    MMTAssertEqualWithAccuracy(frames[1].x, 98.0, 0.0);
+    MMTAssertEqualWithAccuracy(frames[1].y, 12.0, 0.0);
+    MMTAssertEqualWithAccuracy(frames[2].x, 131.0, 0.0);
+    MMTAssertEqualWithAccuracy(frames[3].x, 221.0, 0.0);
+}
+
+static void testEmptyToolbar(void)
+{
+    MMTAssertEqual(MMSnapToolbarLayoutSolve(NULL, 0, MMTMetrics, NULL), 0);
+    
+    const MMSnapToolbarItem items[] = { MMTFlexible() };
+    MMSnapLayoutRect frames[1];
+    
+    MMTAssertEqual(MMSnapToolbarLayoutSolve(items, 1, (MMSnapToolbarMetrics){ 0.0, 0.0, 44.0, 8.0 }, frames), 1);
+    MMTAssertEqualWithAccuracy(frames[0].width, 0.0, 0.0);
+}
+
+int main(void)
+{
+    MMTRun(testItemsArePackedWithSpacing);
+    MMTRun(testSingleItemIsNotSeparated);
+    MMTRun(testFlexibleSpacesShareRemainingWidth);
+    MMTRun(testItemsThatDontFitAreTruncated);
+    MMTRun(testTruncatedFlexibleSpacesStillShareTheWidth);
+    MMTRun(testOriginsAreRounded);
+    MMTRun(testEmptyToolbar);
+    
+    return MMTExitStatus();
+}
@@ -0,0 +1,148 @@
+//
+//  MMSnapTraceTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapTrace.h"
+#include "MMSnapCoreTestSupport.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void MMMakeTemporaryPath(char *path)
+{
+    const int fd = mkstemp(path);
+    MMTAssert(fd >= 0, "couldn't create a temporary file");
+    close(fd);
+}
+
+static MMSnapTraceEvent MMMakeEvent(long idx)
+{
+    return (MMSnapTraceEvent){
+        .time = idx / 60.0,
+        .type = (MMSnapTraceEventType)(MMSnapTraceEventBegin + idx % MMSnapTraceEventPop),
+        .flags = (uint16_t)(idx % 2),
+        .page = idx - 3,
+        .otherPage = -idx,
+        .x = idx * 320.5,
+        .y = -idx * 0.25
+    };
+}
+
+static long MMReadEventCount(const char *path, long expectedCount)
+{
+    MMSnapTraceReaderRef reader = MMSnapTraceReaderOpen(path);
+    MMTAssert(reader != NULL, "trace rejected");
+    
+    MMSnapTraceEvent event;
+    long count = 0;
+    while (MMSnapTraceReaderNext(reader, &event)) {
+        const MMSnapTraceEvent expectedEvent = MMMakeEvent(count);
+        if (count < expectedCount) {
+            MMTAssertEqualWithAccuracy(event.time, expectedEvent.time, 0.0);
+            MMTAssertEqual(event.type, expectedEvent.type);
+            MMTAssertEqual(event.flags, expectedEvent.flags);
+            MMTAssertEqual(event.page, expectedEvent.page);
+            MMTAssertEqual(event.otherPage, expectedEvent.otherPage);
+            MMTAssertEqualWithAccuracy(event.x, expectedEvent.x, 0.0);
+            MMTAssertEqualWithAccuracy(event.y, expectedEvent.y, 0.0);
+        }
+        count++;
+    }
+    
+    MMSnapTraceReaderRelease(reader);
+    return count;
+}
+
+static void testRoundTrip(void)
+{
+    char path[] = "/tmp/MMSnapTraceTests.XXXXXX";
+    MMMakeTemporaryPath(path);
+    
+    // A ring that wraps around several times.
+    MMSnapTraceRecorderRef recorder = MMSnapTraceRecorderCreate(path, 7);
+    MMTAssert(recorder != NULL, "recorder not created");
+    
+    for (long idx = 0; idx < 100; idx++) {
+        const MMSnapTraceEvent event = MMMakeEvent(idx);
+        MMTAssert(MMSnapTraceRecorderRecord(recorder, &event), "event %ld dropped", idx);
+        MMTAssert(MMSnapTraceRecorderGetPendingCount(recorder) <= 7, "ring overflowed");
+    }
+    
+    // Flushed events are in the file before the recorder is released.
+    MMTAssert(MMSnapTraceRecorderFlush(recorder), "flush failed");
+    MMTAssertEqual(MMSnapTraceRecorderGetPendingCount(recorder), 0);
+    MMTAssertEqual(MMReadEventCount(path, 100), 100);
+    
+    const MMSnapTraceEvent event = MMMakeEvent(100);
+    MMSnapTraceRecorderRecord(recorder, &event);
+    
+    unsigned long droppedCount = 1;
+    MMTAssertEqual(MMSnapTraceRecorderGetEventCount(recorder, &droppedCount), 101);
+    MMTAssertEqual(droppedCount, 0);
+    
+    MMSnapTraceRecorderRelease(recorder);
+    MMTAssertEqual(MMReadEventCount(path, 101), 101);
+    
+    unlink(path);
+}
+
+static void testCorruptTracesAreRejected(void)
+{
+    char path[] = "/tmp/MMSnapTraceTests.XXXXXX";
+    MMMakeTemporaryPath(path);
+    
+    // An empty file isn't a trace.
+    MMTAssert(MMSnapTraceReaderOpen(path) == NULL, "empty file accepted");
+    
+    MMSnapTraceRecorderRef recorder = MMSnapTraceRecorderCreate(path, 4);
+    for (long idx = 0; idx < 3; idx++) {
+        const MMSnapTraceEvent event = MMMakeEvent(idx);
+        MMSnapTraceRecorderRecord(recorder, &event);
+    }
+    MMSnapTraceRecorderRelease(recorder);
+    
+    // A partially written last event ends the trace.
+    MMTAssert(truncate(path, 16 + 2 * MMSnapTraceEventSize + 9) == 0, "couldn't truncate");
+    MMTAssertEqual(MMReadEventCount(path, 2), 2);
+    
+    // Another version of the format.
+    FILE *file = fopen(path, "r+b");
+    fseek(file, 4, SEEK_SET);
+    fputc(MMSnapTraceVersion + 1, file);
+    fclose(file);
+    MMTAssert(MMSnapTraceReaderOpen(path) == NULL, "other version accepted");
+    
+    // Something else entirely.
+    file = fopen(path, "wb");
+    fputs("{ \"benchmarks\": [] }", file);
+    fclose(file);
+    MMTAssert(MMSnapTraceReaderOpen(path) == NULL, "other file accepted");
+    
+    unlink(path);
+    MMTAssert(MMSnapTraceReaderOpen(path) == NULL, "missing file opened");
+    
+    // Nowhere to write.
+    MMTAssert(MMSnapTraceRecorderCreate("/nonexistent/MMSnapTraceTests", 4) == NULL, "recorder created");
+    MMTAssert(MMSnapTraceRecorderCreate(path, 0) == NULL, "recorder without a ring created");
+}
+
+static void testEventTypeNames(void)
+{
+    MMTAssert(strcmp(MMSnapTraceEventTypeGetName(MMSnapTraceEventContentOffset), "contentOffset") == 0, "unexpected name");
+    MMTAssert(strcmp(MMSnapTraceEventTypeGetName(MMSnapTraceEventPop), "pop") == 0, "unexpected name");
+    MMTAssert(strcmp(MMSnapTraceEventTypeGetName((MMSnapTraceEventType)0), "unknown") == 0, "unexpected name");
+}
+
+int main(void)
+{
+    MMTRun(testRoundTrip);
+    MMTRun(testCorruptTracesAreRejected);
+    MMTRun(testEventTypeNames);
+    
+    return MMTExitStatus();
+}
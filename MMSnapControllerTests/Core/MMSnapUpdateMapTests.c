@@ -0,0 +1,199 @@
+//
+//  MMSnapUpdateMapTests.c
+//  MMSnapControllerTests
+//
+//  Released under the MIT License, see LICENSE.
+//
+
+#include "MMSnapUpdateMap.h"
+#include "MMSnapPageIndex.h"
+#include "MMSnapCoreTestSupport.h"
+
+#include <stdlib.h>
+
+static double MMInsertedPageWidth(long page, void *context)
+{
+    (void)context;
+    return 500.0 + page;
+}
+
+static void testInsertAndDeleteShiftFollowingPages(void)
+{
+    MMSnapUpdateMapRef updateMap = MMSnapUpdateMapCreate();
+    
+    // 0 1 2 3 4 -> 0 x 1 3 4 x
+    MMSnapUpdateMapDeletePage(updateMap, 2);
+    MMSnapUpdateMapInsertPage(updateMap, 5);
+    MMSnapUpdateMapInsertPage(updateMap, 1);
+    MMTAssert(MMSnapUpdateMapPrepare(updateMap), "valid updates rejected");
+    
+    MMTAssertEqual(MMSnapUpdateMapGetFinalPage(updateMap, 0), 0);
+    MMTAssertEqual(MMSnapUpdateMapGetFinalPage(updateMap, 1), 2);
+    MMTAssertEqual(MMSnapUpdateMapGetFinalPage(updateMap, 2), MMSnapPageNotFound);
+    MMTAssertEqual(MMSnapUpdateMapGetFinalPage(updateMap, 3), 3);
+    MMTAssertEqual(MMSnapUpdateMapGetFinalPage(updateMap, 4), 4);
+    
+    MMSnapUpdateMapRelease(updateMap);
+}
+
+static void testMoveKeepsPageAndShiftsTheOthers(void)
+{
+    MMSnapUpdateMapRef updateMap = MMSnapUpdateMapCreate();
+    
+    // 0 1 2 3 -> 3 0 1 2
+    MMSnapUpdateMapMovePage(updateMap, 3, 0);
+    MMSnapUpdateMapReloadPage(updateMap, 1);
+    MMTAssert(MMSnapUpdateMapPrepare(updateMap), "valid updates rejected");
+    
+    MMTAssertEqual(MMSnapUpdateMapGetFinalPage(updateMap, 3), 0);
+    MMTAssertEqual(MMSnapUpdateMapGetFinalPage(updateMap, 0), 1);
+    MMTAssertEqual(MMSnapUpdateMapGetFinalPage(updateMap, 1), 2);
+    MMTAssertEqual(MMSnapUpdateMapGetFinalPage(updateMap, 2), 3);
+    MMTAssert(MMSnapUpdateMapIsPageReloaded(updateMap, 1), "page 1 was reloaded");
+    MMTAssert(!MMSnapUpdateMapIsPageReloaded(updateMap, 2), "page 2 was not reloaded");
+    MMTAssertEqual(MMSnapUpdateMapGetDeleteCount(updateMap), 0);
+    MMTAssertEqual(MMSnapUpdateMapGetInsertCount(updateMap), 0);
+    
+    MMSnapUpdateMapRelease(updateMap);
+}
+
+static void testConflictingUpdatesAreRejected(void)
+{
+    MMSnapUpdateMapRef updateMap = MMSnapUpdateMapCreate();
+    
+    MMSnapUpdateMapDeletePage(updateMap, 1);
+    MMSnapUpdateMapMovePage(updateMap, 1, 3);
+    MMTAssert(!MMSnapUpdateMapPrepare(updateMap), "deleted and moved page accepted");
+    
+    MMSnapUpdateMapRemoveAllUpdates(updateMap);
+    MMSnapUpdateMapInsertPage(updateMap, 2);
+    MMSnapUpdateMapMovePage(updateMap, 0, 2);
+    MMTAssert(!MMSnapUpdateMapPrepare(updateMap), "two pages added at the same location accepted");
+    
+    MMSnapUpdateMapRemoveAllUpdates(updateMap);
+    MMSnapUpdateMapDeletePage(updateMap, 4);
+    MMSnapUpdateMapReloadPage(updateMap, 4);
+    MMTAssert(!MMSnapUpdateMapPrepare(updateMap), "deleted and reloaded page accepted");
+    
+    MMSnapUpdateMapRemoveAllUpdates(updateMap);
+    MMTAssert(MMSnapUpdateMapPrepare(updateMap), "empty batch rejected");
+    MMTAssertEqual(MMSnapUpdateMapGetFinalPage(updateMap, 7), 7);
+    
+    MMSnapUpdateMapRelease(updateMap);
+}
+
+static void testRandomBatchesMatchReplay(void)
+{
+    enum { MaxCount = 48 };
+    
+    MMSnapUpdateMapRef updateMap = MMSnapUpdateMapCreate();
+    MMSnapPageIndexRef pageIndex = MMSnapPageIndexCreate();
+    
+    srand(5);
+    for (int iteration = 0; iteration < 3000; iteration++) {
+        // Pages are identified by their location before the batch; inserted pages by -1.
+        long finalItems[MaxCount * 2];
+        long movedItems[MaxCount];
+        long finalCount = 0;
+        long movedCount = 0;
+        
+        const long count = rand() % MaxCount;
+        
+        MMSnapUpdateMapRemoveAllUpdates(updateMap);
+        MMSnapPageIndexRemoveAllPages(pageIndex);
+        
+        for (long page = 0; page < count; page++) {
+            MMSnapPageIndexAppendPage(pageIndex, 10.0 + page);
+            
+            switch (rand() % 8) {
+                case 0:
+                    MMSnapUpdateMapDeletePage(updateMap, page);
+                    break;
+                case 1:
+                    movedItems[movedCount++] = page;
+                    break;
+                case 2:
+                    MMSnapUpdateMapReloadPage(updateMap, page);
+                    finalItems[finalCount++] = page;
+                    break;
+                default:
+                    finalItems[finalCount++] = page;
+                    break;
+            }
+        }
+        
+        // Scatter the moved pages and a few new ones.
+        const long insertCount = rand() % 6;
+        for (long idx = 0; idx < movedCount + insertCount; idx++) {
+            const long location = rand() % (finalCount + 1);
+            for (long k = finalCount; k > location; k--) {
+                finalItems[k] = finalItems[k - 1];
+            }
+            finalItems[location] = (idx < movedCount) ? movedItems[idx] : -1;
+            finalCount++;
+        }
+        
+        for (long location = 0; location < finalCount; location++) {
+            const long item = finalItems[location];
+            if (item < 0) {
+                MMSnapUpdateMapInsertPage(updateMap, location);
+            }
+            for (long idx = 0; idx < movedCount; idx++) {
+                if (movedItems[idx] == item) {
+                    MMSnapUpdateMapMovePage(updateMap, item, location);
+                }
+            }
+        }
+        
+        MMTAssert(MMSnapUpdateMapPrepare(updateMap), "iteration %d rejected", iteration);
+        MMTAssertEqual(count - MMSnapUpdateMapGetDeleteCount(updateMap) + MMSnapUpdateMapGetInsertCount(updateMap), finalCount);
+        
+        for (long page = 0; page < count; page++) {
+            long expected = MMSnapPageNotFound;
+            for (long location = 0; location < finalCount; location++) {
+                if (finalItems[location] == page) {
+                    expected = location;
+                }
+            }
+            MMTAssert(MMSnapUpdateMapGetFinalPage(updateMap, page) == expected, "iteration %d maps page %ld to %ld instead of %ld",
+                      iteration, page, MMSnapUpdateMapGetFinalPage(updateMap, page), expected);
+        }
+        
+        // The page index follows the batch, keeping the widths of the pages that stayed in place.
+        long removedCount, addedCount;
+        const long *removed = MMSnapUpdateMapGetRemovedPages(updateMap, &removedCount);
+        const long *added = MMSnapUpdateMapGetAddedPages(updateMap, &addedCount);
+        
+        MMSnapPageIndexRemovePagesAtIndexes(pageIndex, removed, removedCount);
+        MMTAssert(MMSnapPageIndexInsertPagesAtIndexes(pageIndex, added, addedCount), "insertion failed");
+        MMTAssertEqual(MMSnapPageIndexGetCount(pageIndex), finalCount);
+        MMTAssertEqual(MMSnapPageIndexValidate(pageIndex, MMInsertedPageWidth, NULL), addedCount);
+        
+        double origin = 0.0;
+        for (long location = 0; location < finalCount; location++) {
+            const long item = finalItems[location];
+            bool moved = false;
+            for (long idx = 0; idx < movedCount; idx++) {
+                moved = moved || (movedItems[idx] == item);
+            }
+            const double width = (item < 0 || moved) ? 500.0 + location : 10.0 + item;
+            
+            MMTAssertEqualWithAccuracy(MMSnapPageIndexGetWidth(pageIndex, location), width, 0.0001);
+            MMTAssertEqualWithAccuracy(MMSnapPageIndexGetOrigin(pageIndex, location), origin, 0.0001);
+            origin += width;
+        }
+    }
+    
+    MMSnapUpdateMapRelease(updateMap);
+    MMSnapPageIndexRelease(pageIndex);
+}
+
+int main(void)
+{
+    MMTRun(testInsertAndDeleteShiftFollowingPages);
+    MMTRun(testMoveKeepsPageAndShiftsTheOthers);
+    MMTRun(testConflictingUpdatesAreRejected);
+    MMTRun(testRandomBatchesMatchReplay);
+    
+    return MMTExitStatus();
+}
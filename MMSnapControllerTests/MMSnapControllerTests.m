@@ -8,6 +8,154 @@
 
 #import <UIKit/UIKit.h>
 #import <XCTest/XCTest.h>
+#import "MMSnapController.h"
+#import "MMSnapFooterView.h"
+#import "MMSnapHeaderView.h"
+#import "MMSnapScrollView.h"
+
+@interface MMSnapControllerTestsDataSource : NSObject <MMSnapScrollViewDataSource>
+
+@property (assign, nonatomic) NSInteger numberOfPages;
+
+@end
+
+@implementation MMSnapControllerTestsDataSource
+
+- (NSInteger)numberOfPagesInScrollView:(MMSnapScrollView *)scrollView
+{
+    return self.numberOfPages;
+}
+
+- (CGFloat)scrollView:(MMSnapScrollView *)scrollView widthForViewAtPage:(NSInteger)page
+{
+    return 320.0f;
+}
+
+- (UIView *)scrollView:(MMSnapScrollView *)scrollView viewAtPage:(NSInteger)page
+{
+    return [[UIView alloc] initWithFrame:CGRectZero];
+}
+
+@end
+
+@interface MMSnapControllerTestsWidthProvidingDataSource : MMSnapControllerTestsDataSource
+
+@property (assign) CGFloat pageWidth;
+
+@end
+
+@implementation MMSnapControllerTestsWidthProvidingDataSource
+
+- (CGFloat)scrollView:(MMSnapScrollView *)scrollView widthForViewAtPage:(NSInteger)page
+{
+    return self.pageWidth;
+}
+
+- (MMSnapScrollViewWidthProvider)widthProviderForScrollView:(MMSnapScrollView *)scrollView
+{
+    const CGFloat pageWidth = self.pageWidth;
+    
+    return ^CGFloat(NSInteger page) {
+        return pageWidth;
+    };
+}
+
+@end
+
+@interface MMSnapControllerTestsPrefetchingDataSource : NSObject <MMSnapScrollViewPrefetchingDataSource>
+
+@property (strong, nonatomic) NSMutableIndexSet *prefetchedPages;
+@property (strong, nonatomic) NSMutableIndexSet *cancelledPages;
+
+@end
+
+@implementation MMSnapControllerTestsPrefetchingDataSource
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _prefetchedPages = [NSMutableIndexSet indexSet];
+        _cancelledPages = [NSMutableIndexSet indexSet];
+    }
+    return self;
+}
+
+- (void)scrollView:(MMSnapScrollView *)scrollView prefetchPages:(NSIndexSet *)pages
+{
+    [self.prefetchedPages addIndexes:pages];
+}
+
+- (void)scrollView:(MMSnapScrollView *)scrollView cancelPrefetchingForPages:(NSIndexSet *)pages
+{
+    [self.cancelledPages addIndexes:pages];
+}
+
+@end
+
+@interface MMSnapControllerTestsAppearanceCountingViewController : UIViewController
+
+@property (assign, nonatomic) NSUInteger appearanceCount;
+@property (assign, nonatomic) NSUInteger disappearanceCount;
+
+@end
+
+@implementation MMSnapControllerTestsAppearanceCountingViewController
+
+- (void)viewWillAppear:(BOOL)animated
+{
+    [super viewWillAppear:animated];
+    self.appearanceCount++;
+}
+
+- (void)viewWillDisappear:(BOOL)animated
+{
+    [super viewWillDisappear:animated];
+    self.disappearanceCount++;
+}
+
+@end
+
+@interface MMSnapControllerTestsViewControllerDataSource : NSObject <MMSnapControllerDataSource>
+
+@property (assign, nonatomic) NSInteger numberOfPages;
+@property (assign, nonatomic) NSUInteger numberOfCreatedViewControllers;
+@property (assign, nonatomic) NSUInteger numberOfDiscardedViewControllers;
+
+@end
+
+@implementation MMSnapControllerTestsViewControllerDataSource
+
+- (NSInteger)numberOfPagesInSnapController:(MMSnapController *)snapController
+{
+    return self.numberOfPages;
+}
+
+- (id)snapController:(MMSnapController *)snapController identifierForPage:(NSInteger)page
+{
+    return [NSString stringWithFormat:@"page-%ld", (long)page];
+}
+
+- (UIViewController *)snapController:(MMSnapController *)snapController viewControllerForIdentifier:(id)identifier
+{
+    self.numberOfCreatedViewControllers++;
+    
+    UIViewController *viewController = [[UIViewController alloc] init];
+    viewController.title = identifier;
+    return viewController;
+}
+
+- (MMViewControllerMetrics)snapController:(MMSnapController *)snapController metricsForIdentifier:(id)identifier
+{
+    return MMViewControllerMetricsFullscreen;
+}
+
+- (void)snapController:(MMSnapController *)snapController didDiscardViewController:(UIViewController *)viewController forIdentifier:(id)identifier
+{
+    self.numberOfDiscardedViewControllers++;
+}
+
+@end
 
 @interface MMSnapControllerTests : XCTestCase
 
@@ -30,10 +178,625 @@
     XCTAssert(YES, @"Pass");
 }
 
-- (void)testPerformanceExample {
-    // This is an example of a performance test case.
+- (void)testPushingAtTheEndQueriesOneWidth {
+    MMSnapControllerTestsDataSource *dataSource = [[MMSnapControllerTestsDataSource alloc] init];
+    dataSource.numberOfPages = 500;
+    
+    MMSnapScrollView *scrollView = [[MMSnapScrollView alloc] initWithFrame:CGRectMake(0, 0, 1024, 768)];
+    scrollView.dataSource = dataSource;
+    
+    [scrollView layoutIfNeeded];
+    XCTAssertEqual(scrollView.numberOfWidthQueriesInLastLayoutPass, 500);
+    
+    dataSource.numberOfPages = 501;
+    [scrollView insertPages:[NSIndexSet indexSetWithIndex:500] animated:NO];
+    XCTAssertEqual(scrollView.numberOfWidthQueriesInLastLayoutPass, 1);
+    
+    [scrollView invalidateLayoutForPages:[NSIndexSet indexSetWithIndex:250]];
+    [scrollView layoutIfNeeded];
+    XCTAssertEqual(scrollView.numberOfWidthQueriesInLastLayoutPass, 1);
+    XCTAssertEqual(scrollView.contentSize.width, 501 * 320.0f);
+}
+
+- (void)testWidthProviderMeasuresHiddenPagesOffTheMainThread {
+    MMSnapControllerTestsWidthProvidingDataSource *dataSource = [[MMSnapControllerTestsWidthProvidingDataSource alloc] init];
+    dataSource.numberOfPages = 500;
+    dataSource.pageWidth = 320.0f;
+    
+    MMSnapScrollView *scrollView = [[MMSnapScrollView alloc] initWithFrame:CGRectMake(0, 0, 1024, 768)];
+    scrollView.dataSource = dataSource;
+    
+    // Pages that were never measured have no previous width to show.
+    [scrollView layoutIfNeeded];
+    XCTAssertEqual(scrollView.numberOfWidthQueriesInLastLayoutPass, 500);
+    
+    // Only the visible pages are measured on the main thread, the others keep their width for now.
+    dataSource.pageWidth = 400.0f;
+    [scrollView invalidateLayout];
+    [scrollView layoutIfNeeded];
+    
+    XCTAssertLessThanOrEqual(scrollView.numberOfWidthQueriesInLastLayoutPass, 4);
+    XCTAssertLessThan(scrollView.contentSize.width, 500 * 400.0f);
+    
+    NSPredicate *predicate = [NSPredicate predicateWithBlock:^BOOL(MMSnapScrollView *evaluatedScrollView, NSDictionary *bindings) {
+        return evaluatedScrollView.contentSize.width == 500 * 400.0f;
+    }];
+    [self expectationForPredicate:predicate evaluatedWithObject:scrollView handler:nil];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+}
+
+- (void)testDeepStacksScrollThroughABoundedContentWindow {
+    MMSnapControllerTestsDataSource *dataSource = [[MMSnapControllerTestsDataSource alloc] init];
+    dataSource.numberOfPages = 100000;
+    
+    MMSnapScrollView *scrollView = [[MMSnapScrollView alloc] initWithFrame:CGRectMake(0, 0, 1024, 768)];
+    scrollView.dataSource = dataSource;
+    scrollView.maximumContentWidth = 32768.0f;
+    [scrollView layoutIfNeeded];
+    
+    XCTAssertEqual(scrollView.contentSize.width, 32768.0f);
+    XCTAssertEqual(scrollView.contentWindowOrigin, 0.0);
+    
+    // Scroll forward 8000 points at a time, the window follows without moving the pages on screen.
+    double globalOffsetX = 0.0;
+    
+    for (NSInteger step = 0; step < 500; step++) {
+        globalOffsetX += 8000.0;
+        
+        [scrollView setContentOffset:CGPointMake(globalOffsetX - scrollView.contentWindowOrigin, 0)];
+        [scrollView layoutIfNeeded];
+        
+        XCTAssertEqual(scrollView.contentSize.width, 32768.0f);
+        XCTAssertEqual(scrollView.contentWindowOrigin + scrollView.contentOffset.x, globalOffsetX);
+        
+        const NSInteger page = (NSInteger)floor(globalOffsetX / 320.0);
+        XCTAssertEqual(scrollView.pagesForVisibleViews.firstIndex, page);
+        XCTAssertEqual(scrollView.contentWindowOrigin + CGRectGetMinX([scrollView viewAtPage:page + 1].frame), (page + 1) * 320.0);
+    }
+    
+    XCTAssertGreaterThan(scrollView.contentWindowOrigin, 0.0);
+    
+    // Without a limit, the content covers every page again.
+    scrollView.maximumContentWidth = 0.0f;
+    [scrollView layoutIfNeeded];
+    XCTAssertEqual(scrollView.contentSize.width, 100000 * 320.0f);
+    XCTAssertEqual(scrollView.contentWindowOrigin, 0.0);
+}
+
+- (void)testMovesKeepViewsAndReloadsMeasureOnlyTheirPages {
+    MMSnapControllerTestsDataSource *dataSource = [[MMSnapControllerTestsDataSource alloc] init];
+    dataSource.numberOfPages = 10000;
+    
+    MMSnapScrollView *scrollView = [[MMSnapScrollView alloc] initWithFrame:CGRectMake(0, 0, 1024, 768)];
+    scrollView.dataSource = dataSource;
+    [scrollView layoutIfNeeded];
+    
+    UIView *firstView = [scrollView viewAtPage:0];
+    UIView *secondView = [scrollView viewAtPage:1];
+    
+    [scrollView movePage:1 toPage:0];
+    [scrollView layoutIfNeeded];
+    XCTAssertEqual([scrollView viewAtPage:0], secondView);
+    XCTAssertEqual([scrollView viewAtPage:1], firstView);
+    XCTAssertEqual(scrollView.numberOfWidthQueriesInLastLayoutPass, 1);
+    
+    [scrollView reloadPages:[NSIndexSet indexSetWithIndex:1] animated:NO];
+    XCTAssertNotEqual([scrollView viewAtPage:1], firstView);
+    XCTAssertEqual([scrollView viewAtPage:0], secondView);
+    XCTAssertEqual(scrollView.numberOfWidthQueriesInLastLayoutPass, 1);
+}
+
+- (void)testVisibleViewLookupsAreConsistentAndCached {
+    MMSnapControllerTestsDataSource *dataSource = [[MMSnapControllerTestsDataSource alloc] init];
+    dataSource.numberOfPages = 100;
+    
+    MMSnapScrollView *scrollView = [[MMSnapScrollView alloc] initWithFrame:CGRectMake(0, 0, 1024, 768)];
+    scrollView.dataSource = dataSource;
+    [scrollView layoutIfNeeded];
+    
+    NSArray *visibleViews = scrollView.visibleViews;
+    XCTAssertEqual(visibleViews.count, scrollView.pagesForVisibleViews.count);
+    XCTAssertEqual(scrollView.visibleViews, visibleViews);
+    
+    [scrollView.pagesForVisibleViews enumerateIndexesUsingBlock:^(NSUInteger page, BOOL *stop) {
+        UIView *view = [scrollView viewAtPage:page];
+        XCTAssertNotNil(view);
+        XCTAssertEqual([scrollView pageForView:view], (NSInteger)page);
+    }];
+    XCTAssertEqual([scrollView pageForView:[[UIView alloc] init]], NSNotFound);
+    
+    [scrollView setContentOffset:CGPointMake(320.0f * 50, 0)];
+    [scrollView layoutIfNeeded];
+    XCTAssertNotEqual(scrollView.visibleViews, visibleViews);
+    XCTAssertEqual(scrollView.pagesForVisibleViews.firstIndex, 50);
+}
+
+- (void)testPrefetchingFollowsTheScrollingDirection {
+    MMSnapControllerTestsDataSource *dataSource = [[MMSnapControllerTestsDataSource alloc] init];
+    dataSource.numberOfPages = 100;
+    
+    MMSnapControllerTestsPrefetchingDataSource *prefetchDataSource = [[MMSnapControllerTestsPrefetchingDataSource alloc] init];
+    
+    MMSnapScrollView *scrollView = [[MMSnapScrollView alloc] initWithFrame:CGRectMake(0, 0, 320, 768)];
+    scrollView.dataSource = dataSource;
+    scrollView.prefetchDataSource = prefetchDataSource;
+    [scrollView layoutIfNeeded];
+    
+    // Before scrolling, a single page is prefetched on each side.
+    XCTAssertEqualObjects(prefetchDataSource.prefetchedPages, [NSIndexSet indexSetWithIndex:1]);
+    XCTAssertEqual(scrollView.numberOfPrefetchMisses, 1);
+    
+    // Scrolling forward prefetches the look-ahead after the visible page, so the next view is a hit.
+    [scrollView setContentOffset:CGPointMake(320.0f, 0)];
+    [scrollView layoutIfNeeded];
+    XCTAssertEqual(scrollView.numberOfPrefetchHits, 1);
+    XCTAssertTrue([prefetchDataSource.prefetchedPages containsIndexesInRange:NSMakeRange(2, 2)]);
+    
+    // Scrolling back cancels the pages ahead.
+    [scrollView setContentOffset:CGPointMake(0, 0)];
+    [scrollView layoutIfNeeded];
+    XCTAssertTrue([prefetchDataSource.cancelledPages containsIndexesInRange:NSMakeRange(2, 2)]);
+}
+
+- (void)testViewsFarFromTheVisiblePagesAreUnloadedAndRestored {
+    NSMutableArray *viewControllers = [NSMutableArray array];
+    for (NSUInteger idx = 0; idx < 10; idx++) {
+        UIViewController *viewController = [[UIViewController alloc] init];
+        viewController.view = [[UIScrollView alloc] init];
+        [viewControllers addObject:viewController];
+    }
+    
+    MMSnapController *snapController = [[MMSnapController alloc] initWithViewControllers:viewControllers];
+    snapController.maximumNumberOfLoadedViews = 3;
+    snapController.numberOfPagesKeptLoadedAroundVisiblePages = 0;
+    snapController.view.frame = CGRectMake(0, 0, 320, 768);
+    
+    UIScrollView *scrollView = (UIScrollView *)snapController.view;
+    [scrollView layoutIfNeeded];
+    
+    UIScrollView *firstView = (UIScrollView *)[viewControllers.firstObject view];
+    firstView.contentOffset = CGPointMake(0, 100);
+    
+    for (NSUInteger page = 1; page < viewControllers.count; page++) {
+        scrollView.contentOffset = CGPointMake(320.0f * page, 0);
+        [scrollView layoutIfNeeded];
+        
+        NSUInteger loadedCount = 0;
+        for (UIViewController *viewController in viewControllers) {
+            loadedCount += viewController.isViewLoaded ? 1 : 0;
+        }
+        XCTAssertLessThanOrEqual(loadedCount, 3);
+        XCTAssertTrue([viewControllers[page] isViewLoaded]);
+    }
+    XCTAssertFalse([viewControllers.firstObject isViewLoaded]);
+    
+    scrollView.contentOffset = CGPointZero;
+    [scrollView layoutIfNeeded];
+    XCTAssertEqual([(UIScrollView *)[viewControllers.firstObject view] contentOffset].y, 100);
+}
+
+static void MMSnapControllerTestsCountViewRequests(MMSnapScrollViewLayoutPhase phase, uint64_t durationInNanoseconds, void *context)
+{
+    if (phase == MMSnapScrollViewLayoutPhaseViewRequest) {
+        (*(NSUInteger *)context)++;
+    }
+}
+
+- (void)testInstrumentationRecordsLayoutPhases {
+    MMSnapControllerTestsDataSource *dataSource = [[MMSnapControllerTestsDataSource alloc] init];
+    dataSource.numberOfPages = 100;
+    
+    MMSnapScrollView *scrollView = [[MMSnapScrollView alloc] initWithFrame:CGRectMake(0, 0, 1024, 768)];
+    scrollView.dataSource = dataSource;
+    XCTAssertNil(scrollView.instrumentationStatistics);
+    
+    NSUInteger viewRequestCount = 0;
+    [scrollView setInstrumentationObserver:MMSnapControllerTestsCountViewRequests context:&viewRequestCount];
+    scrollView.instrumentationEnabled = YES;
+    [scrollView layoutIfNeeded];
+    
+    NSDictionary *statistics = scrollView.instrumentationStatistics;
+    XCTAssertEqual([statistics[@"layoutPass"][@"count"] unsignedIntegerValue], 1);
+    XCTAssertEqual([statistics[@"viewRequest"][@"count"] unsignedIntegerValue], scrollView.visibleViews.count);
+    XCTAssertEqual(viewRequestCount, scrollView.visibleViews.count);
+    XCTAssertGreaterThanOrEqual([statistics[@"layoutPass"][@"maximumDuration"] doubleValue], [statistics[@"visibleRange"][@"maximumDuration"] doubleValue]);
+    
+    dataSource.numberOfPages = 101;
+    [scrollView insertPages:[NSIndexSet indexSetWithIndex:100] animated:NO];
+    XCTAssertEqual([scrollView.instrumentationStatistics[@"updates"][@"count"] unsignedIntegerValue], 1);
+    
+    [scrollView resetInstrumentation];
+    XCTAssertEqual([scrollView.instrumentationStatistics[@"layoutPass"][@"count"] unsignedIntegerValue], 0);
+    
+    scrollView.instrumentationEnabled = NO;
+    XCTAssertNil(scrollView.instrumentationStatistics);
+}
+
+- (void)testOnlyChangedSeparatorsAreUpdated {
+    MMSnapControllerTestsDataSource *dataSource = [[MMSnapControllerTestsDataSource alloc] init];
+    dataSource.numberOfPages = 20;
+    
+    MMSnapScrollView *scrollView = [[MMSnapScrollView alloc] initWithFrame:CGRectMake(0, 0, 640, 768)];
+    scrollView.pagingEnabled = NO;
+    scrollView.dataSource = dataSource;
+    [scrollView layoutIfNeeded];
+    
+    XCTAssertEqual(scrollView.numberOfSeparatorUpdatesInLastLayoutPass, 2);
+    
+    // Laying out again without changes leaves the separators alone.
+    [scrollView setNeedsLayout];
+    [scrollView layoutIfNeeded];
+    XCTAssertEqual(scrollView.numberOfSeparatorUpdatesInLastLayoutPass, 0);
+    
+    // Scrolling within the first page only updates the separator of the page disappearing behind the content offset.
+    [scrollView setContentOffset:CGPointMake(10, 0)];
+    [scrollView layoutIfNeeded];
+    [scrollView setContentOffset:CGPointMake(20, 0)];
+    [scrollView layoutIfNeeded];
+    XCTAssertEqual(scrollView.numberOfSeparatorUpdatesInLastLayoutPass, 1);
+    
+    // Switching to paging changes the appearance of every visible separator.
+    scrollView.pagingEnabled = YES;
+    [scrollView layoutIfNeeded];
+    XCTAssertEqual(scrollView.numberOfSeparatorUpdatesInLastLayoutPass, 3);
+    XCTAssertGreaterThan(scrollView.numberOfLayoutPasses, 0);
+}
+
+- (void)testHeadersShareTextMeasurements {
+    MMSnapHeaderView *headerView = [[MMSnapHeaderView alloc] initWithFrame:CGRectMake(0, 0, 320, 44)];
+    headerView.title = @"Measured Once";
+    [headerView layoutIfNeeded];
+    
+    const double hitRate = [MMSnapHeaderView textMeasurementCacheHitRate];
+    
+    // A second header with the same title and width reuses the sizes measured by the first one.
+    MMSnapHeaderView *otherHeaderView = [[MMSnapHeaderView alloc] initWithFrame:CGRectMake(0, 0, 320, 44)];
+    otherHeaderView.title = @"Measured Once";
+    [otherHeaderView layoutIfNeeded];
+    
+    XCTAssertGreaterThan([MMSnapHeaderView textMeasurementCacheHitRate], hitRate);
+    
+    // Changing the title invalidates its measurement.
+    UILabel *titleLabel = [otherHeaderView valueForKey:@"titleLabel"];
+    const CGFloat titleWidth = CGRectGetWidth(titleLabel.frame);
+    
+    otherHeaderView.title = @"A Much Longer Title";
+    [otherHeaderView layoutIfNeeded];
+    XCTAssertGreaterThan(CGRectGetWidth(titleLabel.frame), titleWidth);
+}
+
+- (void)testFooterHidesItemsThatDontFit {
+    UIView *firstView = [[UIView alloc] initWithFrame:CGRectZero];
+    UIView *secondView = [[UIView alloc] initWithFrame:CGRectZero];
+    
+    MMSnapFooterSpace *flexibleSpace = [[MMSnapFooterSpace alloc] init];
+    flexibleSpace.width = MMSnapFooterFlexibleWidth;
+    
+    MMSnapFooterSpace *fixedSpace = [[MMSnapFooterSpace alloc] init];
+    fixedSpace.width = 200.0f;
+    
+    MMSnapFooterView *footerView = [[MMSnapFooterView alloc] initWithFrame:CGRectMake(0, 0, 320, 44)];
+    footerView.items = @[ firstView, flexibleSpace, secondView ];
+    [footerView layoutIfNeeded];
+    
+    XCTAssertFalse(firstView.hidden);
+    XCTAssertFalse(secondView.hidden);
+    XCTAssertEqualWithAccuracy(CGRectGetMinX(secondView.frame), 312.0f, 0.5f);
+    
+    // Widening a space takes effect without new items, and truncates the views after it.
+    flexibleSpace.width = 300.0f;
+    [footerView setNeedsLayout];
+    [footerView layoutIfNeeded];
+    
+    XCTAssertFalse(firstView.hidden);
+    XCTAssertTrue(secondView.hidden);
+    
+    // Widening the footer brings them back.
+    footerView.frame = CGRectMake(0, 0, 1024, 44);
+    [footerView layoutIfNeeded];
+    
+    XCTAssertFalse(secondView.hidden);
+    
+    footerView.items = @[ fixedSpace, fixedSpace, secondView ];
+    [footerView layoutIfNeeded];
+    XCTAssertEqualWithAccuracy(CGRectGetMinX(secondView.frame), 424.0f, 0.5f);
+}
+
+- (void)testSupplementaryViewsOfPoppedViewControllersAreReused {
+    UIViewController *rootViewController = [[UIViewController alloc] init];
+    UIViewController *poppedViewController = [[UIViewController alloc] init];
+    
+    MMSnapController *snapController = [[MMSnapController alloc] initWithViewControllers:@[ rootViewController, poppedViewController ]];
+    snapController.view.frame = CGRectMake(0, 0, 1024, 768);
+    [snapController.view layoutIfNeeded];
+    
+    MMSnapHeaderView *headerView = (MMSnapHeaderView *)[snapController headerViewForViewController:poppedViewController];
+    headerView.title = @"Popped";
+    XCTAssertEqual([snapController headerViewForViewController:poppedViewController], headerView);
+    
+    [snapController popViewControllerAnimated:NO];
+    XCTAssertNil([snapController headerViewForViewController:poppedViewController]);
+    
+    // The next view controller gets the same header, without the state of the previous one.
+    UIViewController *pushedViewController = [[UIViewController alloc] init];
+    [snapController pushViewController:pushedViewController animated:NO];
+    
+    MMSnapHeaderView *reusedHeaderView = (MMSnapHeaderView *)[snapController headerViewForViewController:pushedViewController];
+    XCTAssertEqual(reusedHeaderView, headerView);
+    XCTAssertEqual(reusedHeaderView.viewController, pushedViewController);
+    XCTAssertNil(reusedHeaderView.title);
+}
+
+- (void)testStackChangesAreCommittedInASingleTransaction {
+    MMSnapController *snapController = [[MMSnapController alloc] initWithRootViewController:[[UIViewController alloc] init]];
+    snapController.view.frame = CGRectMake(0, 0, 1024, 768);
+    [snapController.view layoutIfNeeded];
+    
+    MMSnapScrollView *scrollView = (MMSnapScrollView *)snapController.view;
+    
+    // Pushes are only applied to the pages on the next layout pass, all at once.
+    for (NSUInteger idx = 0; idx < 3; idx++) {
+        [snapController pushViewController:[[UIViewController alloc] init] animated:NO];
+    }
+    XCTAssertEqual(snapController.viewControllers.count, 4);
+    XCTAssertEqual(scrollView.numberOfPages, 1);
+    
+    [snapController.view layoutIfNeeded];
+    XCTAssertEqual(scrollView.numberOfPages, 4);
+    XCTAssertEqual(snapController.numberOfLayoutValidationsInLastTransaction, 1);
+    
+    // Popping and pushing in the same run loop turn replaces the page in a single update too.
+    UIViewController *pushedViewController = [[UIViewController alloc] init];
+    [snapController popViewControllerAnimated:NO];
+    [snapController pushViewController:pushedViewController animated:NO];
+    
+    [snapController.view layoutIfNeeded];
+    XCTAssertEqual(scrollView.numberOfPages, 4);
+    XCTAssertEqual(snapController.viewControllers.lastObject, pushedViewController);
+    XCTAssertEqual(snapController.numberOfLayoutValidationsInLastTransaction, 1);
+}
+
+- (void)testCoalescedAppearanceCallbacksAreDeliveredAfterTheLayoutPass {
+    MMSnapControllerTestsAppearanceCountingViewController *rootViewController = [[MMSnapControllerTestsAppearanceCountingViewController alloc] init];
+    
+    MMSnapController *snapController = [[MMSnapController alloc] initWithRootViewController:rootViewController];
+    snapController.appearanceCoalescingInterval = 0.1;
+    snapController.view.frame = CGRectMake(0, 0, 1024, 768);
+    
+    // Nothing is scrolling, so the callbacks are delivered after the first layout pass.
+    [snapController.view layoutIfNeeded];
+    XCTAssertEqual(rootViewController.appearanceCount, 1);
+    
+    // Replacing the stack makes the old root disappear once, and the new one appear once.
+    MMSnapControllerTestsAppearanceCountingViewController *viewController = [[MMSnapControllerTestsAppearanceCountingViewController alloc] init];
+    snapController.viewControllers = @[ viewController ];
+    [snapController.view layoutIfNeeded];
+    
+    XCTAssertEqual(rootViewController.disappearanceCount, 1);
+    XCTAssertEqual(viewController.appearanceCount, 1);
+    
+    // Turning coalescing off doesn't replay anything.
+    snapController.appearanceCoalescingInterval = 0.0;
+    XCTAssertEqual(viewController.appearanceCount, 1);
+    XCTAssertEqual(viewController.disappearanceCount, 0);
+}
+
+- (void)testLayoutSnapshotLaysOutTheFirstFrameWithoutMeasuring {
+    MMSnapControllerTestsDataSource *dataSource = [[MMSnapControllerTestsDataSource alloc] init];
+    dataSource.numberOfPages = 100;
+    
+    MMSnapScrollView *scrollView = [[MMSnapScrollView alloc] initWithFrame:CGRectMake(0, 0, 1024, 768)];
+    scrollView.dataSource = dataSource;
+    [scrollView layoutIfNeeded];
+    XCTAssertEqual(scrollView.numberOfWidthQueriesInLastLayoutPass, 100);
+    
+    [scrollView setContentOffset:CGPointMake(3200, 0)];
+    [scrollView layoutIfNeeded];
+    
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"MMSnapControllerTests.layout"];
+    XCTAssertTrue([scrollView writeLayoutSnapshotToFile:path traits:1]);
+    
+    MMSnapScrollView *restoredScrollView = [[MMSnapScrollView alloc] initWithFrame:CGRectMake(0, 0, 1024, 768)];
+    restoredScrollView.dataSource = dataSource;
+    
+    // Snapshots taken for other traits are ignored.
+    XCTAssertFalse([restoredScrollView restoreLayoutFromSnapshotFile:path traits:2]);
+    XCTAssertTrue([restoredScrollView restoreLayoutFromSnapshotFile:path traits:1]);
+    
+    [restoredScrollView layoutIfNeeded];
+    XCTAssertEqual(restoredScrollView.numberOfWidthQueriesInLastLayoutPass, 0);
+    XCTAssertEqual(restoredScrollView.pagesForVisibleViews.firstIndex, 10);
+    
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+}
+
+- (void)testSafeAreaInsetsAreOnlyPropagatedWhenPagesChange {
+    MMSnapController *snapController = [[MMSnapController alloc] initWithRootViewController:[[UIViewController alloc] init]];
+    snapController.view.frame = CGRectMake(0, 0, 1024, 768);
+    [snapController.view layoutIfNeeded];
+    
+    // The first pass propagates to the page that appeared.
+    const NSUInteger propagationsPerSecond = snapController.safeAreaPropagationsPerSecond;
+    XCTAssertEqual(propagationsPerSecond, 1);
+    
+    // Layout passes that don't move any page across the edges don't propagate anything.
+    for (NSUInteger idx = 0; idx < 10; idx++) {
+        [snapController.view setNeedsLayout];
+        [snapController.view layoutIfNeeded];
+    }
+    XCTAssertEqual(snapController.safeAreaPropagationsPerSecond, propagationsPerSecond);
+    
+    // A pushed page appearing is propagated to.
+    [snapController pushViewController:[[UIViewController alloc] init] animated:NO];
+    [snapController.view layoutIfNeeded];
+    XCTAssertEqual(snapController.safeAreaPropagationsPerSecond, propagationsPerSecond + 1);
+}
+
+- (void)testDisappearingPagesAreSwappedForTheirSnapshot {
+    MMSnapControllerTestsDataSource *dataSource = [[MMSnapControllerTestsDataSource alloc] init];
+    dataSource.numberOfPages = 10;
+    
+    MMSnapScrollView *scrollView = [[MMSnapScrollView alloc] initWithFrame:CGRectMake(0, 0, 1024, 768)];
+    scrollView.dataSource = dataSource;
+    scrollView.rasterizesDisappearingPages = YES;
+    [scrollView layoutIfNeeded];
+    
+    UIView *view = [scrollView viewAtPage:0];
+    XCTAssertFalse(view.hidden);
+    
+    // Half covered by the next page.
+    [scrollView setContentOffset:CGPointMake(160, 0)];
+    [scrollView layoutIfNeeded];
+    XCTAssertTrue(view.hidden);
+    
+    // Content changes bring the live view back until the next layout pass.
+    [scrollView invalidateRasterizationForView:view];
+    XCTAssertFalse(view.hidden);
+    [scrollView layoutIfNeeded];
+    XCTAssertTrue(view.hidden);
+    
+    // Re-emerging.
+    [scrollView setContentOffset:CGPointZero];
+    [scrollView layoutIfNeeded];
+    XCTAssertFalse(view.hidden);
+    
+    scrollView.rasterizesDisappearingPages = NO;
+    [scrollView setContentOffset:CGPointMake(160, 0)];
+    [scrollView layoutIfNeeded];
+    XCTAssertFalse(view.hidden);
+}
+
+- (void)testRecordingATrace {
+    MMSnapControllerTestsDataSource *dataSource = [[MMSnapControllerTestsDataSource alloc] init];
+    dataSource.numberOfPages = 10;
+    
+    MMSnapScrollView *scrollView = [[MMSnapScrollView alloc] initWithFrame:CGRectMake(0, 0, 1024, 768)];
+    scrollView.dataSource = dataSource;
+    [scrollView layoutIfNeeded];
+    
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"testRecordingATrace.mmtrace"];
+    XCTAssertTrue([scrollView startRecordingTraceToFile:path]);
+    XCTAssertTrue(scrollView.isRecordingTrace);
+    
+    for (NSUInteger frame = 0; frame < 10; frame++) {
+        [scrollView setContentOffset:CGPointMake(frame * 64.0f, 0)];
+        [scrollView layoutIfNeeded];
+    }
+    
+    dataSource.numberOfPages = 11;
+    [scrollView insertPages:[NSIndexSet indexSetWithIndex:0] animated:NO];
+    [scrollView recordTraceMarker:MMSnapScrollViewTraceMarkerPush page:10];
+    
+    [scrollView stopRecordingTrace];
+    XCTAssertFalse(scrollView.isRecordingTrace);
+    
+    // A header, then the start, the bounds, the widths, the layout passes, the insert, the update and the marker.
+    NSData *trace = [NSData dataWithContentsOfFile:path];
+    XCTAssertEqual(memcmp(trace.bytes, "MMST", 4), 0);
+    XCTAssertGreaterThanOrEqual(trace.length, 16 + (2 + 10 + 3) * 40);
+    XCTAssertEqual((trace.length - 16) % 40, 0);
+    
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+    
+    XCTAssertFalse([scrollView startRecordingTraceToFile:@"/nonexistent/testRecordingATrace.mmtrace"]);
+}
+
+- (void)testViewControllersAreOnlyCreatedAroundTheVisiblePages {
+    MMSnapControllerTestsViewControllerDataSource *dataSource = [[MMSnapControllerTestsViewControllerDataSource alloc] init];
+    dataSource.numberOfPages = 1000;
+    
+    MMSnapController *snapController = [[MMSnapController alloc] init];
+    snapController.dataSource = dataSource;
+    snapController.discardsDistantViewControllers = YES;
+    snapController.numberOfPagesKeptLoadedAroundVisiblePages = 1;
+    snapController.view.frame = CGRectMake(0, 0, 320, 768);
+    
+    UIScrollView *scrollView = (UIScrollView *)snapController.view;
+    [scrollView layoutIfNeeded];
+    
+    // Every page is measured, but only the first ones have a view controller.
+    XCTAssertEqual(scrollView.contentSize.width, 320.0f * 1000);
+    XCTAssertEqualObjects([snapController.visibleViewControllers.firstObject title], @"page-0");
+    XCTAssertLessThanOrEqual(dataSource.numberOfCreatedViewControllers, 10);
+    
+    for (NSUInteger page = 1; page <= 30; page++) {
+        scrollView.contentOffset = CGPointMake(320.0f * page, 0);
+        [scrollView layoutIfNeeded];
+    }
+    
+    // The view controllers of the pages left behind were discarded.
+    XCTAssertGreaterThanOrEqual(dataSource.numberOfCreatedViewControllers, 31);
+    XCTAssertGreaterThan(dataSource.numberOfDiscardedViewControllers, 0);
+    XCTAssertLessThanOrEqual(snapController.childViewControllers.count, 10);
+    XCTAssertEqual(snapController.viewControllers.count, snapController.childViewControllers.count);
+    XCTAssertEqualObjects([snapController.visibleViewControllers.firstObject title], @"page-30");
+    
+    // Pages come back with a new view controller.
+    XCTAssertEqualObjects([[snapController viewControllerAtPage:0] title], @"page-0");
+    XCTAssertNil([snapController viewControllerAtPage:1000]);
+    
+    // Pushing and popping still work, popping pages that never had a view controller returns nothing.
+    UIViewController *pushedViewController = [[UIViewController alloc] init];
+    [snapController pushViewController:pushedViewController animated:NO];
+    [scrollView layoutIfNeeded];
+    XCTAssertEqual([snapController viewControllerAtPage:1000], pushedViewController);
+    
+    XCTAssertEqual([snapController popViewControllerAnimated:NO], pushedViewController);
+    XCTAssertNil([snapController popViewControllerAnimated:NO]);
+    [scrollView layoutIfNeeded];
+    XCTAssertEqual(scrollView.contentSize.width, 320.0f * 999);
+    
+    // Reloading keeps the view controllers of the pages still there.
+    UIViewController *visibleViewController = snapController.visibleViewControllers.firstObject;
+    const NSUInteger createdCount = dataSource.numberOfCreatedViewControllers;
+    [snapController reloadData];
+    [scrollView layoutIfNeeded];
+    XCTAssertEqual(snapController.visibleViewControllers.firstObject, visibleViewController);
+    XCTAssertEqual(dataSource.numberOfCreatedViewControllers, createdCount);
+    XCTAssertEqual(scrollView.contentSize.width, 320.0f * 1000);
+}
+
+- (void)testScrollingThroughManyPagesPerformance {
+    MMSnapControllerTestsDataSource *dataSource = [[MMSnapControllerTestsDataSource alloc] init];
+    dataSource.numberOfPages = 10000;
+    
+    MMSnapScrollView *scrollView = [[MMSnapScrollView alloc] initWithFrame:CGRectMake(0, 0, 1024, 768)];
+    scrollView.dataSource = dataSource;
+    [scrollView layoutIfNeeded];
+    
+    // Drag across the first pages, then jump through the rest, laying out once per frame.
+    [self measureBlock:^{
+        for (NSUInteger frame = 0; frame < 600; frame++) {
+            const CGFloat offset = (frame < 300) ? frame * 24.0f : (frame * 7919 % 9997) * 320.0f;
+            [scrollView setContentOffset:CGPointMake(offset, 0)];
+            [scrollView layoutIfNeeded];
+        }
+        [scrollView setContentOffset:CGPointZero];
+        [scrollView layoutIfNeeded];
+    }];
+}
+
+- (void)testBatchUpdatesPerformance {
+    MMSnapControllerTestsDataSource *dataSource = [[MMSnapControllerTestsDataSource alloc] init];
+    dataSource.numberOfPages = 10000;
+    
+    MMSnapScrollView *scrollView = [[MMSnapScrollView alloc] initWithFrame:CGRectMake(0, 0, 1024, 768)];
+    scrollView.dataSource = dataSource;
+    [scrollView layoutIfNeeded];
+    
+    NSMutableIndexSet *pages = [NSMutableIndexSet indexSet];
+    for (NSUInteger page = 0; page < 10000; page += 100) {
+        [pages addIndex:page];
+    }
+    
+    // Replaces a hundred scattered pages per batch, keeping the number of pages.
     [self measureBlock:^{
-        // Put the code you want to measure the time of here.
+        for (NSUInteger idx = 0; idx < 10; idx++) {
+            [scrollView performBatchUpdates:^{
+                [scrollView deletePages:pages animated:NO];
+                [scrollView insertPages:pages animated:NO];
+            } completion:nil];
+        }
     }];
 }
 